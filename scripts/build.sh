@@ -0,0 +1,25 @@
+#!/bin/sh
+# Headless and capture replay builds against the null and software render backends, see
+# src/game/linux_headless.cpp and src/game/linux_replay.cpp
+#   ./build.sh [release]
+
+cd "$(dirname "$0")"
+
+CompilerFlags="-std=c++11 -g -msse4.1 -fno-rtti -fno-exceptions -fno-strict-aliasing -Wall -Werror -Wno-unused-function -Wno-unused-variable -Wno-unused-but-set-variable -Wno-write-strings -Wno-missing-braces -Wno-endif-labels -Wno-parentheses"
+Defs="-DINTERNAL=1"
+Opt="-O0"
+
+if [ "$1" = "release" ]; then
+	Defs=""
+	Opt="-O2"
+fi
+
+mkdir -p ../build
+echo "Compiling headless"
+g++ $CompilerFlags $Opt $Defs ../src/game/linux_headless.cpp -o ../build/headless -lpthread
+echo "Compiling headless_software"
+g++ $CompilerFlags $Opt $Defs -DRENDERER_SOFTWARE ../src/game/linux_headless.cpp -o ../build/headless_software -lpthread
+echo "Compiling replay"
+g++ $CompilerFlags $Opt $Defs ../src/game/linux_replay.cpp -o ../build/replay -lpthread
+echo "Compiling replay_software"
+g++ $CompilerFlags $Opt $Defs -DRENDERER_SOFTWARE ../src/game/linux_replay.cpp -o ../build/replay_software -lpthread
@@ -1,8 +1,8 @@
 static TextureData*
-LoadTextureData(TextureFormat* tf, GameAssets* assets) {
+LoadTextureData(TextureFormat* tf, AssetPack* pack, GameAssets* assets) {
 	TextureData* result = PushStruct(assets->permanent_arena, TextureData);
 
-	result->pixels = assets->data + tf->offset_to_data;
+	result->pixels = pack->data + tf->offset_to_data;
 	result->width = tf->width;
 	result->height = tf->height;
 	result->num_components = tf->num_components;
@@ -46,11 +46,13 @@ static MeshAssetInfo*
 LoadMeshAsset(char* name, GameAssets* assets) {
 	MeshAssetInfo* mesh_info = PushMeshAssetInfo(assets);
 
-	MeshFormat* mf = GetMeshFormat(name, assets); 
-	MeshData* md = LoadMeshData(mf, assets);
+	AssetIndexEntry* entry = GetAssetIndexEntry(ASSET_BLOB_MESHES, name, assets);
+	MeshFormat* mf = (MeshFormat*)entry->format;
+	MeshData* md = LoadMeshData(mf, entry->pack, assets);
 
 	mesh_info->name = mf->name;
 	mesh_info->data = md;
+	mesh_info->bounds = LoadMeshBounds(mf, entry->pack, assets);
 
 	return mesh_info;
 }
@@ -59,8 +61,9 @@ static TextureAssetInfo*
 LoadTextureAsset(char* name, GameAssets* assets) {
 	TextureAssetInfo* texture_info = PushTextureAssetInfo(assets);
 
-	TextureFormat* tf = GetTextureFormat(name, assets); 
-	TextureData* td = LoadTextureData(tf, assets);
+	AssetIndexEntry* entry = GetAssetIndexEntry(ASSET_BLOB_TEXTURES, name, assets);
+	TextureFormat* tf = (TextureFormat*)entry->format;
+	TextureData* td = LoadTextureData(tf, entry->pack, assets);
 
 	texture_info->name = tf->name;
 	texture_info->data = td;
@@ -70,31 +73,34 @@ LoadTextureAsset(char* name, GameAssets* assets) {
 
 static void
 LoadAllTextureAssets(GameAssets* assets) {
-	u32 count = 0;
-	TextureFormat* tf_array = GetAllTextureFormats(assets, &count);
+	AssetIndex* index = assets->index + ASSET_BLOB_TEXTURES;
 
 	TextureAssetInfo* texture_info;
 	TextureFormat* texture_format;
-	for(u32 i=0; i<count; i++) {
+	for(u32 i=0; i<index->capacity; i++) {
+		AssetIndexEntry* entry = index->entries + i;
+		if(!entry->name) continue;
 		texture_info = PushTextureAssetInfo(assets);
-		texture_format = tf_array+i;
+		texture_format = (TextureFormat*)entry->format;
 		texture_info->name = texture_format->name;
-		texture_info->data = LoadTextureData(texture_format, assets);
+		texture_info->data = LoadTextureData(texture_format, entry->pack, assets);
 	}
 }
 
 static void
 LoadAllMeshAssets(GameAssets* assets) {
-	u32 count = 0;
-	MeshFormat* mf_array = GetAllMeshFormats(assets, &count);
+	AssetIndex* index = assets->index + ASSET_BLOB_MESHES;
 
 	MeshAssetInfo* mesh_info;
 	MeshFormat* mesh_format;
-	for(u32 i=0; i<count; i++) {
+	for(u32 i=0; i<index->capacity; i++) {
+		AssetIndexEntry* entry = index->entries + i;
+		if(!entry->name) continue;
 		mesh_info = PushMeshAssetInfo(assets);
-		mesh_format = mf_array+i;
+		mesh_format = (MeshFormat*)entry->format;
 		mesh_info->name = mesh_format->name;
-		mesh_info->data = LoadMeshData(mesh_format, assets);
+		mesh_info->data = LoadMeshData(mesh_format, entry->pack, assets);
+		mesh_info->bounds = LoadMeshBounds(mesh_format, entry->pack, assets);
 	}
 }
 
@@ -131,7 +137,7 @@ UploadAllTextureAssets(GameAssets* assets, Renderer* renderer) {
 	if(info) {
 		while(info) {
 			info->buffer = UploadTexture(info->data->pixels, info->data->width,
-					info->data->height, info->data->num_components, false, false, renderer);
+					info->data->height, info->data->num_components, TEXTURE_USAGE_Immutable, renderer);
 			info = info->next;
 		}
 	}
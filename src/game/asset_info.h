@@ -6,10 +6,33 @@ struct TextureAssetInfo {
 	TextureAssetInfo* next;
 };
 
+// Mesh space, precomputed by the asset packer
+struct MeshBounds {
+	Vec3 min;
+	Vec3 max;
+	Vec3 half_size;
+
+	Vec3 sphere_center;
+	float sphere_radius;
+
+	Vec3* hull;		// points straight into the pack
+	u32 hull_count;
+};
+
 struct MeshAssetInfo {
 	MeshData* data;
+	MeshBounds* bounds;
 	Mesh* mesh;
 	char* name;
 
 	MeshAssetInfo* next;
 };
+
+struct FontAssetInfo {
+	char* name;
+	void* ttf;
+
+	FontAtlasFormat* atlases;	// points straight into the pack
+	u8* pack_data;				// atlas offsets are relative to this
+	u32 atlas_count;
+};
@@ -1,173 +1,254 @@
 #include "asset_info.h"
 
+#define MAX_ASSET_PACKS 8
+
+// Packs are mounted in order, later packs override same named assets of earlier ones.
+// Only the base pack is required to exist.
+char* asset_pack_names[] = {
+	"data.gaf",
+	"dlc.gaf",
+};
+
+struct AssetPack {
+	PlatformFileMapping file;
+	u8* data;
+	u64 size;
+	u64 offsets[ASSET_BLOB_TOTAL];
+};
+
+struct AssetIndexEntry {
+	char* name;
+	void* format;
+	AssetPack* pack;
+};
+
+// Open addressed on name, one per blob type, merged across all mounted packs
+struct AssetIndex {
+	AssetIndexEntry* entries;
+	u32 capacity;
+	u32 count;
+};
+
 struct GameAssets {
 	MemoryArena* permanent_arena;
-	u32 offsets[ASSET_BLOB_TOTAL];
 
-	u8* data;
-	u32 size;
+	AssetPack packs[MAX_ASSET_PACKS];
+	u32 pack_count;
+
+	AssetIndex index[ASSET_BLOB_TOTAL];
 
 	TextureAssetInfo* texture_assets;
 	MeshAssetInfo* mesh_assets;
 };
 
-static void*
-GetAssetBlob(ASSET_BLOB blob, GameAssets* assets) {
-	return assets->data + assets->offsets[blob];
+static u32
+HashAssetName(char* name) {
+	u32 hash = 2166136261;
+	while(*name) {
+		hash ^= (u8)*name++;
+		hash *= 16777619;
+	}
+	return hash;
 }
 
-static GameAssets* 
-LoadGameAssets(MemoryArena* arena) {
-	GameAssets* ga = {};
+static AssetIndexEntry*
+FindAssetIndexSlot(AssetIndex* index, char* name) {
+	u32 mask = index->capacity - 1;
+	u32 slot = HashAssetName(name) & mask;
+	while(index->entries[slot].name && !StringCompare(index->entries[slot].name, name))
+		slot = (slot + 1) & mask;
+	return index->entries + slot;
+}
 
-	PlatformFileInfo info;
-	u8 name[] = "data.gaf";
-	info.name = name;
-	PlatformFileHandle handle = platform_api.open_file(&info);
-	Assert(!handle.failed);
+static void
+GrowAssetIndex(AssetIndex* index, u32 min_count, MemoryArena* arena) {
+	u32 capacity = index->capacity ? index->capacity : 64;
+	while(capacity*3 < min_count*4) capacity *= 2;
+	if(capacity == index->capacity) return;
+
+	AssetIndex grown = {};
+	grown.capacity = capacity;
+	grown.entries = PushArrayClear(arena, AssetIndexEntry, capacity);
+
+	for(u32 i=0; i<index->capacity; i++) {
+		AssetIndexEntry* entry = index->entries + i;
+		if(entry->name) {
+			*FindAssetIndexSlot(&grown, entry->name) = *entry;
+			grown.count++;
+		}
+	}
 
-	ga = PushStruct(arena, GameAssets);
-	ga->permanent_arena = arena;
+	*index = grown;
+}
 
-	u8* memblock = (u8*)PushSize(arena, info.size);
-	ga->data = memblock; 
-	ga->size = info.size;
+static void
+AddAssetIndexEntry(AssetIndex* index, char* name, void* format, AssetPack* pack) {
+	AssetIndexEntry* entry = FindAssetIndexSlot(index, name);
+	if(!entry->name) index->count++;
 
-	platform_api.read_file(&handle, info.size, ga->data);
-	GameAssetFile* gaf = (GameAssetFile*)ga->data;
-	Assert(StringCompare(gaf->identification, "gaff"));
+	entry->name = name;
+	entry->format = format;
+	entry->pack = pack;
+}
 
-	Directory* dir = (Directory*)(ga->data + gaf->offset_to_blob_directories);
-	for(u8 i=0; i<gaf->number_of_blobs; i++) 
-		for(u8 j=0; j<ASSET_BLOB_TOTAL; j++) 
-			if(StringCompare(blob_names[j], dir[i].name_of_blob))
-				ga->offsets[j] = dir[i].offset_to_blob;
+static AssetIndexEntry*
+GetAssetIndexEntry(ASSET_BLOB blob, char* name, GameAssets* ga) {
+	Assert(name);
+	AssetIndex* index = ga->index + blob;
+	Assert(index->capacity);
 
-	return ga;
+	AssetIndexEntry* entry = FindAssetIndexSlot(index, name);
+	Assert(entry->name);
+
+	return entry;
 }
 
-VertexBufferData 
-MakeVertexBufferData(VertexBufferFormat* vbf, GameAssets* ga) {
-	VertexBufferData vbd = {};
+// Only the header, directory and format tables are touched, payload pages stay on disk until used
+static bool
+MountAssetPack(char* name, GameAssets* ga) {
+	Assert(ga->pack_count < MAX_ASSET_PACKS);
 
-	for(u8 i=0; i<VERTEX_BUFFER_TOTAL; i++) {
-		if(StringCompare(vbf->type, vertex_buffer_names[i])) {
-			vbd.type = (VERTEX_BUFFER)i;
-			break;
-		}
+	PlatformFileInfo info = {};
+	info.name = name;
+	PlatformFileMapping file = platform_api.map_file(&info);
+	if(file.failed) return false;
+
+	// A stale or foreign pack would have its offsets read with the wrong layout, so it is refused
+	GameAssetFile* gaf = (GameAssetFile*)file.data;
+	bool valid = file.size >= sizeof(GameAssetFile) &&
+		!gaf->identification[sizeof(gaf->identification) - 1] && StringCompare(gaf->identification, "gaff") &&
+		gaf->version == GAF_VERSION &&
+		gaf->offset_to_blob_directories <= file.size &&
+		gaf->number_of_blobs <= (file.size - gaf->offset_to_blob_directories)/sizeof(Directory);
+
+	for(u32 i=0; valid && i<gaf->number_of_blobs; i++) {
+		Directory* entry = (Directory*)(file.data + gaf->offset_to_blob_directories) + i;
+		valid = entry->offset_to_blob < file.size;
 	}
 
-	vbd.data = (float*)(ga->data + vbf->offset_to_data);
+	if(!valid) {
+		platform_api.unmap_file(&file);
+		return false;
+	}
 
-	return vbd;
-}
+	AssetPack* pack = ga->packs + ga->pack_count++;
+	pack->file = file;
+	pack->data = file.data;
+	pack->size = file.size;
 
-static MeshFormat*
-GetMeshFormat(char* name, GameAssets* ga) {
-	MeshFormat* result = 0;
+	Directory* dir = (Directory*)(pack->data + gaf->offset_to_blob_directories);
+	for(u32 i=0; i<gaf->number_of_blobs; i++)
+		for(u8 j=0; j<ASSET_BLOB_TOTAL; j++)
+			if(StringCompare(blob_names[j], dir[i].name_of_blob))
+				pack->offsets[j] = dir[i].offset_to_blob;
 
-	MeshesBlob* mb = (MeshesBlob*)(ga->data + ga->offsets[ASSET_BLOB_MESHES]);
-	MeshFormat* mf_arr = (MeshFormat*)(ga->data + mb->offset_to_mesh_formats);
+	if(pack->offsets[ASSET_BLOB_MESHES]) {
+		MeshesBlob* mb = (MeshesBlob*)(pack->data + pack->offsets[ASSET_BLOB_MESHES]);
+		MeshFormat* mf_arr = (MeshFormat*)(pack->data + mb->offset_to_mesh_formats);
 
-	u32 i=0;
-	while(!StringCompare(mf_arr[i].name, name)) i++;
-	result = mf_arr + i;
+		AssetIndex* index = ga->index + ASSET_BLOB_MESHES;
+		GrowAssetIndex(index, index->count + mb->meshes_count, ga->permanent_arena);
+		for(u32 i=0; i<mb->meshes_count; i++)
+			AddAssetIndexEntry(index, mf_arr[i].name, mf_arr + i, pack);
+	}
 
-	return result;
-}
+	if(pack->offsets[ASSET_BLOB_TEXTURES]) {
+		TexturesBlob* tb = (TexturesBlob*)(pack->data + pack->offsets[ASSET_BLOB_TEXTURES]);
+		TextureFormat* tf_arr = (TextureFormat*)(pack->data + tb->offset_to_texture_formats);
 
-MeshData* 
-LoadMeshData(MeshFormat* mf, GameAssets* ga) {
-	MeshData* md = PushStruct(ga->permanent_arena, MeshData);
+		AssetIndex* index = ga->index + ASSET_BLOB_TEXTURES;
+		GrowAssetIndex(index, index->count + tb->textures_count, ga->permanent_arena);
+		for(u32 i=0; i<tb->textures_count; i++)
+			AddAssetIndexEntry(index, tf_arr[i].name, tf_arr + i, pack);
+	}
 
-	md->vertices_count = mf->vertices_count;
-	md->indices_count = mf->indices_count;
-	md->vb_data_count = mf->vertex_buffer_count;
-	md->indices = (u32*)(ga->data + mf->offset_to_indices);
-	md->vb_data = PushArray(ga->permanent_arena, VertexBufferData, mf->vertex_buffer_count);
+	if(pack->offsets[ASSET_BLOB_FONTS]) {
+		FontsBlob* fb = (FontsBlob*)(pack->data + pack->offsets[ASSET_BLOB_FONTS]);
+		FontFormat* ff_arr = (FontFormat*)(pack->data + fb->offset_to_font_formats);
 
-	VertexBufferFormat* vbf_arr = (VertexBufferFormat*)(ga->data + mf->offset_to_vertex_buffers);
-	for(u8 i=0; i<mf->vertex_buffer_count; i++) 
-		md->vb_data[i] = MakeVertexBufferData(vbf_arr + i, ga);
+		AssetIndex* index = ga->index + ASSET_BLOB_FONTS;
+		GrowAssetIndex(index, index->count + fb->fonts_count, ga->permanent_arena);
+		for(u32 i=0; i<fb->fonts_count; i++)
+			AddAssetIndexEntry(index, ff_arr[i].name, ff_arr + i, pack);
+	}
 
-	return md;
+	return true;
 }
 
-static MeshFormat*
-GetAllMeshFormats(GameAssets* ga, u32* count) {
-	MeshesBlob* tb = (MeshesBlob*)(ga->data + ga->offsets[ASSET_BLOB_MESHES]);
-	MeshFormat* mf_arr = (MeshFormat*)(ga->data + tb->offset_to_mesh_formats);
+static GameAssets*
+LoadGameAssets(MemoryArena* arena) {
+	GameAssets* ga = PushStructClear(arena, GameAssets);
+	ga->permanent_arena = arena;
+
+	for(u32 i=0; i<ArrayCount(asset_pack_names); i++) {
+		bool mounted = MountAssetPack(asset_pack_names[i], ga);
+		Assert(mounted || i);
+	}
 
-	*count = tb->meshes_count;
-	return mf_arr;
+	return ga;
 }
 
-static TextureFormat*
-GetAllTextureFormats(GameAssets* ga, u32* count) {
-	TexturesBlob* tb = (TexturesBlob*)(ga->data + ga->offsets[ASSET_BLOB_TEXTURES]);
-	TextureFormat* tf_arr = (TextureFormat*)(ga->data + tb->offset_to_texture_formats);
+VertexBufferData
+MakeVertexBufferData(VertexBufferFormat* vbf, AssetPack* pack) {
+	VertexBufferData vbd = {};
 
-	*count = tb->textures_count;
-	return tf_arr;
-}
+	for(u8 i=0; i<VERTEX_BUFFER_TOTAL; i++) {
+		if(StringCompare(vbf->type, vertex_buffer_names[i])) {
+			vbd.type = (VERTEX_BUFFER)i;
+			break;
+		}
+	}
 
-static FontFormat*
-GetAllFontFormats(GameAssets* ga, u32* count) {
-	FontsBlob* fb = (FontsBlob*)(ga->data + ga->offsets[ASSET_BLOB_FONTS]);
-	FontFormat* ff_arr = (FontFormat*)(ga->data + fb->offset_to_font_formats);
+	vbd.data = (float*)(pack->data + vbf->offset_to_data);
 
-	*count = fb->fonts_count;
-	return ff_arr;
+	return vbd;
 }
 
+MeshData*
+LoadMeshData(MeshFormat* mf, AssetPack* pack, GameAssets* ga) {
+	MeshData* md = PushStruct(ga->permanent_arena, MeshData);
 
-static TextureFormat*
-GetTextureFormat(char* name, GameAssets* ga) {
-	Assert(name);
-	TextureFormat* tf = 0;
+	md->vertices_count = mf->vertices_count;
+	md->indices_count = mf->indices_count;
+	md->vb_data_count = mf->vertex_buffer_count;
+	md->indices = (u32*)(pack->data + mf->offset_to_indices);
+	md->vb_data = PushArray(ga->permanent_arena, VertexBufferData, mf->vertex_buffer_count);
 
-	u32 count = 0;
-	TextureFormat* tf_arr = GetAllTextureFormats(ga, &count);
+	VertexBufferFormat* vbf_arr = (VertexBufferFormat*)(pack->data + mf->offset_to_vertex_buffers);
+	for(u8 i=0; i<mf->vertex_buffer_count; i++)
+		md->vb_data[i] = MakeVertexBufferData(vbf_arr + i, pack);
 
-	bool found = false;
-	u32 i=0;
-	for(i=0; i<count; i++) {
-		if(StringCompare(tf_arr[i].name, name)) {
-			found = true;
-			break;
-		}
-	}
-	Assert(found);
-
-	tf = tf_arr + i;
-	return tf;
+	return md;
 }
 
-static FontFormat*
-GetFontFormat(char* name, GameAssets* ga) {
-	FontFormat* ff = 0;
+MeshBounds*
+LoadMeshBounds(MeshFormat* mf, AssetPack* pack, GameAssets* ga) {
+	MeshBounds* mb = PushStruct(ga->permanent_arena, MeshBounds);
 
-	u32 count = 0;
-	FontFormat* ff_arr = GetAllFontFormats(ga, &count);
+	mb->min = V3(mf->aabb_min[0], mf->aabb_min[1], mf->aabb_min[2]);
+	mb->max = V3(mf->aabb_max[0], mf->aabb_max[1], mf->aabb_max[2]);
+	mb->half_size = V3MulF(V3Sub(mb->max, mb->min), 0.5f);
 
-	bool found = false;
-	u32 i=0;
-	for(i=0; i<count; i++) {
-		if(StringCompare(ff_arr[i].name, name)) {
-			found = true;
-			break;
-		}
-	}
-	Assert(found);
+	mb->sphere_center = V3(mf->sphere_center[0], mf->sphere_center[1], mf->sphere_center[2]);
+	mb->sphere_radius = mf->sphere_radius;
 
-	ff = ff_arr + i;
+	mb->hull = (Vec3*)(pack->data + mf->offset_to_hull);
+	mb->hull_count = mf->hull_count;
 
-	return ff;
+	return mb;
 }
 
-static void*
+static FontAssetInfo*
 GetFont(char* name, GameAssets* ga) {
-	FontFormat* ff = GetFontFormat(name, ga);
-	return ga->data + ff->offset_to_data;
-}
+	AssetIndexEntry* entry = GetAssetIndexEntry(ASSET_BLOB_FONTS, name, ga);
+	FontFormat* ff = (FontFormat*)entry->format;
+
+	FontAssetInfo* result = PushStruct(ga->permanent_arena, FontAssetInfo);
+	result->name = ff->name;
+	result->ttf = entry->pack->data + ff->offset_to_data;
+	result->atlases = (FontAtlasFormat*)(entry->pack->data + ff->offset_to_atlases);
+	result->pack_data = entry->pack->data;
+	result->atlas_count = ff->atlas_count;
 
+	return result;
+}
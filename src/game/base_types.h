@@ -1,4 +1,8 @@
+#ifdef _MSC_VER
 #include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
 #include <stdint.h>
 #include <stddef.h>
 #include <limits.h>
@@ -35,6 +39,13 @@ typedef uint64_t u64;
 
 #define ArrayCount(Array) (sizeof(Array) / sizeof((Array)[0]))
 
+// Returns the value before the add
+#ifdef _MSC_VER
+#define AtomicAddU32(value, addend) ((u32)_InterlockedExchangeAdd((long volatile*)(value), (long)(addend)))
+#else
+#define AtomicAddU32(value, addend) __sync_fetch_and_add((value), (addend))
+#endif
+
 #if INTERNAL
 #define Assert(Expression) if(!(Expression)) {*(volatile int *)0 = 0;}
 #else
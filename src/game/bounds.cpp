@@ -0,0 +1,287 @@
+// World bounds of local boxes under a transform each, over SoA arrays, four boxes per SSE iteration
+// with a scalar tail. The center is scaled, rotated and moved, the extent goes through the
+// absolute rotation matrix, which gives the tightest axis aligned box around all eight corners.
+// Both paths do the same operations in the same order, so they agree to the bit.
+
+#define BOUNDS_BENCH_BOXES 100000
+
+struct BoundsTransforms {
+	float* position_x;
+	float* position_y;
+	float* position_z;
+	float* rotation_x;
+	float* rotation_y;
+	float* rotation_z;
+	float* rotation_w;
+	float* scale_x;
+	float* scale_y;
+	float* scale_z;
+	u32 count;
+};
+
+struct BoundsBench {
+	u32 boxes;
+	u64 scalar_cycles;
+	u64 simd_cycles;
+	u32 corners_outside;		// of the transformed local corners, has to stay 0
+};
+
+static BoundsTransforms
+AllocateBoundsTransforms(u32 capacity, MemoryArena* arena) {
+	BoundsTransforms result = {};
+	result.position_x = PushArray(arena, float, capacity);
+	result.position_y = PushArray(arena, float, capacity);
+	result.position_z = PushArray(arena, float, capacity);
+	result.rotation_x = PushArray(arena, float, capacity);
+	result.rotation_y = PushArray(arena, float, capacity);
+	result.rotation_z = PushArray(arena, float, capacity);
+	result.rotation_w = PushArray(arena, float, capacity);
+	result.scale_x = PushArray(arena, float, capacity);
+	result.scale_y = PushArray(arena, float, capacity);
+	result.scale_z = PushArray(arena, float, capacity);
+	return result;
+}
+
+static void
+SetBoundsTransform(u32 index, Transform* transform, BoundsTransforms* transforms) {
+	transforms->position_x[index] = transform->position.x;
+	transforms->position_y[index] = transform->position.y;
+	transforms->position_z[index] = transform->position.z;
+	transforms->rotation_x[index] = transform->rotation.x;
+	transforms->rotation_y[index] = transform->rotation.y;
+	transforms->rotation_z[index] = transform->rotation.z;
+	transforms->rotation_w[index] = transform->rotation.w;
+	transforms->scale_x[index] = transform->scale.x;
+	transforms->scale_y[index] = transform->scale.y;
+	transforms->scale_z[index] = transform->scale.z;
+}
+
+static u32
+AddBoundsTransform(Transform* transform, BoundsTransforms* transforms) {
+	u32 index = transforms->count++;
+	SetBoundsTransform(index, transform, transforms);
+	return index;
+}
+
+// Boxes and transforms first to end of larger arrays, for kernels working on part of them
+static CullBoxes
+SliceCullBoxes(CullBoxes* boxes, u32 first, u32 end) {
+	CullBoxes result = {};
+	result.center_x = boxes->center_x + first;
+	result.center_y = boxes->center_y + first;
+	result.center_z = boxes->center_z + first;
+	result.extent_x = boxes->extent_x + first;
+	result.extent_y = boxes->extent_y + first;
+	result.extent_z = boxes->extent_z + first;
+	result.count = end - first;
+	return result;
+}
+
+static BoundsTransforms
+SliceBoundsTransforms(BoundsTransforms* transforms, u32 first, u32 end) {
+	BoundsTransforms result = {};
+	result.position_x = transforms->position_x + first;
+	result.position_y = transforms->position_y + first;
+	result.position_z = transforms->position_z + first;
+	result.rotation_x = transforms->rotation_x + first;
+	result.rotation_y = transforms->rotation_y + first;
+	result.rotation_z = transforms->rotation_z + first;
+	result.rotation_w = transforms->rotation_w + first;
+	result.scale_x = transforms->scale_x + first;
+	result.scale_y = transforms->scale_y + first;
+	result.scale_z = transforms->scale_z + first;
+	result.count = end - first;
+	return result;
+}
+
+// Rotation is the one M4FromQuat makes, r01 is row 0 column 1
+static void
+TransformBounds(Vec3 center, Vec3 extent, Transform* transform, Vec3* world_center, Vec3* world_extent) {
+	Quat q = transform->rotation;
+	float mag = SquareRoot(q.x*q.x + q.y*q.y + q.z*q.z + q.w*q.w);
+	float x = q.x/mag;
+	float y = q.y/mag;
+	float z = q.z/mag;
+	float w = q.w/mag;
+
+	float xx = x*x, yy = y*y, zz = z*z;
+	float xy = x*y, xz = x*z, yz = y*z;
+	float wx = w*x, wy = w*y, wz = w*z;
+
+	float r00 = 1.0f - 2.0f*(yy + zz), r01 = 2.0f*(xy - wz),        r02 = 2.0f*(xz + wy);
+	float r10 = 2.0f*(xy + wz),        r11 = 1.0f - 2.0f*(xx + zz), r12 = 2.0f*(yz - wx);
+	float r20 = 2.0f*(xz - wy),        r21 = 2.0f*(yz + wx),        r22 = 1.0f - 2.0f*(xx + yy);
+
+	Vec3 scale = transform->scale;
+	float cx = center.x*scale.x, cy = center.y*scale.y, cz = center.z*scale.z;
+	float ex = extent.x*Abs(scale.x), ey = extent.y*Abs(scale.y), ez = extent.z*Abs(scale.z);
+
+	Vec3 position = transform->position;
+	world_center->x = r00*cx + r01*cy + r02*cz + position.x;
+	world_center->y = r10*cx + r11*cy + r12*cz + position.y;
+	world_center->z = r20*cx + r21*cy + r22*cz + position.z;
+	world_extent->x = Abs(r00)*ex + Abs(r01)*ey + Abs(r02)*ez;
+	world_extent->y = Abs(r10)*ex + Abs(r11)*ey + Abs(r12)*ez;
+	world_extent->z = Abs(r20)*ex + Abs(r21)*ey + Abs(r22)*ez;
+}
+
+static void
+TransformBoundsAt(u32 i, CullBoxes* local, BoundsTransforms* transforms, CullBoxes* world) {
+	Transform transform;
+	transform.position = V3(transforms->position_x[i], transforms->position_y[i], transforms->position_z[i]);
+	transform.rotation = Quat { transforms->rotation_x[i], transforms->rotation_y[i], transforms->rotation_z[i],
+		transforms->rotation_w[i] };
+	transform.scale = V3(transforms->scale_x[i], transforms->scale_y[i], transforms->scale_z[i]);
+
+	Vec3 center, extent;
+	TransformBounds(V3(local->center_x[i], local->center_y[i], local->center_z[i]),
+			V3(local->extent_x[i], local->extent_y[i], local->extent_z[i]), &transform, &center, &extent);
+	world->center_x[i] = center.x;
+	world->center_y[i] = center.y;
+	world->center_z[i] = center.z;
+	world->extent_x[i] = extent.x;
+	world->extent_y[i] = extent.y;
+	world->extent_z[i] = extent.z;
+}
+
+// world has room for local->count boxes
+static void
+TransformBoundsScalar(CullBoxes* local, BoundsTransforms* transforms, CullBoxes* world) {
+	for(u32 i=0; i<local->count; i++) TransformBoundsAt(i, local, transforms, world);
+	world->count = local->count;
+}
+
+static void
+TransformBoundsSSE(CullBoxes* local, BoundsTransforms* transforms, CullBoxes* world) {
+	__m128 sign_mask = _mm_set1_ps(-0.0f);
+	__m128 one = _mm_set1_ps(1.0f);
+	__m128 two = _mm_set1_ps(2.0f);
+
+	u32 simd_count = local->count & ~3;
+	for(u32 i=0; i<simd_count; i+=4) {
+		__m128 qx = _mm_loadu_ps(transforms->rotation_x + i);
+		__m128 qy = _mm_loadu_ps(transforms->rotation_y + i);
+		__m128 qz = _mm_loadu_ps(transforms->rotation_z + i);
+		__m128 qw = _mm_loadu_ps(transforms->rotation_w + i);
+		__m128 mag = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(qx, qx), _mm_mul_ps(qy, qy)),
+						_mm_mul_ps(qz, qz)), _mm_mul_ps(qw, qw)));
+		__m128 x = _mm_div_ps(qx, mag);
+		__m128 y = _mm_div_ps(qy, mag);
+		__m128 z = _mm_div_ps(qz, mag);
+		__m128 w = _mm_div_ps(qw, mag);
+
+		__m128 xx = _mm_mul_ps(x, x), yy = _mm_mul_ps(y, y), zz = _mm_mul_ps(z, z);
+		__m128 xy = _mm_mul_ps(x, y), xz = _mm_mul_ps(x, z), yz = _mm_mul_ps(y, z);
+		__m128 wx = _mm_mul_ps(w, x), wy = _mm_mul_ps(w, y), wz = _mm_mul_ps(w, z);
+
+		__m128 r00 = _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz)));
+		__m128 r01 = _mm_mul_ps(two, _mm_sub_ps(xy, wz));
+		__m128 r02 = _mm_mul_ps(two, _mm_add_ps(xz, wy));
+		__m128 r10 = _mm_mul_ps(two, _mm_add_ps(xy, wz));
+		__m128 r11 = _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz)));
+		__m128 r12 = _mm_mul_ps(two, _mm_sub_ps(yz, wx));
+		__m128 r20 = _mm_mul_ps(two, _mm_sub_ps(xz, wy));
+		__m128 r21 = _mm_mul_ps(two, _mm_add_ps(yz, wx));
+		__m128 r22 = _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy)));
+
+		__m128 sx = _mm_loadu_ps(transforms->scale_x + i);
+		__m128 sy = _mm_loadu_ps(transforms->scale_y + i);
+		__m128 sz = _mm_loadu_ps(transforms->scale_z + i);
+		__m128 cx = _mm_mul_ps(_mm_loadu_ps(local->center_x + i), sx);
+		__m128 cy = _mm_mul_ps(_mm_loadu_ps(local->center_y + i), sy);
+		__m128 cz = _mm_mul_ps(_mm_loadu_ps(local->center_z + i), sz);
+		__m128 ex = _mm_mul_ps(_mm_loadu_ps(local->extent_x + i), _mm_andnot_ps(sign_mask, sx));
+		__m128 ey = _mm_mul_ps(_mm_loadu_ps(local->extent_y + i), _mm_andnot_ps(sign_mask, sy));
+		__m128 ez = _mm_mul_ps(_mm_loadu_ps(local->extent_z + i), _mm_andnot_ps(sign_mask, sz));
+
+		__m128 px = _mm_loadu_ps(transforms->position_x + i);
+		__m128 py = _mm_loadu_ps(transforms->position_y + i);
+		__m128 pz = _mm_loadu_ps(transforms->position_z + i);
+		_mm_storeu_ps(world->center_x + i, _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(r00, cx), _mm_mul_ps(r01, cy)),
+						_mm_mul_ps(r02, cz)), px));
+		_mm_storeu_ps(world->center_y + i, _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(r10, cx), _mm_mul_ps(r11, cy)),
+						_mm_mul_ps(r12, cz)), py));
+		_mm_storeu_ps(world->center_z + i, _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(r20, cx), _mm_mul_ps(r21, cy)),
+						_mm_mul_ps(r22, cz)), pz));
+
+		_mm_storeu_ps(world->extent_x + i, _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_andnot_ps(sign_mask, r00), ex),
+						_mm_mul_ps(_mm_andnot_ps(sign_mask, r01), ey)), _mm_mul_ps(_mm_andnot_ps(sign_mask, r02), ez)));
+		_mm_storeu_ps(world->extent_y + i, _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_andnot_ps(sign_mask, r10), ex),
+						_mm_mul_ps(_mm_andnot_ps(sign_mask, r11), ey)), _mm_mul_ps(_mm_andnot_ps(sign_mask, r12), ez)));
+		_mm_storeu_ps(world->extent_z + i, _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_andnot_ps(sign_mask, r20), ex),
+						_mm_mul_ps(_mm_andnot_ps(sign_mask, r21), ey)), _mm_mul_ps(_mm_andnot_ps(sign_mask, r22), ez)));
+	}
+
+	for(u32 i=simd_count; i<local->count; i++) TransformBoundsAt(i, local, transforms, world);
+	world->count = local->count;
+}
+
+// Random boxes under random transforms, both paths have to agree and every corner has to end up inside
+static BoundsBench
+BenchBounds(MemoryArena* arena) {
+	BoundsBench result = {};
+	TemporaryMemory temp = BeginTemporaryMemory(arena);
+
+	CullBoxes local = AllocateCullBoxes(BOUNDS_BENCH_BOXES, arena);
+	BoundsTransforms transforms = AllocateBoundsTransforms(BOUNDS_BENCH_BOXES, arena);
+	for(u32 i=0; i<BOUNDS_BENCH_BOXES; i++) {
+		Vec3 center = V3((float)rand()/RAND_MAX*2.0f - 1.0f, (float)rand()/RAND_MAX*2.0f - 1.0f, (float)rand()/RAND_MAX*2.0f - 1.0f);
+		Vec3 half_size = V3(0.1f + (float)rand()/RAND_MAX, 0.1f + (float)rand()/RAND_MAX, 0.1f + (float)rand()/RAND_MAX);
+		AddCullBox(V3Sub(center, half_size), V3Add(center, half_size), &local);
+
+		Transform transform = TransformI();
+		transform.position = V3(((float)rand()/RAND_MAX*2.0f - 1.0f)*500.0f, ((float)rand()/RAND_MAX*2.0f - 1.0f)*500.0f,
+				((float)rand()/RAND_MAX*2.0f - 1.0f)*500.0f);
+		transform.rotation = QuatFromEuler((float)rand()/RAND_MAX*2.0f*PI32, (float)rand()/RAND_MAX*2.0f*PI32,
+				(float)rand()/RAND_MAX*2.0f*PI32);
+		transform.scale = V3(1.0f + (float)rand()/RAND_MAX*20.0f, 1.0f + (float)rand()/RAND_MAX*20.0f,
+				i % 8 ? 1.0f + (float)rand()/RAND_MAX*20.0f : -1.0f);
+		AddBoundsTransform(&transform, &transforms);
+	}
+
+	CullBoxes scalar_world = AllocateCullBoxes(BOUNDS_BENCH_BOXES, arena);
+	CullBoxes simd_world = AllocateCullBoxes(BOUNDS_BENCH_BOXES, arena);
+
+	u64 start = __rdtsc();
+	TransformBoundsScalar(&local, &transforms, &scalar_world);
+	u64 middle = __rdtsc();
+	TransformBoundsSSE(&local, &transforms, &simd_world);
+	u64 end = __rdtsc();
+
+	u64 size = BOUNDS_BENCH_BOXES*sizeof(float);
+	Assert(CompareMem(scalar_world.center_x, simd_world.center_x, size));
+	Assert(CompareMem(scalar_world.center_y, simd_world.center_y, size));
+	Assert(CompareMem(scalar_world.center_z, simd_world.center_z, size));
+	Assert(CompareMem(scalar_world.extent_x, simd_world.extent_x, size));
+	Assert(CompareMem(scalar_world.extent_y, simd_world.extent_y, size));
+	Assert(CompareMem(scalar_world.extent_z, simd_world.extent_z, size));
+
+	// Against the full matrix on a slice, with room for rounding
+	for(u32 i=0; i<BOUNDS_BENCH_BOXES; i+=97) {
+		Transform transform;
+		transform.position = V3(transforms.position_x[i], transforms.position_y[i], transforms.position_z[i]);
+		transform.rotation = Quat { transforms.rotation_x[i], transforms.rotation_y[i], transforms.rotation_z[i],
+			transforms.rotation_w[i] };
+		transform.scale = V3(transforms.scale_x[i], transforms.scale_y[i], transforms.scale_z[i]);
+		Mat4 model = MakeTransformMatrix(transform);
+
+		for(u32 corner=0; corner<8; corner++) {
+			Vec4 p = V4(local.center_x[i] + (corner & 1 ? local.extent_x[i] : -local.extent_x[i]),
+					local.center_y[i] + (corner & 2 ? local.extent_y[i] : -local.extent_y[i]),
+					local.center_z[i] + (corner & 4 ? local.extent_z[i] : -local.extent_z[i]), 1.0f);
+			Vec4 world = M4MulV(model, p);
+			float slack = 1e-3f;
+			if(Abs(world.x - simd_world.center_x[i]) > simd_world.extent_x[i] + slack ||
+			   Abs(world.y - simd_world.center_y[i]) > simd_world.extent_y[i] + slack ||
+			   Abs(world.z - simd_world.center_z[i]) > simd_world.extent_z[i] + slack) result.corners_outside++;
+		}
+	}
+	Assert(result.corners_outside == 0);
+
+	result.boxes = BOUNDS_BENCH_BOXES;
+	result.scalar_cycles = middle - start;
+	result.simd_cycles = end - middle;
+
+	EndTemporaryMemory(&temp);
+	return result;
+}
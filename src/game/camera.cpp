@@ -176,6 +176,44 @@ MakeViewPerspective(Camera* camera) {
 	return result;
 }
 
+// Planes point inwards, a point is inside when dot(plane.xyz, p) + plane.w >= 0
+struct Frustum {
+	Vec4 planes[6];
+};
+
+// Gribb/Hartmann on the rows of the view projection. Near is row 2 alone since d3d clips z to [0, w].
+static Frustum
+ExtractFrustum(Mat4* view_projection) {
+	Frustum result = {};
+
+	Vec4 rows[4];
+	for(u8 row=0; row<4; row++)
+		rows[row] = V4(view_projection->elem[0][row], view_projection->elem[1][row],
+				view_projection->elem[2][row], view_projection->elem[3][row]);
+
+	result.planes[0] = V4Add(rows[3], rows[0]);
+	result.planes[1] = V4Sub(rows[3], rows[0]);
+	result.planes[2] = V4Add(rows[3], rows[1]);
+	result.planes[3] = V4Sub(rows[3], rows[1]);
+	result.planes[4] = rows[2];
+	result.planes[5] = V4Sub(rows[3], rows[2]);
+
+	for(u8 i=0; i<6; i++) {
+		Vec4 plane = result.planes[i];
+		float length = SquareRoot(plane.x*plane.x + plane.y*plane.y + plane.z*plane.z);
+		result.planes[i] = V4MulF(plane, 1.0f/length);
+	}
+
+	return result;
+}
+
+// 0 at the camera, 1 at the far clip. The camera looks down its negative forward vector.
+static float
+GetViewDepth(Vec3 point, Camera* camera) {
+	Vec3 view_direction = V3Neg(GetForwardVector(camera->rotation));
+	return V3Dot(V3Sub(point, camera->position), view_direction) / camera->far_clip;
+}
+
 static void
 FirstPersonCamera(Camera* camera, FPControlInfo* fpci, Input* input) {
 	FirstPersonControl(&camera->position, &camera->rotation, true, fpci, input);
@@ -0,0 +1,335 @@
+// Frustum culling over SoA bounds, four objects per SSE iteration with a scalar tail
+
+#define CULL_BENCH_BOXES 100000
+
+struct CullBoxes {
+	float* center_x;
+	float* center_y;
+	float* center_z;
+	float* extent_x;
+	float* extent_y;
+	float* extent_z;
+	u32 count;
+};
+
+struct CullSpheres {
+	float* center_x;
+	float* center_y;
+	float* center_z;
+	float* radius;
+	u32 count;
+};
+
+struct CullStats {
+	u32 tested;
+	u32 visible;
+};
+
+struct CullBench {
+	u32 boxes;
+	u32 visible;
+	u32 mismatches;				// scalar and SSE disagreeing, or an edge case coming out wrong
+	u64 scalar_cycles;
+	u64 simd_cycles;
+};
+
+static CullBoxes
+AllocateCullBoxes(u32 capacity, MemoryArena* arena) {
+	CullBoxes result = {};
+	result.center_x = PushArray(arena, float, capacity);
+	result.center_y = PushArray(arena, float, capacity);
+	result.center_z = PushArray(arena, float, capacity);
+	result.extent_x = PushArray(arena, float, capacity);
+	result.extent_y = PushArray(arena, float, capacity);
+	result.extent_z = PushArray(arena, float, capacity);
+	return result;
+}
+
+static CullSpheres
+AllocateCullSpheres(u32 capacity, MemoryArena* arena) {
+	CullSpheres result = {};
+	result.center_x = PushArray(arena, float, capacity);
+	result.center_y = PushArray(arena, float, capacity);
+	result.center_z = PushArray(arena, float, capacity);
+	result.radius = PushArray(arena, float, capacity);
+	return result;
+}
+
+static u32
+AddCullBox(Vec3 min, Vec3 max, CullBoxes* boxes) {
+	u32 index = boxes->count++;
+	boxes->center_x[index] = (min.x + max.x)*0.5f;
+	boxes->center_y[index] = (min.y + max.y)*0.5f;
+	boxes->center_z[index] = (min.z + max.z)*0.5f;
+	boxes->extent_x[index] = (max.x - min.x)*0.5f;
+	boxes->extent_y[index] = (max.y - min.y)*0.5f;
+	boxes->extent_z[index] = (max.z - min.z)*0.5f;
+	return index;
+}
+
+static u32
+AddCullSphere(Vec3 center, float radius, CullSpheres* spheres) {
+	u32 index = spheres->count++;
+	spheres->center_x[index] = center.x;
+	spheres->center_y[index] = center.y;
+	spheres->center_z[index] = center.z;
+	spheres->radius[index] = radius;
+	return index;
+}
+
+// Outside once the box's projected radius doesn't reach the plane
+static bool
+IsBoxVisible(Frustum* frustum, float cx, float cy, float cz, float ex, float ey, float ez) {
+	for(u8 i=0; i<6; i++) {
+		Vec4 plane = frustum->planes[i];
+		float distance = plane.x*cx + plane.y*cy + plane.z*cz + plane.w;
+		float radius = Abs(plane.x)*ex + Abs(plane.y)*ey + Abs(plane.z)*ez;
+		if(distance + radius < 0.0f) return false;
+	}
+	return true;
+}
+
+static bool
+IsSphereVisible(Frustum* frustum, float cx, float cy, float cz, float radius) {
+	for(u8 i=0; i<6; i++) {
+		Vec4 plane = frustum->planes[i];
+		float distance = plane.x*cx + plane.y*cy + plane.z*cz + plane.w;
+		if(distance + radius < 0.0f) return false;
+	}
+	return true;
+}
+
+static void
+CullBoxesScalar(Frustum* frustum, CullBoxes* boxes, u8* visible, CullStats* stats) {
+	for(u32 i=0; i<boxes->count; i++) {
+		visible[i] = IsBoxVisible(frustum, boxes->center_x[i], boxes->center_y[i], boxes->center_z[i],
+				boxes->extent_x[i], boxes->extent_y[i], boxes->extent_z[i]);
+		stats->visible += visible[i];
+	}
+	stats->tested += boxes->count;
+}
+
+static void
+CullBoxesSSE(Frustum* frustum, CullBoxes* boxes, u8* visible, CullStats* stats) {
+	__m128 sign_mask = _mm_set1_ps(-0.0f);
+	__m128 zero = _mm_setzero_ps();
+
+	__m128 nx[6], ny[6], nz[6], nw[6], ax[6], ay[6], az[6];
+	for(u8 i=0; i<6; i++) {
+		Vec4 plane = frustum->planes[i];
+		nx[i] = _mm_set1_ps(plane.x);
+		ny[i] = _mm_set1_ps(plane.y);
+		nz[i] = _mm_set1_ps(plane.z);
+		nw[i] = _mm_set1_ps(plane.w);
+		ax[i] = _mm_andnot_ps(sign_mask, nx[i]);
+		ay[i] = _mm_andnot_ps(sign_mask, ny[i]);
+		az[i] = _mm_andnot_ps(sign_mask, nz[i]);
+	}
+
+	u32 simd_count = boxes->count & ~3;
+	for(u32 i=0; i<simd_count; i+=4) {
+		__m128 cx = _mm_loadu_ps(boxes->center_x + i);
+		__m128 cy = _mm_loadu_ps(boxes->center_y + i);
+		__m128 cz = _mm_loadu_ps(boxes->center_z + i);
+		__m128 ex = _mm_loadu_ps(boxes->extent_x + i);
+		__m128 ey = _mm_loadu_ps(boxes->extent_y + i);
+		__m128 ez = _mm_loadu_ps(boxes->extent_z + i);
+
+		__m128 outside = zero;
+		for(u8 p=0; p<6; p++) {
+			__m128 distance = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(nx[p], cx), _mm_mul_ps(ny[p], cy)),
+					_mm_mul_ps(nz[p], cz)), nw[p]);
+			__m128 radius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ax[p], ex), _mm_mul_ps(ay[p], ey)), _mm_mul_ps(az[p], ez));
+			outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(distance, radius), zero));
+		}
+
+		int mask = _mm_movemask_ps(outside);
+		for(u32 j=0; j<4; j++) {
+			visible[i + j] = !(mask & (1 << j));
+			stats->visible += visible[i + j];
+		}
+	}
+
+	for(u32 i=simd_count; i<boxes->count; i++) {
+		visible[i] = IsBoxVisible(frustum, boxes->center_x[i], boxes->center_y[i], boxes->center_z[i],
+				boxes->extent_x[i], boxes->extent_y[i], boxes->extent_z[i]);
+		stats->visible += visible[i];
+	}
+	stats->tested += boxes->count;
+}
+
+static void
+CullSpheresScalar(Frustum* frustum, CullSpheres* spheres, u8* visible, CullStats* stats) {
+	for(u32 i=0; i<spheres->count; i++) {
+		visible[i] = IsSphereVisible(frustum, spheres->center_x[i], spheres->center_y[i], spheres->center_z[i],
+				spheres->radius[i]);
+		stats->visible += visible[i];
+	}
+	stats->tested += spheres->count;
+}
+
+static void
+CullSpheresSSE(Frustum* frustum, CullSpheres* spheres, u8* visible, CullStats* stats) {
+	__m128 zero = _mm_setzero_ps();
+
+	__m128 nx[6], ny[6], nz[6], nw[6];
+	for(u8 i=0; i<6; i++) {
+		Vec4 plane = frustum->planes[i];
+		nx[i] = _mm_set1_ps(plane.x);
+		ny[i] = _mm_set1_ps(plane.y);
+		nz[i] = _mm_set1_ps(plane.z);
+		nw[i] = _mm_set1_ps(plane.w);
+	}
+
+	u32 simd_count = spheres->count & ~3;
+	for(u32 i=0; i<simd_count; i+=4) {
+		__m128 cx = _mm_loadu_ps(spheres->center_x + i);
+		__m128 cy = _mm_loadu_ps(spheres->center_y + i);
+		__m128 cz = _mm_loadu_ps(spheres->center_z + i);
+		__m128 r = _mm_loadu_ps(spheres->radius + i);
+
+		__m128 outside = zero;
+		for(u8 p=0; p<6; p++) {
+			__m128 distance = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(nx[p], cx), _mm_mul_ps(ny[p], cy)),
+					_mm_mul_ps(nz[p], cz)), nw[p]);
+			outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(distance, r), zero));
+		}
+
+		int mask = _mm_movemask_ps(outside);
+		for(u32 j=0; j<4; j++) {
+			visible[i + j] = !(mask & (1 << j));
+			stats->visible += visible[i + j];
+		}
+	}
+
+	for(u32 i=simd_count; i<spheres->count; i++) {
+		visible[i] = IsSphereVisible(frustum, spheres->center_x[i], spheres->center_y[i], spheres->center_z[i],
+				spheres->radius[i]);
+		stats->visible += visible[i];
+	}
+	stats->tested += spheres->count;
+}
+
+static float
+RandomCullRange(float range) {
+	return ((float)rand()/RAND_MAX*2.0f - 1.0f)*range;
+}
+
+static u32
+CountCullMismatches(u8* left, u8* right, u32 count) {
+	u32 result = 0;
+	for(u32 i=0; i<count; i++) result += left[i] != right[i];
+	return result;
+}
+
+// Runs both paths over the boxes and spheres, and against the expected results when there are some
+static u32
+CheckCulling(Frustum* frustum, CullBoxes* boxes, CullSpheres* spheres, u8* expected, MemoryArena* arena) {
+	TemporaryMemory temp = BeginTemporaryMemory(arena);
+	u32 count = Max(boxes->count, spheres->count);
+	u8* scalar_visible = PushArray(arena, u8, count);
+	u8* simd_visible = PushArray(arena, u8, count);
+	CullStats stats = {};
+	u32 result = 0;
+
+	CullBoxesScalar(frustum, boxes, scalar_visible, &stats);
+	CullBoxesSSE(frustum, boxes, simd_visible, &stats);
+	result += CountCullMismatches(scalar_visible, simd_visible, boxes->count);
+	if(expected) result += CountCullMismatches(expected, simd_visible, boxes->count);
+
+	CullSpheresScalar(frustum, spheres, scalar_visible, &stats);
+	CullSpheresSSE(frustum, spheres, simd_visible, &stats);
+	result += CountCullMismatches(scalar_visible, simd_visible, spheres->count);
+	if(expected) result += CountCullMismatches(expected, simd_visible, spheres->count);
+
+	EndTemporaryMemory(&temp);
+	return result;
+}
+
+// Random boxes scattered around the camera, both paths have to agree. So do random spheres, bounds
+// that reach one of the camera's planes as closely as floats allow, and bounds that exactly touch
+// an axis aligned frustum, where touching still counts as visible.
+static CullBench
+BenchCulling(Camera* camera, MemoryArena* arena) {
+	CullBench result = {};
+	TemporaryMemory temp = BeginTemporaryMemory(arena);
+
+	Mat4 view_projection = MakeViewPerspective(camera);
+	Frustum frustum = ExtractFrustum(&view_projection);
+
+	CullBoxes boxes = AllocateCullBoxes(CULL_BENCH_BOXES, arena);
+	CullSpheres spheres = AllocateCullSpheres(CULL_BENCH_BOXES, arena);
+	float range = camera->far_clip;
+	for(u32 i=0; i<CULL_BENCH_BOXES; i++) {
+		Vec3 center = V3Add(camera->position, V3(RandomCullRange(range), RandomCullRange(range), RandomCullRange(range)));
+		float size = 1.0f + (float)rand()/RAND_MAX*20.0f;
+		Vec3 half_size = V3MulF(V3I(), size);
+		AddCullBox(V3Sub(center, half_size), V3Add(center, half_size), &boxes);
+		AddCullSphere(center, size, &spheres);
+	}
+
+	u8* scalar_visible = PushArray(arena, u8, CULL_BENCH_BOXES);
+	u8* simd_visible = PushArray(arena, u8, CULL_BENCH_BOXES);
+	CullStats scalar_stats = {};
+	CullStats simd_stats = {};
+
+	u64 start = __rdtsc();
+	CullBoxesScalar(&frustum, &boxes, scalar_visible, &scalar_stats);
+	u64 middle = __rdtsc();
+	CullBoxesSSE(&frustum, &boxes, simd_visible, &simd_stats);
+	u64 end = __rdtsc();
+
+	result.boxes = CULL_BENCH_BOXES;
+	result.visible = simd_stats.visible;
+	result.scalar_cycles = middle - start;
+	result.simd_cycles = end - middle;
+	result.mismatches = CountCullMismatches(scalar_visible, simd_visible, CULL_BENCH_BOXES) +
+		(scalar_stats.visible != simd_stats.visible);
+	result.mismatches += CheckCulling(&frustum, &boxes, &spheres, 0, arena);
+
+	// Moved out from a point on the plane until the projected radius just reaches it
+	boxes.count = 0;
+	spheres.count = 0;
+	for(u32 i=0; i<CULL_BENCH_BOXES/16; i++) {
+		Vec4 plane = frustum.planes[i % 6];
+		Vec3 normal = V3(plane.x, plane.y, plane.z);
+		Vec3 point = V3Add(camera->position, V3(RandomCullRange(range), RandomCullRange(range), RandomCullRange(range)));
+		point = V3Sub(point, V3MulF(normal, V3Dot(normal, point) + plane.w));
+
+		Vec3 half_size = V3((float)rand()/RAND_MAX*20.0f, (float)rand()/RAND_MAX*20.0f, (float)rand()/RAND_MAX*20.0f);
+		float radius = Abs(plane.x)*half_size.x + Abs(plane.y)*half_size.y + Abs(plane.z)*half_size.z;
+		Vec3 center = V3Sub(point, V3MulF(normal, radius));
+		AddCullBox(V3Sub(center, half_size), V3Add(center, half_size), &boxes);
+		AddCullSphere(center, radius, &spheres);
+	}
+	result.mismatches += CheckCulling(&frustum, &boxes, &spheres, 0, arena);
+
+	// A cube of side 16 around the origin. Per plane one bound touching it from outside and one a bit
+	// past it, all of it exact in floats, then one inside for the scalar tail.
+	Frustum cube = {};
+	u8 expected[13];
+	boxes.count = 0;
+	spheres.count = 0;
+	for(u32 i=0; i<6; i++) {
+		float sign = i & 1 ? -1.0f : 1.0f;
+		float axis[3] = {};
+		axis[i/2] = sign;
+		cube.planes[i] = V4(axis[0], axis[1], axis[2], 8.0f);
+
+		for(u32 past=0; past<2; past++) {
+			float offset = -(10.0f + 0.5f*past);
+			Vec3 center = V3(axis[0]*offset, axis[1]*offset, axis[2]*offset);
+			AddCullBox(V3Sub(center, V3MulF(V3I(), 2.0f)), V3Add(center, V3MulF(V3I(), 2.0f)), &boxes);
+			AddCullSphere(center, 2.0f, &spheres);
+			expected[boxes.count - 1] = !past;
+		}
+	}
+	AddCullBox(V3MulF(V3I(), -1.0f), V3I(), &boxes);
+	AddCullSphere(V3Z(), 1.0f, &spheres);
+	expected[boxes.count - 1] = 1;
+	Assert(boxes.count == ArrayCount(expected));
+	result.mismatches += CheckCulling(&cube, &boxes, &spheres, expected, arena);
+
+	EndTemporaryMemory(&temp);
+	return result;
+}
@@ -0,0 +1,215 @@
+// Wireframe lines, boxes and spheres for development builds. Pushes only append to a per kind
+// array, so any thread can draw during the update. DebugDrawShader expands every segment to a
+// screen space strip and each kind costs one instanced draw. Release builds compile it all away.
+
+#ifdef INTERNAL
+
+#define MAX_DEBUG_LINES 16384
+#define MAX_DEBUG_BOXES 8192
+#define MAX_DEBUG_SPHERES 2048
+#define MAX_DEBUG_TEXTS 256
+#define DEBUG_TEXT_SIZE 20.0f
+#define DEBUG_SPHERE_SEGMENTS 16		// per circle, SPHERE_SEGMENTS in the shader
+
+enum DEBUG_PRIMITIVE {
+	DEBUG_PRIMITIVE_Line,
+	DEBUG_PRIMITIVE_Box,
+	DEBUG_PRIMITIVE_Sphere,
+
+	DEBUG_PRIMITIVE_TOTAL
+};
+
+// Lines are start and end, boxes min and max, spheres center and radius in b.x
+struct DebugPrimitive {
+	Vec3 a;
+	u32 color;				// rgba8
+	Vec3 b;
+	float thickness;		// pixels
+};
+
+struct DebugText {
+	Vec3 position;
+	char text[64];
+};
+
+struct DebugDrawConstants {
+	Mat4 view_proj;
+	Vec2 half_size;
+	Vec2 pad;
+};
+
+global u32 debug_primitive_max[DEBUG_PRIMITIVE_TOTAL] = { MAX_DEBUG_LINES, MAX_DEBUG_BOXES, MAX_DEBUG_SPHERES };
+
+// Segments a kind's vertex shader expands one primitive into, six vertices each
+global u32 debug_primitive_segments[DEBUG_PRIMITIVE_TOTAL] = { 1, 12, 3*DEBUG_SPHERE_SEGMENTS };
+
+global char* debug_primitive_vs_entries[DEBUG_PRIMITIVE_TOTAL] = { "vs_line", "vs_box", "vs_sphere" };
+
+struct DebugDraw {
+	bool enabled;
+
+	DebugPrimitive* primitives[DEBUG_PRIMITIVE_TOTAL];
+	u32 volatile counts[DEBUG_PRIMITIVE_TOTAL];
+
+	DebugText texts[MAX_DEBUG_TEXTS];
+	u32 volatile text_count;
+
+	ConstantsBuffer* constants;
+	VertexShader* vs[DEBUG_PRIMITIVE_TOTAL];
+	PixelShader* ps;
+	StructuredBuffer* buffers[DEBUG_PRIMITIVE_TOTAL];
+};
+
+static DebugDraw*
+InitDebugDraw(Renderer* renderer, MemoryArena* arena) {
+	DebugDraw* result = PushStructClear(arena, DebugDraw);
+	result->enabled = true;
+
+	for(u32 i=0; i<DEBUG_PRIMITIVE_TOTAL; i++) {
+		result->primitives[i] = PushArray(arena, DebugPrimitive, debug_primitive_max[i]);
+		result->vs[i] = UploadVertexShader(DebugDrawShader, sizeof(DebugDrawShader), debug_primitive_vs_entries[i],
+				0, 0, renderer);
+		result->buffers[i] = UploadStructuredBuffer(sizeof(DebugPrimitive), debug_primitive_max[i], renderer);
+	}
+	result->ps = UploadPixelShader(DebugDrawShader, sizeof(DebugDrawShader), "psf", renderer);
+	result->constants = UploadConstantsBuffer(sizeof(DebugDrawConstants), renderer);
+
+	return result;
+}
+
+static u32
+PackDebugColor(Vec4 color) {
+	u32 r = (u32)(Clamp(0.0f, color.x, 1.0f)*255.0f + 0.5f);
+	u32 g = (u32)(Clamp(0.0f, color.y, 1.0f)*255.0f + 0.5f);
+	u32 b = (u32)(Clamp(0.0f, color.z, 1.0f)*255.0f + 0.5f);
+	u32 a = (u32)(Clamp(0.0f, color.w, 1.0f)*255.0f + 0.5f);
+	return r | (g << 8) | (b << 16) | (a << 24);
+}
+
+static void
+PushDebugPrimitive(DEBUG_PRIMITIVE kind, Vec3 a, Vec3 b, Vec4 color, float thickness, DebugDraw* debug) {
+	if(!debug->enabled) return;
+
+	u32 index = AtomicAddU32(debug->counts + kind, 1);
+	Assert(index < debug_primitive_max[kind]);
+
+	DebugPrimitive* primitive = debug->primitives[kind] + index;
+	primitive->a = a;
+	primitive->color = PackDebugColor(color);
+	primitive->b = b;
+	primitive->thickness = thickness;
+}
+
+static void
+DebugDrawLine(Vec3 start, Vec3 end, Vec4 color, float thickness, DebugDraw* debug) {
+	PushDebugPrimitive(DEBUG_PRIMITIVE_Line, start, end, color, thickness, debug);
+}
+
+static void
+DebugDrawBox(Vec3 min, Vec3 max, Vec4 color, float thickness, DebugDraw* debug) {
+	PushDebugPrimitive(DEBUG_PRIMITIVE_Box, min, max, color, thickness, debug);
+}
+
+static void
+DebugDrawSphere(Vec3 center, float radius, Vec4 color, float thickness, DebugDraw* debug) {
+	PushDebugPrimitive(DEBUG_PRIMITIVE_Sphere, center, V3(radius, 0.0f, 0.0f), color, thickness, debug);
+}
+
+static void
+DebugDrawText(Vec3 position, char* text, DebugDraw* debug) {
+	if(!debug->enabled) return;
+
+	u32 index = AtomicAddU32(&debug->text_count, 1);
+	Assert(index < MAX_DEBUG_TEXTS);
+
+	DebugText* debug_text = debug->texts + index;
+	debug_text->position = position;
+	u32 length = Min(StringLength(text), (u32)sizeof(debug_text->text) - 1);
+	CopyMem(debug_text->text, text, length);
+	debug_text->text[length] = 0;
+}
+
+// Text goes through the font cache, which is not thread safe, so this runs on the simulation's
+// thread before SnapshotTextUI
+static void
+FlushDebugDrawText(DebugDraw* debug, Camera* camera, TextUI* text_ui) {
+	if(!debug->text_count) return;
+	Mat4 view_proj = MakeViewPerspective(camera);
+
+	for(u32 i=0; i<debug->text_count; i++) {
+		DebugText* text = debug->texts + i;
+		Vec4 clip = M4MulV(view_proj, V4FromV3(text->position, 1.0f));
+		if(clip.w <= 0.0f) continue;
+
+		Vec2 ssc = V2(clip.x/clip.w*0.5f + 0.5f, 0.5f - clip.y/clip.w*0.5f);
+		if(ssc.x < 0.0f || ssc.x > 1.0f || ssc.y < 0.0f || ssc.y > 1.0f) continue;
+		PushTextScreenSpace(text->text, DEBUG_TEXT_SIZE, ssc, text_ui);
+	}
+}
+
+// wd is the render size, thickness is in its pixels
+static void
+DebugDrawFrame(DebugDraw* debug, Camera* camera, WindowDimensions wd, RenderCommandList* list) {
+	u32 total = 0;
+	for(u32 i=0; i<DEBUG_PRIMITIVE_TOTAL; i++) total += debug->counts[i];
+	if(!total) return;
+
+	DebugDrawConstants* constants = PushStructClear(&list->arena, DebugDrawConstants);
+	constants->view_proj = MakeViewPerspective(camera);
+	constants->half_size = V2(wd.width*0.5f, wd.height*0.5f);
+
+	PushRenderConstants* push_constants = PushRenderCommand(list, PushRenderConstants);
+	push_constants->constants = debug->constants;
+	push_constants->data = constants;
+	push_constants->size = sizeof(DebugDrawConstants);
+
+	for(u32 i=0; i<DEBUG_PRIMITIVE_TOTAL; i++) {
+		u32 count = debug->counts[i];
+		if(!count) continue;
+
+		PushRenderBufferData* push_primitives = PushRenderCommand(list, PushRenderBufferData);
+		push_primitives->buffer = debug->buffers[i]->buffer;
+		push_primitives->data = debug->primitives[i];
+		push_primitives->size = sizeof(DebugPrimitive)*count;
+
+		RenderPipelineState state = {};
+		state.blend = BLEND_STATE_NoBlend;
+		state.rasterizer = RASTERIZER_STATE_DoubleSided;
+		state.topology = PRIMITIVE_TOPOLOGY_TriangleList;
+		state.vs = debug->vs[i];
+		state.ps = debug->ps;
+		BeginRenderItem(RENDER_PASS_World, &state, 0, 0, 0.0f, list);
+
+		SetConstantsBuffer* set_constants = PushRenderCommand(list, SetConstantsBuffer);
+		set_constants->constants = debug->constants;
+		set_constants->slot = (u8)1;
+		set_constants->vertex_shader = true;
+
+		SetStructuredBuffer* set_primitives = PushRenderCommand(list, SetStructuredBuffer);
+		set_primitives->vertex_shader = true;
+		set_primitives->structured = debug->buffers[i];
+		set_primitives->slot = 0;
+
+		DrawInstanced* draw_instanced = PushRenderCommand(list, DrawInstanced);
+		draw_instanced->vertices_count = 6*debug_primitive_segments[i];
+		draw_instanced->instance_count = count;
+		draw_instanced->offset = 0;
+
+		EndRenderItem(list);
+	}
+}
+
+static void
+ResetDebugDraw(DebugDraw* debug) {
+	for(u32 i=0; i<DEBUG_PRIMITIVE_TOTAL; i++) debug->counts[i] = 0;
+	debug->text_count = 0;
+}
+
+#else
+
+#define DebugDrawLine(...)
+#define DebugDrawBox(...)
+#define DebugDrawSphere(...)
+#define DebugDrawText(...)
+
+#endif
@@ -10,15 +10,15 @@ EaseLinear(float t, float b, float c, float d) {
 
 static float 
 EaseSineIn(float t, float b, float c, float d) { 
-	return (-c*cosf(t/d*(PI32/2.0f)) + c + b); 
+	return (-c*Cos(t/d*(PI32/2.0f)) + c + b); 
 }
 
 static float 
 EaseSineOut(float t, float b, float c, float d) { 
-	return (c*sinf(t/d*(PI32/2.0f)) + b); 
+	return (c*Sin(t/d*(PI32/2.0f)) + b); 
 } 
 
 static float 
 EaseSineInOut(float t, float b, float c, float d) {
-	return (-c/2.0f*(cosf(PI32*t/d) - 1.0f) + b);
+	return (-c/2.0f*(Cos(PI32*t/d) - 1.0f) + b);
 }
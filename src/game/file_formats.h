@@ -34,36 +34,46 @@ char* texture_type_names[TEXTURE_SLOT_TOTAL] = {
 	"NORMAL"
 };
 
+// Version 1 was the unversioned layout with u32 offsets and a single pack
+// Version 2 had no precomputed mesh bounds
+// Version 3 had no baked font atlases
+// Version 4 baked one coverage atlas per font size instead of a single SDF atlas
+#define GAF_VERSION 5
+
+// Upper bound on simplified hull points, one extreme vertex per 26-DOP direction
+#define MAX_MESH_HULL_POINTS 26
+
 //TODO:Roll your own string lib
 struct GameAssetFile {
 	char identification[5];
-	u8 number_of_blobs;
-	u32 offset_to_blob_directories;
+	u32 version;
+	u32 number_of_blobs;
+	u64 offset_to_blob_directories;
 };
 
 struct Directory {
-	u32 offset_to_blob;
+	u64 offset_to_blob;
 	char name_of_blob[STRING_LENGTH_BLOB];
 };
 
 struct MeshesBlob {
 	u32 meshes_count;
-	u32 offset_to_mesh_formats;
+	u64 offset_to_mesh_formats;
 };
 
 struct TexturesBlob {
 	u32 textures_count;
-	u32 offset_to_texture_formats;
+	u64 offset_to_texture_formats;
 };
 
 struct FontsBlob {
 	u32 fonts_count;
-	u32 offset_to_font_formats;
+	u64 offset_to_font_formats;
 };
 
 struct VertexBufferFormat {
 	char type[STRING_LENGTH_VERTEX_BUFFER];
-	u32 offset_to_data;
+	u64 offset_to_data;
 };
 
 struct MeshFormat {
@@ -71,8 +81,16 @@ struct MeshFormat {
 	u8 vertex_buffer_count;
 	u32 vertices_count;
 	u32 indices_count;
-	u32 offset_to_indices;
-	u32 offset_to_vertex_buffers;
+	u64 offset_to_indices;
+	u64 offset_to_vertex_buffers;
+
+	// Mesh space bounds computed by the packer
+	float aabb_min[3];
+	float aabb_max[3];
+	float sphere_center[3];
+	float sphere_radius;
+	u32 hull_count;
+	u64 offset_to_hull;		// hull_count packed float3 points
 };
 
 struct TextureFormat {
@@ -81,12 +99,33 @@ struct TextureFormat {
 	u32 width;
 	u32 height;
 	u32 num_components;
-	u32 offset_to_data;
+	u64 offset_to_data;
+};
+
+// Layout matches stbtt_packedchar, the game hands it straight to stbtt_GetPackedQuad
+struct PackedCharFormat {
+	u16 x0, y0, x1, y1;
+	float xoff, yoff, xadvance;
+	float xoff2, yoff2;
+};
+
+struct FontAtlasFormat {
+	u32 font_size;
+	float line_height;
+	u32 width;
+	u32 height;
+	u32 first_codepoint;
+	u32 codepoint_count;
+	u32 sdf_padding;			// distance range in pixels at font_size
+	u64 offset_to_packed_chars;
+	u64 offset_to_pixels;		// width*height single channel
 };
 
 struct FontFormat {
 	char name[STRING_LENGTH_FONT];
-	u32 offset_to_data;
+	u64 offset_to_data;
+	u32 atlas_count;
+	u64 offset_to_atlases;
 };
 
 
@@ -1,34 +1,86 @@
-#define MAX_FONT_ATLAS_WIDTH 250
-#define MAX_FONT_ATLAS_HEIGHT 250
 #define MAX_GLYPHS_ON_SCREEN 200
 
-// STB Truetype requires x*y times width and height when oversampling
-//
+#define MAX_CACHED_FONTS 4
+#define MAX_GLYPH_PAGES 5					// first one is the atlas baked by the asset packer
+#define GLYPH_PAGE_DIM 512
+#define GLYPH_CACHE_CAPACITY 2048		// power of two, open addressed
+#define GLYPH_CACHE_EMPTY 0
+
+// Glyphs are generated at the bucket size and scaled from there, the first bucket is the baked one
+#define GLYPH_SIZE_BUCKETS 2
+
 struct Glyph {
 	float x0, y0, x1, y1;
 	float s0, t0, s1, t1;
 	Vec3 color;
 };
 
-struct FontData {
-	FontData* next;
+// Distance field glyph metrics in pixels at glyph_size
+struct CachedGlyph {
+	u64 key;
+	u32 page;
+	u16 x0, y0, x1, y1;
+	float xoff, yoff, xoff2, yoff2;
+	float xadvance;
+	float glyph_size;
+};
+
+struct CachedFont {
+	stbtt_fontinfo info;
+	float base_size;
+	float line_height;		// at base_size
+	u32 sdf_padding;			// at base_size
+};
+
+struct GlyphPage {
+	u8* pixels;
+	u32 width;
+	u32 height;
+	TextureBuffer* texture;
+
+	bool pinned;
+	u64 last_used_frame;
 
-	void* pixels;
-	int font_size;
-	int font_line_width;
-	stbtt_packedchar packed_chars[0x7E-0x20];
+	stbrp_context packer;
+	stbrp_node* nodes;
+
+	bool dirty;
+	u32 dirty_x0, dirty_y0, dirty_x1, dirty_y1;
 
 	Glyph glyphs[MAX_GLYPHS_ON_SCREEN];
 	u32 glyph_counter;
 };
 
+struct TextSnapshotPage {
+	TextureBuffer* texture;
+	Glyph* glyphs;
+	u32 glyph_count;
+
+	u8* dirty_pixels;		// rows of the dirty rectangle, packed
+	u32 dirty_x, dirty_y;
+	u32 dirty_width, dirty_height;
+};
+
+struct TextSnapshot {
+	TextSnapshotPage pages[MAX_GLYPH_PAGES];
+	u32 page_count;
+};
+
 struct TextUI {
 	StructuredBuffer* structured_buffer;
 	VertexShader* text_shader;
-	PixelShader* monochrome_ps;
+	PixelShader* sdf_text_ps;
 
-	void* ttf;
-	FontData* font_data;
+	CachedFont fonts[MAX_CACHED_FONTS];
+	u32 font_count;
+
+	GlyphPage pages[MAX_GLYPH_PAGES];
+	u32 page_count;
+
+	CachedGlyph* glyphs;
+	u32 glyph_count;
+	u64 frame_index;
+	u64 pages_full_frame;		// a glyph found no room, U64Max when none has
 
 	float y_cursor;
 	Vec2 screen_res;
@@ -37,225 +89,458 @@ struct TextUI {
 	Renderer* renderer;
 };
 
-static FontData*
-GenerateFontData(float size, TextUI* text_ui) {
-	FontData* result = PushStruct(text_ui->frame_arena, FontData);
+static u64
+MakeGlyphKey(u32 font, u32 bucket, u32 codepoint) {
+	// Top bit keeps every valid key away from GLYPH_CACHE_EMPTY
+	return (1ull << 63) | ((u64)font << 40) | ((u64)bucket << 32) | codepoint;
+}
+
+static CachedGlyph*
+FindGlyphSlot(TextUI* text_ui, u64 key) {
+	u64 hash = key * 0x9E3779B97F4A7C15ull;
+	u32 slot = (u32)(hash >> 32) & (GLYPH_CACHE_CAPACITY - 1);
+	while(text_ui->glyphs[slot].key != GLYPH_CACHE_EMPTY && text_ui->glyphs[slot].key != key)
+		slot = (slot + 1) & (GLYPH_CACHE_CAPACITY - 1);
+	return text_ui->glyphs + slot;
+}
 
-	if(text_ui->font_data) {
-		result->next = text_ui->font_data;
-		text_ui->font_data = result;
-	}
-	else text_ui->font_data = result;
+// Bucket n holds glyphs generated at base_size*2^n
+static u32
+GetSizeBucket(float size, CachedFont* font) {
+	u32 bucket = 0;
+	while(bucket + 1 < GLYPH_SIZE_BUCKETS && size > font->base_size*(1 << bucket)*1.5f) bucket++;
+	return bucket;
+}
 
-	result->pixels = PushSize(text_ui->frame_arena, MAX_FONT_ATLAS_WIDTH * MAX_FONT_ATLAS_HEIGHT);
+static void
+MarkGlyphPageDirty(GlyphPage* page, u32 x0, u32 y0, u32 x1, u32 y1) {
+	if(!page->dirty) {
+		page->dirty = true;
+		page->dirty_x0 = x0; page->dirty_y0 = y0;
+		page->dirty_x1 = x1; page->dirty_y1 = y1;
+	}
+	else {
+		page->dirty_x0 = Min(page->dirty_x0, x0); page->dirty_y0 = Min(page->dirty_y0, y0);
+		page->dirty_x1 = Max(page->dirty_x1, x1); page->dirty_y1 = Max(page->dirty_y1, y1);
+	}
+}
 
-	stbtt_fontinfo font_info;
-	
-	unsigned char* ttf = (unsigned char*)text_ui->ttf;
+static void
+ResetGlyphPage(GlyphPage* page) {
+	stbrp_init_target(&page->packer, page->width, page->height, page->nodes, page->width);
+	ZeroMem(page->pixels, page->width*page->height);
+	MarkGlyphPageDirty(page, 0, 0, page->width, page->height);
+}
 
-	stbtt_InitFont(&font_info, ttf, stbtt_GetFontOffsetForIndex(ttf, 0));
-	stbtt_pack_context context;
+// Drops every glyph living on the page, the table is rebuilt since linear probing has no cheap delete
+static void
+EvictGlyphPage(u32 page_index, TextUI* text_ui) {
+	TemporaryMemory temp = BeginTemporaryMemory(text_ui->frame_arena);
+
+	CachedGlyph* survivors = PushArray(text_ui->frame_arena, CachedGlyph, text_ui->glyph_count);
+	u32 survivor_count = 0;
+	for(u32 i=0; i<GLYPH_CACHE_CAPACITY; i++) {
+		CachedGlyph* glyph = text_ui->glyphs + i;
+		if(glyph->key != GLYPH_CACHE_EMPTY && glyph->page != page_index)
+			survivors[survivor_count++] = *glyph;
+	}
 
-	int ascent, descent, line_gap, baseline;
-	float scale_factor = stbtt_ScaleForPixelHeight(&font_info, size);
-	stbtt_GetFontVMetrics(&font_info, &ascent, &descent, &line_gap); 
-	ascent = (ascent * scale_factor);
-	descent = (descent * scale_factor);
-	line_gap = (line_gap * line_gap);
-	baseline = (ascent*scale_factor);
+	ZeroArray(text_ui->glyphs, GLYPH_CACHE_CAPACITY);
+	for(u32 i=0; i<survivor_count; i++)
+		*FindGlyphSlot(text_ui, survivors[i].key) = survivors[i];
+	text_ui->glyph_count = survivor_count;
 
-	stbtt_PackBegin(&context, (unsigned char*)result->pixels, MAX_FONT_ATLAS_WIDTH, MAX_FONT_ATLAS_HEIGHT, 0, 1, 0);
-	stbtt_PackSetOversampling(&context, 1, 1);
-	stbtt_PackFontRange(&context, ttf, 0, ascent-descent, 0x20, 0x7E-0x20, result->packed_chars);
-	stbtt_PackEnd(&context);
+	EndTemporaryMemory(&temp);
 
-	result->font_size = size;
-	result->font_line_width = ascent - descent + line_gap * size;
+	ResetGlyphPage(text_ui->pages + page_index);
+}
 
+// Least recently used page that nothing drawn this frame refers to
+static i32
+FindEvictableGlyphPage(TextUI* text_ui) {
+	i32 result = -1;
+	u64 oldest = U64Max;
+	for(u32 i=0; i<text_ui->page_count; i++) {
+		GlyphPage* page = text_ui->pages + i;
+		if(page->pinned || page->last_used_frame == text_ui->frame_index) continue;
+		if(page->last_used_frame < oldest) {
+			oldest = page->last_used_frame;
+			result = i;
+		}
+	}
 	return result;
 }
 
-static FontData*
-GetFontData(float size, TextUI* text_ui) {
-	FontData* font_data = 0;
-	FontData* node = text_ui->font_data;
-	while(node) {
-		if(node->font_size == size) {
-			font_data = node; 
-			break;
+static bool
+PackGlyphRect(stbrp_rect* rect, u32* page_index, TextUI* text_ui) {
+	for(u32 i=0; i<text_ui->page_count; i++) {
+		GlyphPage* page = text_ui->pages + i;
+		if(page->pinned) continue;
+		if(stbrp_pack_rects(&page->packer, rect, 1)) {
+			*page_index = i;
+			return true;
 		}
-		node = node->next;
 	}
-	return font_data;
+
+	i32 evict = FindEvictableGlyphPage(text_ui);
+	if(evict < 0) return false;
+
+	EvictGlyphPage(evict, text_ui);
+	if(!stbrp_pack_rects(&text_ui->pages[evict].packer, rect, 1)) return false;
+	*page_index = evict;
+	return true;
+}
+
+static CachedGlyph*
+CacheGlyph(u32 font_index, u32 bucket, u32 codepoint, TextUI* text_ui) {
+	if(text_ui->pages_full_frame == text_ui->frame_index) return 0;
+
+	CachedFont* font = text_ui->fonts + font_index;
+	float glyph_size = font->base_size * (1 << bucket);
+	float scale = stbtt_ScaleForPixelHeight(&font->info, glyph_size);
+	int padding = font->sdf_padding << bucket;
+
+	// Same generator the packer bakes the first page with, so cached glyphs match the baked ones
+	SDFGlyph sdf = GenerateGlyphSDF(&font->info, codepoint, scale, padding, true);
+
+	CachedGlyph glyph = {};
+	glyph.key = MakeGlyphKey(font_index, bucket, codepoint);
+	glyph.xadvance = sdf.xadvance;
+	glyph.glyph_size = glyph_size;
+
+	if(sdf.pixels) {
+		stbrp_rect rect = {};
+		rect.w = sdf.width + 1;		// gutter against bilinear bleed
+		rect.h = sdf.height + 1;
+
+		u32 page_index = 0;
+		bool packed = PackGlyphRect(&rect, &page_index, text_ui);
+		if(packed) {
+			GlyphPage* page = text_ui->pages + page_index;
+			for(int y=0; y<sdf.height; y++)
+				CopyMem(page->pixels + (rect.y + y)*page->width + rect.x, sdf.pixels + y*sdf.width, sdf.width);
+			MarkGlyphPageDirty(page, rect.x, rect.y, rect.x + sdf.width, rect.y + sdf.height);
+
+			glyph.page = page_index;
+			glyph.x0 = (u16)rect.x;
+			glyph.y0 = (u16)rect.y;
+			glyph.x1 = (u16)(rect.x + sdf.width);
+			glyph.y1 = (u16)(rect.y + sdf.height);
+			glyph.xoff = sdf.xoff;
+			glyph.yoff = sdf.yoff;
+			glyph.xoff2 = sdf.xoff + sdf.width;
+			glyph.yoff2 = sdf.yoff + sdf.height;
+		}
+		free(sdf.pixels);
+
+		// Every page is in use this frame, nothing more gets generated until the next one
+		if(!packed) {
+			text_ui->pages_full_frame = text_ui->frame_index;
+			return 0;
+		}
+	}
+
+	// Evicting may have rebuilt the table so the slot is looked up last
+	CachedGlyph* slot = FindGlyphSlot(text_ui, glyph.key);
+	*slot = glyph;
+	text_ui->glyph_count++;
+	Assert(text_ui->glyph_count < GLYPH_CACHE_CAPACITY*3/4);
+
+	return slot;
+}
+
+static CachedGlyph*
+GetCachedGlyph(u32 font_index, float size, u32 codepoint, TextUI* text_ui) {
+	CachedFont* font = text_ui->fonts + font_index;
+	u32 bucket = GetSizeBucket(size, font);
+
+	CachedGlyph* glyph = FindGlyphSlot(text_ui, MakeGlyphKey(font_index, bucket, codepoint));
+	if(glyph->key == GLYPH_CACHE_EMPTY) glyph = CacheGlyph(font_index, bucket, codepoint, text_ui);
+
+	return glyph;
+}
+
+// Invalid sequences decode to U+FFFD and consume one byte
+static u32
+DecodeUTF8(char** text) {
+	u8* s = (u8*)*text;
+	u32 result = 0xFFFD;
+	u32 length = 1;
+
+	if(s[0] < 0x80) result = s[0];
+	else if((s[0] & 0xE0) == 0xC0 && (s[1] & 0xC0) == 0x80) {
+		result = ((s[0] & 0x1F) << 6) | (s[1] & 0x3F);
+		length = 2;
+	}
+	else if((s[0] & 0xF0) == 0xE0 && (s[1] & 0xC0) == 0x80 && (s[2] & 0xC0) == 0x80) {
+		result = ((s[0] & 0x0F) << 12) | ((s[1] & 0x3F) << 6) | (s[2] & 0x3F);
+		length = 3;
+	}
+	else if((s[0] & 0xF8) == 0xF0 && (s[1] & 0xC0) == 0x80 && (s[2] & 0xC0) == 0x80 && (s[3] & 0xC0) == 0x80) {
+		result = ((s[0] & 0x07) << 18) | ((s[1] & 0x3F) << 12) | ((s[2] & 0x3F) << 6) | (s[3] & 0x3F);
+		length = 4;
+	}
+
+	*text += length;
+	return result;
+}
+
+static void
+AddBakedGlyphPage(FontAssetInfo* font, u32 font_index, TextUI* text_ui) {
+	Assert(font->atlas_count == 1);
+	FontAtlasFormat* atlas = font->atlases;
+
+	u32 page_index = text_ui->page_count++;
+	Assert(page_index < MAX_GLYPH_PAGES);
+	GlyphPage* page = text_ui->pages + page_index;
+	page->pinned = true;
+	page->pixels = font->pack_data + atlas->offset_to_pixels;
+	page->width = atlas->width;
+	page->height = atlas->height;
+	page->texture = UploadTexture(page->pixels, atlas->width, atlas->height, 1, TEXTURE_USAGE_Immutable,
+			text_ui->renderer);
+
+	stbtt_packedchar* packed_chars = (stbtt_packedchar*)(font->pack_data + atlas->offset_to_packed_chars);
+	for(u32 i=0; i<atlas->codepoint_count; i++) {
+		stbtt_packedchar* pc = packed_chars + i;
+		CachedGlyph* glyph = FindGlyphSlot(text_ui, MakeGlyphKey(font_index, 0, atlas->first_codepoint + i));
+		glyph->key = MakeGlyphKey(font_index, 0, atlas->first_codepoint + i);
+		glyph->page = page_index;
+		glyph->x0 = pc->x0; glyph->y0 = pc->y0;
+		glyph->x1 = pc->x1; glyph->y1 = pc->y1;
+		glyph->xoff = pc->xoff; glyph->yoff = pc->yoff;
+		glyph->xoff2 = pc->xoff2; glyph->yoff2 = pc->yoff2;
+		glyph->xadvance = pc->xadvance;
+		glyph->glyph_size = (float)atlas->font_size;
+		text_ui->glyph_count++;
+	}
+}
+
+static u32
+AddCachedFont(FontAssetInfo* font, TextUI* text_ui) {
+	u32 font_index = text_ui->font_count++;
+	Assert(font_index < MAX_CACHED_FONTS);
+
+	CachedFont* cached_font = text_ui->fonts + font_index;
+	u8* ttf = (u8*)font->ttf;
+	stbtt_InitFont(&cached_font->info, ttf, stbtt_GetFontOffsetForIndex(ttf, 0));
+	cached_font->base_size = (float)font->atlases->font_size;
+	cached_font->line_height = font->atlases->line_height;
+	cached_font->sdf_padding = font->atlases->sdf_padding;
+
+	AddBakedGlyphPage(font, font_index, text_ui);
+
+	return font_index;
 }
 
 static TextUI*
-InitFont(void* data, WindowDimensions wd, Renderer* renderer, MemoryArena* arena, MemoryArena* frame) {
-	TextUI* result = PushStruct(arena, TextUI);
-	result->ttf = data;
+InitFont(FontAssetInfo* font, WindowDimensions wd, Renderer* renderer, MemoryArena* arena, MemoryArena* frame) {
+	TextUI* result = PushStructClear(arena, TextUI);
 	result->frame_arena = frame;
 	result->renderer = renderer;
+	result->glyphs = PushArrayClear(arena, CachedGlyph, GLYPH_CACHE_CAPACITY);
+	result->pages_full_frame = U64Max;
+
+	AddCachedFont(font, result);
+
+	while(result->page_count < MAX_GLYPH_PAGES) {
+		GlyphPage* page = result->pages + result->page_count++;
+		page->width = GLYPH_PAGE_DIM;
+		page->height = GLYPH_PAGE_DIM;
+		page->pixels = (u8*)PushSize(arena, GLYPH_PAGE_DIM*GLYPH_PAGE_DIM);
+		page->nodes = PushArray(arena, stbrp_node, GLYPH_PAGE_DIM);
+		ResetGlyphPage(page);
+		page->dirty = false;
+		page->texture = UploadTexture(page->pixels, GLYPH_PAGE_DIM, GLYPH_PAGE_DIM, 1, TEXTURE_USAGE_Default,
+				renderer);
+	}
 
-	GenerateFontData(40.0f, result);
-
-	result->text_shader = UploadVertexShader(TextShader, sizeof(TextShader), 
+	result->text_shader = UploadVertexShader(TextShader, sizeof(TextShader),
 			"vsf", 0, 0, renderer);
-	result->monochrome_ps = UploadPixelShader(MonochromeShader, sizeof(MonochromeShader), 
+	result->sdf_text_ps = UploadPixelShader(SDFTextShader, sizeof(SDFTextShader),
 			"psf", renderer);
 	result->structured_buffer = UploadStructuredBuffer(sizeof(Glyph), MAX_GLYPHS_ON_SCREEN, renderer);
 
 	result->screen_res.x = (float)wd.width;
 	result->screen_res.y = (float)wd.height;
-	result->y_cursor += result->font_data->font_line_width;
-	
+	result->y_cursor += result->fonts[0].line_height * 40.0f/result->fonts[0].base_size;
+
 	return result;
 }
 
+// Same as stbtt_GetPackedQuad without snapping, the distance field is sampled at any scale
+static void
+GetScaledQuad(CachedGlyph* glyph, GlyphPage* page, float size, float* x, float y, stbtt_aligned_quad* quad) {
+	float scale = size/glyph->glyph_size;
+	float ipw = 1.0f/page->width;
+	float iph = 1.0f/page->height;
+
+	quad->x0 = *x + glyph->xoff*scale;
+	quad->y0 = y + glyph->yoff*scale;
+	quad->x1 = *x + glyph->xoff2*scale;
+	quad->y1 = y + glyph->yoff2*scale;
+	quad->s0 = glyph->x0*ipw;
+	quad->t0 = glyph->y0*iph;
+	quad->s1 = glyph->x1*ipw;
+	quad->t1 = glyph->y1*iph;
+
+	*x += glyph->xadvance*scale;
+}
+
 static void
-PushGlyphs(char* text, FontData* font_data, float* x, float* y, Vec2 screen_res) {
-	u32 len = StringLength(text);
-
-	for(u32 i=0; i<len; i++) {
-		// TODO: check
-		int char_index = text[i] - 0x20;
-		stbtt_aligned_quad quad; 
-
-	stbtt_GetPackedQuad(font_data->packed_chars, MAX_FONT_ATLAS_WIDTH,
-				MAX_FONT_ATLAS_HEIGHT, char_index, x, y, &quad, 1);
-	
-		u32 index = font_data->glyph_counter;
-		font_data->glyphs[index].x0 = quad.x0/screen_res.x;
-		font_data->glyphs[index].y0 = quad.y0/screen_res.y;
-		font_data->glyphs[index].x1 = quad.x1/screen_res.x;
-		font_data->glyphs[index].y1 = quad.y1/screen_res.y;
-		font_data->glyphs[index].s0 = quad.s0;
-		font_data->glyphs[index].t0 = quad.t0;
-		font_data->glyphs[index].s1 = quad.s1;
-		font_data->glyphs[index].t1 = quad.t1;
-
-		font_data->glyphs[index].color = WHITE;
-
-		font_data->glyph_counter++;
+PushGlyphs(char* text, float size, u32 font_index, float* x, float* y, TextUI* text_ui) {
+	Vec2 screen_res = text_ui->screen_res;
+
+	while(*text) {
+		u32 codepoint = DecodeUTF8(&text);
+		CachedGlyph* glyph = GetCachedGlyph(font_index, size, codepoint, text_ui);
+		if(!glyph) continue;
+
+		GlyphPage* page = text_ui->pages + glyph->page;
+		page->last_used_frame = text_ui->frame_index;
+
+		stbtt_aligned_quad quad;
+		GetScaledQuad(glyph, page, size, x, *y, &quad);
+		if(glyph->x1 == glyph->x0) continue;
+		if(page->glyph_counter == MAX_GLYPHS_ON_SCREEN) continue;
+
+		u32 index = page->glyph_counter;
+		page->glyphs[index].x0 = quad.x0/screen_res.x;
+		page->glyphs[index].y0 = quad.y0/screen_res.y;
+		page->glyphs[index].x1 = quad.x1/screen_res.x;
+		page->glyphs[index].y1 = quad.y1/screen_res.y;
+		page->glyphs[index].s0 = quad.s0;
+		page->glyphs[index].t0 = quad.t0;
+		page->glyphs[index].s1 = quad.s1;
+		page->glyphs[index].t1 = quad.t1;
+
+		page->glyphs[index].color = WHITE;
+
+		page->glyph_counter++;
 	}
 }
 
 static void
 PushTextScreenSpace(char* text, float size, Vec2 ssc, TextUI* text_ui) {
-	FontData* font_data = GetFontData(size, text_ui);
-	if(!font_data) font_data = GenerateFontData(size, text_ui);
+	CachedFont* font = text_ui->fonts;
 
 	float x = ssc.x * text_ui->screen_res.x;
 	float y = ssc.y * text_ui->screen_res.y;
-	y += font_data->font_line_width;
+	y += font->line_height * size/font->base_size;
 
-	PushGlyphs(text, font_data, &x, &y, text_ui->screen_res);
+	PushGlyphs(text, size, 0, &x, &y, text_ui);
 }
 
 static float
 GetPixelWidthForText(char* text, float size, TextUI* text_ui) {
-	FontData* font_data = GetFontData(size, text_ui);
-	if(!font_data) font_data = GenerateFontData(size, text_ui);
-
-	u32 len = StringLength(text);
-	float x, y;
-	x=0;
-	y=0;
-
-	for(u32 i=0; i<len; i++) {
-		int char_index = text[i] - 0x20;
-		stbtt_aligned_quad quad; 
+	float x = 0;
 
-		stbtt_GetPackedQuad(font_data->packed_chars, MAX_FONT_ATLAS_WIDTH,
-				MAX_FONT_ATLAS_HEIGHT, char_index, &x, &y, &quad, 1);
+	while(*text) {
+		u32 codepoint = DecodeUTF8(&text);
+		CachedGlyph* glyph = GetCachedGlyph(0, size, codepoint, text_ui);
+		if(glyph) x += glyph->xadvance * size/glyph->glyph_size;
 	}
-	int char_index = ' ' - 0x20;
-	stbtt_aligned_quad quad; 
-
-	stbtt_GetPackedQuad(font_data->packed_chars, MAX_FONT_ATLAS_WIDTH,
-			MAX_FONT_ATLAS_HEIGHT, char_index, &x, &y, &quad, 1);
+	CachedGlyph* space = GetCachedGlyph(0, size, ' ', text_ui);
+	if(space) x += space->xadvance * size/space->glyph_size;
 
 	return x;
 }
 
 static void
 PushTextPixelSpace(char* text, float font_size, Vec2 psc, TextUI* text_ui) {
-	FontData* font_data = GetFontData(font_size, text_ui);
-	if(!font_data) font_data = GenerateFontData(font_size, text_ui);
+	CachedFont* font = text_ui->fonts;
 
 	float x = psc.x;
-	float y = psc.y + font_data->font_line_width;
+	float y = psc.y + font->line_height * font_size/font->base_size;
 
-	PushGlyphs(text, font_data, &x, &y, text_ui->screen_res);
+	PushGlyphs(text, font_size, 0, &x, &y, text_ui);
 }
 
+// Copies the frame's glyphs and the dirty part of each page, then starts the next frame. The pages
+// go on changing while the render stage records from the copy.
 static void
-UITextFrame(TextUI* text_ui, WindowDimensions wd, Renderer* renderer) {
-
-	SetRenderTarget* set_render_target = PushRenderCommand(renderer, SetRenderTarget);
-	set_render_target->render_target = &renderer->backbuffer;
-
-	SetBlendState* set_blend_state = PushRenderCommand(renderer, SetBlendState);
-	set_blend_state->type = BLEND_STATE_Regular;
-
-	SetRasterizerState* srs = PushRenderCommand(renderer, SetRasterizerState);
-
-	SetPrimitiveTopology* set_topology = PushRenderCommand(renderer, SetPrimitiveTopology);
-	set_topology->type = PRIMITIVE_TOPOLOGY_TriangleList;
-
-	SetVertexShader* set_vertex_shader = PushRenderCommand(renderer, SetVertexShader);
-	set_vertex_shader->vertex = text_ui->text_shader;
-
-	SetPixelShader* set_pixel_shader = PushRenderCommand(renderer, SetPixelShader);
-	set_pixel_shader->pixel = text_ui->monochrome_ps;
-
-	SetStructuredBuffer* set_glyph_buffer = PushRenderCommand(renderer, SetStructuredBuffer);
-	set_glyph_buffer->vertex_shader = true;
-	set_glyph_buffer->structured = text_ui->structured_buffer;
-	set_glyph_buffer->slot = 0;
+SnapshotTextUI(TextUI* text_ui, WindowDimensions wd, TextSnapshot* snapshot, MemoryArena* arena) {
+	snapshot->page_count = 0;
+
+	for(u32 i=0; i<text_ui->page_count; i++) {
+		GlyphPage* page = text_ui->pages + i;
+		if(!page->dirty && !page->glyph_counter) continue;
+
+		TextSnapshotPage* copy = snapshot->pages + snapshot->page_count++;
+		ZeroStruct(*copy);
+		copy->texture = page->texture;
+
+		if(page->dirty) {
+			copy->dirty_x = page->dirty_x0;
+			copy->dirty_y = page->dirty_y0;
+			copy->dirty_width = page->dirty_x1 - page->dirty_x0;
+			copy->dirty_height = page->dirty_y1 - page->dirty_y0;
+			copy->dirty_pixels = PushArray(arena, u8, copy->dirty_width*copy->dirty_height);
+			for(u32 y=0; y<copy->dirty_height; y++) {
+				CopyMem(copy->dirty_pixels + y*copy->dirty_width,
+						page->pixels + (copy->dirty_y + y)*page->width + copy->dirty_x, copy->dirty_width);
+			}
+			page->dirty = false;
+		}
 
-	FontData* font_data = text_ui->font_data;
-	while(font_data) {
+		copy->glyph_count = page->glyph_counter;
+		copy->glyphs = PushArray(arena, Glyph, copy->glyph_count);
+		CopyMem(copy->glyphs, page->glyphs, copy->glyph_count*sizeof(Glyph));
+		page->glyph_counter = 0;
+	}
 
-		TextureBuffer* texture_buffer = UploadTexture(font_data->pixels, MAX_FONT_ATLAS_WIDTH, MAX_FONT_ATLAS_HEIGHT, 
-				1, false, true, renderer);
+	text_ui->frame_index++;
+	text_ui->screen_res = V2((float)wd.width, (float)wd.height);
+}
 
-		SetTextureBuffer* set_texture_buffer = PushRenderCommand(renderer, SetTextureBuffer);
-		set_texture_buffer->texture = texture_buffer;
-		set_texture_buffer->slot = 0;
+static void
+TextSnapshotFrame(TextSnapshot* snapshot, TextUI* text_ui, RenderCommandList* list) {
+
+	for(u32 i=0; i<snapshot->page_count; i++) {
+		TextSnapshotPage* page = snapshot->pages + i;
+		if(!page->dirty_pixels) continue;
+
+		UpdateTextureRegion* update = PushRenderCommand(list, UpdateTextureRegion);
+		update->texture = page->texture;
+		update->data = page->dirty_pixels;
+		update->pitch = page->dirty_width;
+		update->x = page->dirty_x;
+		update->y = page->dirty_y;
+		update->width = page->dirty_width;
+		update->height = page->dirty_height;
+	}
 
-		PushRenderBufferData* push_glyph_buffer = PushRenderCommand(renderer,PushRenderBufferData);
+	for(u32 i=0; i<snapshot->page_count; i++) {
+		TextSnapshotPage* page = snapshot->pages + i;
+		if(!page->glyph_count) continue;
+
+		RenderPipelineState state = {};
+		state.render_target = &list->renderer->backbuffer;
+		state.blend = BLEND_STATE_Regular;
+		state.rasterizer = RASTERIZER_STATE_DoubleSided;
+		state.topology = PRIMITIVE_TOPOLOGY_TriangleList;
+		state.vs = text_ui->text_shader;
+		state.ps = text_ui->sdf_text_ps;
+		BeginRenderItem(RENDER_PASS_UI, &state, page->texture, 0, 0.0f, list);
+
+		SetSamplerState* set_sampler_state = PushRenderCommand(list, SetSamplerState);
+		set_sampler_state->type = SAMPLER_STATE_Linear;
+		set_sampler_state->slot = 0;
+
+		SetStructuredBuffer* set_glyph_buffer = PushRenderCommand(list, SetStructuredBuffer);
+		set_glyph_buffer->vertex_shader = true;
+		set_glyph_buffer->structured = text_ui->structured_buffer;
+		set_glyph_buffer->slot = 0;
+
+		PushRenderBufferData* push_glyph_buffer = PushRenderCommand(list,PushRenderBufferData);
 		push_glyph_buffer->buffer = text_ui->structured_buffer->buffer;
-		push_glyph_buffer->size = font_data->glyph_counter * sizeof(Glyph);
-		push_glyph_buffer->data = font_data->glyphs;
+		push_glyph_buffer->size = page->glyph_count * sizeof(Glyph);
+		push_glyph_buffer->data = page->glyphs;
 
-		DrawVertices* draw_verts = PushRenderCommand(renderer, DrawVertices);
-		draw_verts->vertices_count = 6*font_data->glyph_counter;
+		DrawVertices* draw_verts = PushRenderCommand(list, DrawVertices);
+		draw_verts->vertices_count = 6*page->glyph_count;
 		draw_verts->offset = 0;
 
-		FreeRenderResource* free_buffer = PushRenderCommand(renderer, FreeRenderResource);
-		free_buffer->buffer = texture_buffer->buffer;
-
-		FreeRenderResource* free_view = PushRenderCommand(renderer, FreeRenderResource);
-		free_view->buffer = texture_buffer->view;
-
-		font_data->glyph_counter = 0;
-
-		//texture_buffer->buffer->Release();
-		//texture_buffer->view->Release();
-		font_data = font_data->next;
+		EndRenderItem(list);
 	}
-	text_ui->font_data = 0;
-
-	text_ui->screen_res = V2((float)wd.width, (float)wd.height);
 }
-
-
-
-
-
-
-
-
-
-
-
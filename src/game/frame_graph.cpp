@@ -0,0 +1,320 @@
+// Frame graph
+// Passes declare the targets they read and the one they write. CompileFrameGraph orders them,
+// culls the ones nothing imported depends on and places every transient target in a pooled
+// physical one, transients whose lifetimes don't overlap share it. Imported targets belong to
+// the renderer, writing one is what keeps a chain of passes alive.
+//
+// Declared and compiled by the render stage, compiling creates and frees targets, then executed
+// into a render list by whichever thread records it.
+
+#define MAX_FRAME_GRAPH_PASSES 32
+#define MAX_FRAME_GRAPH_RESOURCES 32
+#define MAX_FRAME_GRAPH_READS 4
+#define MAX_FRAME_GRAPH_TARGETS 16
+#define FRAME_GRAPH_NONE 0xffffffff
+
+struct FrameGraph;
+struct FrameGraphPass;
+
+#define FRAME_GRAPH_PASS_CALLBACK(name) void name(FrameGraph* graph, FrameGraphPass* pass, RenderCommandList* list)
+typedef FRAME_GRAPH_PASS_CALLBACK(FrameGraphPassCallback);
+
+struct FrameGraphResource {
+	char* name;
+	u32 width, height;
+	u32 used_width, used_height;	// top left part passes draw to and read, the rest is stale
+	bool imported;
+	RenderTarget* target;		// 0 is the readable render target, transients get their physical's
+	TextureBuffer* texture;
+
+	u32 writer;					// pass, FRAME_GRAPH_NONE until one writes it
+	u32 first, last;			// positions of the writer and of the last reader
+	u32 physical;				// transients only
+};
+
+struct FrameGraphPass {
+	char* name;
+	FrameGraphPassCallback* callback;
+	void* data;
+	u32 type;					// meaning is up to the callback
+
+	u32 reads[MAX_FRAME_GRAPH_READS];
+	u32 read_count;
+	u32 write;
+
+	bool live;
+	u32 position;				// in execution order, feeds the sort key
+};
+
+// Kept across frames, a slot whose target went unused in a frame is freed at its end
+struct FrameGraphTarget {
+	ReadableRenderTarget* target;
+	RenderTarget render_target;
+	TextureBuffer texture;
+	u32 width, height;
+
+	bool used;					// this frame
+	u32 busy_until;				// position of the last pass that reads its current transient
+};
+
+struct FrameGraphStats {
+	u32 passes;
+	u32 culled;
+	u32 transients;				// of live passes
+	u32 targets;				// physical targets they were placed in
+	u32 target_bytes;
+	u32 targets_created;
+	u32 targets_freed;
+};
+
+struct FrameGraph {
+	FrameGraphPass passes[MAX_FRAME_GRAPH_PASSES];
+	u32 pass_count;
+	FrameGraphResource resources[MAX_FRAME_GRAPH_RESOURCES];
+	u32 resource_count;
+
+	u32 order[MAX_FRAME_GRAPH_PASSES];		// live passes, filled by CompileFrameGraph
+	u32 order_count;
+
+	FrameGraphTarget targets[MAX_FRAME_GRAPH_TARGETS];
+	FrameGraphStats stats;
+};
+
+static void
+ResetFrameGraph(FrameGraph* graph) {
+	graph->pass_count = 0;
+	graph->resource_count = 0;
+	graph->order_count = 0;
+}
+
+static u32
+AddFrameGraphResource(FrameGraph* graph, char* name, u32 width, u32 height) {
+	Assert(graph->resource_count < MAX_FRAME_GRAPH_RESOURCES);
+	Assert(width && height);
+	u32 result = graph->resource_count++;
+
+	FrameGraphResource* resource = graph->resources + result;
+	ZeroStruct(*resource);
+	resource->name = name;
+	resource->width = width;
+	resource->height = height;
+	resource->used_width = width;
+	resource->used_height = height;
+	resource->writer = FRAME_GRAPH_NONE;
+	resource->physical = FRAME_GRAPH_NONE;
+	return result;
+}
+
+static u32
+ImportFrameGraphTarget(FrameGraph* graph, char* name, u32 width, u32 height, RenderTarget* target, TextureBuffer* texture) {
+	u32 result = AddFrameGraphResource(graph, name, width, height);
+	FrameGraphResource* resource = graph->resources + result;
+	resource->imported = true;
+	resource->target = target;
+	resource->texture = texture;
+	return result;
+}
+
+static u32
+CreateFrameGraphTarget(FrameGraph* graph, char* name, u32 width, u32 height) {
+	return AddFrameGraphResource(graph, name, width, height);
+}
+
+static void
+SetFrameGraphUsedSize(FrameGraph* graph, u32 resource, u32 width, u32 height) {
+	Assert(resource < graph->resource_count);
+	FrameGraphResource* target = graph->resources + resource;
+	Assert(width && width <= target->width && height && height <= target->height);
+	target->used_width = width;
+	target->used_height = height;
+}
+
+// Every resource is written once, a pass that needs to change one writes a new one
+static FrameGraphPass*
+AddFrameGraphPass(FrameGraph* graph, char* name, u32* reads, u32 read_count, u32 write,
+		FrameGraphPassCallback* callback, void* data) {
+	Assert(graph->pass_count < MAX_FRAME_GRAPH_PASSES);
+	Assert(read_count <= MAX_FRAME_GRAPH_READS);
+	Assert(write < graph->resource_count);
+	Assert(graph->resources[write].writer == FRAME_GRAPH_NONE);
+	u32 index = graph->pass_count++;
+
+	FrameGraphPass* pass = graph->passes + index;
+	ZeroStruct(*pass);
+	pass->name = name;
+	pass->callback = callback;
+	pass->data = data;
+	for(u32 i=0; i<read_count; i++) {
+		Assert(reads[i] < graph->resource_count && reads[i] != write);
+		pass->reads[i] = reads[i];
+	}
+	pass->read_count = read_count;
+	pass->write = write;
+	pass->position = FRAME_GRAPH_NONE;
+
+	graph->resources[write].writer = index;
+	return pass;
+}
+
+static void
+ReleaseFrameGraphTarget(FrameGraphTarget* slot, Renderer* renderer) {
+	// Views before the texture they view
+	void* handles[] = { slot->target->render_target, slot->target->shader_resource, slot->target->texture };
+	for(u32 i=0; i<ArrayCount(handles); i++) {
+		FreeRenderResource* free_resource = PushRenderCommand(renderer, FreeRenderResource);
+		free_resource->buffer = handles[i];
+	}
+	ZeroStruct(*slot);
+}
+
+// Finds a free slot of the right size, or makes one
+static u32
+GetFrameGraphTarget(FrameGraph* graph, FrameGraphResource* resource, Renderer* renderer) {
+	u32 empty = FRAME_GRAPH_NONE;
+	for(u32 i=0; i<MAX_FRAME_GRAPH_TARGETS; i++) {
+		FrameGraphTarget* slot = graph->targets + i;
+		if(!slot->target) {
+			if(empty == FRAME_GRAPH_NONE) empty = i;
+			continue;
+		}
+		if(slot->width != resource->width || slot->height != resource->height) continue;
+		if(!slot->used || slot->busy_until < resource->first) return i;
+	}
+
+	Assert(empty != FRAME_GRAPH_NONE);
+	FrameGraphTarget* slot = graph->targets + empty;
+	slot->target = UploadRenderTarget(resource->width, resource->height, renderer);
+	slot->render_target.texture = slot->target->texture;
+	slot->render_target.view = slot->target->render_target;
+	slot->texture.buffer = slot->target->texture;
+	slot->texture.view = slot->target->shader_resource;
+	slot->width = resource->width;
+	slot->height = resource->height;
+	graph->stats.targets_created++;
+	return empty;
+}
+
+static void
+CompileFrameGraph(FrameGraph* graph, Renderer* renderer) {
+	FrameGraphStats* stats = &graph->stats;
+	ZeroStruct(*stats);
+	stats->passes = graph->pass_count;
+
+	// Live passes write something imported or something a live pass reads
+	for(u32 i=0; i<graph->pass_count; i++) {
+		FrameGraphPass* pass = graph->passes + i;
+		pass->live = graph->resources[pass->write].imported;
+	}
+	for(bool changed = true; changed;) {
+		changed = false;
+		for(u32 i=0; i<graph->pass_count; i++) {
+			FrameGraphPass* pass = graph->passes + i;
+			if(!pass->live) continue;
+			for(u32 r=0; r<pass->read_count; r++) {
+				FrameGraphResource* read = graph->resources + pass->reads[r];
+				// Transients have to be written before anything reads them
+				Assert(read->imported || read->writer != FRAME_GRAPH_NONE);
+				if(read->writer != FRAME_GRAPH_NONE && !graph->passes[read->writer].live) {
+					graph->passes[read->writer].live = true;
+					changed = true;
+				}
+			}
+		}
+	}
+
+	// Declaration order among the passes whose inputs are ready
+	graph->order_count = 0;
+	u32 live_count = 0;
+	for(u32 i=0; i<graph->pass_count; i++) {
+		FrameGraphPass* pass = graph->passes + i;
+		pass->position = FRAME_GRAPH_NONE;
+		if(pass->live) live_count++;
+	}
+	stats->culled = graph->pass_count - live_count;
+
+	while(graph->order_count < live_count) {
+		u32 next = FRAME_GRAPH_NONE;
+		for(u32 i=0; i<graph->pass_count && next == FRAME_GRAPH_NONE; i++) {
+			FrameGraphPass* pass = graph->passes + i;
+			if(!pass->live || pass->position != FRAME_GRAPH_NONE) continue;
+
+			bool ready = true;
+			for(u32 r=0; r<pass->read_count; r++) {
+				u32 writer = graph->resources[pass->reads[r]].writer;
+				if(writer != FRAME_GRAPH_NONE && graph->passes[writer].position == FRAME_GRAPH_NONE) ready = false;
+			}
+			if(ready) next = i;
+		}
+
+		// Nothing ready means a cycle
+		Assert(next != FRAME_GRAPH_NONE);
+		graph->passes[next].position = graph->order_count;
+		graph->order[graph->order_count++] = next;
+	}
+
+	for(u32 i=0; i<graph->resource_count; i++) {
+		FrameGraphResource* resource = graph->resources + i;
+		u32 writer = resource->writer;
+		resource->first = writer != FRAME_GRAPH_NONE ? graph->passes[writer].position : FRAME_GRAPH_NONE;
+		resource->last = resource->first;
+		resource->physical = FRAME_GRAPH_NONE;
+	}
+	for(u32 i=0; i<graph->order_count; i++) {
+		FrameGraphPass* pass = graph->passes + graph->order[i];
+		for(u32 r=0; r<pass->read_count; r++) {
+			FrameGraphResource* read = graph->resources + pass->reads[r];
+			read->last = read->last == FRAME_GRAPH_NONE ? i : Max(read->last, i);
+		}
+	}
+
+	// Transients are placed in the order they are written, a slot frees up after its last reader
+	for(u32 i=0; i<MAX_FRAME_GRAPH_TARGETS; i++) graph->targets[i].used = false;
+	for(u32 i=0; i<graph->order_count; i++) {
+		FrameGraphResource* resource = graph->resources + graph->passes[graph->order[i]].write;
+		if(resource->imported) continue;
+
+		u32 physical = GetFrameGraphTarget(graph, resource, renderer);
+		FrameGraphTarget* slot = graph->targets + physical;
+		slot->used = true;
+		slot->busy_until = resource->last;
+
+		resource->physical = physical;
+		resource->target = &slot->render_target;
+		resource->texture = &slot->texture;
+		stats->transients++;
+	}
+
+	for(u32 i=0; i<MAX_FRAME_GRAPH_TARGETS; i++) {
+		FrameGraphTarget* slot = graph->targets + i;
+		if(!slot->target) continue;
+		if(slot->used) {
+			stats->targets++;
+			stats->target_bytes += slot->width*slot->height*4;
+		}
+		else {
+			ReleaseFrameGraphTarget(slot, renderer);
+			stats->targets_freed++;
+		}
+	}
+}
+
+// Records the live passes in order, the callbacks read their targets through the two below
+static void
+ExecuteFrameGraph(FrameGraph* graph, RenderCommandList* list) {
+	for(u32 i=0; i<graph->order_count; i++) {
+		FrameGraphPass* pass = graph->passes + graph->order[i];
+		pass->callback(graph, pass, list);
+	}
+}
+
+static RenderTarget*
+GetFrameGraphRenderTarget(FrameGraph* graph, u32 resource) {
+	Assert(resource < graph->resource_count);
+	return graph->resources[resource].target;
+}
+
+static TextureBuffer*
+GetFrameGraphTexture(FrameGraph* graph, u32 resource) {
+	Assert(resource < graph->resource_count);
+	return graph->resources[resource].texture;
+}
@@ -0,0 +1,121 @@
+// Frame pipeline
+// The simulation writes what a frame draws into a snapshot and hands it to the render stage, which
+// records and submits it on the render queue's thread while the simulation goes on with the next
+// frame. The renderer and everything recording into it belong to the render stage from then on.
+//
+// Each snapshot has its own quad, mesh and debug renderer, so the lists a stage records point into
+// memory the simulation leaves alone. A snapshot is written again only after the stage that read
+// it finished, handing over frame N waits for the stage of frame N-1.
+
+#define FRAME_SNAPSHOTS 2
+
+enum FRAME_FLAG {
+	FRAME_FLAG_Edges                   = 1<<0,
+	FRAME_FLAG_ToggleDynamicResolution = 1<<1,
+	FRAME_FLAG_ReloadShaders           = 1<<2,
+	FRAME_FLAG_CheckDeterminism        = 1<<3,
+	FRAME_FLAG_Capture                 = 1<<4,
+};
+
+// What the render stage reports back, the simulation reads it when the snapshot comes round again
+struct FrameFeedback {
+	RenderQueueStats stats;
+	float render_scale;
+	WindowDimensions render_dim;
+	bool dynamic_resolution;
+};
+
+struct FramePipeline;
+
+struct FrameSnapshot {
+	FramePipeline* pipeline;
+	u32 frame;
+	u32 flags;
+	float frame_time;
+	WindowDimensions window_dim;
+	Camera camera;
+
+	QuadRenderer* quad_renderer;
+	MeshRenderer* mesh_renderer;
+#ifdef INTERNAL
+	DebugDraw* debug_draw;
+#endif
+	UISnapshot ui;
+	TextSnapshot text;
+
+	MemoryArena arena;			// ui and text copies, emptied when the snapshot is written again
+	TemporaryMemory arena_temp;
+
+	FrameFeedback feedback;
+};
+
+#define FRAME_STAGE_CALLBACK(name) void name(FrameSnapshot* snapshot, void* data)
+typedef FRAME_STAGE_CALLBACK(FrameStageCallback);
+
+struct FramePipeline {
+	FrameSnapshot snapshots[FRAME_SNAPSHOTS];
+	u32 frame;						// next one the simulation writes
+
+	PlatformWorkQueue* render_queue;	// 0 runs the stage on the simulation's thread as it is handed over
+	FrameStageCallback* render_stage;
+	void* render_data;
+};
+
+static void
+InitFramePipeline(FramePipeline* pipeline, Renderer* renderer, MemoryArena* arena) {
+	for(u32 i=0; i<FRAME_SNAPSHOTS; i++) {
+		FrameSnapshot* snapshot = pipeline->snapshots + i;
+		snapshot->pipeline = pipeline;
+		snapshot->quad_renderer = InitQuadRenderer(renderer, arena);
+		snapshot->mesh_renderer = InitMeshRenderer(renderer, arena);
+#ifdef INTERNAL
+		snapshot->debug_draw = InitDebugDraw(renderer, arena);
+#endif
+		snapshot->arena_temp = BeginTemporaryMemory(&snapshot->arena);
+	}
+}
+
+static FrameSnapshot*
+BeginFrameSnapshot(FramePipeline* pipeline) {
+	FrameSnapshot* snapshot = pipeline->snapshots + pipeline->frame % FRAME_SNAPSHOTS;
+	EndTemporaryMemory(&snapshot->arena_temp);
+	snapshot->arena_temp = BeginTemporaryMemory(&snapshot->arena);
+
+	snapshot->frame = pipeline->frame;
+	snapshot->flags = 0;
+	ZeroStruct(snapshot->ui);
+	snapshot->text.page_count = 0;
+	return snapshot;
+}
+
+static PLATFORM_WORK_QUEUE_CALLBACK(DoFrameRenderStage) {
+	FrameSnapshot* snapshot = (FrameSnapshot*)data;
+	FramePipeline* pipeline = snapshot->pipeline;
+	pipeline->render_stage(snapshot, pipeline->render_data);
+}
+
+static void
+SubmitFrameSnapshot(FramePipeline* pipeline, FrameSnapshot* snapshot) {
+	Assert(snapshot->frame == pipeline->frame);
+	if(pipeline->render_queue) {
+		platform_api.complete_all_work(pipeline->render_queue);
+		platform_api.add_work_entry(pipeline->render_queue, DoFrameRenderStage, snapshot);
+	}
+	else pipeline->render_stage(snapshot, pipeline->render_data);
+	pipeline->frame++;
+}
+
+// Waits for the frame in flight, anything that touches the renderer from this thread has to call it first
+static void
+FlushFramePipeline(FramePipeline* pipeline) {
+	if(pipeline->render_queue) platform_api.complete_all_work(pipeline->render_queue);
+}
+
+static void
+FillFrameFeedback(FrameSnapshot* snapshot, Renderer* renderer) {
+	FrameFeedback* feedback = &snapshot->feedback;
+	feedback->stats = *GetRenderStats(renderer);
+	feedback->render_scale = renderer->render_scale;
+	feedback->render_dim = renderer->render_dim;
+	feedback->dynamic_resolution = renderer->dynamic_resolution.budget_ms > 0.0f;
+}
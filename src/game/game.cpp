@@ -1,8 +1,13 @@
+#if defined(RENDERER_NULL) || defined(RENDERER_SOFTWARE)
+typedef void* HWND;
+#include <stdlib.h>
+#else
 #include <windows.h>
 #include <stdlib.h>
 #include <d3d11_1.h>
 #include <dxgi1_4.h>
 #include <d3dcompiler.h>
+#endif
 
 #define AssertHR(result) Assert((result) == 0)
 
@@ -28,14 +33,38 @@
 #include "file_formats.h"
 #include "shader_code.h"
 #include "camera.cpp"
+#include "culling.cpp"
+#include "bounds.cpp"
+#if defined(RENDERER_NULL)
+#include "renderer_handles.h"
+#include "renderer_null.h"
+#include "renderer.cpp"
+#include "renderer_capture.cpp"
+#include "renderer_null.cpp"
+#elif defined(RENDERER_SOFTWARE)
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include "include/stb_image_write.h"
+#include "renderer_handles.h"
+#include "renderer_software.h"
 #include "renderer.cpp"
+#include "renderer_capture.cpp"
+#include "renderer_software.cpp"
+#else
+#include "renderer.cpp"
+#include "renderer_capture.cpp"
+#include "renderer_d3d11.cpp"
+#endif
 #include "quad_renderer.cpp"
 #include "mesh_renderer.cpp"
+#include "frame_graph.cpp"
 #include "post_process_renderer.cpp"
 #include "asset_loading.cpp"
 #include "asset_info.cpp"
+#include "sdf.cpp"
 #include "font_handling.cpp"
 #include "ui_renderer.cpp"
+#include "debug_draw.cpp"
+#include "frame_pipeline.cpp"
 #include "simulation.h"
 
 #include "timer.h"
@@ -52,8 +81,173 @@ bool pressed = false;
 bool executable_reloaded = false;
 #endif
 
-extern "C" GAME_LOOP(game_loop) {
+#define FRAME_BUDGET_MS (1000.0f/60.0f)
+
+struct RenderListWork {
+	Renderer* renderer;
+	PostProcessRenderer* pp_renderer;
+	FrameSnapshot* snapshot;
+	RENDER_LIST list;
+};
+
+static PLATFORM_WORK_QUEUE_CALLBACK(DoRenderListWork) {
+	RenderListWork* work = (RenderListWork*)data;
+	FrameSnapshot* snapshot = work->snapshot;
+	RenderCommandList* list = GetRenderCommandList(work->list, work->renderer);
+
+	BeginRenderListTiming(list);
+	switch(work->list) {
+		case RENDER_LIST_Quads: QuadRendererFrame(snapshot->quad_renderer, &snapshot->camera, list); break;
+		case RENDER_LIST_Meshes: MeshRendererFrame(snapshot->mesh_renderer, &snapshot->camera, list); break;
+		case RENDER_LIST_PostProcess: PostProcessRendererFrame(work->pp_renderer, list); break;
+#ifdef INTERNAL
+		case RENDER_LIST_Debug:
+			DebugDrawFrame(snapshot->debug_draw, &snapshot->camera, work->renderer->render_dim, list);
+			break;
+#endif
+		default: Assert(false);
+	}
+	EndRenderListTiming(list);
+}
+
+// World and post process lists are recorded on the work queue, the ui on the render stage's thread
+static RENDER_LIST render_list_work[] = {
+	RENDER_LIST_Quads, RENDER_LIST_Meshes, RENDER_LIST_PostProcess,
+#ifdef INTERNAL
+	RENDER_LIST_Debug,
+#endif
+};
+
+static void
+AddRenderListWork(Renderer* renderer, PostProcessRenderer* pp_renderer, FrameSnapshot* snapshot, MemoryArena* arena) {
+	PlatformWorkQueue* queue = renderer->work_queue;
+	RenderListWork* work = PushArray(arena, RenderListWork, ArrayCount(render_list_work));
+	for(u32 i=0; i<ArrayCount(render_list_work); i++) {
+		work[i].renderer = renderer;
+		work[i].pp_renderer = pp_renderer;
+		work[i].snapshot = snapshot;
+		work[i].list = render_list_work[i];
+		platform_api.add_work_entry(queue, DoRenderListWork, work + i);
+	}
+}
+
+static void
+PushRenderStatsOverlay(RenderQueueStats* stats, UIRenderer* ui_renderer, MemoryArena* frame_arena) {
+	u32 line_size = 128;
+	char* lines[RENDER_STATS_PASSES + 3];
+	for(u32 i=0; i<ArrayCount(lines); i++) lines[i] = PushArray(frame_arena, char, line_size);
+
+	u32 line = 0;
+	for(u32 i=0; i<RENDER_STATS_PASSES; i++) {
+		RenderPassStats* pass = stats->passes + i;
+		stbsp_snprintf(lines[line++], line_size, "%s: %u items, %u draws, %llu verts, %u/%u state, %u KB",
+				render_stats_pass_names[i], pass->items, pass->draws, (unsigned long long)pass->vertices,
+				pass->state_changes, pass->state_commands, pass->buffer_bytes/1024);
+	}
+
+	u64* list_cycles = stats->list_cycles;
+	stbsp_snprintf(lines[line++], line_size, "Record quads %llu, meshes %llu, debug %llu, pp %llu, ui %llu kcycles",
+			(unsigned long long)(list_cycles[RENDER_LIST_Quads]/1000), (unsigned long long)(list_cycles[RENDER_LIST_Meshes]/1000),
+			(unsigned long long)(list_cycles[RENDER_LIST_Debug]/1000),
+			(unsigned long long)(list_cycles[RENDER_LIST_PostProcess]/1000), (unsigned long long)(list_cycles[RENDER_LIST_UI]/1000));
+
+	stbsp_snprintf(lines[line++], line_size, "Merge %llu, Execute %llu, Present %llu kcycles",
+			(unsigned long long)(stats->merge_cycles/1000), (unsigned long long)(stats->execute_cycles/1000),
+			(unsigned long long)(stats->present_cycles/1000));
+	stbsp_snprintf(lines[line++], line_size, "%u commands, resources +%u -%u, upload %u B, %u waits",
+			stats->commands, stats->resources_created, stats->resources_freed, stats->upload_bytes, stats->upload_waits);
+
+	PushUIOverlay(lines, (u8)line, V2(0.0f, 0.2f), ui_renderer);
+}
+
+// Records the worker lists again on this thread and checks the merged stream did not change.
+// Recording reuses the same list memory, so even pointers into it have to match.
+static bool
+CheckRenderListDeterminism(Renderer* renderer, PostProcessRenderer* pp_renderer, FrameSnapshot* snapshot, MemoryArena* arena) {
+	RenderCommandStream* commands = &renderer->commands;
+	RenderCommandMark start = GetRenderCommandMark(commands);
+	MergeRenderCommandLists(renderer);
+	u32 threaded_size = CopyRenderCommands(commands, start, 0);
+	u8* threaded = PushArray(arena, u8, threaded_size);
+	CopyRenderCommands(commands, start, threaded);
+	RewindRenderCommands(commands, start);
+
+	for(u32 i=0; i<ArrayCount(render_list_work); i++) {
+		RenderListWork work = { renderer, pp_renderer, snapshot, render_list_work[i] };
+		ResetRenderCommandList(GetRenderCommandList(work.list, renderer));
+		DoRenderListWork(0, &work);
+	}
+
+	MergeRenderCommandLists(renderer);
+	u32 serial_size = CopyRenderCommands(commands, start, 0);
+	u8* serial = PushArray(arena, u8, serial_size);
+	CopyRenderCommands(commands, start, serial);
+	RewindRenderCommands(commands, start);
+	return serial_size == threaded_size && CompareMem(threaded, serial, threaded_size);
+}
+
+// Render stage, reads the snapshot and owns the renderer. Runs on the render queue's thread while
+// the simulation writes the next snapshot, or right after the simulation when the pipeline is serial.
+static FRAME_STAGE_CALLBACK(RenderGameFrame) {
+	GameState* game_state = (GameState*)data;
+	Renderer* renderer = game_state->renderer;
+
+	EndTemporaryMemory(&game_state->render_arena_temp);
+	game_state->render_arena_temp = BeginTemporaryMemory(game_state->render_arena);
+
+	if(snapshot->flags & FRAME_FLAG_ToggleDynamicResolution) {
+		DynamicResolution* dynamic = &renderer->dynamic_resolution;
+		dynamic->budget_ms = dynamic->budget_ms ? 0.0f : FRAME_BUDGET_MS;
+		dynamic->full_ms = 0.0f;
+		renderer->render_scale = 1.0f;
+	}
+	UpdateRenderScale(renderer, snapshot->frame_time);
+	RendererBeginFrame(renderer, snapshot->window_dim, game_state->render_arena);
+
+	PostProcessRenderer* pp_renderer = game_state->post_process_renderer;
+	BeginPostProcess(pp_renderer, renderer);
+	u32 scene = pp_renderer->scene;
+	if(snapshot->flags & FRAME_FLAG_Edges) {
+		u32 edges = CreatePostProcessTarget("Edges", 1, pp_renderer, renderer);
+		PushPostProcessPass("Edge", POST_PROCESS_TYPE_Edge, scene, edges, pp_renderer);
+		scene = edges;
+	}
+	PushPostProcessPass("Copy", POST_PROCESS_TYPE_Copy, scene, pp_renderer->backbuffer, pp_renderer);
+	EndPostProcess(pp_renderer, renderer);
+
+#ifdef INTERNAL
+	if(snapshot->flags & FRAME_FLAG_ReloadShaders) {
+		for(u32 i=0; i<FRAME_SNAPSHOTS; i++) InitMeshShader(game_state->pipeline.snapshots[i].mesh_renderer, renderer);
+		InitPostProcessShaders(pp_renderer, renderer);
+	}
+#endif
+
+	AddRenderListWork(renderer, pp_renderer, snapshot, game_state->render_arena);
+	RenderCommandList* ui_list = GetRenderCommandList(RENDER_LIST_UI, renderer);
+	BeginRenderListTiming(ui_list);
+	UISnapshotFrame(&snapshot->ui, game_state->ui_renderer, ui_list);
+	TextSnapshotFrame(&snapshot->text, game_state->text_ui, ui_list);
+	EndRenderListTiming(ui_list);
+	platform_api.complete_all_work(renderer->work_queue);
 
+#ifdef INTERNAL
+	if(snapshot->flags & FRAME_FLAG_CheckDeterminism) {
+		bool deterministic = CheckRenderListDeterminism(renderer, pp_renderer, snapshot, game_state->render_arena);
+		Assert(deterministic);
+	}
+	if(snapshot->flags & FRAME_FLAG_Capture) RequestRenderCapture(renderer, "frame.rcap");
+#endif
+
+	ResetQuadRenderer(snapshot->quad_renderer);
+	ResetMeshRenderer(snapshot->mesh_renderer);
+#ifdef INTERNAL
+	ResetDebugDraw(snapshot->debug_draw);
+#endif
+	RendererEndFrame(renderer);
+	FillFrameFeedback(snapshot, renderer);
+}
+
+extern "C" GAME_LOOP(game_loop) {
 #ifdef INTERNAL
 	executable_reloaded = game_layer->executable_reloaded;
 #endif INTERNAL
@@ -65,21 +259,28 @@ extern "C" GAME_LOOP(game_loop) {
 		game_state = game_layer->game_state = BootstrapPushStruct(GameState, total_arena, Megabytes(20));
 
 		game_state->frame_arena = (MemoryArena*)BootstrapPushSize_(sizeof(MemoryArena), 0, 0);
+		game_state->render_arena = (MemoryArena*)BootstrapPushSize_(sizeof(MemoryArena), 0, 0);
 		game_state->assets = LoadGameAssets(&game_state->total_arena);
 		LoadAllTextureAssets(game_state->assets);
 		LoadAllMeshAssets(game_state->assets);
 
-		game_state->renderer = InitRenderer(window, &game_state->total_arena, game_state->frame_arena);
+		game_state->renderer = InitRenderer(window, &game_state->total_arena, game_state->render_arena);
+		game_state->renderer->work_queue = game_layer->work_queue;
+		game_state->renderer->worker_count = game_layer->worker_count;
+		game_state->renderer->dynamic_resolution.budget_ms = FRAME_BUDGET_MS;
+		game_state->renderer->dynamic_resolution.min_scale = 0.5f;
+#ifdef INTERNAL
+		EnableRenderCapture(game_state->renderer);
+#endif
 
 		UploadAllTextureAssets(game_state->assets, game_state->renderer);
 		UploadAllMeshAssets(game_state->assets, game_state->renderer);
 
-		game_state->quad_renderer = InitQuadRenderer(game_state->renderer, &game_state->total_arena);
-		game_state->mesh_renderer = InitMeshRenderer(game_state->renderer, &game_state->total_arena);
+		InitFramePipeline(&game_state->pipeline, game_state->renderer, &game_state->total_arena);
 		game_state->post_process_renderer = InitPostProcessRenderer(game_state->renderer, &game_state->total_arena);
 
-		//void* font = GetFont("FiraSans-Li", game_state->assets);
-		void* font = GetFont("JetBrainsMo", game_state->assets);
+		//FontAssetInfo* font = GetFont("FiraSans-Li", game_state->assets);
+		FontAssetInfo* font = GetFont("JetBrainsMo", game_state->assets);
 
 		game_state->text_ui = InitFont(font, window->dim, game_state->renderer, &game_state->total_arena, game_state->frame_arena);
 		game_state->ui_renderer = InitUIRenderer(game_state->renderer, window->dim, game_state->text_ui, &game_state->total_arena, game_state->frame_arena);
@@ -90,6 +291,8 @@ extern "C" GAME_LOOP(game_loop) {
 		game_state->game_mode = GAME_MODE_TEST;
 
 		game_state->frame_arena_temp = BeginTemporaryMemory(game_state->frame_arena);
+		game_state->render_arena_temp = BeginTemporaryMemory(game_state->render_arena);
+		game_state->timer.real_time = game_layer->timer;
 	}
 
 	EndTemporaryMemory(&game_state->frame_arena_temp);
@@ -99,10 +302,31 @@ extern "C" GAME_LOOP(game_loop) {
 	game_state->timer.real_time = game_layer->timer;
 
 	srand(game_state->timer.real_time);
+	game_state->job_system = game_layer->job_system;
 
 	game_state->camera = DefaultPerspectiveCamera(window->dim, &game_state->total_arena);
 
-	RendererBeginFrame(game_state->renderer, window->dim, game_state->frame_arena_temp.arena);
+	// Set every frame, a reloaded dll moves the stage
+	FramePipeline* pipeline = &game_state->pipeline;
+	pipeline->render_stage = RenderGameFrame;
+	pipeline->render_data = game_state;
+	if(input->buttons[WIN32_BUTTON_F10].pressed) {
+		FlushFramePipeline(pipeline);
+		game_state->serial = !game_state->serial;
+	}
+	pipeline->render_queue = game_state->serial ? 0 : game_layer->render_queue;
+
+	// Nothing below touches the renderer, the render stage of the last frame may still be running
+	FrameSnapshot* snapshot = BeginFrameSnapshot(pipeline);
+	game_state->quad_renderer = snapshot->quad_renderer;
+	game_state->mesh_renderer = snapshot->mesh_renderer;
+#ifdef INTERNAL
+	game_state->debug_draw = snapshot->debug_draw;
+#endif
+	// From the frame this snapshot held before
+	FrameFeedback* feedback = &snapshot->feedback;
+
+	if(input->buttons[WIN32_BUTTON_F9].pressed) snapshot->flags |= FRAME_FLAG_ToggleDynamicResolution;
 
 	if(input->buttons[WIN32_BUTTON_F1].pressed) {
 		game_layer->debug_cursor_request = !game_layer->debug_cursor_request;
@@ -110,6 +334,25 @@ extern "C" GAME_LOOP(game_loop) {
 	if(input->buttons[WIN32_BUTTON_F2].pressed) {
 		game_state->dev_mode =(DEV_MODE)(game_state->dev_mode ^ DEV_MODE_PAUSED);
 	}
+	if(input->buttons[WIN32_BUTTON_F3].pressed) {
+		game_state->cull_bench = BenchCulling(game_state->camera, game_state->frame_arena);
+		Assert(game_state->cull_bench.mismatches == 0);
+		game_state->bounds_bench = BenchBounds(game_state->frame_arena);
+	}
+	if(input->buttons[WIN32_BUTTON_F6].pressed) {
+		game_state->dev_mode =(DEV_MODE)(game_state->dev_mode ^ DEV_MODE_RENDER_STATS);
+	}
+	if(input->buttons[WIN32_BUTTON_F8].pressed) {
+		game_state->dev_mode =(DEV_MODE)(game_state->dev_mode ^ DEV_MODE_EDGES);
+	}
+#ifdef INTERNAL
+	if(input->buttons[WIN32_BUTTON_F7].pressed) {
+		for(u32 i=0; i<FRAME_SNAPSHOTS; i++) {
+			DebugDraw* debug_draw = pipeline->snapshots[i].debug_draw;
+			debug_draw->enabled = !debug_draw->enabled;
+		}
+	}
+#endif
 
 	if(game_state->dev_mode & DEV_MODE_PAUSED) {
 		FPControlInfo info = DefaultFPControlInfo();
@@ -141,24 +384,42 @@ extern "C" GAME_LOOP(game_loop) {
 
 	char text1[100];
 	char text2[100];
+	char text3[100];
+	char text4[100];
+	char text5[100];
+	char text6[100];
+	char text7[100];
+	char text8[100];
 
 	stbsp_sprintf(text1, "%.01f: Frame Time", game_state->timer.frame_time);
 	stbsp_sprintf(text2, "%0.01f: Game Time ms", game_state->timer.real_time);
 
-	char* info_text[] = { text1, text2 };
+	RenderQueueStats* queue_stats = &feedback->stats;
+	stbsp_sprintf(text3, "%u/%u: State Changes, %u Draws", queue_stats->state_changes, queue_stats->state_commands,
+			queue_stats->draws);
+
+	CullStats* cull_stats = &game_state->cull_stats_last_frame;
+	stbsp_sprintf(text4, "%u/%u: Visible", cull_stats->visible, cull_stats->tested);
+
+	CullBench* cull_bench = &game_state->cull_bench;
+	stbsp_sprintf(text5, "%u boxes, %llu/%llu: Cull SSE/Scalar cycles (F3)", cull_bench->boxes,
+			(unsigned long long)cull_bench->simd_cycles, (unsigned long long)cull_bench->scalar_cycles);
+	BoundsBench* bounds_bench = &game_state->bounds_bench;
+	stbsp_sprintf(text8, "%u boxes, %llu/%llu: Bounds SSE/Scalar cycles (F3)", bounds_bench->boxes,
+			(unsigned long long)bounds_bench->simd_cycles, (unsigned long long)bounds_bench->scalar_cycles);
+
+	stbsp_sprintf(text6, "%.02f: Render scale, %ux%u, %s (F9)", feedback->render_scale, feedback->render_dim.width,
+			feedback->render_dim.height, feedback->dynamic_resolution ? "dynamic" : "fixed");
+	stbsp_sprintf(text7, "%s render stage (F10)", pipeline->render_queue ? "Pipelined" : "Serial");
+
+	char* info_text[] = { text1, text2, text3, text4, text5, text8, text6, text7 };
 	PushUIOverlay(info_text, ArrayCount(info_text), V2Z(), game_state->ui_renderer);
+	if(game_state->dev_mode & DEV_MODE_RENDER_STATS)
+		PushRenderStatsOverlay(queue_stats, game_state->ui_renderer, game_state->frame_arena);
 
 	if(pressed) UpdateTestMode(game_state, input, window->dim);
 	else pressed = PushUIButton(text, V2(0.5f, 0.5f), game_state->ui_renderer); 
 
-	QuadRendererFrame(game_state->quad_renderer, game_state->camera, game_state->renderer);
-	MeshRendererFrame(game_state->mesh_renderer, game_state->camera, game_state->renderer);
-
-	PostProcessPipeline copy;
-	copy.type = POST_PROCESS_TYPE_Copy;
-	copy.in = game_state->renderer->readable_render_target.shader_resource;
-	copy.out = game_state->renderer->backbuffer.view;
-
 	Vec2 mouse_pos = *(Vec2*)&input->axes[WIN32_AXIS_MOUSE];
 	stbsp_sprintf(buffer, "%.02f: Mouse x", mouse_pos.x);
 	//PushTextScreenSpace(buffer, 40.0f, V2Z(), game_state->text_ui);
@@ -166,11 +427,25 @@ extern "C" GAME_LOOP(game_loop) {
 	stbsp_sprintf(buffer, "%0.02f: Mouse y", mouse_pos.y);
 	//PushTextScreenSpace(buffer, 60.0f, V2(0.0f, 0.5f), game_state->text_ui);
 
-	PushPostProcessPipeline(&copy, game_state->post_process_renderer, game_state->renderer);
-	PostProcessRendererFrame(game_state->post_process_renderer, game_state->renderer);
-	UIRendererFrame(input, game_state->ui_renderer, game_state->renderer);
-	UITextFrame(game_state->text_ui, window->dim, game_state->renderer);
-	RendererEndFrame(game_state->renderer);
+#ifdef INTERNAL
+	FlushDebugDrawText(snapshot->debug_draw, game_state->camera, game_state->text_ui);
+#endif
+	SnapshotUIRenderer(input, game_state->ui_renderer, &snapshot->ui, &snapshot->arena);
+	SnapshotTextUI(game_state->text_ui, window->dim, &snapshot->text, &snapshot->arena);
+
+	snapshot->frame_time = game_state->timer.frame_time;
+	snapshot->window_dim = window->dim;
+	snapshot->camera = *game_state->camera;
+	if(game_state->dev_mode & DEV_MODE_EDGES) snapshot->flags |= FRAME_FLAG_Edges;
+#ifdef INTERNAL
+	if(executable_reloaded) snapshot->flags |= FRAME_FLAG_ReloadShaders;
+	if(input->buttons[WIN32_BUTTON_F4].pressed) snapshot->flags |= FRAME_FLAG_CheckDeterminism;
+	if(input->buttons[WIN32_BUTTON_F5].pressed) snapshot->flags |= FRAME_FLAG_Capture;
+#endif
+	SubmitFrameSnapshot(pipeline, snapshot);
+
+	game_state->cull_stats_last_frame = game_state->cull_stats;
+	ZeroStruct(game_state->cull_stats);
 
 	//CheckArena(game_state->frame_arena);
 }
@@ -2,8 +2,11 @@ struct GameState {
 	MemoryArena total_arena;
 	MemoryArena* frame_arena;
 	TemporaryMemory frame_arena_temp;
+	MemoryArena* render_arena;		// the render stage's, the renderer records into it
+	TemporaryMemory render_arena_temp;
 
 	Timer timer;
+	PlatformJobSystem* job_system;
 
 	GameAssets* assets;
 	TextUI* text_ui;
@@ -13,6 +16,13 @@ struct GameState {
 	UIRenderer* ui_renderer;
 	PostProcessRenderer* post_process_renderer;
 	Camera* camera;
+#ifdef INTERNAL
+	DebugDraw* debug_draw;
+#endif
+
+	// The quad, mesh and debug renderers above are the ones of the snapshot being written
+	FramePipeline pipeline;
+	bool serial;
 
 	EntityBlob entity_blob;
 
@@ -21,4 +31,9 @@ struct GameState {
 
 	DEV_MODE dev_mode;
 
+	CullStats cull_stats;
+	CullStats cull_stats_last_frame;
+	CullBench cull_bench;
+	BoundsBench bounds_bench;
+
 };
@@ -1,6 +1,10 @@
 struct GameLayer {
 	struct GameState* game_state;
 	PlatformAPI platform_api;
+	PlatformJobSystem* job_system;
+	PlatformWorkQueue* work_queue;
+	u32 worker_count;
+	PlatformWorkQueue* render_queue;	// runs the render stage, one frame at a time
 	float timer;
 	bool quit_request;
 
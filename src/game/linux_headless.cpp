@@ -0,0 +1,1285 @@
+// Headless entry for Linux, drives the render front end without a window or asset pack.
+// Records a synthetic scene every frame on the job system, checks what reached the backend and
+// that the merged lists match a serial recording, and prints per frame cost. Built against the
+// null backend by default, or the software rasterizer with RENDERER_SOFTWARE, which can also
+// write the last frame out and compare it to a golden image.
+// Also checks and times the job system, the SSE frustum culling and math kernels against their
+// scalar references, the batched bounds transform, and UpdateEntities on a level of mines on 1 to
+// n threads.
+//
+//   headless [frames] [meshes] [quads] [-dump out.png] [-compare golden.png] [-capture out.rcap] [-csv out.csv] [-debug] [-edges] [-scale s] [-pipelined] [-workers n]
+//
+// -capture writes the last frame for linux_replay.cpp, -csv the render stats of every frame.
+// -debug adds debug draw lines, boxes and spheres over the scene in INTERNAL builds.
+// -edges runs the edge pass into a transient target before the copy to the backbuffer.
+// -scale draws the scene at that fraction of the window and scales it up in the copy.
+// -pipelined records and submits each frame as a job while the next one is simulated,
+// latency is from the start of a frame's simulation to the end of its present.
+// -workers sets the job system's thread count, one less than the cores by default.
+//
+// Exits non zero when a check fails, so CI can run it as a regression test.
+
+#include <stdio.h>
+#include <math.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#if !defined(RENDERER_SOFTWARE)
+#define RENDERER_NULL
+#endif
+#include "game.cpp"
+#include "linux_platform.cpp"
+
+#define HEADLESS_MESH_KINDS 8
+#define HEADLESS_TEXTURES 16
+#define HEADLESS_DEBUG_SHAPES 64		// of each kind
+
+static u32 headless_failed_checks;
+
+#define HeadlessCheck(expr) \
+	if(!(expr)) { headless_failed_checks++; fprintf(stderr, "check failed: %s (%s:%d)\n", #expr, __FILE__, __LINE__); }
+
+static Mesh
+MakeHeadlessCube(Renderer* renderer) {
+	// Smaller than the grid the scene lays them on, so no two cubes share a plane and nothing z-fights
+	float positions[] = {
+		-0.4f, -0.4f, -0.4f,   0.4f, -0.4f, -0.4f,   0.4f,  0.4f, -0.4f,  -0.4f,  0.4f, -0.4f,
+		-0.4f, -0.4f,  0.4f,   0.4f, -0.4f,  0.4f,   0.4f,  0.4f,  0.4f,  -0.4f,  0.4f,  0.4f,
+	};
+	u32 indices[] = {
+		0, 2, 1,  0, 3, 2,  4, 5, 6,  4, 6, 7,  0, 1, 5,  0, 5, 4,
+		3, 6, 2,  3, 7, 6,  0, 4, 7,  0, 7, 3,  1, 2, 6,  1, 6, 5,
+	};
+
+	// Corner normals are good enough, nothing is shaded
+	Mesh result = {};
+	result.vertex_buffers[0] = UploadVertexBuffer(positions, 8, 3, false, renderer);
+	result.vertex_buffers[1] = UploadVertexBuffer(positions, 8, 3, false, renderer);
+	result.index_buffer = UploadIndexBuffer(indices, ArrayCount(indices), renderer);
+	result.topology = PRIMITIVE_TOPOLOGY_TriangleList;
+	result.vertices_count = 8;
+	result.indices_count = ArrayCount(indices);
+	return result;
+}
+
+// Drives the upload ring against a gpu that finishes frames one to three frames late and
+// checks that no range is handed out while a frame in flight may still read it
+static void
+CheckUploadRing() {
+	u64 owners[16] = {};		// fence of the frame that last took each step of the ring
+	UploadRing ring;
+	InitUploadRing(&ring, ArrayCount(owners)*UPLOAD_RING_ALIGNMENT);
+
+	u64 completed = 0;
+	u32 random = 1;
+	u32 waits = 0;
+	u32 wraps = 0;
+	for(u32 frame=0; frame<4096; frame++) {
+		random = random*1103515245 + 12345;
+		u64 signaled = ring.fence - 1;
+		u64 lag = (random >> 8) % 3;
+		if(signaled > lag) completed = Max(completed, signaled - lag);
+
+		if(ring.frame_count == UPLOAD_RING_MAX_FRAMES) {
+			completed = Max(completed, ring.frames[ring.first_frame].fence);
+			waits++;
+		}
+		RetireUploadRing(&ring, completed);
+
+		// At most 12 steps a frame, so a frame always fits with the padding of one wrap
+		u32 allocations = (random >> 16) % 4;
+		for(u32 i=0; i<allocations; i++) {
+			random = random*1103515245 + 12345;
+			u32 size = (1 + (random >> 16) % 4)*UPLOAD_RING_ALIGNMENT;
+
+			u64 head = ring.head;
+			u32 offset = AllocateUploadRing(&ring, size);
+			while(offset == UPLOAD_RING_FULL) {
+				HeadlessCheck(ring.frame_count);
+				if(!ring.frame_count) return;
+				completed = Max(completed, ring.frames[ring.first_frame].fence);
+				RetireUploadRing(&ring, completed);
+				waits++;
+				offset = AllocateUploadRing(&ring, size);
+			}
+			if(offset < head % ring.size) wraps++;
+
+			HeadlessCheck(offset % UPLOAD_RING_ALIGNMENT == 0);
+			HeadlessCheck(offset + size <= ring.size);
+			for(u32 step=offset/UPLOAD_RING_ALIGNMENT; step<(offset + size)/UPLOAD_RING_ALIGNMENT; step++) {
+				HeadlessCheck(owners[step] <= completed);
+				owners[step] = ring.fence;
+			}
+		}
+
+		EndUploadRingFrame(&ring);
+	}
+
+	HeadlessCheck(waits && wraps);
+}
+
+// Records far more than a frame ever holds into one list and walks the merged stream, twice
+// so the second pass runs on the blocks the first one left behind. Nothing is executed.
+static void
+CheckHeavyRenderFrame(Renderer* renderer, MeshRenderer* mesh_renderer, Mesh* mesh, MemoryArena* frame_arena) {
+	u32 item_count = 20000;
+	u32 immediate_count = 10000;
+	RenderCommandList* list = GetRenderCommandList(RENDER_LIST_UI, renderer);
+
+	for(u32 pass=0; pass<2; pass++) {
+		TemporaryMemory frame_temp = BeginTemporaryMemory(frame_arena);
+		RendererBeginFrame(renderer, renderer->window_dim, frame_arena);
+		RenderCommandMark start = GetRenderCommandMark(&renderer->commands);
+
+		for(u32 i=0; i<immediate_count; i++) {
+			SetViewport* set_viewport = PushRenderCommand(list, SetViewport);
+			set_viewport->topleft = V2((float)i, 0.0f);
+			set_viewport->dim = V2(1.0f, 1.0f);
+		}
+
+		// Later items are nearer and sort first
+		for(u32 i=0; i<item_count; i++) {
+			RenderPipelineState state = {};
+			state.blend = BLEND_STATE_NoBlend;
+			state.rasterizer = RASTERIZER_STATE_Default;
+			state.topology = mesh->topology;
+			state.vs = mesh_renderer->vs;
+			state.ps = mesh_renderer->ps;
+			BeginRenderItem(RENDER_PASS_UI, &state, 0, mesh->vertex_buffers[0], (float)(item_count - i)/(float)item_count, list);
+
+			SetIndexBuffer* set_index_buffer = PushRenderCommand(list, SetIndexBuffer);
+			set_index_buffer->index = mesh->index_buffer;
+			set_index_buffer->offset = 0;
+
+			DrawIndexed* draw = PushRenderCommand(list, DrawIndexed);
+			draw->indices_count = mesh->indices_count;
+			draw->offset = i;
+
+			EndRenderItem(list);
+		}
+
+		MergeRenderCommandLists(renderer);
+		HeadlessCheck(list->max_items >= item_count);
+
+		u32 size = CopyRenderCommands(&renderer->commands, start, 0);
+		u8* commands = PushArray(frame_arena, u8, size);
+		CopyRenderCommands(&renderer->commands, start, commands);
+		HeadlessCheck(size > RENDER_COMMAND_BLOCK_SIZE);
+
+		u32 viewports = 0;
+		u32 draws = 0;
+		u32 last_draw = item_count;
+		for(u8* cursor = commands; cursor < commands + size;) {
+			RenderCommandHeader* header = (RenderCommandHeader*)cursor;
+			HeadlessCheck(header->type < RENDER_COMMAND_TOTAL);
+			HeadlessCheck(header->size % RENDER_COMMAND_ALIGNMENT == 0 && header->size > sizeof(RenderCommandHeader));
+			if(header->size % RENDER_COMMAND_ALIGNMENT || header->size <= sizeof(RenderCommandHeader)) break;
+			cursor += header->size;
+
+			if(header->type == RENDER_COMMAND_SetViewport) {
+				HeadlessCheck(!draws && ((SetViewport*)(header + 1))->topleft.x == (float)viewports);
+				viewports++;
+			}
+			else if(header->type == RENDER_COMMAND_DrawIndexed) {
+				u32 offset = ((DrawIndexed*)(header + 1))->offset;
+				HeadlessCheck(offset == last_draw - 1);
+				last_draw = offset;
+				draws++;
+			}
+		}
+		HeadlessCheck(viewports == immediate_count && draws == item_count);
+
+		ResetRenderCommandList(list);
+		ZeroStruct(renderer->queue_stats);
+		EndTemporaryMemory(&frame_temp);
+	}
+}
+
+// A bloom shaped chain declared back to front, with copies standing in for the passes it would have
+static void
+CheckFrameGraph(Renderer* renderer, PostProcessRenderer* pp_renderer, MemoryArena* frame_arena) {
+	FrameGraph* graph = &pp_renderer->graph;
+	WindowDimensions wd = renderer->window_dim;
+
+	for(u32 run=0; run<2; run++) {
+		TemporaryMemory frame_temp = BeginTemporaryMemory(frame_arena);
+		RendererBeginFrame(renderer, wd, frame_arena);
+
+		// Second run shrinks the blur, the half size targets have to go
+		u32 downsample = run ? 4 : 2;
+		BeginPostProcess(pp_renderer, renderer);
+		u32 scene = pp_renderer->scene;
+		u32 combined = CreatePostProcessTarget("Combined", 1, pp_renderer, renderer);
+		u32 blur_v = CreatePostProcessTarget("BlurV", downsample, pp_renderer, renderer);
+		u32 blur_h = CreatePostProcessTarget("BlurH", downsample, pp_renderer, renderer);
+		u32 bright = CreatePostProcessTarget("Bright", downsample, pp_renderer, renderer);
+		u32 edges = CreatePostProcessTarget("Edges", 1, pp_renderer, renderer);
+
+		u32 combine_reads[] = { scene, blur_v };
+		PushPostProcessPass("Tonemap", POST_PROCESS_TYPE_Copy, combined, pp_renderer->backbuffer, pp_renderer);
+		FrameGraphPass* combine = AddFrameGraphPass(graph, "Combine", combine_reads, ArrayCount(combine_reads), combined,
+				RecordPostProcessPass, pp_renderer);
+		combine->type = POST_PROCESS_TYPE_Copy;
+		PushPostProcessPass("BlurV", POST_PROCESS_TYPE_Copy, blur_h, blur_v, pp_renderer);
+		PushPostProcessPass("BlurH", POST_PROCESS_TYPE_Copy, bright, blur_h, pp_renderer);
+		PushPostProcessPass("Bright", POST_PROCESS_TYPE_Copy, scene, bright, pp_renderer);
+		PushPostProcessPass("Edge", POST_PROCESS_TYPE_Edge, scene, edges, pp_renderer);
+		EndPostProcess(pp_renderer, renderer);
+
+		FrameGraphStats* stats = &graph->stats;
+		u32 expected_order[] = { 4, 3, 2, 1, 0 };
+		HeadlessCheck(graph->order_count == ArrayCount(expected_order));
+		for(u32 i=0; i<graph->order_count && i<ArrayCount(expected_order); i++) {
+			HeadlessCheck(graph->order[i] == expected_order[i]);
+		}
+		HeadlessCheck(stats->passes == 6 && stats->culled == 1);
+
+		// Bright is done with by the time BlurV is written, so the two share
+		u32 small = (wd.width/downsample)*(wd.height/downsample)*4;
+		HeadlessCheck(stats->transients == 4 && stats->targets == 3);
+		HeadlessCheck(stats->target_bytes == wd.width*wd.height*4 + 2*small);
+		HeadlessCheck(graph->resources[bright].physical == graph->resources[blur_v].physical);
+		HeadlessCheck(graph->resources[bright].physical != graph->resources[blur_h].physical);
+		HeadlessCheck(stats->targets_created == (run ? 2u : 3u) && stats->targets_freed == (run ? 2u : 0u));
+
+		// The null backend asserts on a pass reading its own target
+		RenderCommandList* pp_list = GetRenderCommandList(RENDER_LIST_PostProcess, renderer);
+		PostProcessRendererFrame(pp_renderer, pp_list);
+		RendererEndFrame(renderer);
+		HeadlessCheck(GetRenderStats(renderer)->passes[RENDER_PASS_PostProcess].draws == 5);
+
+		EndTemporaryMemory(&frame_temp);
+	}
+}
+
+#define HEADLESS_SCALE_FRAMES 120
+
+// Frame time is modelled as a fixed part plus one that goes with the pixel count. The scale has
+// to settle where frames fit the budget, hold the floor when nothing fits and come back to full
+// size once the load drops, and drawing at the scales it picks must not remake any target.
+static void
+CheckDynamicResolution(Renderer* renderer, PostProcessRenderer* pp_renderer, MemoryArena* frame_arena) {
+	DynamicResolution* dynamic = &renderer->dynamic_resolution;
+	dynamic->budget_ms = 16.0f;
+	dynamic->min_scale = 0.5f;
+	dynamic->full_ms = 0.0f;
+
+	float fixed_ms = 2.0f;
+	float pixel_ms[] = { 30.0f, 200.0f, 4.0f, 30.0f };
+	float scales[ArrayCount(pixel_ms)];
+	for(u32 load=0; load<ArrayCount(pixel_ms); load++) {
+		float frame_ms = 0.0f;
+		for(u32 frame=0; frame<HEADLESS_SCALE_FRAMES; frame++) {
+			float scale = renderer->render_scale;
+			frame_ms = fixed_ms + pixel_ms[load]*scale*scale;
+			UpdateRenderScale(renderer, frame_ms);
+		}
+		scales[load] = renderer->render_scale;
+
+		bool fits = frame_ms <= dynamic->budget_ms && frame_ms >= dynamic->budget_ms*DYNAMIC_RESOLUTION_HEADROOM;
+		bool expected = load == 1 ? scales[load] == dynamic->min_scale : load == 2 ? scales[load] == 1.0f : fits;
+		HeadlessCheck(expected);
+	}
+
+	dynamic->budget_ms = 0.0f;
+	dynamic->full_ms = 0.0f;
+
+	WindowDimensions wd = renderer->window_dim;
+	for(u32 i=0; i<ArrayCount(scales); i++) {
+		TemporaryMemory frame_temp = BeginTemporaryMemory(frame_arena);
+		renderer->render_scale = scales[i];
+		RendererBeginFrame(renderer, wd, frame_arena);
+		HeadlessCheck(renderer->render_dim.width == (u32)(wd.width*scales[i] + 0.5f));
+		HeadlessCheck(renderer->render_dim.height == (u32)(wd.height*scales[i] + 0.5f));
+
+		BeginPostProcess(pp_renderer, renderer);
+		u32 edges = CreatePostProcessTarget("Edges", 1, pp_renderer, renderer);
+		PushPostProcessPass("Edge", POST_PROCESS_TYPE_Edge, pp_renderer->scene, edges, pp_renderer);
+		PushPostProcessPass("Copy", POST_PROCESS_TYPE_Copy, edges, pp_renderer->backbuffer, pp_renderer);
+		EndPostProcess(pp_renderer, renderer);
+
+		RenderCommandList* pp_list = GetRenderCommandList(RENDER_LIST_PostProcess, renderer);
+		PostProcessRendererFrame(pp_renderer, pp_list);
+		RendererEndFrame(renderer);
+
+		// The first frame frees what CheckFrameGraph left and makes the edge target
+		RenderQueueStats* stats = GetRenderStats(renderer);
+		if(i) HeadlessCheck(stats->resources_created == 0 && stats->resources_freed == 0);
+		HeadlessCheck(stats->passes[RENDER_PASS_PostProcess].draws == 2);
+		EndTemporaryMemory(&frame_temp);
+	}
+	renderer->render_scale = 1.0f;
+}
+
+#ifdef RENDERER_NULL
+// Each pass has to draw with the constants it pushed. A half size step reads a target of another
+// size than the scene, so the two ranges differ and a pass bound to the other's would show.
+static void
+CheckPostProcessConstants(Renderer* renderer, PostProcessRenderer* pp_renderer, MemoryArena* frame_arena) {
+	TemporaryMemory frame_temp = BeginTemporaryMemory(frame_arena);
+	renderer->render_scale = 0.75f;
+	RendererBeginFrame(renderer, renderer->window_dim, frame_arena);
+
+	BeginPostProcess(pp_renderer, renderer);
+	u32 half = CreatePostProcessTarget("Half", 2, pp_renderer, renderer);
+	PushPostProcessPass("Copy", POST_PROCESS_TYPE_Copy, half, pp_renderer->backbuffer, pp_renderer);
+	PushPostProcessPass("Down", POST_PROCESS_TYPE_Copy, pp_renderer->scene, half, pp_renderer);
+	EndPostProcess(pp_renderer, renderer);
+
+	Vec4 expected[2];
+	u32 reads[] = { pp_renderer->scene, half };
+	for(u32 i=0; i<ArrayCount(reads); i++) {
+		FrameGraphResource* in = pp_renderer->graph.resources + reads[i];
+		expected[i] = V4((float)in->used_width/(float)in->width, (float)in->used_height/(float)in->height,
+				(float)in->width, (float)in->height);
+	}
+	HeadlessCheck(expected[0].z != expected[1].z);
+
+	RenderCommandList* pp_list = GetRenderCommandList(RENDER_LIST_PostProcess, renderer);
+	PostProcessRendererFrame(pp_renderer, pp_list);
+	RendererEndFrame(renderer);
+
+	NullFrameStats* stats = &renderer->null_device.stats_last_frame;
+	HeadlessCheck(stats->draws == ArrayCount(expected));
+	for(u32 i=0; i<ArrayCount(expected); i++) {
+		HeadlessCheck(CompareMem(stats->ps_constants + i, expected + i, sizeof(Vec4)));
+	}
+
+	renderer->render_scale = 1.0f;
+	EndTemporaryMemory(&frame_temp);
+}
+#endif
+
+#define HEADLESS_MATH_COUNT 4096
+#define HEADLESS_MATH_ROUNDS 16
+
+static float
+HeadlessRandom(float min, float max) {
+	return min + (max - min)*(float)rand()/RAND_MAX;
+}
+
+static bool
+HeadlessM4Equal(Mat4* left, Mat4* right) {
+	for(u32 col=0; col<4; col++)
+		for(u32 row=0; row<4; row++) if(left->elem[col][row] != right->elem[col][row]) return false;
+	return true;
+}
+
+struct HeadlessMathData {
+	Mat4* left;
+	Mat4* right;
+	Mat4* out;
+	Vec4* points;
+	Vec4* out_points;
+	Quat* quats;
+	Quat* out_quats;
+	Transform* transforms;
+	u32 count;
+};
+
+static HeadlessMathData
+MakeHeadlessMathData(u32 count, MemoryArena* arena) {
+	HeadlessMathData result = {};
+	result.left = PushArray(arena, Mat4, count);
+	result.right = PushArray(arena, Mat4, count);
+	result.out = PushArray(arena, Mat4, count);
+	result.points = PushArray(arena, Vec4, count);
+	result.out_points = PushArray(arena, Vec4, count);
+	result.quats = PushArray(arena, Quat, count);
+	result.out_quats = PushArray(arena, Quat, count);
+	result.transforms = PushArray(arena, Transform, count);
+	result.count = count;
+
+	for(u32 i=0; i<count; i++) {
+		for(u32 col=0; col<4; col++) {
+			for(u32 row=0; row<4; row++) {
+				result.left[i].elem[col][row] = HeadlessRandom(-10.0f, 10.0f);
+				result.right[i].elem[col][row] = HeadlessRandom(-10.0f, 10.0f);
+			}
+		}
+		result.points[i] = V4(HeadlessRandom(-100.0f, 100.0f), HeadlessRandom(-100.0f, 100.0f),
+				HeadlessRandom(-100.0f, 100.0f), i % 2 ? 1.0f : 0.0f);
+		result.quats[i] = MakeQuat(HeadlessRandom(-1.0f, 1.0f), HeadlessRandom(-1.0f, 1.0f), HeadlessRandom(-1.0f, 1.0f),
+				HeadlessRandom(-1.0f, 1.0f));
+
+		Transform* transform = result.transforms + i;
+		transform->position = V3(HeadlessRandom(-500.0f, 500.0f), HeadlessRandom(-500.0f, 500.0f),
+				HeadlessRandom(-500.0f, 500.0f));
+		transform->rotation = QuatFromEuler(HeadlessRandom(-PI32, PI32), HeadlessRandom(-PI32, PI32),
+				HeadlessRandom(-PI32, PI32));
+		transform->scale = V3(HeadlessRandom(0.1f, 20.0f), HeadlessRandom(0.1f, 20.0f), i % 8 ? HeadlessRandom(0.1f, 20.0f) : -1.0f);
+	}
+	return result;
+}
+
+// The SSE kernels against the scalar references and the batches against the single ones, which all
+// do the same sums in the same order, and the math.h stand ins against libm
+static void
+CheckMath(MemoryArena* arena) {
+	TemporaryMemory temp = BeginTemporaryMemory(arena);
+	HeadlessMathData data = MakeHeadlessMathData(HEADLESS_MATH_COUNT, arena);
+
+	u32 mismatches[4] = {};
+	for(u32 i=0; i<data.count; i++) {
+		Mat4 product = M4Mul(data.left[i], data.right[i]);
+		Mat4 product_scalar = M4MulScalar(data.left[i], data.right[i]);
+		if(!HeadlessM4Equal(&product, &product_scalar)) mismatches[0]++;
+
+		Vec4 point = M4MulV(data.left[i], data.points[i]);
+		Vec4 point_scalar = M4MulVScalar(data.left[i], data.points[i]);
+		if(point.x != point_scalar.x || point.y != point_scalar.y || point.z != point_scalar.z || point.w != point_scalar.w)
+			mismatches[1]++;
+
+		Quat quat = QuatMul(data.quats[i], data.quats[(i + 1) % data.count]);
+		Quat quat_scalar = QuatMulScalar(data.quats[i], data.quats[(i + 1) % data.count]);
+		if(quat.x != quat_scalar.x || quat.y != quat_scalar.y || quat.z != quat_scalar.z || quat.w != quat_scalar.w)
+			mismatches[2]++;
+
+		Mat4 model = MakeTransformMatrix(data.transforms[i]);
+		Mat4 model_scalar = MakeTransformMatrixScalar(data.transforms[i]);
+		if(!HeadlessM4Equal(&model, &model_scalar)) mismatches[3]++;
+	}
+	for(u32 i=0; i<ArrayCount(mismatches); i++) HeadlessCheck(mismatches[i] == 0);
+
+	u32 batch_mismatches = 0;
+	M4MulPoints(data.left[0], data.points, data.out_points, data.count);
+	for(u32 i=0; i<data.count; i++) {
+		Vec4 point = M4MulV(data.left[0], data.points[i]);
+		if(!CompareMem(&point, data.out_points + i, sizeof(Vec4))) batch_mismatches++;
+	}
+	M4MulN(data.left, data.right, data.out, data.count);
+	for(u32 i=0; i<data.count; i++) {
+		Mat4 product = M4Mul(data.left[i], data.right[i]);
+		if(!CompareMem(&product, data.out + i, sizeof(Mat4))) batch_mismatches++;
+	}
+	MakeTransformMatrices(data.transforms, data.out, data.count - 3);
+	for(u32 i=0; i<data.count - 3; i++) {
+		Mat4 model = MakeTransformMatrix(data.transforms[i]);
+		if(!CompareMem(&model, data.out + i, sizeof(Mat4))) batch_mismatches++;
+	}
+	HeadlessCheck(batch_mismatches == 0);
+
+	float sin_error = 0.0f;
+	float inverse_error = 0.0f;
+	u32 exact_mismatches = 0;
+	for(u32 i=0; i<=100000; i++) {
+		float angle = -50.0f + 100.0f*i/100000.0f;
+		sin_error = Max(sin_error, Max(Abs(Sin(angle) - sinf(angle)), Abs(Cos(angle) - cosf(angle))));
+
+		float t = -1.0f + 2.0f*i/100000.0f;
+		inverse_error = Max(inverse_error, Max(Abs(ASin(t) - asinf(t)), Abs(ACos(t) - acosf(t))));
+		inverse_error = Max(inverse_error, Abs(ATan2(t, angle) - atan2f(t, angle)));
+		inverse_error = Max(inverse_error, Abs(ATan2(angle, t) - atan2f(angle, t)));
+
+		if(SquareRoot(Abs(angle)) != sqrtf(Abs(angle)) || Floor(angle) != floorf(angle) || Ceil(angle) != ceilf(angle))
+			exact_mismatches++;
+	}
+	HeadlessCheck(sin_error < 2e-6f);
+	HeadlessCheck(inverse_error < 2e-6f);
+	HeadlessCheck(exact_mismatches == 0);
+	printf("math          %10.2e sin/cos, %.2e inverse trig max error against libm\n", sin_error, inverse_error);
+
+	EndTemporaryMemory(&temp);
+}
+
+// Cycles per operation of the scalar references, the SSE kernels and their batches, best of the rounds
+static void
+BenchMath(MemoryArena* arena) {
+	TemporaryMemory temp = BeginTemporaryMemory(arena);
+	HeadlessMathData data = MakeHeadlessMathData(HEADLESS_MATH_COUNT, arena);
+	u32 count = data.count;
+	u64 cycles[4][3];
+	for(u32 i=0; i<4; i++)
+		for(u32 j=0; j<3; j++) cycles[i][j] = U64Max;
+
+	for(u32 round=0; round<HEADLESS_MATH_ROUNDS; round++) {
+		u64 start = __rdtsc();
+		for(u32 i=0; i<count; i++) data.out[i] = M4MulScalar(data.left[i], data.right[i]);
+		u64 middle = __rdtsc();
+		for(u32 i=0; i<count; i++) data.out[i] = M4Mul(data.left[i], data.right[i]);
+		u64 end = __rdtsc();
+		M4MulN(data.left, data.right, data.out, count);
+		u64 batch = __rdtsc();
+		cycles[0][0] = Min(cycles[0][0], middle - start);
+		cycles[0][1] = Min(cycles[0][1], end - middle);
+		cycles[0][2] = Min(cycles[0][2], batch - end);
+
+		start = __rdtsc();
+		for(u32 i=0; i<count; i++) data.out_points[i] = M4MulVScalar(data.left[0], data.points[i]);
+		middle = __rdtsc();
+		for(u32 i=0; i<count; i++) data.out_points[i] = M4MulV(data.left[0], data.points[i]);
+		end = __rdtsc();
+		M4MulPoints(data.left[0], data.points, data.out_points, count);
+		batch = __rdtsc();
+		cycles[1][0] = Min(cycles[1][0], middle - start);
+		cycles[1][1] = Min(cycles[1][1], end - middle);
+		cycles[1][2] = Min(cycles[1][2], batch - end);
+
+		start = __rdtsc();
+		for(u32 i=0; i<count; i++) data.out_quats[i] = QuatMulScalar(data.quats[i], data.quats[count - 1 - i]);
+		middle = __rdtsc();
+		for(u32 i=0; i<count; i++) data.out_quats[i] = QuatMul(data.quats[i], data.quats[count - 1 - i]);
+		end = __rdtsc();
+		cycles[2][0] = Min(cycles[2][0], middle - start);
+		cycles[2][1] = Min(cycles[2][1], end - middle);
+
+		start = __rdtsc();
+		for(u32 i=0; i<count; i++) data.out[i] = MakeTransformMatrixScalar(data.transforms[i]);
+		middle = __rdtsc();
+		for(u32 i=0; i<count; i++) data.out[i] = MakeTransformMatrix(data.transforms[i]);
+		end = __rdtsc();
+		MakeTransformMatrices(data.transforms, data.out, count);
+		batch = __rdtsc();
+		cycles[3][0] = Min(cycles[3][0], middle - start);
+		cycles[3][1] = Min(cycles[3][1], end - middle);
+		cycles[3][2] = Min(cycles[3][2], batch - end);
+	}
+
+	// The single transform is scalar, against the reference's three matrix products
+	char* names[] = { "m4 mul", "m4 mul v", "quat mul", "transform" };
+	char* kinds[] = { "scalar/SSE/batch", "scalar/SSE/batch", "scalar/SSE", "products/single/batch" };
+	for(u32 i=0; i<ArrayCount(names); i++) {
+		printf("%-13s %10.2f/%.2f", names[i], cycles[i][0]/(double)count, cycles[i][1]/(double)count);
+		if(cycles[i][2] != U64Max) printf("/%.2f", cycles[i][2]/(double)count);
+		printf(" cycles %s\n", kinds[i]);
+	}
+
+	EndTemporaryMemory(&temp);
+}
+
+#define HEADLESS_JOBS 1024
+#define HEADLESS_NESTED_JOBS 16
+#define HEADLESS_BENCH_JOBS (1 << 16)
+#define HEADLESS_FAN_OUT 64
+#define HEADLESS_FAN_OUT_ROUNDS 1000
+
+struct HeadlessJob {
+	PlatformJobSystem* system;
+	u32 index;
+	u32 volatile runs;
+	u32 volatile nested_runs;
+	PlatformJobCounter* dependency;		// has to be at zero when the job runs
+	bool dependency_done;
+	bool scratch_intact;
+	bool thread_valid;
+};
+
+static PLATFORM_JOB_CALLBACK(DoHeadlessJob) {
+	HeadlessJob* job = (HeadlessJob*)data;
+	AtomicAddU32(&job->runs, 1);
+	job->thread_valid = context->thread_index <= job->system->worker_count;
+	if(job->dependency) job->dependency_done = job->dependency->count == 0;
+
+	// Filled, then checked after other jobs had a chance to run on this thread
+	u32* scratch = PushJobScratchArray(context, u32, 256);
+	for(u32 i=0; i<256; i++) scratch[i] = job->index*256 + i;
+	for(volatile u32 spin=0; spin<job->index % 64; spin++);
+	job->scratch_intact = true;
+	for(u32 i=0; i<256; i++) if(scratch[i] != job->index*256 + i) job->scratch_intact = false;
+}
+
+static PLATFORM_JOB_CALLBACK(DoHeadlessNestedJob) {
+	HeadlessJob* job = (HeadlessJob*)data;
+	u64 used = context->scratch->used;
+
+	HeadlessJob* children = PushJobScratchArray(context, HeadlessJob, HEADLESS_NESTED_JOBS);
+	PlatformJob* jobs = PushJobScratchArray(context, PlatformJob, HEADLESS_NESTED_JOBS);
+	for(u32 i=0; i<HEADLESS_NESTED_JOBS; i++) {
+		children[i] = {};
+		children[i].system = job->system;
+		children[i].index = job->index*HEADLESS_NESTED_JOBS + i;
+		jobs[i] = { DoHeadlessJob, children + i };
+	}
+
+	PlatformJobCounter counter = {};
+	platform_api.add_jobs(job->system, jobs, HEADLESS_NESTED_JOBS, &counter, 0);
+	platform_api.wait_for_counter(job->system, &counter);
+
+	// Jobs run during the wait took their scratch from above ours and gave it back
+	job->scratch_intact = context->scratch->used == used + sizeof(HeadlessJob)*HEADLESS_NESTED_JOBS +
+		sizeof(PlatformJob)*HEADLESS_NESTED_JOBS;
+	for(u32 i=0; i<HEADLESS_NESTED_JOBS; i++) {
+		if(children[i].runs != 1 || !children[i].scratch_intact) job->scratch_intact = false;
+		AtomicAddU32(&job->nested_runs, children[i].runs);
+	}
+	AtomicAddU32(&job->runs, 1);
+}
+
+// Every job runs once, nested waits finish and a batch behind a counter starts after it
+static void
+CheckJobSystem(PlatformJobSystem* system, MemoryArena* arena) {
+	TemporaryMemory temp = BeginTemporaryMemory(arena);
+	HeadlessJob* data = PushArrayClear(arena, HeadlessJob, 2*HEADLESS_JOBS);
+	PlatformJob* jobs = PushArray(arena, PlatformJob, 2*HEADLESS_JOBS);
+
+	for(u32 i=0; i<2*HEADLESS_JOBS; i++) {
+		data[i].system = system;
+		data[i].index = i;
+		jobs[i] = { DoHeadlessJob, data + i };
+	}
+
+	PlatformJobCounter first = {};
+	PlatformJobCounter second = {};
+	for(u32 i=HEADLESS_JOBS; i<2*HEADLESS_JOBS; i++) data[i].dependency = &first;
+	platform_api.add_jobs(system, jobs, HEADLESS_JOBS, &first, 0);
+	platform_api.add_jobs(system, jobs + HEADLESS_JOBS, HEADLESS_JOBS, &second, &first);
+	platform_api.wait_for_counter(system, &second);
+	HeadlessCheck(first.count == 0 && second.count == 0 && !first.dependents);
+
+	u32 failures = 0;
+	for(u32 i=0; i<2*HEADLESS_JOBS; i++) {
+		HeadlessJob* job = data + i;
+		if(job->runs != 1 || !job->scratch_intact || !job->thread_valid) failures++;
+		if(job->dependency && !job->dependency_done) failures++;
+	}
+	HeadlessCheck(failures == 0);
+
+	ZeroArray(data, HEADLESS_JOBS);
+	for(u32 i=0; i<HEADLESS_JOBS; i++) {
+		data[i].system = system;
+		data[i].index = i;
+		jobs[i] = { DoHeadlessNestedJob, data + i };
+	}
+	PlatformJobCounter nested = {};
+	platform_api.add_jobs(system, jobs, HEADLESS_JOBS, &nested, 0);
+	platform_api.wait_for_counter(system, &nested);
+
+	failures = 0;
+	for(u32 i=0; i<HEADLESS_JOBS; i++) {
+		if(data[i].runs != 1 || data[i].nested_runs != HEADLESS_NESTED_JOBS || !data[i].scratch_intact) failures++;
+	}
+	HeadlessCheck(failures == 0);
+	HeadlessCheck(linux_job_context.scratch && linux_job_context.scratch->used == 0);
+
+	EndTemporaryMemory(&temp);
+}
+
+static PLATFORM_JOB_CALLBACK(DoEmptyJob) {
+}
+
+struct HeadlessSpawn {
+	PlatformJobSystem* system;
+	PlatformJob* jobs;
+	u32 count;
+};
+
+static PLATFORM_JOB_CALLBACK(DoHeadlessSpawn) {
+	HeadlessSpawn* spawn = (HeadlessSpawn*)data;
+	PlatformJobCounter counter = {};
+	platform_api.add_jobs(spawn->system, spawn->jobs, spawn->count, &counter, 0);
+	platform_api.wait_for_counter(spawn->system, &counter);
+}
+
+// Empty jobs added from this thread and from inside a job, and the time to add a few and wait for them
+static void
+BenchJobSystem(PlatformJobSystem* system, MemoryArena* arena) {
+	TemporaryMemory temp = BeginTemporaryMemory(arena);
+	PlatformJob* jobs = PushArray(arena, PlatformJob, HEADLESS_BENCH_JOBS);
+	for(u32 i=0; i<HEADLESS_BENCH_JOBS; i++) jobs[i] = { DoEmptyJob, 0 };
+
+	PlatformJobCounter counter = {};
+	u64 start = LinuxTimeNS();
+	platform_api.add_jobs(system, jobs, HEADLESS_BENCH_JOBS, &counter, 0);
+	platform_api.wait_for_counter(system, &counter);
+	u64 shared_ns = LinuxTimeNS() - start;
+
+	// Added to a worker's deque when there is one, the others steal them
+	HeadlessSpawn spawn = { system, jobs, HEADLESS_BENCH_JOBS };
+	PlatformJob spawn_job = { DoHeadlessSpawn, &spawn };
+	start = LinuxTimeNS();
+	platform_api.add_jobs(system, &spawn_job, 1, &counter, 0);
+	platform_api.wait_for_counter(system, &counter);
+	u64 spawned_ns = LinuxTimeNS() - start;
+
+	u64 fan_ns = 0;
+	u64 max_fan_ns = 0;
+	for(u32 i=0; i<HEADLESS_FAN_OUT_ROUNDS; i++) {
+		start = LinuxTimeNS();
+		platform_api.add_jobs(system, jobs, HEADLESS_FAN_OUT, &counter, 0);
+		platform_api.wait_for_counter(system, &counter);
+		u64 ns = LinuxTimeNS() - start;
+		fan_ns += ns;
+		max_fan_ns = Max(max_fan_ns, ns);
+	}
+
+	printf("empty jobs    %10.2f M/s added here, %.2f M/s from a job\n",
+			HEADLESS_BENCH_JOBS*1e3/(double)Max(shared_ns, 1), HEADLESS_BENCH_JOBS*1e3/(double)Max(spawned_ns, 1));
+	printf("fan out/in    %10.2f us for %u jobs, %.2f max\n", fan_ns/(double)HEADLESS_FAN_OUT_ROUNDS/1000.0,
+			HEADLESS_FAN_OUT, max_fan_ns/1000.0);
+
+	EndTemporaryMemory(&temp);
+}
+
+#define HEADLESS_ENTITY_GRID 64		// mines on a side
+#define HEADLESS_ENTITY_PLAYERS 8
+#define HEADLESS_ENTITY_FRAMES 60
+
+static u64
+HashHeadlessBytes(u64 hash, void* data, u64 size) {
+	u8* bytes = (u8*)data;
+	for(u64 i=0; i<size; i++) hash = (hash ^ bytes[i])*0x100000001b3ull;
+	return hash;
+}
+
+// The test mode's level with a grid of mines closing in on a row of players
+static void
+SpawnHeadlessEntities(GameState* game_state, Mesh mesh, MeshBounds* bounds) {
+	BoundingBox level = { V3(-600.0f, -600.0f, -50.0f), V3(600.0f, 600.0f, 50.0f) };
+	SpawnLevelBoundary(level, game_state);
+
+	for(u32 i=0; i<HEADLESS_ENTITY_GRID*HEADLESS_ENTITY_GRID; i++) {
+		Entity* entity = AllocEntity(&game_state->entity_blob);
+		entity->properties = ENTITY_PROPERTY_Mesh | ENTITY_PROPERTY_SpinInPlace | ENTITY_PROPERTY_BoundingBox |
+			ENTITY_PROPERTY_SimpleChase | ENTITY_PROPERTY_DealsCollisionDamage | ENTITY_PROPERTY_TakesCollisionDamage |
+			ENTITY_PROPERTY_HasHealth;
+		entity->team = TEAM_ENEMY;
+		entity->response = RESPONSE_HOSTILE;
+		entity->health = 10;
+		entity->attack_damage = 10;
+		entity->mesh_bounds = bounds;
+		entity->bb_mesh_space = GetBoundingBoxFromMeshBounds(bounds);
+		entity->transform = TransformI();
+		entity->transform.scale = V3(6.0f, 6.0f, 6.0f);
+		entity->transform.position = V3((float)(i % HEADLESS_ENTITY_GRID)*14.0f - 441.0f,
+				(float)(i / HEADLESS_ENTITY_GRID)*14.0f - 441.0f, 0.0f);
+		entity->bb_object_space = UpdateBoundingBox(&entity->bb_mesh_space, &entity->transform);
+		entity->mesh_pipeline.mesh = mesh;
+		entity->spin_axis = (u8)(i % 3);
+		entity->spin_amount = 1.0f;
+		entity->speed = 1.0f;
+		entity->acceleration = 1.0f;
+	}
+
+	for(u32 i=0; i<HEADLESS_ENTITY_PLAYERS; i++) {
+		Entity* entity = AllocEntity(&game_state->entity_blob);
+		entity->properties = ENTITY_PROPERTY_Mesh | ENTITY_PROPERTY_PlayerControlled | ENTITY_PROPERTY_BoundingBox |
+			ENTITY_PROPERTY_HasHealth | ENTITY_PROPERTY_TakesCollisionDamage | ENTITY_PROPERTY_DealsCollisionDamage |
+			ENTITY_PROPERTY_Movable;
+		entity->team = TEAM_PLAYER;
+		entity->response = RESPONSE_HOSTILE;
+		entity->health = 100000;
+		entity->attack_damage = 1;
+		entity->mesh_bounds = bounds;
+		entity->bb_mesh_space = GetBoundingBoxFromMeshBounds(bounds);
+		entity->transform = TransformI();
+		entity->transform.scale = V3(0.01f, 0.01f, 0.01f);
+		entity->transform.position = V3((float)i*100.0f - 350.0f, 5.0f, 0.0f);
+		entity->bb_object_space = UpdateBoundingBox(&entity->bb_mesh_space, &entity->transform);
+		entity->mesh_pipeline.mesh = mesh;
+	}
+}
+
+// Hash of what every frame drew and of the entities at the end
+static u64
+RunHeadlessEntities(GameState* game_state, PlatformJobSystem* system, Mesh mesh, MeshBounds* bounds, u64* update_ns) {
+	MemoryArena entity_arena = {};
+	ZeroStruct(game_state->entity_blob);
+	game_state->entity_blob.permanent_arena = &entity_arena;
+	game_state->entity_blob.frame_arena = game_state->frame_arena;
+	game_state->job_system = system;
+	SpawnHeadlessEntities(game_state, mesh, bounds);
+
+	u64 hash = 0xcbf29ce484222325ull;
+	Input input = {};
+	*update_ns = 0;
+	for(u32 frame=0; frame<HEADLESS_ENTITY_FRAMES; frame++) {
+		TemporaryMemory temp = BeginTemporaryMemory(game_state->frame_arena);
+		ResetMeshRenderer(game_state->mesh_renderer);
+		ResetQuadRenderer(game_state->quad_renderer);
+#ifdef INTERNAL
+		ResetDebugDraw(game_state->debug_draw);
+#endif
+		input.buttons[WIN32_BUTTON_D].held = frame % 20 < 10;
+
+		u64 start = LinuxTimeNS();
+		UpdateEntities(game_state, &input);
+		*update_ns += LinuxTimeNS() - start;
+
+		MeshRenderer* mesh_renderer = game_state->mesh_renderer;
+		hash = HashHeadlessBytes(hash, &mesh_renderer->count, sizeof(mesh_renderer->count));
+		hash = HashHeadlessBytes(hash, mesh_renderer->instances, sizeof(MeshInfo)*mesh_renderer->count);
+		EndTemporaryMemory(&temp);
+	}
+
+	for(Entity* entity = game_state->entity_blob.entities; entity; entity = entity->next) {
+		hash = HashHeadlessBytes(hash, &entity->transform, sizeof(entity->transform));
+		hash = HashHeadlessBytes(hash, &entity->health, sizeof(entity->health));
+		hash = HashHeadlessBytes(hash, &entity->bb_object_space, sizeof(entity->bb_object_space));
+	}
+	hash = HashHeadlessBytes(hash, &game_state->entity_blob.entity_count, sizeof(u32));
+
+	ClearMemoryArena(&entity_arena);
+	return hash;
+}
+
+// UpdateEntities on 1 to worker_count + 1 threads, every run has to come out the same as the first
+static void
+BenchEntityPhases(PlatformJobSystem* job_system, Renderer* renderer, WindowDimensions wd, Mesh mesh, MemoryArena* arena,
+		MemoryArena* frame_arena) {
+	GameState* game_state = PushStructClear(arena, GameState);
+	game_state->frame_arena = frame_arena;
+	game_state->camera = DefaultPerspectiveCamera(wd, arena);
+	game_state->camera->position = V3(0.0f, 0.0f, 300.0f);
+	game_state->mesh_renderer = InitMeshRenderer(renderer, arena);
+	game_state->quad_renderer = InitQuadRenderer(renderer, arena);
+#ifdef INTERNAL
+	game_state->debug_draw = InitDebugDraw(renderer, arena);
+#endif
+
+	MeshBounds* bounds = PushStructClear(arena, MeshBounds);
+	bounds->min = V3(-1.0f, -1.0f, -1.0f);
+	bounds->max = V3(1.0f, 1.0f, 1.0f);
+	bounds->half_size = V3(1.0f, 1.0f, 1.0f);
+	bounds->sphere_radius = 1.7320508f;
+
+	u32 entity_count = 1 + HEADLESS_ENTITY_GRID*HEADLESS_ENTITY_GRID + HEADLESS_ENTITY_PLAYERS;
+	u64 first_hash = 0;
+	u64 first_ns = 0;
+	for(u32 workers=0; workers<=job_system->worker_count; workers++) {
+		PlatformJobSystem* system = workers == job_system->worker_count ? job_system : LinuxCreateJobSystem(workers);
+		u64 update_ns;
+		u64 hash = RunHeadlessEntities(game_state, system, mesh, bounds, &update_ns);
+		if(!workers) {
+			first_hash = hash;
+			first_ns = update_ns;
+			HeadlessCheck(game_state->entity_blob.entity_count < entity_count);
+		}
+		HeadlessCheck(hash == first_hash);
+
+		printf("entities      %10.2f us/frame, %u threads, %.2fx, %u entities\n", update_ns/(double)HEADLESS_ENTITY_FRAMES/1000.0,
+				workers + 1, first_ns/(double)Max(update_ns, 1), entity_count);
+	}
+}
+
+static void
+WriteRenderStatsHeaderCSV(FILE* file) {
+	fprintf(file, "frame,record_ns,submit_ns");
+	for(u32 i=0; i<RENDER_LIST_TOTAL; i++) fprintf(file, ",%s_cycles", render_stats_list_names[i]);
+	fprintf(file, ",merge_cycles,execute_cycles,present_cycles,items,commands,draws,vertices,state_commands,state_changes,"
+			"buffer_bytes,upload_bytes,upload_waits,resources_created,resources_freed");
+	for(u32 i=0; i<RENDER_STATS_PASSES; i++) {
+		char* name = render_stats_pass_names[i];
+		fprintf(file, ",%s_items,%s_draws,%s_vertices,%s_state_changes,%s_buffer_bytes", name, name, name, name, name);
+	}
+	for(u32 i=0; i<RENDER_COMMAND_TOTAL; i++) fprintf(file, ",%s", render_command_names[i]);
+	fprintf(file, "\n");
+}
+
+static void
+WriteRenderStatsCSV(FILE* file, u32 frame, u64 record_ns, u64 submit_ns, RenderQueueStats* stats) {
+	fprintf(file, "%u,%llu,%llu", frame, (unsigned long long)record_ns, (unsigned long long)submit_ns);
+	for(u32 i=0; i<RENDER_LIST_TOTAL; i++) fprintf(file, ",%llu", (unsigned long long)stats->list_cycles[i]);
+	fprintf(file, ",%llu,%llu,%llu,%u,%u,%u,%llu,%u,%u,%u,%u,%u,%u,%u",
+			(unsigned long long)stats->merge_cycles, (unsigned long long)stats->execute_cycles,
+			(unsigned long long)stats->present_cycles, stats->items, stats->commands, stats->draws,
+			(unsigned long long)stats->vertices, stats->state_commands, stats->state_changes, stats->buffer_bytes,
+			stats->upload_bytes, stats->upload_waits, stats->resources_created, stats->resources_freed);
+	for(u32 i=0; i<RENDER_STATS_PASSES; i++) {
+		RenderPassStats* pass = stats->passes + i;
+		fprintf(file, ",%u,%u,%llu,%u,%u", pass->items, pass->draws, (unsigned long long)pass->vertices,
+				pass->state_changes, pass->buffer_bytes);
+	}
+	for(u32 type=0; type<RENDER_COMMAND_TOTAL; type++) {
+		u32 count = 0;
+		for(u32 i=0; i<RENDER_STATS_PASSES; i++) count += stats->passes[i].commands[type];
+		fprintf(file, ",%u", count);
+	}
+	fprintf(file, "\n");
+}
+
+#ifdef RENDERER_SOFTWARE
+// Channels may differ by a couple of steps between compilers and optimization levels
+#define HEADLESS_COMPARE_TOLERANCE 2
+
+static bool
+CompareHeadlessGolden(char* path, Renderer* renderer) {
+	SoftwareResource* backbuffer = (SoftwareResource*)renderer->backbuffer.texture;
+
+	int width, height, components;
+	u8* golden = stbi_load(path, &width, &height, &components, 4);
+	if(!golden) {
+		fprintf(stderr, "could not load %s\n", path);
+		return false;
+	}
+	if((u32)width != backbuffer->width || (u32)height != backbuffer->height) {
+		fprintf(stderr, "%s is %dx%d, frame is %ux%u\n", path, width, height, backbuffer->width, backbuffer->height);
+		stbi_image_free(golden);
+		return false;
+	}
+
+	u32 mismatches = 0;
+	for(u32 y=0; y<backbuffer->height; y++) {
+		u8* row = backbuffer->data + y*backbuffer->pitch*4;
+		u8* golden_row = golden + y*width*4;
+		for(u32 x=0; x<backbuffer->width*4; x++) {
+			if(Abs((i32)row[x] - (i32)golden_row[x]) > HEADLESS_COMPARE_TOLERANCE) {
+				mismatches++;
+				break;
+			}
+		}
+	}
+
+	stbi_image_free(golden);
+	if(mismatches) fprintf(stderr, "%u rows differ from %s\n", mismatches, path);
+	return mismatches == 0;
+}
+#endif
+
+// What the render stage checks every frame against, and what it measured
+struct HeadlessRun {
+	Renderer* renderer;
+	PostProcessRenderer* pp_renderer;
+	MemoryArena* frame_arena;
+	FILE* csv;
+	char* capture_path;
+
+	u64 expected_bytes;
+	u64 expected_buffer_bytes;
+	u32 expected_draws;
+	u32 expected_world_draws;
+	u32 expected_upload;
+
+	u64 simulate_begin_ns[FRAME_SNAPSHOTS];
+	u32 next_frame;
+	u64 record_ns;
+	u64 submit_ns;
+	u64 latency_ns;
+	u64 max_latency_ns;
+};
+
+static FRAME_STAGE_CALLBACK(RenderHeadlessFrame) {
+	HeadlessRun* run = (HeadlessRun*)data;
+	Renderer* renderer = run->renderer;
+	PostProcessRenderer* pp_renderer = run->pp_renderer;
+	u32 frame = snapshot->frame;
+	bool edges = snapshot->flags & FRAME_FLAG_Edges;
+	HeadlessCheck(frame == run->next_frame);
+	run->next_frame = frame + 1;
+
+	TemporaryMemory frame_temp = BeginTemporaryMemory(run->frame_arena);
+	u64 start = LinuxTimeNS();
+
+	RendererBeginFrame(renderer, snapshot->window_dim, run->frame_arena);
+
+	BeginPostProcess(pp_renderer, renderer);
+	u32 scene = pp_renderer->scene;
+	if(edges) {
+		u32 edge_target = CreatePostProcessTarget("Edges", 1, pp_renderer, renderer);
+		PushPostProcessPass("Edge", POST_PROCESS_TYPE_Edge, scene, edge_target, pp_renderer);
+		scene = edge_target;
+	}
+	PushPostProcessPass("Copy", POST_PROCESS_TYPE_Copy, scene, pp_renderer->backbuffer, pp_renderer);
+	EndPostProcess(pp_renderer, renderer);
+
+	AddRenderListWork(renderer, pp_renderer, snapshot, run->frame_arena);
+	platform_api.complete_all_work(renderer->work_queue);
+
+	// The first frame is not timed, the merged stream has to match the lists recorded on this thread
+	if(!frame) HeadlessCheck(CheckRenderListDeterminism(renderer, pp_renderer, snapshot, run->frame_arena));
+
+	ResetQuadRenderer(snapshot->quad_renderer);
+	ResetMeshRenderer(snapshot->mesh_renderer);
+#ifdef INTERNAL
+	ResetDebugDraw(snapshot->debug_draw);
+#endif
+
+	u64 recorded = LinuxTimeNS();
+	if(snapshot->flags & FRAME_FLAG_Capture) RequestRenderCapture(renderer, run->capture_path);
+	RendererEndFrame(renderer);
+	u64 end = LinuxTimeNS();
+
+	// First frame pays for the list arenas
+	if(frame) {
+		u64 latency = end - run->simulate_begin_ns[frame % FRAME_SNAPSHOTS];
+		run->record_ns += recorded - start;
+		run->submit_ns += end - recorded;
+		run->latency_ns += latency;
+		run->max_latency_ns = Max(run->max_latency_ns, latency);
+	}
+
+	RenderQueueStats* frame_stats = GetRenderStats(renderer);
+	if(run->csv) WriteRenderStatsCSV(run->csv, frame, recorded - start, end - recorded, frame_stats);
+
+	RenderPassStats* world = frame_stats->passes + RENDER_PASS_World;
+	HeadlessCheck(frame_stats->draws == run->expected_draws);
+	HeadlessCheck(world->draws == run->expected_world_draws && world->items == world->draws);
+	HeadlessCheck(frame_stats->passes[RENDER_PASS_PostProcess].draws == (edges ? 2u : 1u));
+	HeadlessCheck(frame_stats->buffer_bytes == run->expected_buffer_bytes);
+	HeadlessCheck(frame_stats->upload_bytes == run->expected_upload);
+	HeadlessCheck(frame_stats->upload_waits == 0);
+#ifdef RENDERER_NULL
+	NullFrameStats* stats = &renderer->null_device.stats_last_frame;
+	HeadlessCheck(stats->draws == run->expected_draws);
+	HeadlessCheck(stats->vertices == frame_stats->vertices);
+	HeadlessCheck(stats->bytes_uploaded == run->expected_bytes);
+#else
+	SoftwareFrameStats* stats = &renderer->software_device.stats_last_frame;
+	HeadlessCheck(stats->draws == run->expected_draws);
+	// The post process pass covers the whole target at least once
+	HeadlessCheck(stats->pixels_shaded >= snapshot->window_dim.width*snapshot->window_dim.height);
+#endif
+	// Init uploads land in the first frame's count, so do the targets left from CheckFrameGraph
+	if(frame) HeadlessCheck(frame_stats->resources_created == 0 && frame_stats->resources_freed == 0);
+	FrameGraphStats* graph_stats = &pp_renderer->graph.stats;
+	HeadlessCheck(graph_stats->targets == (edges ? 1u : 0u));
+	if(frame) HeadlessCheck(graph_stats->targets_created == 0 && graph_stats->targets_freed == 0);
+
+	EndTemporaryMemory(&frame_temp);
+}
+
+int
+main(int argc, char** argv) {
+	u32 numbers[] = { 1000, 4096, 2048 };
+	u32 number_count = 0;
+	char* dump_path = 0;
+	char* compare_path = 0;
+	char* capture_path = 0;
+	char* csv_path = 0;
+	bool debug_shapes = false;
+	bool edges = false;
+	float render_scale = 1.0f;
+	bool pipelined = false;
+	u32 worker_count = LinuxGetWorkerCount();
+	for(i32 i=1; i<argc; i++) {
+		if(StringCompare(argv[i], "-dump") && i + 1 < argc) dump_path = argv[++i];
+		else if(StringCompare(argv[i], "-compare") && i + 1 < argc) compare_path = argv[++i];
+		else if(StringCompare(argv[i], "-capture") && i + 1 < argc) capture_path = argv[++i];
+		else if(StringCompare(argv[i], "-csv") && i + 1 < argc) csv_path = argv[++i];
+		else if(StringCompare(argv[i], "-debug")) debug_shapes = true;
+		else if(StringCompare(argv[i], "-edges")) edges = true;
+		else if(StringCompare(argv[i], "-scale") && i + 1 < argc) render_scale = (float)atof(argv[++i]);
+		else if(StringCompare(argv[i], "-pipelined")) pipelined = true;
+		else if(StringCompare(argv[i], "-workers") && i + 1 < argc) worker_count = (u32)atoi(argv[++i]);
+		else if(number_count < ArrayCount(numbers)) numbers[number_count++] = (u32)atoi(argv[i]);
+	}
+
+	u32 frame_count = numbers[0];
+	u32 mesh_count = numbers[1];
+	u32 quad_count = numbers[2];
+	Assert(frame_count);
+	Assert(mesh_count <= MAX_MESH_INSTANCES);
+	Assert(quad_count <= MAX_TEXTURED_QUADS);
+
+	FILE* csv = 0;
+	if(csv_path) {
+		csv = fopen(csv_path, "w");
+		if(!csv) {
+			fprintf(stderr, "could not write %s\n", csv_path);
+			return 1;
+		}
+		WriteRenderStatsHeaderCSV(csv);
+	}
+
+	LinuxSetPlatformAPI();
+	CheckUploadRing();
+
+	worker_count = Min(worker_count, MAX_WORKER_THREADS);
+	PlatformJobSystem* job_system = LinuxCreateJobSystem(worker_count);
+	PlatformWorkQueue work_queue;
+	LinuxInitWorkQueue(&work_queue, job_system);
+	PlatformWorkQueue render_queue;
+	LinuxInitWorkQueue(&render_queue, job_system);
+
+	MemoryArena arena = {};
+	MemoryArena frame_arena = {};
+	CheckJobSystem(job_system, &frame_arena);
+	CheckMath(&frame_arena);
+
+	Win32Window window = {};
+	window.dim = { 1920, 1080 };
+
+	Renderer* renderer = InitRenderer(&window, &arena, &frame_arena);
+	renderer->work_queue = &work_queue;
+	renderer->worker_count = worker_count;
+	if(capture_path) EnableRenderCapture(renderer);
+	PostProcessRenderer* pp_renderer = InitPostProcessRenderer(renderer, &arena);
+	Camera* camera = DefaultPerspectiveCamera(window.dim, &arena);
+#ifndef INTERNAL
+	debug_shapes = false;
+#endif
+
+	HeadlessRun run = {};
+	run.renderer = renderer;
+	run.pp_renderer = pp_renderer;
+	run.frame_arena = &frame_arena;
+	run.csv = csv;
+	run.capture_path = capture_path;
+
+	FramePipeline pipeline = {};
+	InitFramePipeline(&pipeline, renderer, &arena);
+	pipeline.render_queue = pipelined ? &render_queue : 0;
+	pipeline.render_stage = RenderHeadlessFrame;
+	pipeline.render_data = &run;
+
+	Mesh meshes[HEADLESS_MESH_KINDS];
+	for(u32 i=0; i<HEADLESS_MESH_KINDS; i++) meshes[i] = MakeHeadlessCube(renderer);
+	CheckHeavyRenderFrame(renderer, pipeline.snapshots[0].mesh_renderer, meshes, &frame_arena);
+	CheckFrameGraph(renderer, pp_renderer, &frame_arena);
+	CheckDynamicResolution(renderer, pp_renderer, &frame_arena);
+#ifdef RENDERER_NULL
+	CheckPostProcessConstants(renderer, pp_renderer, &frame_arena);
+#endif
+#ifdef RENDERER_NULL
+	CheckPostProcessConstants(renderer, pp_renderer, &frame_arena);
+#endif
+	renderer->render_scale = render_scale;
+
+	// Distinct colors so a dumped frame shows which texture went where
+	u32 pixels[64*64];
+	TextureBuffer* textures[HEADLESS_TEXTURES];
+	for(u32 i=0; i<HEADLESS_TEXTURES; i++) {
+		u32 color = 0xff000000 | ((i*0x35) & 0xff) | (((i*0x71 + 0x40) & 0xff) << 8) | (((0xff - i*0x10) & 0xff) << 16);
+		for(u32 p=0; p<ArrayCount(pixels); p++) pixels[p] = ((p % 64) ^ (p / 64)) & 8 ? color : 0xffffffff;
+		textures[i] = UploadTexture(pixels, 64, 64, 4, TEXTURE_USAGE_Immutable, renderer);
+	}
+	u32 mesh_kinds = Min(mesh_count, HEADLESS_MESH_KINDS);
+	u32 texture_kinds = Min(quad_count, HEADLESS_TEXTURES);
+
+	// Bytes the frame functions push through PushRenderBufferData, the backend has to see all of them
+	u64 expected_bytes = 0;
+	if(quad_count) expected_bytes += sizeof(Mat4) + sizeof(Quad)*quad_count;
+	if(mesh_count) expected_bytes += sizeof(Mat4) + sizeof(LightInfo) + sizeof(MeshInfo)*mesh_count;
+	u64 expected_buffer_bytes = sizeof(Quad)*quad_count + sizeof(MeshInfo)*mesh_count;
+	u32 expected_draws = mesh_kinds + texture_kinds + (edges ? 2 : 1);
+	Assert(render_scale > 0.0f && render_scale <= 1.0f);
+	u32 expected_upload = ((quad_count ? 1 : 0) + (mesh_count ? 2 : 0))*UPLOAD_RING_ALIGNMENT;
+	u32 expected_world_draws = mesh_kinds + texture_kinds;
+	u32 post_process_passes = edges ? 2 : 1;
+	expected_bytes += sizeof(PostProcessConstants)*post_process_passes;
+	expected_upload += UPLOAD_RING_ALIGNMENT*post_process_passes;
+#ifdef INTERNAL
+	if(debug_shapes) {
+		u64 debug_bytes = sizeof(DebugPrimitive)*HEADLESS_DEBUG_SHAPES*DEBUG_PRIMITIVE_TOTAL;
+		expected_bytes += sizeof(DebugDrawConstants) + debug_bytes;
+		expected_buffer_bytes += debug_bytes;
+		expected_draws += DEBUG_PRIMITIVE_TOTAL;
+		expected_world_draws += DEBUG_PRIMITIVE_TOTAL;
+		expected_upload += UPLOAD_RING_ALIGNMENT;
+	}
+#endif
+
+	run.expected_bytes = expected_bytes;
+	run.expected_buffer_bytes = expected_buffer_bytes;
+	run.expected_draws = expected_draws;
+	run.expected_world_draws = expected_world_draws;
+	run.expected_upload = expected_upload;
+
+	// Simulation stage, fills the snapshot and hands it to the render stage
+	u64 simulate_ns = 0;
+	u64 loop_start = 0;
+	for(u32 frame=0; frame<frame_count; frame++) {
+		FrameSnapshot* snapshot = BeginFrameSnapshot(&pipeline);
+		u64 start = LinuxTimeNS();
+		run.simulate_begin_ns[frame % FRAME_SNAPSHOTS] = start;
+		if(frame == 1) loop_start = start;
+
+		for(u32 i=0; i<mesh_count; i++) {
+			MeshInfo info;
+			info.model = M4Translate(V3((float)(i % 64) - 32.0f, (float)(i / 64 % 64) - 32.0f, -10.0f - (float)(i / 4096)));
+			info.color = V4((float)(i % 7)/6.0f, (float)(i % 5)/4.0f, (float)(i % 3)/2.0f, 1.0f);
+
+			MeshPipeline mesh_pipeline = { meshes[i % HEADLESS_MESH_KINDS], &info };
+			PushMeshPipeline(mesh_pipeline, snapshot->mesh_renderer);
+		}
+
+		for(u32 i=0; i<quad_count; i++) {
+			Vec3 center = V3((float)(i % 64) - 32.0f, (float)(i / 64 % 64) - 32.0f, -20.0f);
+			Quad quad;
+			quad.tl = V3Add(center, V3(-0.5f,  0.5f, 0.0f));
+			quad.tr = V3Add(center, V3( 0.5f,  0.5f, 0.0f));
+			quad.bl = V3Add(center, V3(-0.5f, -0.5f, 0.0f));
+			quad.br = V3Add(center, V3( 0.5f, -0.5f, 0.0f));
+			PushTexturedQuad(&quad, textures[i % HEADLESS_TEXTURES], snapshot->quad_renderer);
+		}
+
+#ifdef INTERNAL
+		// Spread over the quads so the dumped frame shows every kind, a few lines cross the near plane
+		for(u32 i=0; debug_shapes && i<HEADLESS_DEBUG_SHAPES; i++) {
+			Vec3 center = V3((float)(i % 8)*8.0f - 28.0f, (float)(i / 8)*8.0f - 28.0f, -15.0f);
+			Vec4 color = V4((float)(i % 4)/3.0f, (float)(i % 3)/2.0f, 1.0f, 1.0f);
+			Vec3 end = i % 16 ? V3Add(center, V3(3.0f, 2.0f, 0.0f)) : V3(center.x, center.y, 20.0f);
+			DebugDraw* debug_draw = snapshot->debug_draw;
+			DebugDrawLine(center, end, color, 2.0f, debug_draw);
+			DebugDrawBox(V3Sub(center, V3(1.5f, 1.5f, 1.5f)), V3Add(center, V3(1.5f, 1.5f, 1.5f)), color, 1.0f, debug_draw);
+			DebugDrawSphere(center, 2.5f, color, 1.5f, debug_draw);
+		}
+#endif
+
+		snapshot->window_dim = window.dim;
+		snapshot->camera = *camera;
+		if(edges) snapshot->flags |= FRAME_FLAG_Edges;
+		if(capture_path && frame == frame_count - 1) snapshot->flags |= FRAME_FLAG_Capture;
+		if(frame) simulate_ns += LinuxTimeNS() - start;
+
+		SubmitFrameSnapshot(&pipeline, snapshot);
+		if(headless_failed_checks) break;
+	}
+	FlushFramePipeline(&pipeline);
+	u64 loop_ns = LinuxTimeNS() - loop_start;
+
+	RenderQueueStats* queue = GetRenderStats(renderer);
+	double timed_frames = frame_count > 1 ? (double)(frame_count - 1) : 1.0;
+
+	printf("frames %u, meshes %u, quads %u, %ux%u, workers %u\n", frame_count, mesh_count, quad_count,
+			window.dim.width, window.dim.height, worker_count);
+	printf("simulate      %10.2f us/frame\n", simulate_ns/timed_frames/1000.0);
+	printf("record        %10.2f us/frame\n", run.record_ns/timed_frames/1000.0);
+	printf("merge+execute %10.2f us/frame\n", run.submit_ns/timed_frames/1000.0);
+	printf("latency       %10.2f us/frame, %.2f max\n", run.latency_ns/timed_frames/1000.0, run.max_latency_ns/1000.0);
+	BenchJobSystem(job_system, &frame_arena);
+	BenchMath(&frame_arena);
+	BoundsBench bounds_bench = BenchBounds(&frame_arena);
+	HeadlessCheck(bounds_bench.corners_outside == 0);
+	printf("bounds        %10.2f/%.2f cycles/box SSE/scalar, %u boxes\n",
+			bounds_bench.simd_cycles/(double)bounds_bench.boxes, bounds_bench.scalar_cycles/(double)bounds_bench.boxes,
+			bounds_bench.boxes);
+	BenchEntityPhases(job_system, renderer, window.dim, meshes[0], &arena, &frame_arena);
+	if(frame_count > 1) {
+		printf("throughput    %10.2f frames/s, %s\n", timed_frames*1e9/(double)Max(loop_ns, 1),
+				pipelined ? "pipelined" : "serial");
+	}
+	printf("items %u, draws %u, state commands %u, state changes %u\n",
+			queue->items, queue->draws, queue->state_commands, queue->state_changes);
+#ifdef RENDERER_NULL
+	NullFrameStats* stats = &renderer->null_device.stats_last_frame;
+	printf("backend commands %u, vertices %llu, bytes uploaded %llu\n",
+			stats->commands, (unsigned long long)stats->vertices, (unsigned long long)stats->bytes_uploaded);
+	printf("resources live %u, %llu bytes\n",
+			renderer->null_device.resources_live, (unsigned long long)renderer->null_device.resource_bytes);
+#else
+	SoftwareFrameStats* stats = &renderer->software_device.stats_last_frame;
+	printf("triangles %u, culled %u, bin entries %u, flushes %u, pixels shaded %u\n",
+			stats->triangles, stats->triangles_culled, stats->bin_entries, stats->flushes, stats->pixels_shaded);
+	printf("geometry %llu kcycles, tiles %llu kcycles\n",
+			(unsigned long long)(stats->geometry_cycles/1000), (unsigned long long)(stats->tile_cycles/1000));
+
+	if(dump_path) {
+		HeadlessCheck(WriteSoftwareBackbuffer(dump_path, renderer));
+		printf("wrote %s\n", dump_path);
+	}
+	if(compare_path) HeadlessCheck(CompareHeadlessGolden(compare_path, renderer));
+#endif
+
+	CullBench cull_bench = BenchCulling(camera, &frame_arena);
+	HeadlessCheck(cull_bench.mismatches == 0);
+	printf("culling       %10.2f/%.2f cycles/box SSE/scalar, %u boxes, %u visible\n",
+			cull_bench.simd_cycles/(double)cull_bench.boxes, cull_bench.scalar_cycles/(double)cull_bench.boxes,
+			cull_bench.boxes, cull_bench.visible);
+
+	if(csv) {
+		fclose(csv);
+		printf("wrote %s\n", csv_path);
+	}
+
+	if(headless_failed_checks) {
+		fprintf(stderr, "%u checks failed\n", headless_failed_checks);
+		return 1;
+	}
+	return 0;
+}
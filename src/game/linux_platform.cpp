@@ -0,0 +1,445 @@
+// Linux platform layer for the headless tools. Entries include the system headers it needs
+// ahead of game.cpp, then this file after it.
+
+#define MAX_WORK_QUEUE_ENTRIES 256
+#define MAX_WORKER_THREADS 8
+#define JOB_DEQUE_SIZE 4096				// per worker, a power of two
+#define JOB_SHARED_QUEUE_SIZE 4096		// a power of two
+#define JOB_SCRATCH_SIZE Megabytes(1)
+#define JOB_SPIN_COUNT 256				// tries before a worker sleeps
+
+struct PlatformJobEntry {
+	PlatformJobCallback* callback;
+	void* data;
+	PlatformJobCounter* counter;
+};
+
+// Chase-Lev, the owner pushes and pops at the bottom, thieves take from the top
+struct LinuxJobDeque {
+	i64 volatile top;
+	u8 pad[56];
+	i64 volatile bottom;
+	PlatformJobEntry entries[JOB_DEQUE_SIZE];
+};
+
+struct LinuxJobThread {
+	PlatformJobSystem* system;
+	u32 thread_index;
+};
+
+struct PlatformJobSystem {
+	LinuxJobDeque deques[MAX_WORKER_THREADS];	// worker n owns deques[n - 1]
+	LinuxJobThread threads[MAX_WORKER_THREADS];
+	u32 worker_count;
+
+	// Jobs from threads that are not workers, a ring behind a spin lock
+	u32 volatile shared_lock;
+	u32 volatile shared_read;
+	u32 volatile shared_write;
+	PlatformJobEntry shared[JOB_SHARED_QUEUE_SIZE];
+
+	u32 volatile sleeping;
+	sem_t semaphore;
+};
+
+struct PlatformWorkQueueEntry {
+	PlatformWorkQueue* queue;
+	PlatformWorkQueueCallback* callback;
+	void* data;
+};
+
+// A counter on the job system
+struct PlatformWorkQueue {
+	PlatformJobSystem* system;
+	PlatformJobCounter counter;
+	u32 entry_count;
+	PlatformWorkQueueEntry entries[MAX_WORK_QUEUE_ENTRIES];
+};
+
+static __thread PlatformJobContext linux_job_context;
+
+static PLATFORM_ALLOCATE_MEMORY(linux_allocate_memory) {
+	u64 total_size = sizeof(PlatformMemoryBlock) + size;
+
+	// Anonymous pages come back zeroed, same as VirtualAlloc
+	void* memory = mmap(0, total_size, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+	Assert(memory != MAP_FAILED);
+
+	PlatformMemoryBlock* block = (PlatformMemoryBlock*)memory;
+	block->bp = (u8*)memory + sizeof(PlatformMemoryBlock);
+	block->size = size;
+	return block;
+}
+
+static PLATFORM_DEALLOCATE_MEMORY(linux_deallocate_memory) {
+	if(block) {
+		int result = munmap(block, sizeof(PlatformMemoryBlock) + block->size);
+		Assert(result == 0);
+	}
+}
+
+static PLATFORM_OPEN_FILE(linux_open_file) {
+	PlatformFileHandle result = {};
+	int fd = open((char*)info->name, O_RDONLY);
+
+	struct stat st = {};
+	if(fd >= 0 && fstat(fd, &st) == 0) info->size = (u64)st.st_size;
+
+	result.failed = fd < 0;
+	result.handle = (void*)(intptr_t)fd;
+	return result;
+}
+
+static PLATFORM_CLOSE_FILE(linux_close_file) {
+	Assert(!file_handle->failed);
+	close((int)(intptr_t)file_handle->handle);
+}
+
+static PLATFORM_READ_FILE(linux_read_file) {
+	Assert(!win32_handle->failed);
+	int fd = (int)(intptr_t)win32_handle->handle;
+
+	u8* cursor = (u8*)dst;
+	while(size) {
+		ssize_t bytes_read = read(fd, cursor, size);
+		Assert(bytes_read > 0);
+		cursor += bytes_read;
+		size -= bytes_read;
+	}
+}
+
+static PLATFORM_MAP_FILE(linux_map_file) {
+	PlatformFileMapping result = {};
+	int fd = open((char*)info->name, O_RDONLY);
+
+	struct stat st = {};
+	if(fd < 0 || fstat(fd, &st) != 0 || st.st_size == 0) {
+		if(fd >= 0) close(fd);
+		result.failed = true;
+		return result;
+	}
+	info->size = (u64)st.st_size;
+
+	void* data = mmap(0, info->size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if(data == MAP_FAILED) {
+		result.failed = true;
+		return result;
+	}
+
+	result.data = (u8*)data;
+	result.size = info->size;
+	return result;
+}
+
+static PLATFORM_UNMAP_FILE(linux_unmap_file) {
+	Assert(!file_mapping->failed);
+	munmap(file_mapping->data, file_mapping->size);
+	*file_mapping = {};
+}
+
+static PLATFORM_WRITE_ENTIRE_FILE(linux_write_entire_file) {
+	int fd = open(path, O_WRONLY|O_CREAT|O_TRUNC, 0644);
+	if(fd < 0) return false;
+
+	u8* cursor = (u8*)data;
+	while(size) {
+		ssize_t bytes_written = write(fd, cursor, size);
+		if(bytes_written <= 0) break;
+		cursor += bytes_written;
+		size -= bytes_written;
+	}
+
+	close(fd);
+	return size == 0;
+}
+
+// Same job system as win32.cpp on pthreads and gcc builtins
+static void
+LinuxLockJobs(u32 volatile* lock) {
+	while(__atomic_exchange_n(lock, 1, __ATOMIC_ACQUIRE)) _mm_pause();
+}
+
+static void
+LinuxUnlockJobs(u32 volatile* lock) {
+	__atomic_store_n(lock, 0, __ATOMIC_RELEASE);
+}
+
+static bool
+LinuxPushJobDeque(LinuxJobDeque* deque, PlatformJobEntry* entry) {
+	i64 bottom = __atomic_load_n(&deque->bottom, __ATOMIC_RELAXED);
+	i64 top = __atomic_load_n(&deque->top, __ATOMIC_ACQUIRE);
+	if(bottom - top >= JOB_DEQUE_SIZE) return false;
+
+	deque->entries[bottom & (JOB_DEQUE_SIZE - 1)] = *entry;
+	__atomic_store_n(&deque->bottom, bottom + 1, __ATOMIC_RELEASE);
+	return true;
+}
+
+static bool
+LinuxPopJobDeque(LinuxJobDeque* deque, PlatformJobEntry* entry) {
+	i64 bottom = __atomic_load_n(&deque->bottom, __ATOMIC_RELAXED) - 1;
+	__atomic_store_n(&deque->bottom, bottom, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	i64 top = __atomic_load_n(&deque->top, __ATOMIC_RELAXED);
+
+	if(top > bottom) {
+		__atomic_store_n(&deque->bottom, bottom + 1, __ATOMIC_RELAXED);
+		return false;
+	}
+
+	*entry = deque->entries[bottom & (JOB_DEQUE_SIZE - 1)];
+	if(top < bottom) return true;
+
+	// Last one, a thief may be taking it too
+	bool taken = __atomic_compare_exchange_n(&deque->top, &top, top + 1, false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED);
+	__atomic_store_n(&deque->bottom, bottom + 1, __ATOMIC_RELAXED);
+	return taken;
+}
+
+static bool
+LinuxStealJobDeque(LinuxJobDeque* deque, PlatformJobEntry* entry) {
+	i64 top = __atomic_load_n(&deque->top, __ATOMIC_ACQUIRE);
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	i64 bottom = __atomic_load_n(&deque->bottom, __ATOMIC_ACQUIRE);
+	if(top >= bottom) return false;
+
+	*entry = deque->entries[top & (JOB_DEQUE_SIZE - 1)];
+	return __atomic_compare_exchange_n(&deque->top, &top, top + 1, false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED);
+}
+
+// Own deque first, then the shared queue, then the other workers'
+static bool
+LinuxTakeJob(PlatformJobSystem* system, PlatformJobEntry* entry) {
+	u32 thread_index = linux_job_context.thread_index;
+	if(thread_index && LinuxPopJobDeque(system->deques + thread_index - 1, entry)) return true;
+
+	if(__atomic_load_n(&system->shared_read, __ATOMIC_ACQUIRE) != __atomic_load_n(&system->shared_write, __ATOMIC_ACQUIRE)) {
+		bool taken = false;
+		LinuxLockJobs(&system->shared_lock);
+		if(system->shared_read != system->shared_write) {
+			*entry = system->shared[system->shared_read & (JOB_SHARED_QUEUE_SIZE - 1)];
+			__atomic_store_n(&system->shared_read, system->shared_read + 1, __ATOMIC_RELEASE);
+			taken = true;
+		}
+		LinuxUnlockJobs(&system->shared_lock);
+		if(taken) return true;
+	}
+
+	for(u32 i=0; i<system->worker_count; i++) {
+		u32 victim = (thread_index + i) % system->worker_count;
+		if(victim + 1 == thread_index) continue;
+		if(LinuxStealJobDeque(system->deques + victim, entry)) return true;
+	}
+	return false;
+}
+
+static void LinuxPushJobs(PlatformJobSystem* system, PlatformJob* jobs, u32 count, PlatformJobCounter* counter);
+
+// The thread that takes the count to zero holds the lock while it does, so a waiter that saw
+// zero and no lock is the last one to touch the counter
+static void
+LinuxFinishJob(PlatformJobSystem* system, PlatformJobCounter* counter) {
+	for(;;) {
+		u32 count = __atomic_load_n(&counter->count, __ATOMIC_SEQ_CST);
+		Assert(count);
+		if(count > 1) {
+			if(__atomic_compare_exchange_n(&counter->count, &count, count - 1, false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)) return;
+			continue;
+		}
+
+		PlatformJob* dependents = 0;
+		u32 dependent_count = 0;
+		PlatformJobCounter* dependent_counter = 0;
+
+		LinuxLockJobs(&counter->lock);
+		if(__atomic_sub_fetch(&counter->count, 1, __ATOMIC_SEQ_CST) == 0) {
+			dependents = counter->dependents;
+			dependent_count = counter->dependent_count;
+			dependent_counter = counter->dependent_counter;
+			counter->dependents = 0;
+		}
+		LinuxUnlockJobs(&counter->lock);
+
+		if(dependents) LinuxPushJobs(system, dependents, dependent_count, dependent_counter);
+		return;
+	}
+}
+
+static void
+LinuxRunJob(PlatformJobSystem* system, PlatformJobEntry* entry) {
+	PlatformJobContext* context = &linux_job_context;
+	Assert(context->scratch);
+
+	// Jobs run inside a wait stack their scratch on top of the waiting job's
+	u64 used = context->scratch->used;
+	entry->callback(context, entry->data);
+	context->scratch->used = used;
+
+	if(entry->counter) LinuxFinishJob(system, entry->counter);
+}
+
+static void
+LinuxPushJobs(PlatformJobSystem* system, PlatformJob* jobs, u32 count, PlatformJobCounter* counter) {
+	u32 thread_index = linux_job_context.thread_index;
+
+	for(u32 i=0; i<count; i++) {
+		PlatformJobEntry entry = { jobs[i].callback, jobs[i].data, counter };
+		if(thread_index) {
+			// A full deque runs the job in place
+			if(!LinuxPushJobDeque(system->deques + thread_index - 1, &entry)) LinuxRunJob(system, &entry);
+			continue;
+		}
+
+		LinuxLockJobs(&system->shared_lock);
+		while(system->shared_write - system->shared_read == JOB_SHARED_QUEUE_SIZE) {
+			LinuxUnlockJobs(&system->shared_lock);
+			PlatformJobEntry other;
+			if(LinuxTakeJob(system, &other)) LinuxRunJob(system, &other);
+			LinuxLockJobs(&system->shared_lock);
+		}
+		system->shared[system->shared_write & (JOB_SHARED_QUEUE_SIZE - 1)] = entry;
+		__atomic_store_n(&system->shared_write, system->shared_write + 1, __ATOMIC_RELEASE);
+		LinuxUnlockJobs(&system->shared_lock);
+	}
+
+	// Pairs with the sleeping count going up before a worker looks for jobs one last time
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	u32 wake = Min(count, __atomic_load_n(&system->sleeping, __ATOMIC_SEQ_CST));
+	for(u32 i=0; i<wake; i++) sem_post(&system->semaphore);
+}
+
+static PLATFORM_ADD_JOBS(linux_add_jobs) {
+	if(!count) return;
+	if(counter) __atomic_add_fetch(&counter->count, count, __ATOMIC_SEQ_CST);
+
+	if(dependency) {
+		LinuxLockJobs(&dependency->lock);
+		bool park = __atomic_load_n(&dependency->count, __ATOMIC_SEQ_CST) != 0;
+		if(park) {
+			Assert(!dependency->dependents);
+			dependency->dependents = jobs;
+			dependency->dependent_count = count;
+			dependency->dependent_counter = counter;
+		}
+		LinuxUnlockJobs(&dependency->lock);
+		if(park) return;
+	}
+
+	LinuxPushJobs(system, jobs, count, counter);
+}
+
+// The calling thread runs jobs instead of waiting
+static PLATFORM_WAIT_FOR_COUNTER(linux_wait_for_counter) {
+	while(__atomic_load_n(&counter->count, __ATOMIC_SEQ_CST) || __atomic_load_n(&counter->lock, __ATOMIC_SEQ_CST)) {
+		PlatformJobEntry entry;
+		if(LinuxTakeJob(system, &entry)) LinuxRunJob(system, &entry);
+		else _mm_pause();
+	}
+}
+
+static void*
+LinuxWorkerThreadProc(void* param) {
+	LinuxJobThread* thread = (LinuxJobThread*)param;
+	PlatformJobSystem* system = thread->system;
+	linux_job_context.thread_index = thread->thread_index;
+	linux_job_context.scratch = linux_allocate_memory(JOB_SCRATCH_SIZE);
+
+	for(;;) {
+		PlatformJobEntry entry;
+		bool found = false;
+		for(u32 spin=0; spin<JOB_SPIN_COUNT && !found; spin++) {
+			found = LinuxTakeJob(system, &entry);
+			if(!found) _mm_pause();
+		}
+
+		if(!found) {
+			__atomic_add_fetch(&system->sleeping, 1, __ATOMIC_SEQ_CST);
+			found = LinuxTakeJob(system, &entry);
+			if(!found) sem_wait(&system->semaphore);
+			__atomic_sub_fetch(&system->sleeping, 1, __ATOMIC_SEQ_CST);
+		}
+
+		if(found) LinuxRunJob(system, &entry);
+	}
+	return 0;
+}
+
+// One per core besides the main thread's
+static u32
+LinuxGetWorkerCount() {
+	long processors = sysconf(_SC_NPROCESSORS_ONLN);
+	return Min((u32)(processors > 1 ? processors - 1 : 0), MAX_WORKER_THREADS);
+}
+
+static PlatformJobSystem*
+LinuxCreateJobSystem(u32 worker_count) {
+	Assert(worker_count <= MAX_WORKER_THREADS);
+	PlatformJobSystem* system = (PlatformJobSystem*)linux_allocate_memory(sizeof(PlatformJobSystem))->bp;
+	system->worker_count = worker_count;
+	sem_init(&system->semaphore, 0, 0);
+
+	// The creating thread is the one that adds and waits outside of jobs, it runs them while waiting
+	if(!linux_job_context.scratch) linux_job_context.scratch = linux_allocate_memory(JOB_SCRATCH_SIZE);
+
+	for(u32 i=0; i<worker_count; i++) {
+		LinuxJobThread* thread = system->threads + i;
+		thread->system = system;
+		thread->thread_index = i + 1;
+
+		pthread_t handle;
+		pthread_create(&handle, 0, LinuxWorkerThreadProc, thread);
+		pthread_detach(handle);
+	}
+	return system;
+}
+
+static PLATFORM_JOB_CALLBACK(LinuxDoWorkQueueEntry) {
+	PlatformWorkQueueEntry* entry = (PlatformWorkQueueEntry*)data;
+	entry->callback(entry->queue, entry->data);
+}
+
+static PLATFORM_ADD_WORK_ENTRY(linux_add_work_entry) {
+	Assert(queue->entry_count < MAX_WORK_QUEUE_ENTRIES);
+	PlatformWorkQueueEntry* entry = queue->entries + queue->entry_count++;
+	entry->queue = queue;
+	entry->callback = callback;
+	entry->data = data;
+
+	PlatformJob job = { LinuxDoWorkQueueEntry, entry };
+	linux_add_jobs(queue->system, &job, 1, &queue->counter, 0);
+}
+
+static PLATFORM_COMPLETE_ALL_WORK(linux_complete_all_work) {
+	linux_wait_for_counter(queue->system, &queue->counter);
+	queue->entry_count = 0;
+}
+
+static void
+LinuxInitWorkQueue(PlatformWorkQueue* queue, PlatformJobSystem* system) {
+	ZeroStruct(*queue);
+	queue->system = system;
+}
+
+static u64
+LinuxTimeNS() {
+	timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (u64)ts.tv_sec*1000000000ull + (u64)ts.tv_nsec;
+}
+
+static void
+LinuxSetPlatformAPI() {
+	platform_api.open_file = linux_open_file;
+	platform_api.close_file = linux_close_file;
+	platform_api.read_file = linux_read_file;
+	platform_api.map_file = linux_map_file;
+	platform_api.unmap_file = linux_unmap_file;
+	platform_api.write_entire_file = linux_write_entire_file;
+	platform_api.allocate_memory = linux_allocate_memory;
+	platform_api.deallocate_memory = linux_deallocate_memory;
+	platform_api.add_work_entry = linux_add_work_entry;
+	platform_api.complete_all_work = linux_complete_all_work;
+	platform_api.add_jobs = linux_add_jobs;
+	platform_api.wait_for_counter = linux_wait_for_counter;
+}
@@ -0,0 +1,115 @@
+// Replays a frame written by a render capture, see renderer_capture.cpp. Built against the
+// null backend by default or the software rasterizer with RENDERER_SOFTWARE. The first run
+// is untimed, then the frame runs the given number of times without per command timing to
+// measure decode and dispatch, then again with it to report the backend cost of every
+// command type.
+//
+//   replay capture.rcap [iterations] [-dump out.png]
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#if !defined(RENDERER_SOFTWARE)
+#define RENDERER_NULL
+#endif
+#include "game.cpp"
+#include "linux_platform.cpp"
+
+int
+main(int argc, char** argv) {
+	char* capture_path = 0;
+	char* dump_path = 0;
+	u32 iterations = 1000;
+	for(i32 i=1; i<argc; i++) {
+		if(StringCompare(argv[i], "-dump") && i + 1 < argc) dump_path = argv[++i];
+		else if(!capture_path) capture_path = argv[i];
+		else iterations = (u32)atoi(argv[i]);
+	}
+	if(!capture_path || !iterations) {
+		fprintf(stderr, "usage: replay capture.rcap [iterations] [-dump out.png]\n");
+		return 1;
+	}
+
+	LinuxSetPlatformAPI();
+
+	PlatformFileInfo info = {};
+	info.name = capture_path;
+	PlatformFileMapping file = platform_api.map_file(&info);
+	if(file.failed || file.size < sizeof(RenderCaptureHeader)) {
+		fprintf(stderr, "could not read %s\n", capture_path);
+		return 1;
+	}
+
+	u32 worker_count = LinuxGetWorkerCount();
+	PlatformWorkQueue work_queue;
+	LinuxInitWorkQueue(&work_queue, LinuxCreateJobSystem(worker_count));
+
+	MemoryArena arena = {};
+	MemoryArena frame_arena = {};
+
+	Win32Window window = {};
+	window.dim = ((RenderCaptureHeader*)file.data)->window_dim;
+
+	Renderer* renderer = InitRenderer(&window, &arena, &frame_arena);
+	renderer->work_queue = &work_queue;
+	renderer->worker_count = worker_count;
+
+	RenderCaptureReplay replay;
+	if(!LoadRenderCapture(&replay, file.data, file.size, renderer)) {
+		fprintf(stderr, "%s is not a capture this build can replay\n", capture_path);
+		return 1;
+	}
+
+	ReplayRenderCapture(&replay);
+
+	u64 decode_start_ns = LinuxTimeNS();
+	for(u32 i=0; i<iterations; i++) ReplayRenderCapture(&replay);
+	u64 decode_ns = LinuxTimeNS() - decode_start_ns;
+	u32 commands_per_frame = GetRenderStats(renderer)->commands;
+
+	RenderCommandTimings timings = {};
+	renderer->command_timings = &timings;
+
+	u64 start_ns = LinuxTimeNS();
+	u64 start_cycles = __rdtsc();
+	for(u32 i=0; i<iterations; i++) ReplayRenderCapture(&replay);
+	u64 total_ns = LinuxTimeNS() - start_ns;
+	u64 total_cycles = __rdtsc() - start_cycles;
+	double ns_per_cycle = total_cycles ? (double)total_ns/(double)total_cycles : 0.0;
+
+	RenderQueueStats* queue = GetRenderStats(renderer);
+	printf("%s: %ux%u, %u resources, %u command bytes, %u frees dropped\n", capture_path,
+			window.dim.width, window.dim.height, replay.resource_count, replay.command_size, replay.freed_resources);
+	printf("draws %u, state commands %u, state changes %u\n", queue->draws, queue->state_commands, queue->state_changes);
+	printf("%u iterations, %10.2f us/frame, %6.1f ns/command untimed\n", iterations,
+			decode_ns/(double)iterations/1000.0, decode_ns/(double)iterations/Max(commands_per_frame, 1));
+	printf("%u iterations, %10.2f us/frame timed\n\n", iterations, total_ns/(double)iterations/1000.0);
+
+	printf("%-22s %10s %14s %12s\n", "command", "per frame", "cycles/frame", "ns/command");
+	u64 backend_cycles = 0;
+	for(u32 i=0; i<RENDER_COMMAND_TOTAL; i++) {
+		if(!timings.counts[i]) continue;
+		backend_cycles += timings.cycles[i];
+		printf("%-22s %10.1f %14.0f %12.1f\n", render_command_names[i],
+				timings.counts[i]/(double)iterations, timings.cycles[i]/(double)iterations,
+				timings.cycles[i]*ns_per_cycle/timings.counts[i]);
+	}
+	printf("%-22s %10s %14.0f\n", "front end and present", "", (total_cycles - backend_cycles)/(double)iterations);
+
+#ifdef RENDERER_SOFTWARE
+	if(dump_path) {
+		if(!WriteSoftwareBackbuffer(dump_path, renderer)) return 1;
+		printf("wrote %s\n", dump_path);
+	}
+#endif
+
+	platform_api.unmap_file(&file);
+	return 0;
+}
@@ -1,5 +1,3 @@
-#include <math.h>
-// TODO: Get rid of c math header
 #define Abs(a) ((a) > 0 ? (a) : -(a))
 #define Mod(a, m) (((a) % (m)) >= 0 ? ((a) % (m)) : (((a) % (m)) + (m)))
 
@@ -20,6 +18,104 @@ Clamp(float Min, float Value, float Max) {
 	return(Result);
 }
 
+//------------------------------------------------------------------------
+// In place of the C math header. Square root, floor and ceil are single SSE instructions, the trig
+// functions reduce the argument and run the Cephes minimax polynomials, within a few ulps of libm.
+static float SquareRoot(float x) { return _mm_cvtss_f32(_mm_sqrt_ss(_mm_set_ss(x))); }
+static float Floor(float x) { __m128 v = _mm_set_ss(x); return _mm_cvtss_f32(_mm_floor_ss(v, v)); }
+static float Ceil(float x) { __m128 v = _mm_set_ss(x); return _mm_cvtss_f32(_mm_ceil_ss(v, v)); }
+static float Round(float x) {
+	__m128 v = _mm_set_ss(x);
+	return _mm_cvtss_f32(_mm_round_ss(v, v, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC));
+}
+
+// Angle less the nearest multiple of pi/2, which is split in three so the first two products are exact
+static float
+ReduceAngle(float angle, i32* quadrant) {
+	float k = Round(angle*(2.0f/PI32));
+	*quadrant = (i32)k;
+	return ((angle - k*1.5703125f) - k*4.837512969970703125e-4f) - k*7.54978995489188216e-8f;
+}
+
+// On [-pi/4, pi/4]
+static float SinPoly(float x) {
+	float z = x*x;
+	return ((-1.9515295891e-4f*z + 8.3321608736e-3f)*z - 1.6666654611e-1f)*z*x + x;
+}
+static float CosPoly(float x) {
+	float z = x*x;
+	return ((2.443315711809948e-5f*z - 1.388731625493765e-3f)*z + 4.166664568298827e-2f)*z*z - 0.5f*z + 1.0f;
+}
+
+static float Sin(float angle) {
+	i32 quadrant;
+	float x = ReduceAngle(angle, &quadrant);
+	float result = quadrant & 1 ? CosPoly(x) : SinPoly(x);
+	return quadrant & 2 ? -result : result;
+}
+static float Cos(float angle) {
+	i32 quadrant;
+	float x = ReduceAngle(angle, &quadrant);
+	quadrant++;
+	float result = quadrant & 1 ? CosPoly(x) : SinPoly(x);
+	return quadrant & 2 ? -result : result;
+}
+static float Tan(float angle) { return Sin(angle)/Cos(angle); }
+
+static float
+ATan(float x) {
+	float a = Abs(x);
+	float offset = 0.0f;
+	if(a > 2.414213562373095f) {
+		offset = PI32/2.0f;
+		a = -1.0f/a;
+	}
+	else if(a > 0.4142135623730950f) {
+		offset = PI32/4.0f;
+		a = (a - 1.0f)/(a + 1.0f);
+	}
+	float z = a*a;
+	float result = offset + (((8.05374449538e-2f*z - 1.38776856032e-1f)*z + 1.99777106478e-1f)*z - 3.33329491539e-1f)*z*a + a;
+	return x < 0.0f ? -result : result;
+}
+
+static float
+ATan2(float y, float x) {
+	if(x == 0.0f) {
+		if(y > 0.0f) return PI32/2.0f;
+		if(y < 0.0f) return -PI32/2.0f;
+		return 0.0f;
+	}
+	float result = ATan(y/x);
+	if(x < 0.0f) result += y < 0.0f ? -PI32 : PI32;
+	return result;
+}
+
+static float
+ASin(float x) {
+	float a = Abs(x);
+	float z, r;
+	if(a > 0.5f) {
+		z = 0.5f*(1.0f - a);
+		r = SquareRoot(z);
+	}
+	else {
+		z = a*a;
+		r = a;
+	}
+	float result = ((((4.2163199048e-2f*z + 2.4181311049e-2f)*z + 4.5470025998e-2f)*z + 7.4953002686e-2f)*z +
+			1.6666752422e-1f)*z*r + r;
+	if(a > 0.5f) result = PI32/2.0f - 2.0f*result;
+	return x < 0.0f ? -result : result;
+}
+
+static float
+ACos(float x) {
+	if(x < -0.5f) return PI32 - 2.0f*ASin(SquareRoot(0.5f*(1.0f + x)));
+	if(x > 0.5f) return 2.0f*ASin(SquareRoot(0.5f*(1.0f - x)));
+	return PI32/2.0f - ASin(x);
+}
+
 //------------------------------------------------------------------------
 struct Vec2u {
 	union {
@@ -62,7 +158,7 @@ struct Vec4 {
 		};
 		struct {
 			Vec3 xyz;
-			float z;
+			float ignored0_;
 		};
 		float elem[4];
 	};
@@ -75,7 +171,7 @@ struct Quat {
 		};
 		struct {
 			Vec3 xyz;
-			float z;
+			float ignored0_;
 		};
 		float elem[4];
 	};
@@ -201,7 +297,7 @@ static float V3MagSquared(Vec3 vec) {
 static Vec3 V3Neg(Vec3 vec) { return V3Sub(V3Z(), vec); }
 
 static float V3Mag(Vec3 vec) {
-	return sqrtf(V3MagSquared(vec));
+	return SquareRoot(V3MagSquared(vec));
 }
 static Vec3 V3Norm(Vec3 vec) {
 	Vec3 result = {};
@@ -222,6 +318,16 @@ static float V3Dot(Vec3 left, Vec3 right) {
 	return left.x*right.x + left.y*right.y + left.z*right.z;
 }
 
+static Vec4 V4Add(Vec4 left, Vec4 right) {
+	return Vec4 { left.x + right.x, left.y + right.y, left.z + right.z, left.w + right.w };
+}
+static Vec4 V4Sub(Vec4 left, Vec4 right) {
+	return Vec4 { left.x - right.x, left.y - right.y, left.z - right.z, left.w - right.w };
+}
+static Vec4 V4MulF(Vec4 left, float scalar) {
+	return Vec4 { left.x*scalar, left.y*scalar, left.z*scalar, left.w*scalar };
+}
+
 static Mat4 M4I() {
 	return Mat4 { 1.0f, 0.0f, 0.0f, 0.0f,
 								0.0f, 1.0f, 0.0f, 0.0f,
@@ -237,7 +343,25 @@ static Mat4 M4Transpose(Mat4 mat) {
 	return result;
 }
 
-static Mat4 M4Mul(Mat4 left, Mat4 right) {
+// Column major, so a matrix times a vector is its columns weighted by the vector's elements
+static __m128
+M4MulColumnSSE(__m128* columns, __m128 vec) {
+	__m128 result = _mm_mul_ps(columns[0], _mm_shuffle_ps(vec, vec, _MM_SHUFFLE(0, 0, 0, 0)));
+	result = _mm_add_ps(result, _mm_mul_ps(columns[1], _mm_shuffle_ps(vec, vec, _MM_SHUFFLE(1, 1, 1, 1))));
+	result = _mm_add_ps(result, _mm_mul_ps(columns[2], _mm_shuffle_ps(vec, vec, _MM_SHUFFLE(2, 2, 2, 2))));
+	result = _mm_add_ps(result, _mm_mul_ps(columns[3], _mm_shuffle_ps(vec, vec, _MM_SHUFFLE(3, 3, 3, 3))));
+	return result;
+}
+
+static void
+M4MulSSE(Mat4* left, Mat4* right, Mat4* result) {
+	__m128 columns[4];
+	for(u8 col=0; col<4; col++) columns[col] = _mm_loadu_ps(left->elem[col]);
+	for(u8 col=0; col<4; col++) _mm_storeu_ps(result->elem[col], M4MulColumnSSE(columns, _mm_loadu_ps(right->elem[col])));
+}
+
+// Scalar reference for M4Mul, same sums in the same order
+static Mat4 M4MulScalar(Mat4 left, Mat4 right) {
 	Mat4 result = M4I();
 	for (u8 col = 0; col < 4; col++) {
 		for (u8 row = 0; row < 4; row++) {
@@ -249,6 +373,12 @@ static Mat4 M4Mul(Mat4 left, Mat4 right) {
 	return result;
 }
 
+static Mat4 M4Mul(Mat4 left, Mat4 right) {
+	Mat4 result;
+	M4MulSSE(&left, &right, &result);
+	return result;
+}
+
 static Mat4 M4MulF(Mat4 mat, float scalar) {
 	Mat4 result = M4I();
 	for(u8 col=0; col<4; col++)
@@ -257,7 +387,7 @@ static Mat4 M4MulF(Mat4 mat, float scalar) {
 	return result;
 }
 
-static Vec4 M4MulV(Mat4 mat, Vec4 vec) {
+static Vec4 M4MulVScalar(Mat4 mat, Vec4 vec) {
 	Vec4 result = {};
 	for(u8 row=0; row<4; row++) {
 		float sum = 0;
@@ -267,6 +397,14 @@ static Vec4 M4MulV(Mat4 mat, Vec4 vec) {
 	return result;
 }
 
+static Vec4 M4MulV(Mat4 mat, Vec4 vec) {
+	__m128 columns[4];
+	for(u8 col=0; col<4; col++) columns[col] = _mm_loadu_ps(mat.elem[col]);
+	Vec4 result;
+	_mm_storeu_ps(result.elem, M4MulColumnSSE(columns, _mm_loadu_ps(vec.elem)));
+	return result;
+}
+
 static Mat4 M4Orthographic(float left, float right, float bottom,
 																	 float top, float Near, float Far) {
 	Mat4 result = M4I();
@@ -285,7 +423,7 @@ static Mat4 M4Orthographic(float left, float right, float bottom,
 
 static Mat4 M4Perspective(float fov, float aspect_ratio, float Near, float Far) {
 	Mat4 result ={};
-	float cot = 1.0f / tanf(fov * (PI32/360.0f));
+	float cot = 1.0f / Tan(fov * (PI32/360.0f));
 	result.elem[0][0] = cot / aspect_ratio;
 	result.elem[1][1] = cot;
 	result.elem[2][3] = -1.0f;
@@ -306,8 +444,8 @@ static Mat4 M4Translate(Vec3 translation) {
 static Mat4 M4Rotate(Vec3 axis, float angle) {
 	Mat4 result = M4I();
 	axis = V3Norm(axis);
-	float sin = sinf(DegToRad(angle));
-	float cos = cosf(DegToRad(angle));
+	float sin = Sin(DegToRad(angle));
+	float cos = Cos(DegToRad(angle));
 	float one_minus_cos = 1.0f - cos;
 
 	result.elem[0][0] = (axis.x*axis.x*one_minus_cos) + cos;
@@ -371,7 +509,7 @@ static Quat QuatSub(Quat left, Quat right) {
 }
 // Note : Follows composition format ie: concatenating rotations should be 
 // new rotation * old rotation
-static Quat QuatMul(Quat left, Quat right) { 
+static Quat QuatMulScalar(Quat left, Quat right) { 
 	Quat result = {};
 	result.x = (left.x*right.w) + (left.y*right.z) - (left.z*right.y) + (left.w*right.x);
 	result.y = (-left.x*right.z) + (left.y*right.w) + (left.z*right.x) + (left.w*right.y);
@@ -379,6 +517,21 @@ static Quat QuatMul(Quat left, Quat right) {
 	result.w = (-left.x*right.x) - (left.y*right.y) - (left.z*right.z) + (left.w*right.w);
 	return result;
 }
+// left.x times (w, -z, y, -x) of right and so on, the same sums in the same order as the scalar one
+static Quat QuatMul(Quat left, Quat right) {
+	__m128 l = _mm_loadu_ps(left.elem);
+	__m128 r = _mm_loadu_ps(right.elem);
+	__m128 sum = _mm_mul_ps(_mm_shuffle_ps(l, l, _MM_SHUFFLE(0, 0, 0, 0)),
+			_mm_xor_ps(_mm_shuffle_ps(r, r, _MM_SHUFFLE(0, 1, 2, 3)), _mm_set_ps(-0.0f, 0.0f, -0.0f, 0.0f)));
+	sum = _mm_add_ps(sum, _mm_mul_ps(_mm_shuffle_ps(l, l, _MM_SHUFFLE(1, 1, 1, 1)),
+			_mm_xor_ps(_mm_shuffle_ps(r, r, _MM_SHUFFLE(1, 0, 3, 2)), _mm_set_ps(-0.0f, -0.0f, 0.0f, 0.0f))));
+	sum = _mm_add_ps(sum, _mm_mul_ps(_mm_shuffle_ps(l, l, _MM_SHUFFLE(2, 2, 2, 2)),
+			_mm_xor_ps(_mm_shuffle_ps(r, r, _MM_SHUFFLE(2, 3, 0, 1)), _mm_set_ps(-0.0f, 0.0f, 0.0f, -0.0f))));
+	sum = _mm_add_ps(sum, _mm_mul_ps(_mm_shuffle_ps(l, l, _MM_SHUFFLE(3, 3, 3, 3)), r));
+	Quat result;
+	_mm_storeu_ps(result.elem, sum);
+	return result;
+}
 static Quat QuatMulF(Quat quat, float scalar) {
 	return Quat { quat.x*scalar, quat.y*scalar, quat.z*scalar, quat.w*scalar };
 }
@@ -395,11 +548,13 @@ static Quat QuatInverse(Quat quat) {
 }
 static Quat QuatNorm(Quat quat) {
 	Quat result = {};
-	float mag = sqrtf(QuatDot(quat, quat));
+	float mag = SquareRoot(QuatDot(quat, quat));
 	result = QuatDivF(quat, mag);
 	return result;
 }
 
+// Stays scalar, one quaternion is too little work to pay for the lane setup. MakeTransformMatrices
+// does four at once through M4FromQuat4.
 static Mat4 M4FromQuat(Quat quat) {
 	Mat4 result = M4I();
 	Quat quat_norm = QuatNorm(quat);
@@ -437,24 +592,52 @@ static Mat4 M4FromQuat(Quat quat) {
 	return result;
 }
 
+// Columns of the rotation for four quaternions at once, x, y, z and w hold one element of each
+static void
+M4FromQuat4(__m128 x, __m128 y, __m128 z, __m128 w, __m128* m) {
+	__m128 mag = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z)),
+				_mm_mul_ps(w, w)));
+	x = _mm_div_ps(x, mag);
+	y = _mm_div_ps(y, mag);
+	z = _mm_div_ps(z, mag);
+	w = _mm_div_ps(w, mag);
+
+	__m128 xx = _mm_mul_ps(x, x), yy = _mm_mul_ps(y, y), zz = _mm_mul_ps(z, z);
+	__m128 xy = _mm_mul_ps(x, y), xz = _mm_mul_ps(x, z), yz = _mm_mul_ps(y, z);
+	__m128 wx = _mm_mul_ps(w, x), wy = _mm_mul_ps(w, y), wz = _mm_mul_ps(w, z);
+	__m128 one = _mm_set1_ps(1.0f);
+	__m128 two = _mm_set1_ps(2.0f);
+
+	// m[3*col + row]
+	m[0] = _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz)));
+	m[1] = _mm_mul_ps(two, _mm_add_ps(xy, wz));
+	m[2] = _mm_mul_ps(two, _mm_sub_ps(xz, wy));
+	m[3] = _mm_mul_ps(two, _mm_sub_ps(xy, wz));
+	m[4] = _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz)));
+	m[5] = _mm_mul_ps(two, _mm_add_ps(yz, wx));
+	m[6] = _mm_mul_ps(two, _mm_add_ps(xz, wy));
+	m[7] = _mm_mul_ps(two, _mm_sub_ps(yz, wx));
+	m[8] = _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy)));
+}
+
 static Quat QuatFromAxisAngle(Vec3 axis, float angle) {
 	Quat result = {};
 	Vec3 axis_norm = V3Norm(axis);
-	float sin = sinf(angle/2.0f);
+	float sin = Sin(angle/2.0f);
 	result.xyz = V3MulF(axis_norm, sin);
-	result.w = cosf(angle/2.0f);
+	result.w = Cos(angle/2.0f);
 	return result;
 }
 
 static Quat QuatFromEuler(float pitch , float yaw, float roll) {
 	Quat result = {};
 
-	float x0 = cosf(pitch*0.5f);
-	float x1 = sinf(pitch*0.5f);
-	float y0 = cosf(yaw*0.5f);
-	float y1 = sinf(yaw*0.5f);
-	float z0 = cosf(roll*0.5f);
-	float z1 = sinf(roll*0.5f);
+	float x0 = Cos(pitch*0.5f);
+	float x1 = Sin(pitch*0.5f);
+	float y0 = Cos(yaw*0.5f);
+	float y1 = Sin(yaw*0.5f);
+	float z0 = Cos(roll*0.5f);
+	float z1 = Sin(roll*0.5f);
 
 	result.x = x1*y0*z0 - x0*y1*z1;
 	result.y = x0*y1*z0 + x1*y0*z1;
@@ -470,27 +653,27 @@ static Vec3 EulerFromQuat(Quat quat) {
 	// Roll (x-axis rotation)
 	float x0 = 2.0f*(quat.w*quat.x + quat.y*quat.z);
 	float x1 = 1.0f - 2.0f*(quat.x*quat.x + quat.y*quat.y);
-	result.x = atan2f(x0, x1);
+	result.x = ATan2(x0, x1);
 
 	// Pitch (y-axis rotation)
 	float y0 = 2.0f*(quat.w*quat.y - quat.z*quat.x);
 	y0 = y0 > 1.0f ? 1.0f : y0;
 	y0 = y0 < -1.0f ? -1.0f : y0;
-	result.y = asinf(y0);
+	result.y = ASin(y0);
 
 	// Yaw (z-axis rotation)
 	float z0 = 2.0f*(quat.w*quat.z + quat.x*quat.y);
 	float z1 = 1.0f - 2.0f*(quat.y*quat.y + quat.z*quat.z);
-	result.z = atan2f(z0, z1);
+	result.z = ATan2(z0, z1);
 
 	return result;
 }
 
 static void AxisAngleFromQuat(Quat q, Vec3* outAxis, float* outAngle) {
-	if (fabs(q.w) > 1.0f)
+	if (Abs(q.w) > 1.0f)
 	{
 		QuatNorm(q);
-		float length = sqrtf(q.x*q.x + q.y*q.y + q.z*q.z + q.w*q.w);
+		float length = SquareRoot(q.x*q.x + q.y*q.y + q.z*q.z + q.w*q.w);
 		if (length == 0.0f) length = 1.0f;
 		float ilength = 1.0f/length;
 
@@ -501,8 +684,8 @@ static void AxisAngleFromQuat(Quat q, Vec3* outAxis, float* outAngle) {
 	}
 
 	Vec3 resAxis = { 0.0f, 0.0f, 0.0f };
-	float resAngle = 2.0f*acosf(q.w);
-	float den = sqrtf(1.0f - q.w*q.w);
+	float resAngle = 2.0f*ACos(q.w);
+	float den = SquareRoot(1.0f - q.w*q.w);
 
 	if (den > 0.0001f)
 	{
@@ -531,7 +714,7 @@ static Quat QuatFromDirectionChange(Vec3 from, Vec3 to) {
 	if (Abs(cos - (1.0f)) < 0.00001f) {
 		result = QuatI();
 	}
-	float angle = acosf(cos);
+	float angle = ACos(cos);
 	Vec3 axis = V3Cross(from, to);
 	axis = V3Norm(axis);
 	result = QuatFromAxisAngle(axis, angle);
@@ -571,15 +754,108 @@ static Vec3 GetForwardVector(Quat quat) {	return V3Norm(RotateVecByQuat(V3Forwar
 static Vec3 GetRightVector(Quat quat) {	return V3Norm(RotateVecByQuat(V3Right(), quat)); } 
 static Vec3 GetUpVector(Quat quat) {	return V3Norm(RotateVecByQuat(V3Up(), quat)); } 
 
-static Mat4 MakeTransformMatrix(Transform transform) {
+// Reference for MakeTransformMatrix and MakeTransformMatrices
+static Mat4 MakeTransformMatrixScalar(Transform transform) {
 	Mat4 result = M4I();
 	Mat4 translation = M4Translate(transform.position);
 	Mat4 rotation = M4FromQuat(transform.rotation);
 	Mat4 scale = M4Scale(transform.scale);
 
 	// Checked
-	result = M4Mul(M4Mul(translation, rotation), scale);
-	//result = M4Mul(M4Mul(scale, rotation), translation);
+	result = M4MulScalar(M4MulScalar(translation, rotation), scale);
+	//result = M4MulScalar(M4MulScalar(scale, rotation), translation);
 
 	return result;
 }
+
+// M4FromQuat's terms times the scale, position in the last column, what the reference's products
+// come out as. Spelled out so it all stays in registers, going through a Mat4 costs four times as much.
+static Mat4 MakeTransformMatrix(Transform transform) {
+	Quat quat_norm = QuatNorm(transform.rotation);
+	float xx, yy, zz, xy, xz, yz, wx, wy, wz;
+	xx = quat_norm.x * quat_norm.x;
+	yy = quat_norm.y * quat_norm.y;
+	zz = quat_norm.z * quat_norm.z;
+	xy = quat_norm.x * quat_norm.y;
+	xz = quat_norm.x * quat_norm.z;
+	yz = quat_norm.y * quat_norm.z;
+	wx = quat_norm.w * quat_norm.x;
+	wy = quat_norm.w * quat_norm.y;
+	wz = quat_norm.w * quat_norm.z;
+	Vec3 scale = transform.scale;
+
+	// The zeros are scaled too, so a negative scale gives the same -0 as the batch
+	Mat4 result;
+	result.elem[0][0] = (1.0f - 2.0f*(yy+zz)) * scale.x;
+	result.elem[0][1] = (2.0f * (xy+wz)) * scale.x;
+	result.elem[0][2] = (2.0f * (xz-wy)) * scale.x;
+	result.elem[0][3] = 0.0f * scale.x;
+
+	result.elem[1][0] = (2.0f * (xy-wz)) * scale.y;
+	result.elem[1][1] = (1.0f - 2.0f*(xx+zz)) * scale.y;
+	result.elem[1][2] = (2.0f * (yz+wx)) * scale.y;
+	result.elem[1][3] = 0.0f * scale.y;
+
+	result.elem[2][0] = (2.0f * (xz+wy)) * scale.z;
+	result.elem[2][1] = (2.0f * (yz-wx)) * scale.z;
+	result.elem[2][2] = (1.0f - 2.0f*(xx+yy)) * scale.z;
+	result.elem[2][3] = 0.0f * scale.z;
+
+	result.elem[3][0] = transform.position.x;
+	result.elem[3][1] = transform.position.y;
+	result.elem[3][2] = transform.position.z;
+	result.elem[3][3] = 1.0f;
+	return result;
+}
+
+//------------------------------------------------------------------------
+// Batches, out can not overlap the inputs
+
+static void
+M4MulPoints(Mat4 mat, Vec4* points, Vec4* out, u32 count) {
+	__m128 columns[4];
+	for(u8 col=0; col<4; col++) columns[col] = _mm_loadu_ps(mat.elem[col]);
+	for(u32 i=0; i<count; i++) _mm_storeu_ps(out[i].elem, M4MulColumnSSE(columns, _mm_loadu_ps(points[i].elem)));
+}
+
+static void
+M4MulN(Mat4* left, Mat4* right, Mat4* out, u32 count) {
+	for(u32 i=0; i<count; i++) M4MulSSE(left + i, right + i, out + i);
+}
+
+// Four at a time through M4FromQuat4, the quaternions go across and the columns come back with a transpose
+static void
+MakeTransformMatrices(Transform* transforms, Mat4* out, u32 count) {
+	u32 simd_count = count & ~3;
+	for(u32 i=0; i<simd_count; i+=4) {
+		Transform* t = transforms + i;
+		__m128 x = _mm_loadu_ps(t[0].rotation.elem);
+		__m128 y = _mm_loadu_ps(t[1].rotation.elem);
+		__m128 z = _mm_loadu_ps(t[2].rotation.elem);
+		__m128 w = _mm_loadu_ps(t[3].rotation.elem);
+		_MM_TRANSPOSE4_PS(x, y, z, w);
+
+		__m128 m[9];
+		M4FromQuat4(x, y, z, w, m);
+		for(u8 col=0; col<3; col++) {
+			__m128 row0 = m[3*col];
+			__m128 row1 = m[3*col + 1];
+			__m128 row2 = m[3*col + 2];
+			__m128 row3 = _mm_setzero_ps();
+			_MM_TRANSPOSE4_PS(row0, row1, row2, row3);
+			_mm_storeu_ps(out[i].elem[col], _mm_mul_ps(row0, _mm_set1_ps(t[0].scale.elem[col])));
+			_mm_storeu_ps(out[i + 1].elem[col], _mm_mul_ps(row1, _mm_set1_ps(t[1].scale.elem[col])));
+			_mm_storeu_ps(out[i + 2].elem[col], _mm_mul_ps(row2, _mm_set1_ps(t[2].scale.elem[col])));
+			_mm_storeu_ps(out[i + 3].elem[col], _mm_mul_ps(row3, _mm_set1_ps(t[3].scale.elem[col])));
+		}
+		for(u32 j=0; j<4; j++) {
+			Mat4* mat = out + i + j;
+			mat->elem[3][0] = t[j].position.x;
+			mat->elem[3][1] = t[j].position.y;
+			mat->elem[3][2] = t[j].position.z;
+			mat->elem[3][3] = 1.0f;
+		}
+	}
+
+	for(u32 i=simd_count; i<count; i++) out[i] = MakeTransformMatrix(transforms[i]);
+}
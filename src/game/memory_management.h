@@ -25,6 +25,7 @@ static bool CompareMem(void* left, void* right, u64 len) {
 #define PushStructClear(ptr_arena, type) (type*)PushSize_((ptr_arena), sizeof(type), true)
 #define PushArray(ptr_arena, type, count) (type*)PushSize_((ptr_arena), sizeof(type)*(count), false)
 #define PushArrayClear(ptr_arena, type, count) (type*)PushSize_((ptr_arena), sizeof(type)*(count), true)
+#define PushJobScratchArray(context, type, count) (type*)PushJobScratch_((context), sizeof(type)*(count))
 #define BootstrapPushStruct(type, member, min_size) (type*)BootstrapPushSize_(sizeof(type), offsetof(type, member), min_size)
 
 struct MemoryArena {
@@ -126,6 +127,18 @@ BootstrapPushSize_(u64 struct_size, u64 offset_to_arena, u64 min_block_size) {
 	return structure;
 }
 
+// Scratch of the thread running a job, all of it is popped when the job returns
+static void*
+PushJobScratch_(PlatformJobContext* context, u64 size) {
+	PlatformMemoryBlock* scratch = context->scratch;
+	u64 aligned_size = (size + 7) & (-8);
+	Assert((scratch->used + aligned_size) <= scratch->size);
+
+	void* result = scratch->bp + scratch->used;
+	scratch->used += aligned_size;
+	return result;
+}
+
 static u32
 StringLength(char* string) {
 	u32 i=0;
@@ -1,4 +1,7 @@
-#define MAX_MESH_PIPELINES 100
+#define MAX_MESH_GROUPS 100
+#define MAX_MESH_INSTANCES 16384
+#define MAX_MESH_SINGLES 256
+static_assert(MAX_MESH_GROUPS <= 256, "group_of_instance stores the group as a u8");
 
 struct LightInfo {
 	Vec3 position;
@@ -23,22 +26,70 @@ struct MeshPipeline {
 	MeshInfo* info;
 };
 
+// Instances of one mesh, drawn with a single instanced call
+struct MeshGroup {
+	Mesh mesh;
+	u32 first;
+	u32 count;
+	float depth;
+};
+
 struct MeshRenderer {
-	MeshPipeline pipelines[MAX_MESH_PIPELINES];
+	MeshGroup groups[MAX_MESH_GROUPS];
+	u32 group_count;
+
+	MeshInfo instances[MAX_MESH_INSTANCES];
+	u8 group_of_instance[MAX_MESH_INSTANCES];
 	u32 count;
 
+	// Instances that found either table above full, each drawn on its own
+	Mesh single_meshes[MAX_MESH_SINGLES];
+	MeshInfo single_instances[MAX_MESH_SINGLES];
+	u32 single_count;
+
 	LightInfo light;
 	ConstantsBuffer* camera_constants;
-	ConstantsBuffer* mesh_constants;
 	ConstantsBuffer* light_constants;
+	StructuredBuffer* instance_buffer;
 	VertexShader* vs;
 	PixelShader* ps;
 };
 
+// The info is copied, it doesn't have to outlive the call
 static void
 PushMeshPipeline(MeshPipeline pipeline, MeshRenderer* mesh_renderer) {
-	Assert(mesh_renderer->count < MAX_MESH_PIPELINES);
-	mesh_renderer->pipelines[mesh_renderer->count++] = pipeline;
+	// Same mesh as the previous instance is the common case
+	u32 group = mesh_renderer->group_count;
+	if(mesh_renderer->count < MAX_MESH_INSTANCES) {
+		if(mesh_renderer->count) {
+			u32 last = mesh_renderer->group_of_instance[mesh_renderer->count - 1];
+			if(mesh_renderer->groups[last].mesh.vertex_buffers[0] == pipeline.mesh.vertex_buffers[0]) group = last;
+		}
+
+		if(group == mesh_renderer->group_count) {
+			for(group=0; group<mesh_renderer->group_count; group++)
+				if(mesh_renderer->groups[group].mesh.vertex_buffers[0] == pipeline.mesh.vertex_buffers[0]) break;
+
+			if(group == mesh_renderer->group_count && group < MAX_MESH_GROUPS) {
+				MeshGroup* new_group = mesh_renderer->groups + mesh_renderer->group_count++;
+				new_group->mesh = pipeline.mesh;
+				new_group->count = 0;
+			}
+		}
+	}
+
+	// Without room in the tables it falls back to a draw of its own, once those run out it is dropped
+	if(group == mesh_renderer->group_count) {
+		if(mesh_renderer->single_count < MAX_MESH_SINGLES) {
+			mesh_renderer->single_meshes[mesh_renderer->single_count] = pipeline.mesh;
+			mesh_renderer->single_instances[mesh_renderer->single_count++] = *pipeline.info;
+		}
+		return;
+	}
+
+	mesh_renderer->groups[group].count++;
+	mesh_renderer->group_of_instance[mesh_renderer->count] = (u8)group;
+	mesh_renderer->instances[mesh_renderer->count++] = *pipeline.info;
 }
 
 static void
@@ -49,7 +100,6 @@ InitMeshShader(MeshRenderer* mesh_renderer, Renderer* renderer) {
 	mesh_renderer->ps = UploadPixelShader(MeshShader, sizeof(MeshShader), "psf", renderer);
 	mesh_renderer->camera_constants = UploadConstantsBuffer(sizeof(Mat4), renderer);
 	mesh_renderer->light_constants = UploadConstantsBuffer(sizeof(LightInfo), renderer);
-	mesh_renderer->mesh_constants = UploadConstantsBuffer(sizeof(MeshInfo), renderer);
 }
 
 MeshRenderer* 
@@ -57,99 +107,141 @@ InitMeshRenderer(Renderer* renderer, MemoryArena* arena) {
 	MeshRenderer* result = PushStruct(arena, MeshRenderer);
 
 	InitMeshShader(result, renderer);
+	result->instance_buffer = UploadStructuredBuffer(sizeof(MeshInfo), MAX_MESH_INSTANCES, renderer);
 
 	return result;
 }
 
 static void
-MeshRendererFrame(MeshRenderer* mesh_renderer, Camera* camera, Renderer* renderer) {
-
-#ifdef INTERNAL
-	if(executable_reloaded) InitMeshShader(mesh_renderer, renderer);
-#endif INTERNAL
+MeshRendererFrame(MeshRenderer* mesh_renderer, Camera* camera, RenderCommandList* list) {
+	if(mesh_renderer->count == 0 && mesh_renderer->single_count == 0) return;
 
-	if(mesh_renderer->count == 0) return;
-
-	Mat4* vp = PushStruct(renderer->frame_arena, Mat4);
+	Mat4* vp = PushStruct(&list->arena, Mat4);
 	*vp = MakeViewPerspective(camera);
 
-	SetRenderTarget* set_render_target = PushRenderCommand(renderer, SetRenderTarget);
-
-	SetBlendState* set_blend_state = PushRenderCommand(renderer, SetBlendState);
-	set_blend_state->type = BLEND_STATE_Regular;
-
-	SetVertexShader* set_vertex_shader = PushRenderCommand(renderer, SetVertexShader);
-	set_vertex_shader->vertex = mesh_renderer->vs;
-
-	SetPixelShader* set_pixel_shader = PushRenderCommand(renderer, SetPixelShader);
-	set_pixel_shader->pixel = mesh_renderer->ps;
-
-	SetConstantsBuffer* set_camera_constants = PushRenderCommand(renderer, SetConstantsBuffer);
-	set_camera_constants->vertex_shader = true;
-	set_camera_constants->constants = mesh_renderer->camera_constants;
-	set_camera_constants->slot = 1;
-
-	SetConstantsBuffer* set_light_constants = PushRenderCommand(renderer, SetConstantsBuffer);
-	set_light_constants->vertex_shader = false;
-	set_light_constants->constants = mesh_renderer->light_constants;
-	set_light_constants->slot = 1;
-
-	SetConstantsBuffer* set_mesh_constants = PushRenderCommand(renderer, SetConstantsBuffer);
-	set_mesh_constants->vertex_shader = true;
-	set_mesh_constants->constants = mesh_renderer->mesh_constants;
-	set_mesh_constants->slot = 2;
-
-	PushRenderBufferData* push_camera_constants = PushRenderCommand(renderer, PushRenderBufferData);
-	push_camera_constants->buffer = mesh_renderer->camera_constants->buffer;
+	PushRenderConstants* push_camera_constants = PushRenderCommand(list, PushRenderConstants);
+	push_camera_constants->constants = mesh_renderer->camera_constants;
 	push_camera_constants->size = sizeof(Mat4);
 	push_camera_constants->data = vp;
 
-	PushRenderBufferData* push_light_constants = PushRenderCommand(renderer, PushRenderBufferData);
-	push_light_constants->buffer = mesh_renderer->light_constants->buffer;
+	PushRenderConstants* push_light_constants = PushRenderCommand(list, PushRenderConstants);
+	push_light_constants->constants = mesh_renderer->light_constants;
 	push_light_constants->size = sizeof(LightInfo);
 	push_light_constants->data = &mesh_renderer->light;
 
+	u32 draw_count = mesh_renderer->group_count + mesh_renderer->single_count;
+	MeshGroup* groups = PushArray(&list->arena, MeshGroup, draw_count);
+	MeshInfo* instances = PushArray(&list->arena, MeshInfo, mesh_renderer->count + mesh_renderer->single_count);
+
+	u32 first = 0;
+	for(u32 i=0; i<mesh_renderer->group_count; i++) {
+		MeshGroup* group = groups + i;
+		*group = mesh_renderer->groups[i];
+		group->first = first;
+		first += group->count;
+		group->count = 0;
+		group->depth = 0.0f;
+	}
+
+	// Groups sort on their farthest instance, the mesh pipeline blends
 	for(u32 i=0; i<mesh_renderer->count; i++) {
-		MeshPipeline* mesh_pipeline = mesh_renderer->pipelines + i;
+		MeshGroup* group = groups + mesh_renderer->group_of_instance[i];
+		MeshInfo* info = mesh_renderer->instances + i;
+		instances[group->first + group->count++] = *info;
 
-		SetPrimitiveTopology* set_topology = PushRenderCommand(renderer, SetPrimitiveTopology);
-		set_topology->type = mesh_pipeline->mesh.topology;
+		Vec3 position = V3(info->model.elem[3][0], info->model.elem[3][1], info->model.elem[3][2]);
+		float depth = GetViewDepth(position, camera);
+		group->depth = Max(group->depth, depth);
+	}
+
+	// Instances that fell back become groups of one after the shared ones
+	for(u32 i=0; i<mesh_renderer->single_count; i++) {
+		MeshGroup* group = groups + mesh_renderer->group_count + i;
+		MeshInfo* info = mesh_renderer->single_instances + i;
+		group->mesh = mesh_renderer->single_meshes[i];
+		group->first = first++;
+		group->count = 1;
+		instances[group->first] = *info;
+
+		Vec3 position = V3(info->model.elem[3][0], info->model.elem[3][1], info->model.elem[3][2]);
+		group->depth = GetViewDepth(position, camera);
+	}
+
+	for(u32 i=0; i<draw_count; i++) {
+		MeshGroup* group = groups + i;
+		Mesh* mesh = &group->mesh;
+
+		RenderPipelineState state = {};
+		state.blend = BLEND_STATE_Regular;
+		state.rasterizer = RASTERIZER_STATE_Default;
+		state.topology = mesh->topology;
+		state.vs = mesh_renderer->vs;
+		state.ps = mesh_renderer->ps;
+		BeginRenderItem(RENDER_PASS_World, &state, 0, mesh->vertex_buffers[0], group->depth, list);
+
+		SetConstantsBuffer* set_camera_constants = PushRenderCommand(list, SetConstantsBuffer);
+		set_camera_constants->vertex_shader = true;
+		set_camera_constants->constants = mesh_renderer->camera_constants;
+		set_camera_constants->slot = 1;
+
+		SetConstantsBuffer* set_light_constants = PushRenderCommand(list, SetConstantsBuffer);
+		set_light_constants->vertex_shader = false;
+		set_light_constants->constants = mesh_renderer->light_constants;
+		set_light_constants->slot = 1;
+
+		SetStructuredBuffer* set_instance_buffer = PushRenderCommand(list, SetStructuredBuffer);
+		set_instance_buffer->vertex_shader = true;
+		set_instance_buffer->structured = mesh_renderer->instance_buffer;
+		set_instance_buffer->slot = 0;
 
 		{
-			SetVertexBuffer* set_vertex_buffer = PushRenderCommand(renderer, SetVertexBuffer);
-			set_vertex_buffer->vertex= mesh_pipeline->mesh.vertex_buffers[0];
-			set_vertex_buffer->vertices_count = mesh_pipeline->mesh.vertices_count;
+			SetVertexBuffer* set_vertex_buffer = PushRenderCommand(list, SetVertexBuffer);
+			set_vertex_buffer->vertex= mesh->vertex_buffers[0];
+			set_vertex_buffer->vertices_count = mesh->vertices_count;
 			set_vertex_buffer->offset = 0;
 			set_vertex_buffer->stride = sizeof(float)*3;
 			set_vertex_buffer->slot = 0;
 		} {
-			SetVertexBuffer* set_vertex_buffer = PushRenderCommand(renderer, SetVertexBuffer);
-			set_vertex_buffer->vertex= mesh_pipeline->mesh.vertex_buffers[1];
-			set_vertex_buffer->vertices_count = mesh_pipeline->mesh.vertices_count;
+			SetVertexBuffer* set_vertex_buffer = PushRenderCommand(list, SetVertexBuffer);
+			set_vertex_buffer->vertex= mesh->vertex_buffers[1];
+			set_vertex_buffer->vertices_count = mesh->vertices_count;
 			set_vertex_buffer->offset = 0;
 			set_vertex_buffer->stride = sizeof(float)*3;
 			set_vertex_buffer->slot = 1;
 		}
 
-		PushRenderBufferData* push_mesh_info = PushRenderCommand(renderer, PushRenderBufferData);
-		push_mesh_info->buffer = mesh_renderer->mesh_constants->buffer;
-		push_mesh_info->size = sizeof(MeshInfo);
-		push_mesh_info->data = mesh_pipeline->info;
-
-		if(mesh_pipeline->mesh.index_buffer) {
-			SetIndexBuffer* set_index_buffer = PushRenderCommand(renderer, SetIndexBuffer);
-			set_index_buffer->index = mesh_pipeline->mesh.index_buffer;
-
-			DrawIndexed* draw_indices = PushRenderCommand(renderer, DrawIndexed);
-			draw_indices->indices_count = mesh_pipeline->mesh.indices_count;
+		// SV_InstanceID ignores the start instance, so every group uploads its own range
+		PushRenderBufferData* push_instances = PushRenderCommand(list, PushRenderBufferData);
+		push_instances->buffer = mesh_renderer->instance_buffer->buffer;
+		push_instances->size = sizeof(MeshInfo) * group->count;
+		push_instances->data = instances + group->first;
+
+		if(mesh->index_buffer) {
+			SetIndexBuffer* set_index_buffer = PushRenderCommand(list, SetIndexBuffer);
+			set_index_buffer->index = mesh->index_buffer;
+			set_index_buffer->offset = 0;
+
+			DrawIndexedInstanced* draw_indices = PushRenderCommand(list, DrawIndexedInstanced);
+			draw_indices->indices_count = mesh->indices_count;
+			draw_indices->instance_count = group->count;
+			draw_indices->offset = 0;
 		}
 		else {
-			DrawVertices* draw_vertices = PushRenderCommand(renderer, DrawVertices);
-			draw_vertices->vertices_count = mesh_pipeline->mesh.vertices_count;
+			DrawInstanced* draw_vertices = PushRenderCommand(list, DrawInstanced);
+			draw_vertices->vertices_count = mesh->vertices_count;
+			draw_vertices->instance_count = group->count;
+			draw_vertices->offset = 0;
 		}
+
+		EndRenderItem(list);
 	}
+}
 
+static void
+ResetMeshRenderer(MeshRenderer* mesh_renderer) {
 	mesh_renderer->count = 0;
+	mesh_renderer->group_count = 0;
+	mesh_renderer->single_count = 0;
 }
 
 
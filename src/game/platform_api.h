@@ -16,6 +16,15 @@ struct PlatformFileInfo {
 	void* name;
 };
 
+// Read-only view of a whole file, pages are only touched when accessed
+struct PlatformFileMapping {
+	bool failed;
+	void* handle;
+	void* mapping;
+	u8* data;
+	u64 size;
+};
+
 enum WIN32_BUTTON {
 	WIN32_BUTTON_A,
 	WIN32_BUTTON_B,
@@ -115,8 +124,18 @@ typedef PLATFORM_OPEN_FILE(PlatformOpenFile);
 #define PLATFORM_CLOSE_FILE(name) void name(PlatformFileHandle* file_handle)
 typedef PLATFORM_CLOSE_FILE(PlatformCloseFile);
      
-#define PLATFORM_READ_FILE(name) void name(PlatformFileHandle* win32_handle, u32 size, void *dst)
+#define PLATFORM_READ_FILE(name) void name(PlatformFileHandle* win32_handle, u64 size, void *dst)
 typedef PLATFORM_READ_FILE(PlatformReadFile);
+
+#define PLATFORM_MAP_FILE(name) PlatformFileMapping name(PlatformFileInfo* info)
+typedef PLATFORM_MAP_FILE(PlatformMapFile);
+
+#define PLATFORM_UNMAP_FILE(name) void name(PlatformFileMapping* file_mapping)
+typedef PLATFORM_UNMAP_FILE(PlatformUnmapFile);
+     
+// Creates or truncates the file
+#define PLATFORM_WRITE_ENTIRE_FILE(name) bool name(char* path, void* data, u64 size)
+typedef PLATFORM_WRITE_ENTIRE_FILE(PlatformWriteEntireFile);
      
 #define PLATFORM_ALLOCATE_MEMORY(name) PlatformMemoryBlock* name(u64 size)
 typedef PLATFORM_ALLOCATE_MEMORY(PlatformAllocateMemory);
@@ -124,11 +143,72 @@ typedef PLATFORM_ALLOCATE_MEMORY(PlatformAllocateMemory);
 #define PLATFORM_DEALLOCATE_MEMORY(name) void name(PlatformMemoryBlock* block)
 typedef PLATFORM_DEALLOCATE_MEMORY(PlatformDeallocateMemory);
 
+// Jobs
+// Every worker thread owns a deque, it runs the newest job of its own and steals the oldest of
+// another one when it runs dry. Jobs added on a worker go to its deque, from any other thread to
+// a shared queue the workers take from too.
+//
+// A counter counts the jobs added with it that have not finished. Waiting on one runs other jobs
+// until it drops to zero, so a job can wait on jobs it adds. Jobs can also be added behind a
+// counter, they start once it drops to zero. A counter holds one such batch at a time.
+struct PlatformJobSystem;
+
+struct PlatformJobContext {
+	u32 thread_index;					// 0 for threads that are not workers
+	PlatformMemoryBlock* scratch;		// the thread's, see PushJobScratch_
+};
+
+#define PLATFORM_JOB_CALLBACK(name) void name(PlatformJobContext* context, void* data)
+typedef PLATFORM_JOB_CALLBACK(PlatformJobCallback);
+
+struct PlatformJob {
+	PlatformJobCallback* callback;
+	void* data;
+};
+
+struct PlatformJobCounter {
+	u32 volatile count;
+	u32 volatile lock;
+
+	// Waiting for count to drop, the jobs have to stay valid until then
+	PlatformJob* dependents;
+	u32 dependent_count;
+	PlatformJobCounter* dependent_counter;
+};
+
+// counter and dependency may be 0
+#define PLATFORM_ADD_JOBS(name) void name(PlatformJobSystem* system, PlatformJob* jobs, u32 count, \
+		PlatformJobCounter* counter, PlatformJobCounter* dependency)
+typedef PLATFORM_ADD_JOBS(PlatformAddJobs);
+
+#define PLATFORM_WAIT_FOR_COUNTER(name) void name(PlatformJobSystem* system, PlatformJobCounter* counter)
+typedef PLATFORM_WAIT_FOR_COUNTER(PlatformWaitForCounter);
+
+// Single producer batch of jobs waited on together, entries added during a frame have to be
+// completed before it ends
+struct PlatformWorkQueue;
+
+#define PLATFORM_WORK_QUEUE_CALLBACK(name) void name(PlatformWorkQueue* queue, void* data)
+typedef PLATFORM_WORK_QUEUE_CALLBACK(PlatformWorkQueueCallback);
+
+#define PLATFORM_ADD_WORK_ENTRY(name) void name(PlatformWorkQueue* queue, PlatformWorkQueueCallback* callback, void* data)
+typedef PLATFORM_ADD_WORK_ENTRY(PlatformAddWorkEntry);
+
+#define PLATFORM_COMPLETE_ALL_WORK(name) void name(PlatformWorkQueue* queue)
+typedef PLATFORM_COMPLETE_ALL_WORK(PlatformCompleteAllWork);
+
 struct PlatformAPI {
 	PlatformOpenFile* open_file;
 	PlatformCloseFile* close_file;
 	PlatformReadFile* read_file;
+	PlatformMapFile* map_file;
+	PlatformUnmapFile* unmap_file;
+	PlatformWriteEntireFile* write_entire_file;
 	PlatformAllocateMemory* allocate_memory;
 	PlatformDeallocateMemory* deallocate_memory;
+	PlatformAddWorkEntry* add_work_entry;
+	PlatformCompleteAllWork* complete_all_work;
+	PlatformAddJobs* add_jobs;
+	PlatformWaitForCounter* wait_for_counter;
 };
 extern PlatformAPI platform_api;
@@ -4,18 +4,25 @@ enum POST_PROCESS_TYPE {
 	POST_PROCESS_TYPE_TOTAL,
 };
 
-struct PostProcessPipeline {
-	u8 type;
-	ID3D11ShaderResourceView* in;
-	ID3D11RenderTargetView* out;
+// Mirrors the pass cbuffer in FullScreenQuadShader and PostProcessShader
+struct PostProcessConstants {
+	Vec2 uv_scale;
+	Vec2 resolution;
 };
 
+// Passes go through a frame graph, so a chain only costs the targets it needs at once. Scene
+// sized targets are allocated at target_dim and drawn at render_dim, the pass that writes the
+// backbuffer scales the image back up.
 struct PostProcessRenderer {
 	VertexShader* full_screen_quad_shader;
 	PixelShader* ps[POST_PROCESS_TYPE_TOTAL];
 
-	ConstantsBuffer* resolution_constants;
-	PostProcessPipeline pipeline;
+	ConstantsBuffer* pass_constants;
+
+	FrameGraph graph;
+	TextureBuffer scene_texture;
+	u32 scene;						// the readable render target the world was drawn to
+	u32 backbuffer;
 };
 
 static void
@@ -34,83 +41,123 @@ InitPostProcessRenderer(Renderer* renderer, MemoryArena* arena) {
 
 	InitPostProcessShaders(result, renderer);
 
-	result->resolution_constants = UploadConstantsBuffer(sizeof(Vec2), renderer);
+	result->pass_constants = UploadConstantsBuffer(sizeof(PostProcessConstants), renderer);
 	return result;
 };
 
 static void
-PushPostProcessPipeline(PostProcessPipeline* pipeline, PostProcessRenderer* pp_renderer, Renderer* renderer) {
-	pp_renderer->pipeline = *pipeline;
+BeginPostProcess(PostProcessRenderer* pp_renderer, Renderer* renderer) {
+	FrameGraph* graph = &pp_renderer->graph;
+	ResetFrameGraph(graph);
+
+	WindowDimensions wd = renderer->window_dim;
+	WindowDimensions td = renderer->target_dim;
+	WindowDimensions rd = renderer->render_dim;
+	pp_renderer->scene_texture.buffer = renderer->readable_render_target.texture;
+	pp_renderer->scene_texture.view = renderer->readable_render_target.shader_resource;
+	pp_renderer->scene = ImportFrameGraphTarget(graph, "Scene", td.width, td.height, 0, &pp_renderer->scene_texture);
+	SetFrameGraphUsedSize(graph, pp_renderer->scene, rd.width, rd.height);
+	pp_renderer->backbuffer = ImportFrameGraphTarget(graph, "Backbuffer", wd.width, wd.height, &renderer->backbuffer, 0);
 }
 
+// Scene sized divided by downsample, a render scale change doesn't touch the allocation
+static u32
+CreatePostProcessTarget(char* name, u32 downsample, PostProcessRenderer* pp_renderer, Renderer* renderer) {
+	WindowDimensions td = renderer->target_dim;
+	WindowDimensions rd = renderer->render_dim;
+	FrameGraph* graph = &pp_renderer->graph;
+	u32 result = CreateFrameGraphTarget(graph, name, Max(td.width/downsample, 1), Max(td.height/downsample, 1));
+	SetFrameGraphUsedSize(graph, result, Max(rd.width/downsample, 1), Max(rd.height/downsample, 1));
+	return result;
+}
+
+static FRAME_GRAPH_PASS_CALLBACK(RecordPostProcessPass);
+
 static void
-PostProcessRendererFrame(PostProcessRenderer* pp_renderer, Renderer* renderer) {
-#if INTERNAL
-	if(executable_reloaded) InitPostProcessShaders(pp_renderer, renderer);
-#endif
-	PostProcessPipeline pipeline = pp_renderer->pipeline;
-
-	SetRasterizerState* srs = PushRenderCommand(renderer, SetRasterizerState);
-	srs->type = RASTERIZER_STATE_DoubleSided;
-
-	SetVertexShader* svs = PushRenderCommand(renderer, SetVertexShader);
-	svs->vertex = pp_renderer->full_screen_quad_shader;
-
-	SetPixelShader* sps = PushRenderCommand(renderer, SetPixelShader);
-	sps->pixel = pp_renderer->ps[pipeline.type];
-
-	if(pipeline.type == POST_PROCESS_TYPE_Edge) {
-		PushRenderBufferData* push_resolution = PushRenderCommand(renderer, PushRenderBufferData);
-		Vec2* resolution = PushStruct(renderer->frame_arena, Vec2);
-		resolution->x = (float)renderer->window_dim.width;
-		resolution->y = (float)renderer->window_dim.height;
-		push_resolution->buffer = pp_renderer->resolution_constants->buffer;
-		push_resolution->data = resolution;
-		push_resolution->size = sizeof(Vec2);
-
-		SetBlendState* set_blend_state = PushRenderCommand(renderer, SetBlendState);
-		set_blend_state->type = BLEND_STATE_NoBlend;
-
-		SetConstantsBuffer* scb = PushRenderCommand(renderer, SetConstantsBuffer);
-		scb->vertex_shader = false;
-		scb->constants = pp_renderer->resolution_constants;
+PushPostProcessPass(char* name, POST_PROCESS_TYPE type, u32 in, u32 out, PostProcessRenderer* pp_renderer) {
+	FrameGraphPass* pass = AddFrameGraphPass(&pp_renderer->graph, name, &in, 1, out, RecordPostProcessPass, pp_renderer);
+	pass->type = type;
+}
+
+static void
+EndPostProcess(PostProcessRenderer* pp_renderer, Renderer* renderer) {
+	CompileFrameGraph(&pp_renderer->graph, renderer);
+}
+
+static FRAME_GRAPH_PASS_CALLBACK(RecordPostProcessPass) {
+	PostProcessRenderer* pp_renderer = (PostProcessRenderer*)pass->data;
+	FrameGraphResource* in = graph->resources + pass->reads[0];
+	FrameGraphResource* out = graph->resources + pass->write;
+
+	RenderTarget* rt = GetFrameGraphRenderTarget(graph, pass->write);
+
+	RenderPipelineState state = {};
+	state.render_target = rt;
+	state.blend = pass->type == POST_PROCESS_TYPE_Edge ? BLEND_STATE_NoBlend : BLEND_STATE_Regular;
+	state.rasterizer = RASTERIZER_STATE_DoubleSided;
+	state.topology = PRIMITIVE_TOPOLOGY_TriangleList;
+	state.vs = pp_renderer->full_screen_quad_shader;
+	state.ps = pp_renderer->ps[pass->type];
+	BeginRenderItem(RENDER_PASS_PostProcess, &state, 0, 0, (float)pass->position/MAX_FRAME_GRAPH_PASSES, list);
+
+	// Pushed inside the item, an immediate push would run before every pass and leave them all
+	// bound to the last range
+	PostProcessConstants* constants = PushStruct(&list->arena, PostProcessConstants);
+	constants->uv_scale = V2((float)in->used_width/(float)in->width, (float)in->used_height/(float)in->height);
+	constants->resolution = V2((float)in->width, (float)in->height);
+
+	PushRenderConstants* push_constants = PushRenderCommand(list, PushRenderConstants);
+	push_constants->constants = pp_renderer->pass_constants;
+	push_constants->data = constants;
+	push_constants->size = sizeof(PostProcessConstants);
+
+	// The last pass writes something imported at window size, so later passes get their viewport back
+	SetViewport* set_viewport = PushRenderCommand(list, SetViewport);
+	set_viewport->topleft = V2Z();
+	set_viewport->dim = V2((float)out->used_width, (float)out->used_height);
+
+	for(u32 vertex_shader=0; vertex_shader<2; vertex_shader++) {
+		SetConstantsBuffer* scb = PushRenderCommand(list, SetConstantsBuffer);
+		scb->vertex_shader = vertex_shader != 0;
+		scb->constants = pp_renderer->pass_constants;
 		scb->slot = 0;
 	}
-	else {
-		SetBlendState* set_blend_state = PushRenderCommand(renderer, SetBlendState);
-		set_blend_state->type = BLEND_STATE_Regular;
-	}
-
-	RenderTarget* rt = PushStruct(renderer->frame_arena, RenderTarget);
-	rt->view = pipeline.out;
-	SetRenderTarget* srt = PushRenderCommand(renderer, SetRenderTarget);
-	srt->render_target = rt;
 
-	ClearRenderTarget* crt = PushRenderCommand(renderer, ClearRenderTarget);
+	ClearRenderTarget* crt = PushRenderCommand(list, ClearRenderTarget);
 	crt->render_target = rt;
 	*(Vec4*)crt->color = V4FromV3(RED, 1.0f);
 
-	ClearDepth* cd = PushRenderCommand(renderer, ClearDepth);
+	ClearDepth* cd = PushRenderCommand(list, ClearDepth);
 	cd->value = 1.0f;
 
-	SetSamplerState* set_sampler_state = PushRenderCommand(renderer, SetSamplerState);
-	set_sampler_state->type = SAMPLER_STATE_Default;
+	// Filtered only when the pass scales, so a same size copy stays exact
+	bool scales = in->used_width != out->used_width || in->used_height != out->used_height;
+	SetSamplerState* set_sampler_state = PushRenderCommand(list, SetSamplerState);
+	set_sampler_state->type = scales ? SAMPLER_STATE_Linear : SAMPLER_STATE_Default;
 	set_sampler_state->slot = 0;
 
-	TextureBuffer* tb = PushStruct(renderer->frame_arena, TextureBuffer);
-	tb->view = pipeline.in;
-	SetTextureBuffer* stb = PushRenderCommand(renderer, SetTextureBuffer);
-	stb->texture = tb;
-	stb->slot = 0;
-
-	SetPrimitiveTopology* set_topology = PushRenderCommand(renderer, SetPrimitiveTopology);
-	set_topology->type = PRIMITIVE_TOPOLOGY_TriangleList;
+	// Bound after the render target so it is not unbound as the output
+	for(u32 i=0; i<pass->read_count; i++) {
+		SetTextureBuffer* stb = PushRenderCommand(list, SetTextureBuffer);
+		stb->texture = GetFrameGraphTexture(graph, pass->reads[i]);
+		stb->slot = (u8)i;
+	}
 
-	DrawVertices* dv = PushRenderCommand(renderer, DrawVertices);
+	DrawVertices* dv = PushRenderCommand(list, DrawVertices);
 	dv->vertices_count = 3;
+	dv->offset = 0;
 
-	SetTextureBuffer* stb2 = PushRenderCommand(renderer, SetTextureBuffer);
-	stb2->texture = 0;
-	stb2->slot = 0;
+	// Unbound so a later pass can render to what this one read
+	for(u32 i=0; i<pass->read_count; i++) {
+		SetTextureBuffer* stb = PushRenderCommand(list, SetTextureBuffer);
+		stb->texture = 0;
+		stb->slot = (u8)i;
+	}
+
+	EndRenderItem(list);
+}
 
+static void
+PostProcessRendererFrame(PostProcessRenderer* pp_renderer, RenderCommandList* list) {
+	ExecuteFrameGraph(&pp_renderer->graph, list);
 }
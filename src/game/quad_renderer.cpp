@@ -1,5 +1,7 @@
 #define MAX_QUADS 10000
 #define MAX_TEXTURED_QUADS 10000
+#define MAX_TEXTURED_QUAD_BATCHES 64
+static_assert(MAX_TEXTURED_QUAD_BATCHES <= 256, "batch_of_quad stores the batch as a u8");
 
 struct RenderQuad {
 	Quad quad;
@@ -11,6 +13,15 @@ struct TexturedQuad {
 	TextureBuffer* texture;
 };
 
+// Quads sharing texture and blend state, drawn as one instanced strip
+struct TexturedQuadBatch {
+	TextureBuffer* texture;
+	u8 blend_state;
+	u32 first;
+	u32 count;
+	float depth;
+};
+
 struct QuadRenderer {
 	RenderQuad quads[MAX_QUADS];
 	u32 quad_counter;
@@ -20,25 +31,22 @@ struct QuadRenderer {
 	PixelShader* quad_ps;
 	StructuredBuffer* quad_buffer;
 
-	Vec3 positions[MAX_TEXTURED_QUADS*4];
-	Vec2 texcoords[MAX_TEXTURED_QUADS*4];
+	Quad textured_quads[MAX_TEXTURED_QUADS];
 	TextureBuffer* textures[MAX_TEXTURED_QUADS];
 	u8 blend_states[MAX_TEXTURED_QUADS];
 	u32 textured_quad_counter;
 
 	VertexShader* textured_quad_vs;
 	PixelShader* textured_quad_ps;
-	VertexBuffer* textured_quad_vertex_buffers[2];
+	StructuredBuffer* textured_quad_buffer;
 };
 
 static QuadRenderer*
 InitQuadRenderer(Renderer* renderer, MemoryArena* arena) {
 	QuadRenderer* result = PushStruct(arena, QuadRenderer);
 
-	VERTEX_BUFFER vertex_buffers[] = { VERTEX_BUFFER_POSITION, VERTEX_BUFFER_TEXCOORD };
-
 	result->textured_quad_vs = UploadVertexShader(TexturedQuadShader, sizeof(TexturedQuadShader),
-			"vsf", vertex_buffers, ArrayCount(vertex_buffers), renderer);
+			"vsf", 0, 0, renderer);
 
 	result->textured_quad_ps = UploadPixelShader(TexturedQuadShader, sizeof(TexturedQuadShader), 
 			"psf", renderer);
@@ -50,8 +58,7 @@ InitQuadRenderer(Renderer* renderer, MemoryArena* arena) {
 
 	result->camera_constants = UploadConstantsBuffer(sizeof(Mat4), renderer);
 
-	result->textured_quad_vertex_buffers[0] = UploadVertexBuffer(0, MAX_TEXTURED_QUADS*4, 3, true, renderer);
-	result->textured_quad_vertex_buffers[1] = UploadVertexBuffer(0, MAX_TEXTURED_QUADS*4, 2, true, renderer);
+	result->textured_quad_buffer = UploadStructuredBuffer(sizeof(Quad), MAX_TEXTURED_QUADS, renderer);
 
 	return result;
 }
@@ -64,49 +71,23 @@ PushRenderQuad(Quad* quad, Vec4 color, QuadRenderer* quad_renderer) {
 }
 
 static void
-PushTexturedQuad(Quad* quad, TextureBuffer* texture_buffer, QuadRenderer* quad_renderer) {
-	Assert(quad_renderer->textured_quad_counter <= MAX_TEXTURED_QUADS);
-	Vec2* texcoords = quad_renderer->texcoords;
-	Vec3* positions = quad_renderer->positions;
-	u32 textured_quad_counter = quad_renderer->textured_quad_counter;
-
-	positions[textured_quad_counter*4] = quad->bl;
-	texcoords[textured_quad_counter*4] = V2(0.0f, 1.0f);
-
-	positions[textured_quad_counter*4 + 1] = quad->br;
-	texcoords[textured_quad_counter*4 + 1] = V2(1.0f, 1.0f);
+PushTexturedQuadBlended(Quad* quad, TextureBuffer* texture_buffer, u8 blend_state, QuadRenderer* quad_renderer) {
+	Assert(quad_renderer->textured_quad_counter < MAX_TEXTURED_QUADS);
+	u32 index = quad_renderer->textured_quad_counter++;
 
-	positions[textured_quad_counter*4 + 2] = quad->tl;
-	texcoords[textured_quad_counter*4 + 2] = V2(0.0f, 0.0f);
-
-	positions[textured_quad_counter*4 + 3] = quad->tr;
-	texcoords[textured_quad_counter*4 + 3] = V2(1.0f, 0.0f);
+	quad_renderer->textured_quads[index] = *quad;
+	quad_renderer->textures[index] = texture_buffer;
+	quad_renderer->blend_states[index] = blend_state;
+}
 
-	quad_renderer->textures[quad_renderer->textured_quad_counter] = texture_buffer;
-	quad_renderer->blend_states[quad_renderer->textured_quad_counter++] = 0;
+static void
+PushTexturedQuad(Quad* quad, TextureBuffer* texture_buffer, QuadRenderer* quad_renderer) {
+	PushTexturedQuadBlended(quad, texture_buffer, BLEND_STATE_NoBlend, quad_renderer);
 }
 
 static void
 PushParticleQuad(Quad* quad, TextureBuffer* texture_buffer, QuadRenderer* quad_renderer) {
-	Assert(quad_renderer->textured_quad_counter <= MAX_TEXTURED_QUADS);
-	Vec2* texcoords = quad_renderer->texcoords;
-	Vec3* positions = quad_renderer->positions;
-	u32 textured_quad_counter = quad_renderer->textured_quad_counter;
-
-	positions[textured_quad_counter*4] = quad->bl;
-	texcoords[textured_quad_counter*4] = V2(0.0f, 1.0f);
-
-	positions[textured_quad_counter*4 + 1] = quad->br;
-	texcoords[textured_quad_counter*4 + 1] = V2(1.0f, 1.0f);
-
-	positions[textured_quad_counter*4 + 2] = quad->tl;
-	texcoords[textured_quad_counter*4 + 2] = V2(0.0f, 0.0f);
-
-	positions[textured_quad_counter*4 + 3] = quad->tr;
-	texcoords[textured_quad_counter*4 + 3] = V2(1.0f, 0.0f);
-
-	quad_renderer->textures[quad_renderer->textured_quad_counter++] = texture_buffer;
-	quad_renderer->blend_states[quad_renderer->textured_quad_counter++] = BLEND_STATE_Regular;
+	PushTexturedQuadBlended(quad, texture_buffer, BLEND_STATE_Regular, quad_renderer);
 }
 
 static void
@@ -121,91 +102,151 @@ PushRenderLine(Line* line, Vec4 color, float thickness, Camera* camera, QuadRend
 }
 
 static void
-QuadRendererFrame(QuadRenderer* quad_renderer, Camera* cam, Renderer* renderer) {
+QuadRendererFrame(QuadRenderer* quad_renderer, Camera* cam, RenderCommandList* list) {
 	if(!quad_renderer->quad_counter && !quad_renderer->textured_quad_counter) return;
 
-	Mat4* vp = PushStruct(renderer->frame_arena, Mat4);
+	Mat4* vp = PushStruct(&list->arena, Mat4);
 	*vp = MakeViewPerspective(cam);
 
-	PushRenderBufferData* push_camera_constants = PushRenderCommand(renderer, PushRenderBufferData);
-	push_camera_constants->buffer = quad_renderer->camera_constants->buffer;
+	PushRenderConstants* push_camera_constants = PushRenderCommand(list, PushRenderConstants);
+	push_camera_constants->constants = quad_renderer->camera_constants;
 	push_camera_constants->data = vp;
 	push_camera_constants->size = sizeof(Mat4);
 
-	SetConstantsBuffer* set_camera_constants = PushRenderCommand(renderer, SetConstantsBuffer);
-	set_camera_constants->constants = quad_renderer->camera_constants;
-	set_camera_constants->slot = (u8)1;
-	set_camera_constants->vertex_shader = true;
-
 	if(quad_renderer->textured_quad_counter) {
-		SetPrimitiveTopology* set_topology = PushRenderCommand(renderer, SetPrimitiveTopology);
-		set_topology->type = (u8)PRIMITIVE_TOPOLOGY_TriangleStrip;
-
-		SetVertexShader* set_vertex_shader = PushRenderCommand(renderer, SetVertexShader);
-		set_vertex_shader->vertex = quad_renderer->textured_quad_vs;
-
-		SetPixelShader* set_pixel_shader = PushRenderCommand(renderer, SetPixelShader);
-		set_pixel_shader->pixel = quad_renderer->textured_quad_ps;
-
-		PushRenderBufferData* push_pos_verts = PushRenderCommand(renderer, PushRenderBufferData);
-		push_pos_verts->buffer = quad_renderer->textured_quad_vertex_buffers[0]->buffer;
-		push_pos_verts->data = quad_renderer->positions;
-		push_pos_verts->size = sizeof(float)*3 * quad_renderer->textured_quad_counter*4;
-
-		PushRenderBufferData* push_tex_verts = PushRenderCommand(renderer, PushRenderBufferData);
-		push_tex_verts->buffer = quad_renderer->textured_quad_vertex_buffers[1]->buffer;
-		push_tex_verts->data = quad_renderer->texcoords;
-		push_tex_verts->size = sizeof(float)*2 * quad_renderer->textured_quad_counter*4;
-
-		SetVertexBuffer* set_position_buffer = PushRenderCommand(renderer, SetVertexBuffer);
-		set_position_buffer->vertex = quad_renderer->textured_quad_vertex_buffers[0];
-		set_position_buffer->slot = 0;
-		set_position_buffer->stride = sizeof(float)*3;
-		set_position_buffer->offset = 0;
-
-		SetVertexBuffer* set_texcoord_buffer = PushRenderCommand(renderer, SetVertexBuffer);
-		set_texcoord_buffer->vertex = quad_renderer->textured_quad_vertex_buffers[1];
-		set_texcoord_buffer->slot = 1;
-		set_texcoord_buffer->stride = sizeof(float)*2;
-		set_texcoord_buffer->offset = 0;
-
-		for(u32 i=0; i<quad_renderer->textured_quad_counter; i++) {
-			SetTextureBuffer* set_texture_buffer = PushRenderCommand(renderer, SetTextureBuffer);
-			set_texture_buffer->texture = quad_renderer->textures[i];
-			set_texture_buffer->slot = 0;
-
-			SetBlendState* set_blend_state = PushRenderCommand(renderer, SetBlendState);
-			set_blend_state->type = quad_renderer->blend_states[i];
-
-			DrawVertices* draw_verts = PushRenderCommand(renderer, DrawVertices);
-			draw_verts->vertices_count = 4 * quad_renderer->textured_quad_counter;
+		u32 count = quad_renderer->textured_quad_counter;
+		u8* batch_of_quad = PushArray(&list->arena, u8, count);
+		Quad* instances = PushArray(&list->arena, Quad, count);
+
+		// A full batch table draws the quads bucketed so far and starts over with the rest
+		u32 start = 0;
+		while(start < count) {
+			TexturedQuadBatch batches[MAX_TEXTURED_QUAD_BATCHES];
+			u32 batch_count = 0;
+
+			// Bucket by texture and blend, consecutive quads usually share one
+			u32 last = 0;
+			u32 end = start;
+			for(; end<count; end++) {
+				TextureBuffer* texture = quad_renderer->textures[end];
+				u8 blend_state = quad_renderer->blend_states[end];
+
+				u32 batch = last;
+				if(!batch_count || batches[batch].texture != texture || batches[batch].blend_state != blend_state) {
+					for(batch=0; batch<batch_count; batch++)
+						if(batches[batch].texture == texture && batches[batch].blend_state == blend_state) break;
+
+					if(batch == batch_count) {
+						if(batch_count == MAX_TEXTURED_QUAD_BATCHES) break;
+						TexturedQuadBatch* new_batch = batches + batch_count++;
+						new_batch->texture = texture;
+						new_batch->blend_state = blend_state;
+						new_batch->count = 0;
+						new_batch->depth = blend_state == BLEND_STATE_NoBlend ? 1.0f : 0.0f;
+					}
+				}
+
+				// Opaque batches sort on their nearest quad, blended ones on their farthest
+				Quad* quad = quad_renderer->textured_quads + end;
+				Vec3 center = V3MulF(V3Add(quad->bl, quad->tr), 0.5f);
+				float depth = GetViewDepth(center, cam);
+				TexturedQuadBatch* quad_batch = batches + batch;
+				if(blend_state == BLEND_STATE_NoBlend) quad_batch->depth = Min(quad_batch->depth, depth);
+				else quad_batch->depth = Max(quad_batch->depth, depth);
+
+				quad_batch->count++;
+				batch_of_quad[end] = (u8)batch;
+				last = batch;
+			}
+
+			u32 first = start;
+			for(u32 i=0; i<batch_count; i++) {
+				batches[i].first = first;
+				first += batches[i].count;
+				batches[i].count = 0;
+			}
+
+			for(u32 i=start; i<end; i++) {
+				TexturedQuadBatch* batch = batches + batch_of_quad[i];
+				instances[batch->first + batch->count++] = quad_renderer->textured_quads[i];
+			}
+
+			for(u32 i=0; i<batch_count; i++) {
+				TexturedQuadBatch* batch = batches + i;
+
+				RenderPipelineState state = {};
+				state.blend = batch->blend_state;
+				state.rasterizer = RASTERIZER_STATE_Default;
+				state.topology = PRIMITIVE_TOPOLOGY_TriangleStrip;
+				state.vs = quad_renderer->textured_quad_vs;
+				state.ps = quad_renderer->textured_quad_ps;
+				BeginRenderItem(RENDER_PASS_World, &state, batch->texture, 0, batch->depth, list);
+
+				SetConstantsBuffer* set_camera_constants = PushRenderCommand(list, SetConstantsBuffer);
+				set_camera_constants->constants = quad_renderer->camera_constants;
+				set_camera_constants->slot = (u8)1;
+				set_camera_constants->vertex_shader = true;
+
+				SetSamplerState* set_sampler_state = PushRenderCommand(list, SetSamplerState);
+				set_sampler_state->type = SAMPLER_STATE_Default;
+				set_sampler_state->slot = 0;
+
+				SetStructuredBuffer* set_instance_buffer = PushRenderCommand(list, SetStructuredBuffer);
+				set_instance_buffer->vertex_shader = true;
+				set_instance_buffer->structured = quad_renderer->textured_quad_buffer;
+				set_instance_buffer->slot = 0;
+
+				// SV_InstanceID ignores the start instance, so every batch uploads its own range
+				PushRenderBufferData* push_instances = PushRenderCommand(list, PushRenderBufferData);
+				push_instances->buffer = quad_renderer->textured_quad_buffer->buffer;
+				push_instances->data = instances + batch->first;
+				push_instances->size = sizeof(Quad) * batch->count;
+
+				DrawInstanced* draw_instanced = PushRenderCommand(list, DrawInstanced);
+				draw_instanced->vertices_count = 4;
+				draw_instanced->instance_count = batch->count;
+				draw_instanced->offset = 0;
+
+				EndRenderItem(list);
+			}
+			start = end;
 		}
 	}
 
 	if(quad_renderer->quad_counter) {
-		SetPrimitiveTopology* set_topology = PushRenderCommand(renderer, SetPrimitiveTopology);
-		set_topology->type = (u8)PRIMITIVE_TOPOLOGY_TriangleList;
-
-		PushRenderBufferData* push_quad_buffer = PushRenderCommand(renderer, PushRenderBufferData);
+		PushRenderBufferData* push_quad_buffer = PushRenderCommand(list, PushRenderBufferData);
 		push_quad_buffer->buffer = quad_renderer->quad_buffer->buffer;
 		push_quad_buffer->data = quad_renderer->quads;
 		push_quad_buffer->size = sizeof(RenderQuad) * quad_renderer->quad_counter;
 
-		SetStructuredBuffer* set_quad_buffer = PushRenderCommand(renderer, SetStructuredBuffer);
+		RenderPipelineState state = {};
+		state.blend = BLEND_STATE_Regular;
+		state.rasterizer = RASTERIZER_STATE_Default;
+		state.topology = PRIMITIVE_TOPOLOGY_TriangleList;
+		state.vs = quad_renderer->quad_vs;
+		state.ps = quad_renderer->quad_ps;
+		BeginRenderItem(RENDER_PASS_World, &state, 0, 0, 0.0f, list);
+
+		SetConstantsBuffer* set_camera_constants = PushRenderCommand(list, SetConstantsBuffer);
+		set_camera_constants->constants = quad_renderer->camera_constants;
+		set_camera_constants->slot = (u8)1;
+		set_camera_constants->vertex_shader = true;
+
+		SetStructuredBuffer* set_quad_buffer = PushRenderCommand(list, SetStructuredBuffer);
 		set_quad_buffer->vertex_shader = true;
 		set_quad_buffer->structured = quad_renderer->quad_buffer;
 		set_quad_buffer->slot = 0;
 
-		SetVertexShader* set_vertex_shader = PushRenderCommand(renderer, SetVertexShader);
-		set_vertex_shader->vertex = quad_renderer->quad_vs;
-
-		SetPixelShader* set_pixel_shader = PushRenderCommand(renderer, SetPixelShader);
-		set_pixel_shader->pixel = quad_renderer->quad_ps;
-
-		DrawVertices* draw_verts = PushRenderCommand(renderer, DrawVertices);
+		DrawVertices* draw_verts = PushRenderCommand(list, DrawVertices);
 		draw_verts->vertices_count = 6 * quad_renderer->quad_counter;
+		draw_verts->offset = 0;
+
+		EndRenderItem(list);
 	}
+}
 
+static void
+ResetQuadRenderer(QuadRenderer* quad_renderer) {
 	quad_renderer->quad_counter = 0;
 	quad_renderer->textured_quad_counter = 0;
 }
@@ -1,866 +1,862 @@
 #include "renderer.h"
 
-static void
-PushRenderData(ID3D11Buffer* buffer, void* data, u32 size, ID3D11DeviceContext* context) {
-	D3D11_MAPPED_SUBRESOURCE msr = {};
-
-	context->Map(buffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &msr);
-	CopyMem(msr.pData, data, size);
-	context->Unmap(buffer, 0);
-
-	data = nullptr;
-}
-
-static void* 
-PushCommandBuffer(Renderer* renderer, u32 size) {
-	void* result = 0;
-
-	u8* command_buffer_end = renderer->command_buffer_base + renderer->command_buffer_size;
-
-	if((renderer->command_buffer_cursor + size) <= command_buffer_end) {
-		result = renderer->command_buffer_cursor;
-		renderer->command_buffer_cursor += size;
+// Moves on to the block after current, reusing one from an earlier frame when there is one
+static RenderCommandBlock*
+NextRenderCommandBlock(RenderCommandStream* stream) {
+	RenderCommandBlock* block = stream->current ? stream->current->next : stream->first;
+	if(!block) {
+		block = (RenderCommandBlock*)PushSize(stream->arena, sizeof(RenderCommandBlock) + RENDER_COMMAND_BLOCK_SIZE);
+		block->next = 0;
+		block->base = (u8*)(block + 1);
+		block->size = RENDER_COMMAND_BLOCK_SIZE;
+
+		if(stream->current) stream->current->next = block;
+		else stream->first = block;
 	}
-	else Assert(false);
 
-	return result;
+	block->used = 0;
+	stream->current = block;
+	return block;
 }
 
-#define PushRenderCommand(renderer, type) (type *)PushRenderCommand_(renderer, sizeof(type), RENDER_COMMAND_##type)
-
 static void*
-PushRenderCommand_(Renderer* renderer, u32 size, RENDER_COMMAND type ) {
-	void* result = 0;
+PushRenderCommandStream(RenderCommandStream* stream, u32 size) {
+	Assert(size <= RENDER_COMMAND_BLOCK_SIZE);
 
-	u32 actual_size = size + sizeof(RenderCommandHeader);
-	void* ptr = PushCommandBuffer(renderer, actual_size);
+	RenderCommandBlock* block = stream->current;
+	if(!block || block->used + size > block->size) block = NextRenderCommandBlock(stream);
 
-	RenderCommandHeader* header = (RenderCommandHeader*)ptr;
-	header->type = (u8)type;
-	result = (u8*)ptr + sizeof(RenderCommandHeader);
+	void* result = block->base + block->used;
+	block->used += size;
+	return result;
+}
 
+static RenderCommandMark
+GetRenderCommandMark(RenderCommandStream* stream) {
+	RenderCommandMark result = {};
+	result.block = stream->current;
+	result.used = stream->current ? stream->current->used : 0;
 	return result;
 }
 
+// Drops everything pushed after the mark, the blocks stay in the stream to be reused
 static void
-ExecuteRenderCommands(Renderer* renderer) {
-	u8* cursor = renderer->command_buffer_base;
-	while(cursor < renderer->command_buffer_cursor) {
-		RenderCommandHeader* header = (RenderCommandHeader*)cursor;
-		cursor += sizeof(RenderCommandHeader);
-		void* data = (u8*)header + sizeof(RenderCommandHeader);
+RewindRenderCommands(RenderCommandStream* stream, RenderCommandMark mark) {
+	stream->current = mark.block;
+	if(mark.block) mark.block->used = mark.used;
+}
 
-		switch(header->type) {
+// Copies everything pushed after the mark to dest when there is one, returns the size either way
+static u32
+CopyRenderCommands(RenderCommandStream* stream, RenderCommandMark from, u8* dest) {
+	u32 result = 0;
+	if(!stream->current) return result;
+
+	RenderCommandBlock* block = from.block ? from.block : stream->first;
+	u32 offset = from.block ? from.used : 0;
+	for(;;) {
+		u32 size = block->used - offset;
+		if(dest) CopyMem(dest + result, block->base + offset, size);
+		result += size;
+
+		if(block == stream->current) break;
+		block = block->next;
+		offset = 0;
+	}
 
-			case RENDER_COMMAND_ClearRenderTarget: {
-				cursor += sizeof(ClearRenderTarget);
-				ClearRenderTarget* command = (ClearRenderTarget*)data;
+	return result;
+}
 
-				if(command->render_target)
-					renderer->context->ClearRenderTargetView(command->render_target->view, command->color);
-				else
-					renderer->context->ClearRenderTargetView(renderer->readable_render_target.render_target, command->color);
+static void* 
+PushCommandBuffer(Renderer* renderer, u32 size) {
+	return PushRenderCommandStream(&renderer->commands, size);
+}
 
-			} break;
+// While a render item is open commands go to the item stream, they reach the command buffer sorted
+static void* 
+PushCommandBuffer(RenderCommandList* list, u32 size) {
+	RenderItem* item = list->open_item;
+	if(!item) return PushRenderCommandStream(&list->immediates, size);
+
+	void* result = PushRenderCommandStream(&list->item_commands, size);
+	// The item outgrew the space BeginRenderItem made sure of
+	Assert((u8*)result == item->commands + item->size);
+	item->size += size;
+	return result;
+}
 
-			case RENDER_COMMAND_ClearDepth: {
-				cursor += sizeof(ClearDepth);
-				ClearDepth* command = (ClearDepth*)data;
+static u32
+GetRenderCommandSize(u32 payload_size) {
+	u32 size = sizeof(RenderCommandHeader) + payload_size;
+	return (size + RENDER_COMMAND_ALIGNMENT - 1) & ~(RENDER_COMMAND_ALIGNMENT - 1);
+}
 
-					renderer->context->ClearDepthStencilView(renderer->depth_stencil.view, D3D11_CLEAR_DEPTH,
-							command->value, 0);
-			} break;
+static void*
+WriteRenderCommandHeader(void* ptr, RENDER_COMMAND type, u32 size) {
+	RenderCommandHeader* header = (RenderCommandHeader*)ptr;
+	header->type = type;
+	header->size = size;
+	return header + 1;
+}
 
-			case RENDER_COMMAND_ClearStencil: {
-				cursor += sizeof(ClearStencil);
-				ClearStencil* command = (ClearStencil*)data;
+// Takes either the renderer or a command list
+#define PushRenderCommand(target, type) (type *)PushRenderCommand_(target, sizeof(type), RENDER_COMMAND_##type)
 
-				// TODO: handle default value
-				renderer->context->ClearDepthStencilView(renderer->depth_stencil.view, D3D11_CLEAR_STENCIL, 0, command->value);
-			} break;
+static void*
+PushRenderCommand_(Renderer* renderer, u32 size, RENDER_COMMAND type ) {
+	u32 command_size = GetRenderCommandSize(size);
+	void* ptr = PushCommandBuffer(renderer, command_size);
+	return WriteRenderCommandHeader(ptr, type, command_size);
+}
 
-			case RENDER_COMMAND_SetRenderTarget: {
-				cursor += sizeof(SetRenderTarget);
-				SetRenderTarget* command = (SetRenderTarget*)data;
+static void*
+PushRenderCommand_(RenderCommandList* list, u32 size, RENDER_COMMAND type ) {
+	u32 command_size = GetRenderCommandSize(size);
+	void* ptr = PushCommandBuffer(list, command_size);
+	return WriteRenderCommandHeader(ptr, type, command_size);
+}
 
-				if(command->render_target) 
-					renderer->context->OMSetRenderTargets(1, &command->render_target->view, renderer->depth_stencil.view);
-				else
-					renderer->context->OMSetRenderTargets(1, &renderer->readable_render_target.render_target, renderer->depth_stencil.view);
-			} break;
+static RenderCommandList*
+GetRenderCommandList(RENDER_LIST index, Renderer* renderer) {
+	return renderer->lists + index;
+}
 
-			case RENDER_COMMAND_SetDepthStencilState: {
-				cursor += sizeof(SetDepthStencilState);
-				SetDepthStencilState* command = (SetDepthStencilState*)data;
+// Most significant first: pass 4 | blend 2 | rasterizer 2 | shader 12 | texture 12 | mesh 8 | depth 24
+// Blended draws move depth in front of the shader and invert it so they go back to front.
+// Ids are truncated to their field, a collision only costs state changes.
+static u64
+MakeSortKey(RENDER_PASS pass, RenderPipelineState* state, TextureBuffer* texture, VertexBuffer* mesh, float depth) {
+	u64 shader = (((u64)state->vs->id & 0x3f) << 6) | ((u64)state->ps->id & 0x3f);
+	u64 texture_id = texture ? (texture->id & 0xfff) : 0;
+	u64 mesh_id = mesh ? (mesh->id & 0xff) : 0;
+	u64 depth_bits = (u64)(Clamp(0.0f, depth, 1.0f) * (float)0xffffff);
 
-				renderer->context->OMSetDepthStencilState(renderer->default_depth_stencil_state, 0);
-			} break;
+	// Post process items run in the order the frame graph scheduled them, depth carries it
+	if(pass == RENDER_PASS_PostProcess) return ((u64)pass << 60) | (depth_bits << 32);
 
+	u64 result = ((u64)pass << 60) | ((u64)(state->blend & 0x3) << 58) | ((u64)(state->rasterizer & 0x3) << 56);
 
-			case RENDER_COMMAND_SetBlendState: {
-				cursor += sizeof(SetBlendState);
-				SetBlendState* command = (SetBlendState*)data;
+	if(state->blend == BLEND_STATE_NoBlend)
+		result |= (shader << 44) | (texture_id << 32) | (mesh_id << 24) | depth_bits;
+	else
+		result |= ((0xffffff - depth_bits) << 32) | (shader << 20) | (texture_id << 8) | mesh_id;
 
-				renderer->context->OMSetBlendState(renderer->blend_states[command->type], 0, 0xffffffff);
-			} break;
+	return result;
+}
 
-			case RENDER_COMMAND_SetRasterizerState: {
-				cursor += sizeof(SetRasterizerState);
-				SetRasterizerState* command = (SetRasterizerState*)data;
+// depth is 0 at the camera and 1 at the far clip, ui uses it as layer order and post process as
+// pass order
+static void
+BeginRenderItem(RENDER_PASS pass, RenderPipelineState* state, TextureBuffer* texture, VertexBuffer* mesh, float depth,
+		RenderCommandList* list) {
+	Assert(!list->open_item);
+
+	if(list->item_count == list->max_items) {
+		u32 max_items = list->max_items*2;
+		RenderItem* items = PushArray(&list->buffer_arena, RenderItem, max_items);
+		CopyMem(items, list->items, list->item_count*sizeof(RenderItem));
+		list->items = items;
+		list->max_items = max_items;
+	}
 
-				renderer->context->RSSetState(renderer->rasterizer_states[command->type]);
-			} break;
+	RenderCommandStream* stream = &list->item_commands;
+	if(!stream->current || stream->current->used + RENDER_ITEM_MAX_SIZE > stream->current->size)
+		NextRenderCommandBlock(stream);
 
-			case RENDER_COMMAND_SetSamplerState: {
-				cursor += sizeof(SetSamplerState);
-				SetSamplerState* command = (SetSamplerState*)data;
+	RenderItem* item = list->items + list->item_count++;
+	item->key = MakeSortKey(pass, state, texture, mesh, depth);
+	item->commands = stream->current->base + stream->current->used;
+	item->size = 0;
+	list->open_item = item;
 
-				renderer->context->PSSetSamplers(command->slot, 1, &renderer->samplers[command->type]);
-			} break;
+	SetRenderTarget* set_render_target = PushRenderCommand(list, SetRenderTarget);
+	set_render_target->render_target = state->render_target;
 
-			case RENDER_COMMAND_SetViewport: {
-				cursor += sizeof(SetViewport);
-				SetViewport* command = (SetViewport*)data;
+	SetBlendState* set_blend_state = PushRenderCommand(list, SetBlendState);
+	set_blend_state->type = state->blend;
 
-				D3D11_VIEWPORT vp = {};
-				vp.TopLeftX       = command->topleft.x;
-				vp.TopLeftY       = command->topleft.y;
-				vp.Width          = command->dim.x;
-				vp.Height         = command->dim.y;
+	SetRasterizerState* set_rasterizer_state = PushRenderCommand(list, SetRasterizerState);
+	set_rasterizer_state->type = state->rasterizer;
 
-				renderer->context->RSSetViewports(1, &vp);
+	SetPrimitiveTopology* set_topology = PushRenderCommand(list, SetPrimitiveTopology);
+	set_topology->type = state->topology;
 
-				D3D11_RECT rect = {};
-				rect.right = vp.Width;
-				rect.bottom = vp.Height;
+	SetVertexShader* set_vertex_shader = PushRenderCommand(list, SetVertexShader);
+	set_vertex_shader->vertex = state->vs;
 
-				renderer->context->RSSetScissorRects(1, &rect);
+	SetPixelShader* set_pixel_shader = PushRenderCommand(list, SetPixelShader);
+	set_pixel_shader->pixel = state->ps;
 
-			} break;
+	if(texture) {
+		SetTextureBuffer* set_texture_buffer = PushRenderCommand(list, SetTextureBuffer);
+		set_texture_buffer->texture = texture;
+		set_texture_buffer->slot = 0;
+	}
+}
 
-			case RENDER_COMMAND_SetPrimitiveTopology: {
-				cursor += sizeof(SetPrimitiveTopology);
-				SetPrimitiveTopology* command = (SetPrimitiveTopology*)data;
+static void
+EndRenderItem(RenderCommandList* list) {
+	Assert(list->open_item);
+	list->open_item = 0;
+}
 
-				D3D_PRIMITIVE_TOPOLOGY topology;
-				if(command->type == PRIMITIVE_TOPOLOGY_TriangleList)
-					topology = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-				if(command->type == PRIMITIVE_TOPOLOGY_TriangleStrip)
-					topology = D3D_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP;
+static void
+InitRenderCommandList(RenderCommandList* list, Renderer* renderer) {
+	list->renderer = renderer;
+	list->arena.min_block_size = Megabytes(4);
+	list->buffer_arena.min_block_size = Megabytes(1);
+	list->immediates.arena = &list->buffer_arena;
+	list->item_commands.arena = &list->buffer_arena;
+
+	// Also keeps the arena's first block from going back to the platform every frame
+	list->max_items = 1024;
+	list->items = PushArray(&list->arena, RenderItem, list->max_items);
+	list->arena_temp = BeginTemporaryMemory(&list->arena);
+}
 
-				renderer->context->IASetPrimitiveTopology(topology);
-			} break;
+static void
+ResetRenderCommandList(RenderCommandList* list) {
+	Assert(!list->open_item);
+	EndTemporaryMemory(&list->arena_temp);
+	list->arena_temp = BeginTemporaryMemory(&list->arena);
+
+	list->immediates.current = 0;
+	list->item_commands.current = 0;
+	list->item_count = 0;
+	list->record_cycles = 0;
+}
 
-			case RENDER_COMMAND_SetVertexShader: {
-				cursor += sizeof(SetVertexShader);
-				SetVertexShader* command = (SetVertexShader*)data;
+// Around the code recording a list, shows up as the list's cycles in the frame stats
+static void
+BeginRenderListTiming(RenderCommandList* list) {
+	list->record_start = __rdtsc();
+}
 
-				renderer->context->IASetInputLayout(command->vertex->il);
-				renderer->context->VSSetShader(command->vertex->shader, 0, 0);
-			} break;
+static void
+EndRenderListTiming(RenderCommandList* list) {
+	list->record_cycles += __rdtsc() - list->record_start;
+}
 
-			case RENDER_COMMAND_SetPixelShader: {
-				cursor += sizeof(SetPixelShader);
-				SetPixelShader* command = (SetPixelShader*)data;
+// LSD radix sort on the key a byte at a time, bytes every item agrees on are skipped.
+// Stable, so items with equal keys stay in recording order.
+static void
+SortRenderItems(RenderItem* items, u32 count, MemoryArena* arena) {
+	if(count < 2) return;
+
+	RenderItem* src = items;
+	RenderItem* dst = PushArray(arena, RenderItem, count);
+
+	for(u32 shift=0; shift<64; shift+=8) {
+		u32 offsets[256] = {};
+		for(u32 i=0; i<count; i++) offsets[(src[i].key >> shift) & 0xff]++;
+		if(offsets[(src[0].key >> shift) & 0xff] == count) continue;
+
+		u32 total = 0;
+		for(u32 i=0; i<256; i++) {
+			u32 bucket_count = offsets[i];
+			offsets[i] = total;
+			total += bucket_count;
+		}
 
-				renderer->context->PSSetShader(command->pixel->shader, 0, 0);
-			} break;
+		for(u32 i=0; i<count; i++) dst[offsets[(src[i].key >> shift) & 0xff]++] = src[i];
 
-			case RENDER_COMMAND_SetVertexBuffer: {
-				cursor += sizeof(SetVertexBuffer);
-				SetVertexBuffer* command = (SetVertexBuffer*)data;
+		RenderItem* temp = src;
+		src = dst;
+		dst = temp;
+	}
 
-				renderer->context->IASetVertexBuffers(command->slot, 1, &command->vertex->buffer, &command->stride, &command->offset);
-			} break;
+	if(src != items) CopyMem(items, src, count*sizeof(RenderItem));
+}
 
-			case RENDER_COMMAND_SetIndexBuffer: {
-				cursor += sizeof(SetIndexBuffer);
-				SetIndexBuffer* command = (SetIndexBuffer*)data;
+// Appends every list to the command buffer, immediates in list order then all items sorted by key
+// with a BeginRenderPass in front of each pass.
+// Lists are left as they are, the output only depends on what they hold and not on who recorded them.
+static void
+MergeRenderCommandLists(Renderer* renderer) {
+	u64 start = __rdtsc();
+	RenderQueueStats* stats = &renderer->queue_stats;
+	for(u32 i=0; i<RENDER_STATS_PASSES; i++) stats->passes[i].items = 0;
+
+	u32 item_count = 0;
+	for(u32 i=0; i<RENDER_LIST_TOTAL; i++) {
+		RenderCommandList* list = renderer->lists + i;
+		Assert(!list->open_item);
+		stats->list_cycles[i] = list->record_cycles;
+
+		for(RenderCommandBlock* block = list->immediates.first; list->immediates.current; block = block->next) {
+			CopyMem(PushCommandBuffer(renderer, block->used), block->base, block->used);
+			if(block == list->immediates.current) break;
+		}
+		item_count += list->item_count;
+	}
 
-				renderer->context->IASetIndexBuffer(command->index->buffer, DXGI_FORMAT_R32_UINT, command->offset);
-			} break;
+	RenderItem* items = PushArray(renderer->frame_arena, RenderItem, item_count);
+	RenderItem* cursor = items;
+	for(u32 i=0; i<RENDER_LIST_TOTAL; i++) {
+		RenderCommandList* list = renderer->lists + i;
+		CopyMem(cursor, list->items, list->item_count*sizeof(RenderItem));
+		cursor += list->item_count;
+	}
 
-			case RENDER_COMMAND_SetStructuredBuffer: {
-				cursor += sizeof(SetStructuredBuffer);
-				SetStructuredBuffer* command = (SetStructuredBuffer*)data;
+	SortRenderItems(items, item_count, renderer->frame_arena);
 
-				if(command->vertex_shader)
-					renderer->context->VSSetShaderResources(command->slot, 1, &command->structured->view);
-				else
-					renderer->context->PSSetShaderResources(command->slot, 1, &command->structured->view);
-			} break;
+	u32 pass = RENDER_STATS_IMMEDIATE;
+	for(u32 i=0; i<item_count; i++) {
+		RenderItem* item = items + i;
 
-			case RENDER_COMMAND_SetTextureBuffer: {
-				cursor += sizeof(SetTextureBuffer);
-				SetTextureBuffer* command = (SetTextureBuffer*)data;
+		u32 item_pass = (u32)(item->key >> 60);
+		if(item_pass != pass) {
+			pass = item_pass;
+			BeginRenderPass* begin_pass = PushRenderCommand(renderer, BeginRenderPass);
+			begin_pass->pass = pass;
+		}
+		stats->passes[pass].items++;
 
-				if(command->texture)
-					renderer->context->PSSetShaderResources(command->slot, 1, &command->texture->view);
-				else {
-					ID3D11ShaderResourceView* srv[1] = { 0 };
-					renderer->context->PSSetShaderResources(command->slot, 1, srv);
-				}
-			} break;
+		CopyMem(PushCommandBuffer(renderer, item->size), item->commands, item->size);
+	}
 
-			case RENDER_COMMAND_SetConstantsBuffer: {
-				cursor += sizeof(SetConstantsBuffer);
-				SetConstantsBuffer* command = (SetConstantsBuffer*)data;
+	stats->merge_cycles = __rdtsc() - start;
+}
 
-				if(command->vertex_shader)
-					renderer->context->VSSetConstantBuffers(command->slot, 1, &command->constants->buffer);
-				else
-					renderer->context->PSSetConstantBuffers(command->slot, 1, &command->constants->buffer);
-			} break;
+static void
+InitUploadRing(UploadRing* ring, u32 size) {
+	Assert(size % UPLOAD_RING_ALIGNMENT == 0);
+	ZeroStruct(*ring);
+	ring->size = size;
+	ring->fence = 1;
+}
 
-			case RENDER_COMMAND_PushRenderBufferData: {
-				cursor += sizeof(PushRenderBufferData);
-				PushRenderBufferData* command = (PushRenderBufferData*)data;
+// Returns the offset of size free bytes, or UPLOAD_RING_FULL when frames in flight still hold them.
+// A range that would run past the end starts over at zero, the bytes skipped go with it.
+static u32
+AllocateUploadRing(UploadRing* ring, u32 size) {
+	Assert(size && size <= ring->size);
+	Assert(size % UPLOAD_RING_ALIGNMENT == 0);
 
-				PushRenderData((ID3D11Buffer*)command->buffer, command->data, command->size, renderer->context);
-			} break;
+	u64 offset = ring->head % ring->size;
+	u64 padding = offset + size > ring->size ? ring->size - offset : 0;
+	u64 end = ring->head + padding + size;
+	if(end - ring->tail > ring->size) return UPLOAD_RING_FULL;
 
-			case RENDER_COMMAND_FreeRenderResource: {
-				cursor += sizeof(FreeRenderResource);
-				FreeRenderResource* command = (FreeRenderResource*)data;
+	ring->head = end;
+	return (u32)((end - size) % ring->size);
+}
 
-				ID3D11Resource* resource = (ID3D11Resource*)command->buffer;
-				resource->Release();
-			} break;
+// Everything allocated so far belongs to the returned fence
+static u64
+EndUploadRingFrame(UploadRing* ring) {
+	Assert(ring->frame_count < UPLOAD_RING_MAX_FRAMES);
+	UploadRingFrame* frame = ring->frames + (ring->first_frame + ring->frame_count++) % UPLOAD_RING_MAX_FRAMES;
+	frame->end = ring->head;
+	frame->fence = ring->fence++;
+	return frame->fence;
+}
 
-			case RENDER_COMMAND_DrawVertices: {
-				cursor += sizeof(DrawVertices);
-				DrawVertices* command = (DrawVertices*)data;
+static void
+RetireUploadRing(UploadRing* ring, u64 completed_fence) {
+	while(ring->frame_count && ring->frames[ring->first_frame].fence <= completed_fence) {
+		ring->tail = ring->frames[ring->first_frame].end;
+		ring->first_frame = (ring->first_frame + 1) % UPLOAD_RING_MAX_FRAMES;
+		ring->frame_count--;
+	}
+}
 
-				renderer->context->Draw(command->vertices_count, command->offset);
-			} break;
+static void
+WaitOldestUploadRingFrame(Renderer* renderer) {
+	UploadRing* ring = &renderer->upload_ring;
+	u64 fence = ring->frames[ring->first_frame].fence;
+	WaitBackendFence(renderer, fence);
+	RetireUploadRing(ring, fence);
+	renderer->queue_stats.upload_waits++;
+}
 
-			case RENDER_COMMAND_DrawIndexed: {
-				cursor += sizeof(DrawIndexed);
-				DrawIndexed* command = (DrawIndexed*)data;
+static u32
+AllocateRenderConstants(Renderer* renderer, u32 size) {
+	UploadRing* ring = &renderer->upload_ring;
+	u32 result = AllocateUploadRing(ring, size);
+	while(result == UPLOAD_RING_FULL) {
+		// The current frame alone doesn't fit
+		Assert(ring->frame_count);
+		WaitOldestUploadRingFrame(renderer);
+		result = AllocateUploadRing(ring, size);
+	}
 
-				renderer->context->DrawIndexed(command->indices_count, command->offset, 0);
-			} break;
+	renderer->queue_stats.upload_bytes += size;
+	return result;
+}
 
-			case RENDER_COMMAND_DrawInstanced: {
-				cursor += sizeof(DrawInstanced);
-				DrawInstanced* command = (DrawInstanced*)data;
+#define MAX_CACHED_SLOTS 4
+#define RENDER_STATE_UNKNOWN_TYPE 0xff
+#define RENDER_STATE_UNKNOWN ((void*)~(uintptr_t)0)
+
+// Last thing bound to the context, starts out unknown since the context keeps the previous frame's state
+struct RenderStateCache {
+	void* render_target;
+	u8 blend;
+	u8 depth_stencil;
+	u8 rasterizer;
+	u8 topology;
+	u8 samplers[MAX_CACHED_SLOTS];
+
+	void* vs;
+	void* ps;
+
+	void* vertex_buffers[MAX_CACHED_SLOTS];
+	u32 vertex_strides[MAX_CACHED_SLOTS];
+	u32 vertex_offsets[MAX_CACHED_SLOTS];
+	void* index_buffer;
+	u32 index_offset;
+
+	void* vs_resources[MAX_CACHED_SLOTS];
+	void* ps_resources[MAX_CACHED_SLOTS];
+	void* vs_constants[MAX_CACHED_SLOTS];
+	void* ps_constants[MAX_CACHED_SLOTS];
+	u32 vs_constant_offsets[MAX_CACHED_SLOTS];
+	u32 ps_constant_offsets[MAX_CACHED_SLOTS];
+
+	RenderPassStats* stats;		// of the pass being decoded
+};
 
-				renderer->context->DrawInstanced(command->vertices_count, command->instance_count, command->offset, 0);
-			} break;
-		}
+// Binding a render target unbinds any view of it from the shader stages behind our back
+static void
+InvalidateShaderResourceCache(RenderStateCache* cache) {
+	for(u32 i=0; i<MAX_CACHED_SLOTS; i++) {
+		cache->vs_resources[i] = RENDER_STATE_UNKNOWN;
+		cache->ps_resources[i] = RENDER_STATE_UNKNOWN;
 	}
 }
 
-static ReadableRenderTarget
-CreateReadableRenderTarget(Renderer* renderer) {
-	HRESULT hr = {};
-	ReadableRenderTarget result = {};
-	ID3D11Texture2D* texture = NULL;
-	ID3D11RenderTargetView*	render_target = NULL;
-	ID3D11ShaderResourceView* shader_resource = NULL;
-
-	DXGI_FORMAT format = DXGI_FORMAT_R8G8B8A8_UNORM;
-
-	D3D11_TEXTURE2D_DESC buffer_desc = {};
-	buffer_desc.ArraySize = 1;
-	buffer_desc.BindFlags = D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE;
-	buffer_desc.CPUAccessFlags = 0;
-	buffer_desc.Format = format;
-	buffer_desc.Width = renderer->window_dim.width;
-	buffer_desc.Height = renderer->window_dim.height;
-	buffer_desc.MipLevels = 1;
-	buffer_desc.MiscFlags = 0;
-	buffer_desc.SampleDesc.Count = renderer->msaa_sample_count;
-	buffer_desc.SampleDesc.Quality = renderer->msaa_quality_level;
-	buffer_desc.Usage = D3D11_USAGE_DEFAULT;
-	hr = renderer->device->CreateTexture2D(&buffer_desc, 0, &texture);
-
-	D3D11_RENDER_TARGET_VIEW_DESC render_target_view_desc;
-	render_target_view_desc.Format = format;
-	render_target_view_desc.ViewDimension = D3D11_RTV_DIMENSION_TEXTURE2D;
-	render_target_view_desc.Texture2D.MipSlice = 0;
-	hr = renderer->device->CreateRenderTargetView(texture, 0, &render_target);
-
-	AssertHR(hr);
-
-	D3D11_SHADER_RESOURCE_VIEW_DESC shader_resource_view_desc;
-	shader_resource_view_desc.Format = format;
-	shader_resource_view_desc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
-	shader_resource_view_desc.Texture2D.MostDetailedMip = 0;
-	shader_resource_view_desc.Texture2D.MipLevels = 1;
-	hr = renderer->device->CreateShaderResourceView(texture, &shader_resource_view_desc, &shader_resource);
-
-	AssertHR(hr);
-
-	result.texture = texture;
-	result.render_target = render_target;
-	result.shader_resource = shader_resource;
-
-	return result;
+static void
+InvalidateRenderStateCache(RenderStateCache* cache) {
+	cache->render_target = RENDER_STATE_UNKNOWN;
+	cache->blend = RENDER_STATE_UNKNOWN_TYPE;
+	cache->depth_stencil = RENDER_STATE_UNKNOWN_TYPE;
+	cache->rasterizer = RENDER_STATE_UNKNOWN_TYPE;
+	cache->topology = RENDER_STATE_UNKNOWN_TYPE;
+	cache->vs = RENDER_STATE_UNKNOWN;
+	cache->ps = RENDER_STATE_UNKNOWN;
+	cache->index_buffer = RENDER_STATE_UNKNOWN;
+
+	for(u32 i=0; i<MAX_CACHED_SLOTS; i++) {
+		cache->samplers[i] = RENDER_STATE_UNKNOWN_TYPE;
+		cache->vertex_buffers[i] = RENDER_STATE_UNKNOWN;
+		cache->vs_constants[i] = RENDER_STATE_UNKNOWN;
+		cache->ps_constants[i] = RENDER_STATE_UNKNOWN;
+	}
+	InvalidateShaderResourceCache(cache);
 }
 
-static void
-RendererBeginFrame(Renderer* renderer, WindowDimensions wd, MemoryArena* frame_arena) {
-	renderer->frame_arena = frame_arena;
-	renderer->command_buffer_cursor = 
-		renderer->command_buffer_base = (u8*)PushSize(renderer->frame_arena, renderer->command_buffer_size);
+// Every command type has a filter that keeps the cache and stats and returns whether the
+// command still has to reach the backend. BeginRenderPass never does.
+typedef bool RenderCommandFilter(RenderStateCache* cache, void* data, Renderer* renderer);
 
-	if(renderer->window_dim.width != wd.width ||
-	   renderer->window_dim.height != wd.height) {
+static bool
+SubmitRenderCommand(RenderStateCache* cache, void* data, Renderer* renderer) {
+	return true;
+}
 
-		renderer->window_dim = wd;
+static bool
+CountDrawVertices(RenderStateCache* cache, void* data, Renderer* renderer) {
+	cache->stats->draws++;
+	cache->stats->vertices += ((DrawVertices*)data)->vertices_count;
+	return true;
+}
 
-		renderer->backbuffer.texture->Release();
-		renderer->backbuffer.view->Release();
-		renderer->depth_stencil.texture->Release();
-		renderer->depth_stencil.view->Release();
-
-		renderer->swapchain->ResizeBuffers(0, wd.width, wd.height, DXGI_FORMAT_R8G8B8A8_UNORM, 0);
-
-		ID3D11Texture2D* backbuffer;
-		ID3D11RenderTargetView* rtv;
-		renderer->swapchain->GetBuffer(0, IID_PPV_ARGS(&backbuffer));
-		renderer->device->CreateRenderTargetView((ID3D11Resource*)backbuffer, NULL, &rtv);
-
-		D3D11_TEXTURE2D_DESC depth_desc = {};
-		depth_desc.Width = wd.width;
-		depth_desc.Height = wd.height;
-		depth_desc.MipLevels = 1;
-		depth_desc.ArraySize = 1;
-		depth_desc.Format = DXGI_FORMAT_D32_FLOAT; // or use DXGI_FORMAT_D32_FLOAT_S8X24_UINT if you need stencil
-		depth_desc.SampleDesc = { 1, 0 };
-		depth_desc.Usage = D3D11_USAGE_DEFAULT;
-		depth_desc.BindFlags = D3D11_BIND_DEPTH_STENCIL;
-
-		// create new depth stencil texture & DepthStencil view
-		ID3D11Texture2D* depth;
-		ID3D11DepthStencilView* dsv;
-		renderer->device->CreateTexture2D(&depth_desc, NULL, &depth);
-		renderer->device->CreateDepthStencilView((ID3D11Resource*)depth, NULL, &dsv);
-
-		renderer->backbuffer.texture = backbuffer;
-		renderer->backbuffer.view = rtv;
-		renderer->depth_stencil.texture = depth;
-		renderer->depth_stencil.view = dsv;
-
-		renderer->readable_render_target.texture->Release();
-		renderer->readable_render_target.render_target->Release();
-		renderer->readable_render_target.shader_resource->Release();
-
-		renderer->readable_render_target = CreateReadableRenderTarget(renderer);
-	}
+static bool
+CountDrawIndexed(RenderStateCache* cache, void* data, Renderer* renderer) {
+	cache->stats->draws++;
+	cache->stats->vertices += ((DrawIndexed*)data)->indices_count;
+	return true;
+}
 
-	SetTextureBuffer* stb = PushRenderCommand(renderer, SetTextureBuffer);
-	stb->texture = 0;
-	stb->slot = 0;
+static bool
+CountDrawInstanced(RenderStateCache* cache, void* data, Renderer* renderer) {
+	DrawInstanced* command = (DrawInstanced*)data;
+	cache->stats->draws++;
+	cache->stats->vertices += (u64)command->vertices_count*command->instance_count;
+	return true;
+}
 
-	SetRenderTarget* set_render_target = PushRenderCommand(renderer, SetRenderTarget);
-	set_render_target->render_target = 0;
+static bool
+CountDrawIndexedInstanced(RenderStateCache* cache, void* data, Renderer* renderer) {
+	DrawIndexedInstanced* command = (DrawIndexedInstanced*)data;
+	cache->stats->draws++;
+	cache->stats->vertices += (u64)command->indices_count*command->instance_count;
+	return true;
+}
 
-	ClearRenderTarget* clear_render_target = PushRenderCommand(renderer, ClearRenderTarget);
-	clear_render_target->render_target = &renderer->backbuffer;
-	*(Vec4*)clear_render_target->color = { 0.1f, 0.1f, 0.1f, 1.0f };
+static bool
+CountPushRenderBufferData(RenderStateCache* cache, void* data, Renderer* renderer) {
+	cache->stats->buffer_bytes += ((PushRenderBufferData*)data)->size;
+	return true;
+}
 
-	ClearRenderTarget* clear_render_target1 = PushRenderCommand(renderer, ClearRenderTarget);
-	clear_render_target1->render_target = 0;
-	*(Vec4*)clear_render_target1->color = { 0.1f, 0.1f, 0.1f, 1.0f };
+static bool
+FilterBeginRenderPass(RenderStateCache* cache, void* data, Renderer* renderer) {
+	u32 pass = ((BeginRenderPass*)data)->pass;
+	Assert(pass < RENDER_PASS_TOTAL);
+	cache->stats = renderer->queue_stats.passes + pass;
+	return false;
+}
 
-	ClearDepth* clear_depth = PushRenderCommand(renderer, ClearDepth);
-	clear_depth->value = 1.0f;
+static bool
+FilterStateChange(bool unchanged, RenderStateCache* cache) {
+	cache->stats->state_commands++;
+	if(unchanged) return false;
+	cache->stats->state_changes++;
+	return true;
+}
 
-	SetDepthStencilState* set_depth_stencil_state = PushRenderCommand(renderer, SetDepthStencilState);
-	set_depth_stencil_state->type = 0;
+static bool
+FilterSetRenderTarget(RenderStateCache* cache, void* data, Renderer* renderer) {
+	SetRenderTarget* command = (SetRenderTarget*)data;
+	void* view = command->render_target ? (void*)command->render_target->view :
+		(void*)renderer->readable_render_target.render_target;
+
+	if(!FilterStateChange(cache->render_target == view, cache)) return false;
+	cache->render_target = view;
+	InvalidateShaderResourceCache(cache);
+	return true;
+}
 
-	SetBlendState* set_blend_state = PushRenderCommand(renderer, SetBlendState);
-	set_blend_state->type = BLEND_STATE_Regular;
+static bool
+FilterSetDepthStencilState(RenderStateCache* cache, void* data, Renderer* renderer) {
+	SetDepthStencilState* command = (SetDepthStencilState*)data;
 
-	SetRasterizerState* set_rasterizer_state = PushRenderCommand(renderer, SetRasterizerState);
-	set_rasterizer_state->type = RASTERIZER_STATE_Default;
+	if(!FilterStateChange(cache->depth_stencil == command->type, cache)) return false;
+	cache->depth_stencil = command->type;
+	return true;
+}
 
-	SetSamplerState* set_sampler_state = PushRenderCommand(renderer, SetSamplerState);
-	set_sampler_state->type = SAMPLER_STATE_Default;
-	set_sampler_state->slot = 0;
+static bool
+FilterSetBlendState(RenderStateCache* cache, void* data, Renderer* renderer) {
+	SetBlendState* command = (SetBlendState*)data;
+	Assert(command->type < BLEND_STATE_TOTAL);
 
-	SetViewport* set_viewport = PushRenderCommand(renderer, SetViewport);
-	set_viewport->topleft = V2Z();
-	set_viewport->dim = V2((float)wd.width, (float)wd.height);
+	if(!FilterStateChange(cache->blend == command->type, cache)) return false;
+	cache->blend = command->type;
+	return true;
+}
 
-	SetPrimitiveTopology* set_topology = PushRenderCommand(renderer, SetPrimitiveTopology);
-	set_topology->type = PRIMITIVE_TOPOLOGY_TriangleList;
+static bool
+FilterSetRasterizerState(RenderStateCache* cache, void* data, Renderer* renderer) {
+	SetRasterizerState* command = (SetRasterizerState*)data;
+	Assert(command->type < RASTERIZER_STATE_TOTAL);
 
+	if(!FilterStateChange(cache->rasterizer == command->type, cache)) return false;
+	cache->rasterizer = command->type;
+	return true;
 }
 
-static void
-RendererEndFrame(Renderer* renderer) {
-	ExecuteRenderCommands(renderer);
-	renderer->swapchain->Present(0, 0);
+static bool
+FilterSetSamplerState(RenderStateCache* cache, void* data, Renderer* renderer) {
+	SetSamplerState* command = (SetSamplerState*)data;
+	Assert(command->slot < MAX_CACHED_SLOTS);
+	Assert(command->type < SAMPLER_STATE_TOTAL);
+
+	if(!FilterStateChange(cache->samplers[command->slot] == command->type, cache)) return false;
+	cache->samplers[command->slot] = command->type;
+	return true;
 }
 
-static void 
-MakeD3DInputElementDesc(VERTEX_BUFFER* vb_type, D3D11_INPUT_ELEMENT_DESC* d3d_il_desc, u8 count) {
-	for (u32 i = 0; i < count; i++) {
-		DXGI_FORMAT format;
-		if (vb_type[i] == VERTEX_BUFFER_POSITION) format = DXGI_FORMAT_R32G32B32_FLOAT;
-		else if (vb_type[i] == VERTEX_BUFFER_NORMAL) format = DXGI_FORMAT_R32G32B32_FLOAT;
-		else if (vb_type[i] == VERTEX_BUFFER_COLOR) format = DXGI_FORMAT_R32G32B32_FLOAT;
-		//else if (vb_type[i] == VERTEX_BUFFER_TANGENT) format = DXGI_FORMAT_R32G32B32_FLOAT;
-		else if (vb_type[i] == VERTEX_BUFFER_TEXCOORD) format = DXGI_FORMAT_R32G32_FLOAT;
-		else Assert(false);
+static bool
+FilterSetPrimitiveTopology(RenderStateCache* cache, void* data, Renderer* renderer) {
+	SetPrimitiveTopology* command = (SetPrimitiveTopology*)data;
 
-		d3d_il_desc[i] = { vertex_buffer_names[vb_type[i]], 0, format, i, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 };
-	}	
+	if(!FilterStateChange(cache->topology == command->type, cache)) return false;
+	cache->topology = command->type;
+	return true;
 }
 
-static ConstantsBuffer* 
-UploadConstantsBuffer(u32 size, Renderer* renderer) {
-	HRESULT hr = {};
-	ConstantsBuffer* cb = PushStruct(renderer->permanent_arena, ConstantsBuffer);
-	ID3D11Buffer* buffer = 0;
+static bool
+FilterSetVertexShader(RenderStateCache* cache, void* data, Renderer* renderer) {
+	SetVertexShader* command = (SetVertexShader*)data;
 
-	size += (16 - (size % 16));
-	D3D11_BUFFER_DESC cb_desc = {};
-	cb_desc.ByteWidth 		 = size;
-	cb_desc.Usage          = D3D11_USAGE_DYNAMIC;
-	cb_desc.BindFlags      = D3D11_BIND_CONSTANT_BUFFER;
-	cb_desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
-	hr = renderer->device->CreateBuffer(&cb_desc, nullptr, &buffer);
+	if(!FilterStateChange(cache->vs == command->vertex, cache)) return false;
+	cache->vs = command->vertex;
+	return true;
+}
 
-	AssertHR(hr);
+static bool
+FilterSetPixelShader(RenderStateCache* cache, void* data, Renderer* renderer) {
+	SetPixelShader* command = (SetPixelShader*)data;
 
-	cb->buffer = buffer;
-	return cb;
+	if(!FilterStateChange(cache->ps == command->pixel, cache)) return false;
+	cache->ps = command->pixel;
+	return true;
 }
 
-static StructuredBuffer* 
-UploadStructuredBuffer(u32 struct_size, u32 count, Renderer* renderer) {
-	HRESULT hr = {};
-	StructuredBuffer* sb = PushStruct(renderer->permanent_arena, StructuredBuffer);
-
-	ID3D11Buffer* buffer = 0;
-	ID3D11ShaderResourceView* view = 0;
+static bool
+FilterSetVertexBuffer(RenderStateCache* cache, void* data, Renderer* renderer) {
+	SetVertexBuffer* command = (SetVertexBuffer*)data;
+	Assert(command->slot < MAX_CACHED_SLOTS);
+
+	bool unchanged = cache->vertex_buffers[command->slot] == command->vertex->buffer &&
+		cache->vertex_strides[command->slot] == command->stride &&
+		cache->vertex_offsets[command->slot] == command->offset;
+	if(!FilterStateChange(unchanged, cache)) return false;
+	cache->vertex_buffers[command->slot] = command->vertex->buffer;
+	cache->vertex_strides[command->slot] = command->stride;
+	cache->vertex_offsets[command->slot] = command->offset;
+	return true;
+}
 
-	D3D11_BUFFER_DESC buffer_desc = {};
-	buffer_desc.ByteWidth = struct_size * count;
-	buffer_desc.Usage = D3D11_USAGE_DYNAMIC;
-	buffer_desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
-	buffer_desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
-	buffer_desc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
-	buffer_desc.StructureByteStride = struct_size;
+static bool
+FilterSetIndexBuffer(RenderStateCache* cache, void* data, Renderer* renderer) {
+	SetIndexBuffer* command = (SetIndexBuffer*)data;
 
-	hr = renderer->device->CreateBuffer(&buffer_desc, NULL, &buffer);
-	AssertHR(hr);
+	bool unchanged = cache->index_buffer == command->index->buffer && cache->index_offset == command->offset;
+	if(!FilterStateChange(unchanged, cache)) return false;
+	cache->index_buffer = command->index->buffer;
+	cache->index_offset = command->offset;
+	return true;
+}
 
-	D3D11_SHADER_RESOURCE_VIEW_DESC view_desc = {};
-	view_desc.Format = DXGI_FORMAT_UNKNOWN;
-	view_desc.ViewDimension = D3D11_SRV_DIMENSION_BUFFER;
-	view_desc.Buffer.ElementOffset = 0;
-	view_desc.Buffer.ElementWidth = count;
+static bool
+FilterSetStructuredBuffer(RenderStateCache* cache, void* data, Renderer* renderer) {
+	SetStructuredBuffer* command = (SetStructuredBuffer*)data;
+	Assert(command->slot < MAX_CACHED_SLOTS);
 
-	hr = renderer->device->CreateShaderResourceView(buffer, &view_desc, &view);
-	AssertHR(hr);
+	void** cached = command->vertex_shader ? cache->vs_resources : cache->ps_resources;
+	if(!FilterStateChange(cached[command->slot] == command->structured->view, cache)) return false;
+	cached[command->slot] = command->structured->view;
+	return true;
+}
 
-	sb->buffer = buffer;
-	sb->view = view; 
+static bool
+FilterSetTextureBuffer(RenderStateCache* cache, void* data, Renderer* renderer) {
+	SetTextureBuffer* command = (SetTextureBuffer*)data;
+	Assert(command->slot < MAX_CACHED_SLOTS);
 
-	return sb;
-};
+	void* view = command->texture ? command->texture->view : 0;
+	if(!FilterStateChange(cache->ps_resources[command->slot] == view, cache)) return false;
+	cache->ps_resources[command->slot] = view;
+	return true;
+}
 
 static bool
-CompileShader(char* shader_code, u32 shader_length, char* entry, void** shader, ID3DBlob** blob,
-		bool vertex_shader, Renderer* renderer) {
-	HRESULT hr;
-	ID3DBlob* error;
-
-	if(vertex_shader)
-		hr = D3DCompile(shader_code, shader_length, nullptr, nullptr, nullptr, entry, "vs_5_0",
-				0, 0, blob, &error);
-	else
-		hr = D3DCompile(shader_code, shader_length, nullptr, nullptr, nullptr, entry, "ps_5_0",
-				0, 0, blob, &error);
+FilterSetConstantsBuffer(RenderStateCache* cache, void* data, Renderer* renderer) {
+	SetConstantsBuffer* command = (SetConstantsBuffer*)data;
+	Assert(command->slot < MAX_CACHED_SLOTS);
+
+	ConstantsBuffer* constants = command->constants;
+	Assert(constants->fence == renderer->upload_ring.fence);
+
+	void** cached = command->vertex_shader ? cache->vs_constants : cache->ps_constants;
+	u32* cached_offsets = command->vertex_shader ? cache->vs_constant_offsets : cache->ps_constant_offsets;
+	bool unchanged = cached[command->slot] == constants && cached_offsets[command->slot] == constants->offset;
+	if(!FilterStateChange(unchanged, cache)) return false;
+	cached[command->slot] = constants;
+	cached_offsets[command->slot] = constants->offset;
+	return true;
+}
 
-	if (hr) {
-		char* msg = (char*)error->GetBufferPointer();
-		OutputDebugStringA(msg);
-		return false;
-	}
+// Binds made before the push keep the old range
+static bool
+FilterPushRenderConstants(RenderStateCache* cache, void* data, Renderer* renderer) {
+	PushRenderConstants* command = (PushRenderConstants*)data;
+	ConstantsBuffer* constants = command->constants;
+	Assert(command->size <= constants->size);
 
-	if(vertex_shader) 
-		hr = renderer->device->CreateVertexShader(blob[0]->GetBufferPointer(), blob[0]->GetBufferSize(), 
-				nullptr, (ID3D11VertexShader**)shader);
-	else 
-		hr = renderer->device->CreatePixelShader(blob[0]->GetBufferPointer(), blob[0]->GetBufferSize(), 
-				nullptr, (ID3D11PixelShader**)shader);
+	constants->offset = AllocateRenderConstants(renderer, constants->size);
+	constants->fence = renderer->upload_ring.fence;
+	return true;
+}
 
-	if(hr) return false;
-	
+static bool
+FilterFreeRenderResource(RenderStateCache* cache, void* data, Renderer* renderer) {
+	// The address can come back as a new resource
+	InvalidateRenderStateCache(cache);
+	renderer->queue_stats.resources_freed++;
+	if(renderer->capture) ForgetRenderCaptureResource(renderer, ((FreeRenderResource*)data)->buffer);
 	return true;
+}
+
+// In RENDER_COMMAND order, SetTopology is never pushed
+static RenderCommandFilter* render_command_filters[RENDER_COMMAND_TOTAL] = {
+	SubmitRenderCommand, SubmitRenderCommand, SubmitRenderCommand,
+	FilterSetRenderTarget, FilterSetBlendState, FilterSetDepthStencilState, FilterSetRasterizerState,
+	FilterSetPrimitiveTopology, FilterSetSamplerState, SubmitRenderCommand, 0,
+	FilterSetVertexShader, FilterSetPixelShader,
+	FilterSetVertexBuffer, FilterSetIndexBuffer, FilterSetStructuredBuffer, FilterSetConstantsBuffer, FilterSetTextureBuffer,
+	CountDrawVertices, CountDrawIndexed, CountDrawInstanced, CountDrawIndexedInstanced,
+	CountPushRenderBufferData, FilterPushRenderConstants, SubmitRenderCommand, FilterFreeRenderResource,
+	FilterBeginRenderPass,
 };
 
-static PixelShader* 
-UploadPixelShader(char* code, u32 length, char* entry, Renderer* renderer) {
-	PixelShader* ps = PushStruct(renderer->permanent_arena, PixelShader);
-	ID3D11PixelShader* shader;
-	ID3DBlob* blob;
+// Decodes the stream, drops state the backend already has and hands everything else to
+// ExecuteBackendCommand, which every backend implements for the whole RENDER_COMMAND set
+static void
+ExecuteRenderCommands(Renderer* renderer) {
+	u64 execute_start = __rdtsc();
+	RenderStateCache cache;
+	InvalidateRenderStateCache(&cache);
+	cache.stats = renderer->queue_stats.passes + RENDER_STATS_IMMEDIATE;
+
+	UploadRing* ring = &renderer->upload_ring;
+	RetireUploadRing(ring, GetBackendCompletedFence(renderer));
+	if(ring->frame_count == UPLOAD_RING_MAX_FRAMES) WaitOldestUploadRingFrame(renderer);
+
+	RenderCommandStream* stream = &renderer->commands;
+	for(RenderCommandBlock* block = stream->first; stream->current; block = block->next) {
+		u8* cursor = block->base;
+		u8* end = block->base + block->used;
+		while(cursor < end) {
+			RenderCommandHeader* header = (RenderCommandHeader*)cursor;
+			void* data = header + 1;
+			Assert(header->type < RENDER_COMMAND_TOTAL && render_command_filters[header->type]);
+			Assert(header->size && cursor + header->size <= end);
+			cursor += header->size;
+			cache.stats->commands[header->type]++;
+
+			if(!render_command_filters[header->type](&cache, data, renderer)) continue;
+			cache.stats->submitted++;
+			if(renderer->command_timings) {
+				u64 start = __rdtsc();
+				ExecuteBackendCommand((RENDER_COMMAND)header->type, data, renderer);
+				renderer->command_timings->cycles[header->type] += __rdtsc() - start;
+				renderer->command_timings->counts[header->type]++;
+			}
+			else ExecuteBackendCommand((RENDER_COMMAND)header->type, data, renderer);
+		}
 
-	Assert(CompileShader(code, length, entry, (void**)&shader, &blob, false, renderer));
+		if(block == stream->current) break;
+	}
 
-	ps->shader = shader;
-	return ps;
+	SignalBackendFence(renderer, EndUploadRingFrame(ring));
+	renderer->queue_stats.execute_cycles += __rdtsc() - execute_start;
 }
 
-static VertexShader* 
-UploadVertexShader(char* code, u32 length, char* entry, VERTEX_BUFFER* vertex_buffers, u8 count, Renderer* renderer) {
-	HRESULT hr = {};
+static void
+PresentRenderer(Renderer* renderer) {
+	u64 start = __rdtsc();
+	PresentBackend(renderer);
+	renderer->queue_stats.present_cycles += __rdtsc() - start;
+}
 
-	VertexShader* vs = PushStruct(renderer->permanent_arena, VertexShader);
-	ID3D11VertexShader* shader = 0;
-	ID3D11InputLayout* il = 0;
-	ID3DBlob* blob = 0;
+// Sums up the passes and makes the frame's stats the ones GetRenderStats returns
+static void
+EndRenderStatsFrame(Renderer* renderer) {
+	RenderQueueStats* stats = &renderer->queue_stats;
+	for(u32 i=0; i<RENDER_STATS_PASSES; i++) {
+		RenderPassStats* pass = stats->passes + i;
+		for(u32 type=0; type<RENDER_COMMAND_TOTAL; type++) stats->commands += pass->commands[type];
+		stats->items += pass->items;
+		stats->draws += pass->draws;
+		stats->vertices += pass->vertices;
+		stats->state_commands += pass->state_commands;
+		stats->state_changes += pass->state_changes;
+		stats->buffer_bytes += pass->buffer_bytes;
+	}
 
-	Assert(CompileShader(code, length, entry, (void**)&shader, &blob, true, renderer));
+	renderer->queue_stats_last_frame = *stats;
+	ZeroStruct(*stats);
+}
 
-	if(vertex_buffers) {
-		D3D11_INPUT_ELEMENT_DESC* ie_desc = PushArray(renderer->frame_arena, D3D11_INPUT_ELEMENT_DESC, count);
-		MakeD3DInputElementDesc(vertex_buffers, ie_desc, count);
+static char* render_stats_pass_names[RENDER_STATS_PASSES] = { "World", "PostProcess", "UI", "Immediate" };
+static char* render_stats_list_names[RENDER_LIST_TOTAL] = { "Quads", "Meshes", "Debug", "PostProcess", "UI" };
 
-		hr = renderer->device->CreateInputLayout(ie_desc, count, blob->GetBufferPointer(), blob->GetBufferSize(), &il);
-		AssertHR(hr);
-	}
+// Counters of the last frame that went through RendererEndFrame
+static RenderQueueStats*
+GetRenderStats(Renderer* renderer) {
+	return &renderer->queue_stats_last_frame;
+}
 
-	vs->shader = shader;
-	vs->il = il;
+// Preallocates the offscreen targets, so the window can grow up to dim without remaking them
+static void
+ReserveRenderTargets(Renderer* renderer, WindowDimensions dim) {
+	if(dim.width <= renderer->target_dim.width && dim.height <= renderer->target_dim.height) return;
+	renderer->target_dim.width = Max(renderer->target_dim.width, dim.width);
+	renderer->target_dim.height = Max(renderer->target_dim.height, dim.height);
+	ResizeBackendTargets(renderer, true);
+}
 
-	return vs;
+// Feeds the controller the time of the last frame, the new scale applies from the next RendererBeginFrame
+static void
+UpdateRenderScale(Renderer* renderer, float frame_ms) {
+	DynamicResolution* dynamic = &renderer->dynamic_resolution;
+	if(dynamic->budget_ms <= 0.0f || frame_ms <= 0.0f) return;
+
+	// Cost is taken to go with the pixel count, the square of the scale. Filtering it at full size
+	// keeps the filter from lagging behind the scale changes it causes.
+	float scale = renderer->render_scale;
+	float full_ms = frame_ms/(scale*scale);
+	dynamic->full_ms = dynamic->full_ms ? dynamic->full_ms + (full_ms - dynamic->full_ms)*DYNAMIC_RESOLUTION_SMOOTHING : full_ms;
+
+	float budget = dynamic->budget_ms;
+	float expected_ms = dynamic->full_ms*scale*scale;
+	if(expected_ms <= budget && expected_ms >= budget*DYNAMIC_RESOLUTION_HEADROOM) return;
+
+	// Aims for the middle of the band
+	float target = SquareRoot(budget*(1.0f + DYNAMIC_RESOLUTION_HEADROOM)*0.5f/dynamic->full_ms);
+	float step = Clamp(-DYNAMIC_RESOLUTION_MAX_STEP, target - scale, DYNAMIC_RESOLUTION_MAX_STEP);
+	renderer->render_scale = Clamp(dynamic->min_scale, scale + step, 1.0f);
 }
 
-static TextureBuffer* 
-UploadTexture(void* data, u32 width, u32 height, u8 num_components, bool dynamic, bool temp, Renderer* renderer) {
-	TextureBuffer* texture_buffer = 0;
-	if(!temp) texture_buffer = PushStruct(renderer->permanent_arena, TextureBuffer);
-	else texture_buffer = PushStruct(renderer->frame_arena, TextureBuffer);
+static void
+RendererBeginFrame(Renderer* renderer, WindowDimensions wd, MemoryArena* frame_arena) {
+	renderer->frame_arena = frame_arena;
+	renderer->commands.arena = frame_arena;
+	renderer->commands.first = renderer->commands.current = 0;
+	for(u32 i=0; i<RENDER_LIST_TOTAL; i++) ResetRenderCommandList(renderer->lists + i);
 
-	HRESULT hr = {};
-	ID3D11ShaderResourceView* view;
+	// Offscreen targets only grow, a smaller window or render scale is a smaller viewport into them
+	if(renderer->window_dim.width != wd.width ||
+	   renderer->window_dim.height != wd.height) {
+		renderer->window_dim = wd;
+		bool grow = wd.width > renderer->target_dim.width || wd.height > renderer->target_dim.height;
+		renderer->target_dim.width = Max(renderer->target_dim.width, wd.width);
+		renderer->target_dim.height = Max(renderer->target_dim.height, wd.height);
+		ResizeBackendTargets(renderer, grow);
+	}
+	renderer->render_dim.width = Max((u32)(wd.width*renderer->render_scale + 0.5f), 1);
+	renderer->render_dim.height = Max((u32)(wd.height*renderer->render_scale + 0.5f), 1);
 
-	D3D11_TEXTURE2D_DESC desc = {};
-	desc.Width = width;
-	desc.Height = height;
-	desc.MipLevels = 1;
-	desc.ArraySize = 1;
-	DXGI_FORMAT format;
+	SetTextureBuffer* stb = PushRenderCommand(renderer, SetTextureBuffer);
+	stb->texture = 0;
+	stb->slot = 0;
 
-	if(num_components == 4) format = DXGI_FORMAT_R8G8B8A8_UNORM;
-	else if(num_components == 1) format = DXGI_FORMAT_R8_UNORM;
-	else Assert(false);
+	SetRenderTarget* set_render_target = PushRenderCommand(renderer, SetRenderTarget);
+	set_render_target->render_target = 0;
 
-	D3D11_USAGE usage_flag = D3D11_USAGE_IMMUTABLE; 
-	u32 cpu_access_flags = 0;
-	if(dynamic) {
-		usage_flag = D3D11_USAGE_DYNAMIC; 
-		cpu_access_flags |= D3D11_CPU_ACCESS_WRITE;
-	}
+	ClearRenderTarget* clear_render_target = PushRenderCommand(renderer, ClearRenderTarget);
+	clear_render_target->render_target = &renderer->backbuffer;
+	*(Vec4*)clear_render_target->color = { 0.1f, 0.1f, 0.1f, 1.0f };
 
-	desc.Format = format;
-	desc.SampleDesc.Count = renderer->msaa_sample_count;
-	desc.SampleDesc.Quality = renderer->msaa_quality_level;
-	desc.Usage = usage_flag;
-	desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
-	desc.CPUAccessFlags = cpu_access_flags;
-
-	D3D11_SUBRESOURCE_DATA sr = {};
-	sr.pSysMem = data;
-	sr.SysMemPitch = width * num_components;
-
-	ID3D11Texture2D* buffer;
-	if(data) hr = renderer->device->CreateTexture2D(&desc, &sr, &buffer);
-	else hr = renderer->device->CreateTexture2D(&desc, 0, &buffer);
-
-	// RESEARCH: view examples
-	D3D11_SHADER_RESOURCE_VIEW_DESC view_desc = {};
-	view_desc.Format = desc.Format;
-	view_desc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
-	view_desc.Texture2D.MostDetailedMip = 0;
-	view_desc.Texture2D.MipLevels = (u32)-1;
-	
-	hr = renderer->device->CreateShaderResourceView(buffer, &view_desc, &view);
-	AssertHR(hr);
-
-	texture_buffer->buffer = buffer;
-	texture_buffer->view = view;
-	return texture_buffer;
-}
-
-static IndexBuffer*
-UploadIndexBuffer(void* data, u32 count, Renderer* renderer) {
-	IndexBuffer* index_buffer = PushStruct(renderer->permanent_arena, IndexBuffer);
-
-	ID3D11Buffer* buffer;
-	D3D11_BUFFER_DESC desc = {};
-	desc.ByteWidth = sizeof(u32) * count;
-	desc.Usage = D3D11_USAGE_IMMUTABLE;
-	desc.BindFlags = D3D11_BIND_INDEX_BUFFER;
-	D3D11_SUBRESOURCE_DATA sr = {};
-	sr.pSysMem = data;
-	renderer->device->CreateBuffer(&desc, &sr, &buffer);
-
-	index_buffer->buffer = buffer;
-	return index_buffer;
-}
-
-static VertexBuffer* 
-UploadVertexBuffer(void* initial_data, u32 num_vertices, u8 num_components, bool dynamic, Renderer* renderer) {
-	HRESULT hr;
-	VertexBuffer* vb = PushStruct(renderer->permanent_arena, VertexBuffer);
-
-	ID3D11Buffer* buffer;
-	D3D11_BUFFER_DESC desc = {};
-
-	u32 component_width = sizeof(float);
-
-	D3D11_USAGE usage_flag = D3D11_USAGE_IMMUTABLE; 
-	u32 cpu_access_flags = 0;
-	if(dynamic) {
-		usage_flag = D3D11_USAGE_DYNAMIC; 
-		cpu_access_flags |= D3D11_CPU_ACCESS_WRITE;
-	}
-	
-	desc.ByteWidth = num_components * component_width * num_vertices;
-	desc.Usage = usage_flag;
-	desc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
-	desc.CPUAccessFlags = cpu_access_flags;
-
-	if(initial_data) {
-		D3D11_SUBRESOURCE_DATA sr = {};
-		sr.pSysMem = initial_data;
-		hr = renderer->device->CreateBuffer(&desc, &sr, &buffer);
-	}
-	else hr = renderer->device->CreateBuffer(&desc, 0, &buffer);
-	AssertHR(hr);
+	ClearRenderTarget* clear_render_target1 = PushRenderCommand(renderer, ClearRenderTarget);
+	clear_render_target1->render_target = 0;
+	*(Vec4*)clear_render_target1->color = { 0.1f, 0.1f, 0.1f, 1.0f };
 
-	vb->buffer = buffer;
+	ClearDepth* clear_depth = PushRenderCommand(renderer, ClearDepth);
+	clear_depth->value = 1.0f;
 
-	return vb;
-}
+	SetDepthStencilState* set_depth_stencil_state = PushRenderCommand(renderer, SetDepthStencilState);
+	set_depth_stencil_state->type = 0;
 
-static Renderer*
-InitRenderer(Win32Window* window, MemoryArena* parent_arena, MemoryArena* frame_arena) {
-	Renderer* renderer;
-	renderer = PushStruct(parent_arena, Renderer);
-	renderer->permanent_arena = parent_arena;
-	renderer->frame_arena = frame_arena;
-	renderer->command_buffer_size = Megabytes(2);
-
-	renderer->window_dim = window->dim;
-
-	HRESULT hr = {};
-	u32 msaa_quality_level = 0;
-	u32 msaa_sample_count = 1;
-	{
-		u32 flags = 0;
-		IDXGIFactory4* dxgi_factory;
-		hr = CreateDXGIFactory2(flags, IID_IDXGIFactory4, (void**)&dxgi_factory);
-		AssertHR(hr);
-
-		flags = 0;
-		flags = DXGI_MWA_NO_WINDOW_CHANGES | DXGI_MWA_NO_ALT_ENTER;
-		dxgi_factory->MakeWindowAssociation(window->handle, flags);
-
-		IDXGIAdapter1* adapters[4] = { NULL };
-		u32 adapter_count = 0;
-
-		while ((adapter_count < ArrayCount(adapters) -1) &&
-				(dxgi_factory->EnumAdapters1(adapter_count, &adapters[adapter_count])
-				 != DXGI_ERROR_NOT_FOUND)) adapter_count++;
-
-		u32 adapter_to_use = 0;
-		u64 video_memory_available = 0;
-		for (u32 i = 0; i < adapter_count; i++) {
-			DXGI_ADAPTER_DESC1 desc = { NULL };
-			adapters[i]->GetDesc1(&desc);
-			if (desc.DedicatedVideoMemory > video_memory_available) {
-				video_memory_available = desc.DedicatedVideoMemory;
-				adapter_to_use = i;
-			}
-		}
+	SetBlendState* set_blend_state = PushRenderCommand(renderer, SetBlendState);
+	set_blend_state->type = BLEND_STATE_Regular;
 
-		D3D_FEATURE_LEVEL target_feature_levels[] = {
-			D3D_FEATURE_LEVEL_11_1,
-			D3D_FEATURE_LEVEL_11_1
-		};
-		D3D_FEATURE_LEVEL out_feature_levels = D3D_FEATURE_LEVEL_9_1;
-
-		flags = 0;
-		flags |= D3D11_CREATE_DEVICE_DEBUG;
-		hr = D3D11CreateDevice((IDXGIAdapter*)adapters[adapter_to_use], D3D_DRIVER_TYPE_UNKNOWN, NULL,
-				flags, target_feature_levels, ArrayCount(target_feature_levels), D3D11_SDK_VERSION,
-				&renderer->device, &out_feature_levels, &renderer->context);
-
-		AssertHR(hr);
-		hr = renderer->device->CheckMultisampleQualityLevels(DXGI_FORMAT_R8G8B8A8_UNORM, 
-				msaa_sample_count, &msaa_quality_level);
-		msaa_quality_level--;
-
-		renderer->msaa_sample_count = msaa_sample_count;
-		renderer->msaa_quality_level = msaa_quality_level;
-
-		DXGI_SWAP_CHAIN_DESC1 swapchain_desc;
-		swapchain_desc.Width = 0;
-		swapchain_desc.Height = 0;
-		swapchain_desc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
-		swapchain_desc.Stereo = 0;
-		//TODO:RENDERER Multisampling
-		swapchain_desc.SampleDesc.Count = msaa_sample_count;
-		swapchain_desc.SampleDesc.Quality = msaa_quality_level;
-		swapchain_desc.BufferUsage = DXGI_USAGE_RENDER_TARGET_OUTPUT;
-		//TODO:RENDERER Swapchain buffer counts
-		swapchain_desc.BufferCount = 2;
-		swapchain_desc.Scaling = DXGI_SCALING_STRETCH;
-		swapchain_desc.SwapEffect = DXGI_SWAP_EFFECT_FLIP_DISCARD;
-		swapchain_desc.AlphaMode = DXGI_ALPHA_MODE_UNSPECIFIED;
-		swapchain_desc.Flags = DXGI_SWAP_CHAIN_FLAG_ALLOW_MODE_SWITCH;
-
-		hr = dxgi_factory->CreateSwapChainForHwnd((IUnknown*)renderer->device, window->handle, &swapchain_desc, NULL, NULL, &renderer->swapchain);
-
-		AssertHR(hr);
-		//dxgi_factory->Release();
-
-		hr = renderer->swapchain->QueryInterface(IID_PPV_ARGS(&renderer->swapchain));
-		AssertHR(hr);
-	}
-	{
-		ID3D11Texture2D* rtv_tex;
-		ID3D11RenderTargetView* rtv;
-		hr = renderer->swapchain->GetBuffer(0, IID_PPV_ARGS(&rtv_tex));
-		D3D11_TEXTURE2D_DESC rtv_tex_desc = {}; 
-		rtv_tex->GetDesc(&rtv_tex_desc);
-
-		D3D11_RENDER_TARGET_VIEW_DESC rtv_desc = {};
-		rtv_desc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
-		rtv_desc.ViewDimension = D3D11_RTV_DIMENSION_TEXTURE2D;
-
-		hr = renderer->device->CreateRenderTargetView((ID3D11Resource*)rtv_tex, &rtv_desc, &rtv);
-		AssertHR(hr);
-
-		renderer->readable_render_target = CreateReadableRenderTarget(renderer);
-
-		ID3D11Texture2D* dsv_tex;
-		ID3D11DepthStencilView* dsv;
-		D3D11_TEXTURE2D_DESC dsv_tex_desc;
-		rtv_tex->GetDesc(&dsv_tex_desc);
-		dsv_tex_desc.MipLevels = 1;
-		dsv_tex_desc.ArraySize = 1;
-		dsv_tex_desc.Format = DXGI_FORMAT_D32_FLOAT;
-		dsv_tex_desc.Usage = D3D11_USAGE_DEFAULT;
-		dsv_tex_desc.BindFlags = D3D11_BIND_DEPTH_STENCIL;
-		dsv_tex_desc.SampleDesc.Count = msaa_sample_count;
-		dsv_tex_desc.SampleDesc.Quality = msaa_quality_level;
-
-		hr = renderer->device->CreateTexture2D(&dsv_tex_desc, NULL, &dsv_tex);
-		AssertHR(hr);
-
-		D3D11_DEPTH_STENCIL_VIEW_DESC dsv_desc = {};
-		dsv_desc.Format = DXGI_FORMAT_D32_FLOAT;
-		dsv_desc.ViewDimension = D3D11_DSV_DIMENSION_TEXTURE2D;
-		hr = renderer->device->CreateDepthStencilView((ID3D11Resource*)dsv_tex, &dsv_desc, &dsv);
-		AssertHR(hr);
-
-		renderer->backbuffer.texture = rtv_tex;
-		renderer->backbuffer.view = rtv;
-		renderer->depth_stencil.texture = dsv_tex;
-		renderer->depth_stencil.view = dsv;
-	}
-	{ //(FC) = (SP) (X) (SBF) (+) (DP) (X) (DPF)
-		//(FA) = (SA)(SBF) (+) (DA)(DBF)
-		// No blend
-		// TODO:RENDERER Multiple render targets bind in OM Stage
-		D3D11_BLEND_DESC bs_desc = {};
-		bs_desc.RenderTarget[0].RenderTargetWriteMask = D3D11_COLOR_WRITE_ENABLE_ALL;
-		bs_desc.RenderTarget[0].BlendEnable = false;
-
-		hr = renderer->device->CreateBlendState(&bs_desc, &renderer->blend_states[BLEND_STATE_NoBlend]);
-		AssertHR(hr);
-	}
-	{ // Regular
-		D3D11_BLEND_DESC bs_desc = {};
-		bs_desc.RenderTarget[0].RenderTargetWriteMask = D3D11_COLOR_WRITE_ENABLE_ALL;
-		bs_desc.RenderTarget[0].BlendEnable = true;
-		bs_desc.RenderTarget[0].SrcBlend = D3D11_BLEND_SRC_ALPHA;
-		bs_desc.RenderTarget[0].DestBlend = D3D11_BLEND_INV_SRC_ALPHA;
-		bs_desc.RenderTarget[0].BlendOp = D3D11_BLEND_OP_ADD;
-		bs_desc.RenderTarget[0].SrcBlendAlpha = D3D11_BLEND_ONE;
-		bs_desc.RenderTarget[0].DestBlendAlpha = D3D11_BLEND_ONE;
-		bs_desc.RenderTarget[0].BlendOpAlpha = D3D11_BLEND_OP_ADD;
-
-		hr = renderer->device->CreateBlendState(&bs_desc, &renderer->blend_states[BLEND_STATE_Regular]);
-		AssertHR(hr);
-	}
-	{ // Premultiplied Alpha
-		D3D11_BLEND_DESC bs_desc = {};
-		bs_desc.RenderTarget[0].RenderTargetWriteMask = D3D11_COLOR_WRITE_ENABLE_ALL;
-		bs_desc.RenderTarget[0].BlendEnable = true;
-		bs_desc.RenderTarget[0].SrcBlend = D3D11_BLEND_ONE;
-		bs_desc.RenderTarget[0].DestBlend = D3D11_BLEND_INV_SRC_ALPHA;
-		bs_desc.RenderTarget[0].BlendOp = D3D11_BLEND_OP_ADD;
-		bs_desc.RenderTarget[0].SrcBlendAlpha = D3D11_BLEND_ONE;
-		bs_desc.RenderTarget[0].DestBlendAlpha = D3D11_BLEND_ONE;
-		bs_desc.RenderTarget[0].BlendOpAlpha = D3D11_BLEND_OP_ADD;
-
-		hr = renderer->device->CreateBlendState(&bs_desc, &renderer->blend_states[BLEND_STATE_PreMulAlpha]);
-		AssertHR(hr);
-	}
-	{
-		ID3D11DepthStencilState* dss;
-		D3D11_DEPTH_STENCIL_DESC dss_desc = {};
-		dss_desc.DepthEnable = true;
-		dss_desc.DepthWriteMask = D3D11_DEPTH_WRITE_MASK_ALL;
-		dss_desc.DepthFunc = D3D11_COMPARISON_LESS_EQUAL;
-		hr = renderer->device->CreateDepthStencilState(&dss_desc, &dss);
-		renderer->default_depth_stencil_state = dss;
-		AssertHR(hr);
-	}
-	{ 
-		// Default Rasterizer
-		ID3D11RasterizerState* rs;
-		D3D11_RASTERIZER_DESC rs_desc;
-		rs_desc.FillMode = D3D11_FILL_SOLID;
-		rs_desc.CullMode = D3D11_CULL_BACK;
-		rs_desc.FrontCounterClockwise = true;
-		rs_desc.MultisampleEnable = true;
-		hr = renderer->device->CreateRasterizerState(&rs_desc, &rs);
-		renderer->rasterizer_states[RASTERIZER_STATE_Default] = rs;
-		AssertHR(hr);
-
-		// Wireframe
-		rs_desc.FillMode = D3D11_FILL_WIREFRAME;
-		hr = renderer->device->CreateRasterizerState(&rs_desc, &rs);
-		renderer->rasterizer_states[RASTERIZER_STATE_Wireframe] = rs;
-		AssertHR(hr);
-
-		rs_desc = {};
-		rs_desc.FillMode = D3D11_FILL_SOLID;
-		rs_desc.CullMode = D3D11_CULL_NONE;
-		rs_desc.FrontCounterClockwise = true;
-		hr = renderer->device->CreateRasterizerState(&rs_desc, &rs);
-		renderer->rasterizer_states[RASTERIZER_STATE_DoubleSided] = rs;
-		AssertHR(hr);
-	}
-	{ // default
-		ID3D11SamplerState* ss;
-		D3D11_SAMPLER_DESC desc = {};
-		desc.Filter = D3D11_FILTER_MIN_MAG_MIP_POINT;
-		desc.AddressU = D3D11_TEXTURE_ADDRESS_CLAMP;
-		desc.AddressV = D3D11_TEXTURE_ADDRESS_CLAMP;
-		desc.AddressW = D3D11_TEXTURE_ADDRESS_CLAMP;
-		desc.ComparisonFunc = D3D11_COMPARISON_ALWAYS;
-		desc.MaxLOD = D3D11_FLOAT32_MAX;
-		hr = renderer->device->CreateSamplerState(&desc, &ss);
-		AssertHR(hr);
-		renderer->samplers[SAMPLER_STATE_Default] = ss;
-	}
+	SetRasterizerState* set_rasterizer_state = PushRenderCommand(renderer, SetRasterizerState);
+	set_rasterizer_state->type = RASTERIZER_STATE_Default;
 
+	SetSamplerState* set_sampler_state = PushRenderCommand(renderer, SetSamplerState);
+	set_sampler_state->type = SAMPLER_STATE_Default;
+	set_sampler_state->slot = 0;
 
-	return renderer;
-}
+	SetViewport* set_viewport = PushRenderCommand(renderer, SetViewport);
+	set_viewport->topleft = V2Z();
+	set_viewport->dim = V2((float)renderer->render_dim.width, (float)renderer->render_dim.height);
 
+	SetPrimitiveTopology* set_topology = PushRenderCommand(renderer, SetPrimitiveTopology);
+	set_topology->type = PRIMITIVE_TOPOLOGY_TriangleList;
 
+}
 
+static void
+RendererEndFrame(Renderer* renderer) {
+	MergeRenderCommandLists(renderer);
+	if(renderer->capture) WriteRenderCapture(renderer);
+	ExecuteRenderCommands(renderer);
+	PresentRenderer(renderer);
+	EndRenderStatsFrame(renderer);
+}
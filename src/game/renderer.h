@@ -16,10 +16,19 @@ enum RASTERIZER_STATE {
 
 enum SAMPLER_STATE {
 	SAMPLER_STATE_Default,
+	SAMPLER_STATE_Linear,
 
 	SAMPLER_STATE_TOTAL
 };
 
+enum TEXTURE_USAGE {
+	TEXTURE_USAGE_Immutable,
+	TEXTURE_USAGE_Dynamic,		// cpu rewrites the whole texture through Map
+	TEXTURE_USAGE_Default,		// cpu updates sub regions through UpdateTextureRegion
+
+	TEXTURE_USAGE_TOTAL
+};
+
 enum STRUCTURED_BINDING_SLOT {
 	STRUCTURED_BINDING_SLOT_Frame
 };
@@ -56,9 +65,18 @@ struct DepthStencil {
 	ID3D11DepthStencilView* view;
 };
 
+// ids only feed the render queue sort key
+
 struct IndexBuffer     { ID3D11Buffer* buffer; };
-struct ConstantsBuffer { ID3D11Buffer* buffer; };
-struct VertexBuffer    { ID3D11Buffer* buffer; };
+struct VertexBuffer    { ID3D11Buffer* buffer; u16 id; };
+
+// Has no buffer of its own, every PushRenderConstants takes a new range of the upload ring
+// and later binds use it. A range only lives as long as the frame it was pushed in.
+struct ConstantsBuffer {
+	u32 size;		// multiple of UPLOAD_RING_ALIGNMENT
+	u32 offset;		// into the ring
+	u64 fence;		// of the frame that pushed it
+};
 
 struct StructuredBuffer {
 	ID3D11Buffer* buffer;
@@ -68,15 +86,18 @@ struct StructuredBuffer {
 struct TextureBuffer {
 	ID3D11Texture2D* buffer;
 	ID3D11ShaderResourceView* view;
+	u16 id;
 };
 
 struct VertexShader {
 	ID3D11VertexShader* shader;
 	ID3D11InputLayout* il;
+	u16 id;
 };
 
 struct PixelShader {
 	ID3D11PixelShader* shader;
+	u16 id;
 };
 
 struct SetVertexBuffer { 
@@ -114,6 +135,14 @@ struct SetSamplerState {
 	u8 slot;
 };
 
+struct UpdateTextureRegion {
+	TextureBuffer* texture;
+	void* data;		// first texel of the region, has to stay valid until the frame executes
+	u32 pitch;
+	u32 x, y;
+	u32 width, height;
+};
+
 struct FreeRenderResource {
 	void* buffer;
 };
@@ -144,6 +173,17 @@ struct PushRenderBufferData {
 	u32 pitch;
 };
 
+// Put in front of the items of each pass by the merge, only the stats look at it
+struct BeginRenderPass {
+	u32 pass;
+};
+
+struct PushRenderConstants {
+	ConstantsBuffer* constants;
+	void* data;
+	u32 size;
+};
+
 struct DrawIndexed {
 	u32 indices_count;
 	u32 offset;
@@ -160,6 +200,12 @@ struct DrawInstanced {
 	u32 offset;
 };
 
+struct DrawIndexedInstanced {
+	u32 indices_count;
+	u32 instance_count;
+	u32 offset;
+};
+
 struct ClearRenderTarget {
 	RenderTarget* render_target;
 	float color[4];
@@ -200,12 +246,186 @@ enum RENDER_COMMAND {
 	RENDER_COMMAND_DrawVertices,
 	RENDER_COMMAND_DrawIndexed,
 	RENDER_COMMAND_DrawInstanced,
+	RENDER_COMMAND_DrawIndexedInstanced,
 
 	RENDER_COMMAND_PushRenderBufferData,
-	RENDER_COMMAND_FreeRenderResource
+	RENDER_COMMAND_PushRenderConstants,
+	RENDER_COMMAND_UpdateTextureRegion,
+	RENDER_COMMAND_FreeRenderResource,
+
+	RENDER_COMMAND_BeginRenderPass,
+
+	RENDER_COMMAND_TOTAL
 };
 
-struct RenderCommandHeader { u8 type; };
+#define RENDER_COMMAND_ALIGNMENT 8
+#define RENDER_COMMAND_BLOCK_SIZE Kilobytes(64)
+#define RENDER_ITEM_MAX_SIZE Kilobytes(2)		// free space an item starts with, so it never straddles blocks
+
+// size covers the header, the payload that follows it and the padding to the next header
+struct RenderCommandHeader {
+	u32 type;
+	u32 size;
+};
+
+// Commands never straddle blocks, one that doesn't fit starts the next block
+struct RenderCommandBlock {
+	RenderCommandBlock* next;
+	u8* base;
+	u32 size;
+	u32 used;
+};
+
+// Blocks past current are left over from an earlier frame and get reused before new ones come
+// from the arena
+struct RenderCommandStream {
+	MemoryArena* arena;
+	RenderCommandBlock* first;
+	RenderCommandBlock* current;
+};
+
+// A position in a stream, block 0 is the start
+struct RenderCommandMark {
+	RenderCommandBlock* block;
+	u32 used;
+};
+
+enum RENDER_PASS {
+	RENDER_PASS_World,
+	RENDER_PASS_PostProcess,
+	RENDER_PASS_UI,
+
+	RENDER_PASS_TOTAL
+};
+
+// Everything a draw binds besides its buffers, pushed at the start of every render item
+struct RenderPipelineState {
+	RenderTarget* render_target;	// 0 means the readable render target
+	u8 blend;
+	u8 rasterizer;
+	u8 topology;
+	VertexShader* vs;
+	PixelShader* ps;
+};
+
+// Self contained run of commands ending in a draw, sorted on key at the end of the frame
+struct RenderItem {
+	u64 key;
+	u8* commands;
+	u32 size;
+};
+
+// Lists are merged in this order, items with equal keys keep it
+enum RENDER_LIST {
+	RENDER_LIST_Quads,
+	RENDER_LIST_Meshes,
+	RENDER_LIST_Debug,
+	RENDER_LIST_PostProcess,
+	RENDER_LIST_UI,
+
+	RENDER_LIST_TOTAL
+};
+
+// Recorded by one thread at a time without touching the renderer. Commands pushed outside
+// an item are immediate, the immediates of every list run before the first item.
+struct RenderCommandList {
+	struct Renderer* renderer;	// read only while recording
+	MemoryArena arena;			// data commands point at, reset every frame
+	TemporaryMemory arena_temp;
+
+	MemoryArena buffer_arena;	// command blocks and grown item arrays, kept between frames
+	RenderCommandStream immediates;
+	RenderCommandStream item_commands;
+	RenderItem* items;
+	RenderItem* open_item;
+	u32 max_items;
+	u32 item_count;
+
+	u64 record_cycles;
+	u64 record_start;
+};
+
+// Cycles spent in the backend per command type, filled by ExecuteRenderCommands when set
+struct RenderCommandTimings {
+	u64 cycles[RENDER_COMMAND_TOTAL];
+	u32 counts[RENDER_COMMAND_TOTAL];
+};
+
+// Immediates run before the first item and are counted apart from the passes
+#define RENDER_STATS_IMMEDIATE RENDER_PASS_TOTAL
+#define RENDER_STATS_PASSES (RENDER_PASS_TOTAL + 1)
+
+struct RenderPassStats {
+	u32 commands[RENDER_COMMAND_TOTAL];		// decoded, before state filtering
+	u32 submitted;			// commands that reached the backend
+	u32 items;
+	u32 draws;
+	u64 vertices;			// vertices or indices times instances
+	u32 state_commands;		// Set* commands decoded
+	u32 state_changes;		// Set* commands that reached the device after filtering
+	u32 buffer_bytes;		// pushed through PushRenderBufferData
+};
+
+// Totals are the sum over passes. Cycles are rdtsc, list cycles are whatever the recording
+// code timed with BeginRenderListTiming.
+struct RenderQueueStats {
+	RenderPassStats passes[RENDER_STATS_PASSES];
+
+	u32 items;
+	u32 commands;
+	u32 draws;
+	u64 vertices;
+	u32 state_commands;
+	u32 state_changes;
+	u32 buffer_bytes;
+	u32 upload_bytes;		// upload ring space taken
+	u32 upload_waits;		// times the ring was full and the cpu waited on the gpu
+
+	// Device objects created through the Upload* helpers and target (re)creation, outside of
+	// init and resizes this should stay at zero
+	u32 resources_created;
+	u32 resources_freed;
+
+	u64 list_cycles[RENDER_LIST_TOTAL];
+	u64 merge_cycles;
+	u64 execute_cycles;
+	u64 present_cycles;
+};
+
+#define UPLOAD_RING_SIZE Megabytes(1)
+#define UPLOAD_RING_ALIGNMENT 256		// VSSetConstantBuffers1 offsets and counts go in steps of 16 constants
+#define UPLOAD_RING_MAX_FRAMES 3		// frames the gpu can be behind before the cpu waits
+#define UPLOAD_RING_FULL 0xffffffff
+
+struct UploadRingFrame {
+	u64 end;			// head when the frame was submitted
+	u64 fence;
+};
+
+// Suballocates one dynamic buffer that is only ever mapped without overwrite. Positions only
+// grow and offsets are them modulo size. Space comes back a frame at a time, once the
+// backend reports that frame's fence as passed.
+struct UploadRing {
+	u32 size;
+	u64 head;
+	u64 tail;
+	u64 fence;			// signaled at the end of the frame being recorded, starts at 1
+
+	UploadRingFrame frames[UPLOAD_RING_MAX_FRAMES];
+	u32 first_frame;
+	u32 frame_count;
+};
+
+#define DYNAMIC_RESOLUTION_SMOOTHING 0.1f
+#define DYNAMIC_RESOLUTION_HEADROOM 0.85f		// the scale only grows once frames are this far under budget
+#define DYNAMIC_RESOLUTION_MAX_STEP 0.05f		// per frame
+
+// Moves render_scale so frames take budget_ms, a budget of 0 leaves it alone
+struct DynamicResolution {
+	float budget_ms;
+	float min_scale;
+	float full_ms;				// filtered frame time scaled to render_scale 1
+};
 
 // Push this on the heap
 struct Renderer {
@@ -213,9 +433,14 @@ struct Renderer {
 	MemoryArena* frame_arena;
 
 	WindowDimensions window_dim;
+	WindowDimensions target_dim;		// depth and readable render target, only ever grow
+	WindowDimensions render_dim;		// top left part of them the world is drawn to this frame
+	float render_scale;
+	DynamicResolution dynamic_resolution;
 
 	ID3D11Device* device;
 	ID3D11DeviceContext* context; 
+	ID3D11DeviceContext1* context1;		// offset constant buffer binds
 	IDXGISwapChain1* swapchain;
 	u32 msaa_sample_count;
 	u32 msaa_quality_level;
@@ -231,12 +456,58 @@ struct Renderer {
 	ID3D11BlendState* blend_states[BLEND_STATE_TOTAL];
 	ID3D11RasterizerState* rasterizer_states[RASTERIZER_STATE_TOTAL];
 
-	u32 command_buffer_size;
-	u8* command_buffer_base;
-	u8* command_buffer_cursor;
+	RenderCommandStream commands;	// blocks come from the frame arena
+
+	RenderCommandList lists[RENDER_LIST_TOTAL];
+
+	u16 next_shader_id;
+	u16 next_texture_id;
+	u16 next_mesh_id;
+
+	RenderQueueStats queue_stats;
+	RenderQueueStats queue_stats_last_frame;
+
+	UploadRing upload_ring;
+	ID3D11Buffer* upload_ring_buffer;
+	bool upload_ring_discarded;			// the first map of a dynamic buffer has to discard
+	ID3D11Query* fence_queries[UPLOAD_RING_MAX_FRAMES];
+
+#ifdef RENDERER_NULL
+	NullDevice null_device;
+#endif
+#ifdef RENDERER_SOFTWARE
+	SoftwareDevice software_device;
+#endif
+
+	// Cpu backends split their work over this queue, 0 runs it all on the calling thread
+	PlatformWorkQueue* work_queue;
+	u32 worker_count;
+
+	struct RenderCapture* capture;				// see renderer_capture.cpp, 0 unless enabled
+	RenderCommandTimings* command_timings;
 
 };
 
+// Implemented by the backend, renderer_d3d11.cpp, renderer_null.cpp or renderer_software.cpp, along with InitRenderer.
+// The Upload* calls in renderer_capture.cpp wrap the UploadBackend* ones. ResizeBackendTargets remakes the
+// backbuffer at window_dim, and with offscreen set depth and the readable render target at target_dim.
+static void ExecuteBackendCommand(RENDER_COMMAND type, void* data, Renderer* renderer);
+static void ResizeBackendTargets(Renderer* renderer, bool offscreen);
+static void PresentBackend(Renderer* renderer);
 
+// Fences are signaled once per frame after its last command, in increasing order
+static void SignalBackendFence(Renderer* renderer, u64 fence);
+static u64 GetBackendCompletedFence(Renderer* renderer);
+static void WaitBackendFence(Renderer* renderer, u64 fence);
 
+static StructuredBuffer* UploadBackendStructuredBuffer(u32 struct_size, u32 count, Renderer* renderer);
+static PixelShader* UploadBackendPixelShader(char* code, u32 length, char* entry, Renderer* renderer);
+static VertexShader* UploadBackendVertexShader(char* code, u32 length, char* entry, VERTEX_BUFFER* vertex_buffers, u8 count, Renderer* renderer);
+static TextureBuffer* UploadBackendTexture(void* data, u32 width, u32 height, u8 num_components, TEXTURE_USAGE usage, Renderer* renderer);
+static ReadableRenderTarget* UploadBackendRenderTarget(u32 width, u32 height, Renderer* renderer);
+static IndexBuffer* UploadBackendIndexBuffer(void* data, u32 count, Renderer* renderer);
+static VertexBuffer* UploadBackendVertexBuffer(void* initial_data, u32 num_vertices, u8 num_components, bool dynamic, Renderer* renderer);
 
+// renderer_capture.cpp
+static void WriteRenderCapture(Renderer* renderer);		// writes the frame if one was requested
+static void ForgetRenderCaptureResource(Renderer* renderer, void* handle);
@@ -0,0 +1,706 @@
+// Frame capture
+// Once enabled, every Upload* call is recorded with a copy of its initial data. A requested
+// capture writes the merged command stream of that frame, everything it points at and the
+// resources it references, so ReplayRenderCapture can run the same frame without the game.
+//
+// File layout: RenderCaptureHeader, RenderCaptureResource[resource_count], the command
+// stream, then the payload every data pointer and initial data copy was moved into.
+// Pointers in the stored commands hold a RENDER_CAPTURE_REF or a payload offset instead.
+
+#define RENDER_CAPTURE_MAGIC 0x50414352		// "RCAP"
+#define RENDER_CAPTURE_VERSION 5
+#define MAX_RENDER_CAPTURE_RESOURCES 4096
+
+enum RENDER_CAPTURE_RESOURCE {
+	RENDER_CAPTURE_RESOURCE_ConstantsBuffer,
+	RENDER_CAPTURE_RESOURCE_StructuredBuffer,
+	RENDER_CAPTURE_RESOURCE_PixelShader,
+	RENDER_CAPTURE_RESOURCE_VertexShader,
+	RENDER_CAPTURE_RESOURCE_Texture,
+	RENDER_CAPTURE_RESOURCE_IndexBuffer,
+	RENDER_CAPTURE_RESOURCE_VertexBuffer,
+	RENDER_CAPTURE_RESOURCE_RenderTarget,
+
+	RENDER_CAPTURE_RESOURCE_TOTAL
+};
+
+// Targets owned by the renderer are recreated by InitRenderer, resources follow them
+enum RENDER_CAPTURE_REF {
+	RENDER_CAPTURE_REF_None,
+	RENDER_CAPTURE_REF_Backbuffer,
+	RENDER_CAPTURE_REF_ReadableTarget,
+	RENDER_CAPTURE_REF_DepthStencil,
+
+	RENDER_CAPTURE_REF_FirstResource
+};
+
+// Shaders are stored by index, the replay has the same sources compiled in
+static char* render_capture_shaders[] = {
+	TexturedQuadShader, QuadShader, CipSpaceTexturedShader, ScreenSpaceShader, TextShader,
+	SDFTextShader, MeshShader, FullScreenQuadShader, CopyShader, PostProcessShader, UIShader, DebugDrawShader,
+};
+
+static char* render_command_names[RENDER_COMMAND_TOTAL] = {
+	"ClearRenderTarget", "ClearDepth", "ClearStencil",
+	"SetRenderTarget", "SetBlendState", "SetDepthStencilState", "SetRasterizerState",
+	"SetPrimitiveTopology", "SetSamplerState", "SetViewport", "SetTopology",
+	"SetVertexShader", "SetPixelShader",
+	"SetVertexBuffer", "SetIndexBuffer", "SetStructuredBuffer", "SetConstantsBuffer", "SetTextureBuffer",
+	"DrawVertices", "DrawIndexed", "DrawInstanced", "DrawIndexedInstanced",
+	"PushRenderBufferData", "PushRenderConstants", "UpdateTextureRegion", "FreeRenderResource",
+	"BeginRenderPass",
+};
+
+// SetTopology has no payload and no backend handles it
+static u32 render_command_sizes[RENDER_COMMAND_TOTAL] = {
+	sizeof(ClearRenderTarget), sizeof(ClearDepth), sizeof(ClearStencil),
+	sizeof(SetRenderTarget), sizeof(SetBlendState), sizeof(SetDepthStencilState), sizeof(SetRasterizerState),
+	sizeof(SetPrimitiveTopology), sizeof(SetSamplerState), sizeof(SetViewport), 0,
+	sizeof(SetVertexShader), sizeof(SetPixelShader),
+	sizeof(SetVertexBuffer), sizeof(SetIndexBuffer), sizeof(SetStructuredBuffer), sizeof(SetConstantsBuffer), sizeof(SetTextureBuffer),
+	sizeof(DrawVertices), sizeof(DrawIndexed), sizeof(DrawInstanced), sizeof(DrawIndexedInstanced),
+	sizeof(PushRenderBufferData), sizeof(PushRenderConstants), sizeof(UpdateTextureRegion), sizeof(FreeRenderResource),
+	sizeof(BeginRenderPass),
+};
+
+struct RenderCaptureHeader {
+	u32 magic;
+	u32 version;
+	u32 pointer_size;
+	WindowDimensions window_dim;
+	WindowDimensions target_dim;
+	u32 resource_count;
+	u32 command_size;
+	u64 payload_size;
+};
+
+// What the Upload* call was given, the meaning of width and height depends on kind
+struct RenderCaptureResource {
+	u8 kind;				// RENDER_CAPTURE_RESOURCE
+	u8 shader;				// index into render_capture_shaders
+	u8 components;
+	u8 usage;				// TEXTURE_USAGE for textures, dynamic for vertex buffers
+	u32 width;				// texels, struct size, vertex or index count, constants size
+	u32 height;				// texels, struct count, vertex components
+	u32 data_size;			// 0 when created without data
+	u64 data_offset;
+	u8 vertex_buffer_count;
+	u8 vertex_buffers[VERTEX_BUFFER_TOTAL];
+	char entry[16];
+};
+
+struct RenderCaptureEntry {
+	RenderCaptureResource desc;
+	void* handle;			// device object commands can reference directly
+	void* view;
+	void* target_view;		// render targets are bound through a second view
+	void* data;
+	bool freed;
+};
+
+struct RenderCapture {
+	RenderCaptureEntry* entries;
+	u32 entry_count;
+	char* pending_path;		// written at the end of the frame it was requested in
+};
+
+// Has to run before anything the capture should see is uploaded
+static void
+EnableRenderCapture(Renderer* renderer) {
+	RenderCapture* capture = PushStructClear(renderer->permanent_arena, RenderCapture);
+	capture->entries = PushArray(renderer->permanent_arena, RenderCaptureEntry, MAX_RENDER_CAPTURE_RESOURCES);
+	renderer->capture = capture;
+}
+
+static void
+RequestRenderCapture(Renderer* renderer, char* path) {
+	Assert(renderer->capture);
+	renderer->capture->pending_path = path;
+}
+
+static RenderCaptureEntry*
+RecordRenderCaptureResource(Renderer* renderer, RENDER_CAPTURE_RESOURCE kind, void* handle, void* view, void* data, u32 data_size) {
+	RenderCapture* capture = renderer->capture;
+	Assert(capture->entry_count < MAX_RENDER_CAPTURE_RESOURCES);
+
+	RenderCaptureEntry* entry = capture->entries + capture->entry_count++;
+	ZeroStruct(*entry);
+	entry->desc.kind = (u8)kind;
+	entry->handle = handle;
+	entry->view = view;
+	if(data && data_size) {
+		entry->data = PushSize(renderer->permanent_arena, data_size);
+		CopyMem(entry->data, data, data_size);
+		entry->desc.data_size = data_size;
+	}
+	return entry;
+}
+
+static void
+ForgetRenderCaptureResource(Renderer* renderer, void* handle) {
+	RenderCapture* capture = renderer->capture;
+	for(u32 i=0; i<capture->entry_count; i++) {
+		RenderCaptureEntry* entry = capture->entries + i;
+		if(entry->handle == handle) entry->freed = true;
+	}
+}
+
+static u8
+GetRenderCaptureShader(char* code) {
+	for(u8 i=0; i<ArrayCount(render_capture_shaders); i++) {
+		if(render_capture_shaders[i] == code) return i;
+	}
+
+	// New shader sources have to be added to the table
+	Assert(false);
+	return 0;
+}
+
+// Lives in the upload ring, so the wrapper is all there is to create and capture refers to it
+static ConstantsBuffer*
+UploadConstantsBuffer(u32 size, Renderer* renderer) {
+	ConstantsBuffer* result = PushStructClear(renderer->permanent_arena, ConstantsBuffer);
+	result->size = (size + UPLOAD_RING_ALIGNMENT - 1) & ~(UPLOAD_RING_ALIGNMENT - 1);
+	if(renderer->capture) {
+		RenderCaptureEntry* entry = RecordRenderCaptureResource(renderer, RENDER_CAPTURE_RESOURCE_ConstantsBuffer,
+				result, 0, 0, 0);
+		entry->desc.width = size;
+	}
+	return result;
+}
+
+static StructuredBuffer*
+UploadStructuredBuffer(u32 struct_size, u32 count, Renderer* renderer) {
+	StructuredBuffer* result = UploadBackendStructuredBuffer(struct_size, count, renderer);
+	if(renderer->capture) {
+		RenderCaptureEntry* entry = RecordRenderCaptureResource(renderer, RENDER_CAPTURE_RESOURCE_StructuredBuffer,
+				result->buffer, result->view, 0, 0);
+		entry->desc.width = struct_size;
+		entry->desc.height = count;
+	}
+	return result;
+}
+
+static PixelShader*
+UploadPixelShader(char* code, u32 length, char* entry_point, Renderer* renderer) {
+	PixelShader* result = UploadBackendPixelShader(code, length, entry_point, renderer);
+	if(renderer->capture) {
+		RenderCaptureEntry* entry = RecordRenderCaptureResource(renderer, RENDER_CAPTURE_RESOURCE_PixelShader,
+				result->shader, 0, 0, 0);
+		entry->desc.shader = GetRenderCaptureShader(code);
+		entry->desc.width = length;
+		Assert(StringLength(entry_point) < sizeof(entry->desc.entry));
+		CopyMem(entry->desc.entry, entry_point, StringLength(entry_point));
+	}
+	return result;
+}
+
+static VertexShader*
+UploadVertexShader(char* code, u32 length, char* entry_point, VERTEX_BUFFER* vertex_buffers, u8 count, Renderer* renderer) {
+	VertexShader* result = UploadBackendVertexShader(code, length, entry_point, vertex_buffers, count, renderer);
+	if(renderer->capture) {
+		RenderCaptureEntry* entry = RecordRenderCaptureResource(renderer, RENDER_CAPTURE_RESOURCE_VertexShader,
+				result->shader, 0, 0, 0);
+		entry->desc.shader = GetRenderCaptureShader(code);
+		entry->desc.width = length;
+		Assert(StringLength(entry_point) < sizeof(entry->desc.entry));
+		CopyMem(entry->desc.entry, entry_point, StringLength(entry_point));
+
+		Assert(count <= ArrayCount(entry->desc.vertex_buffers));
+		entry->desc.vertex_buffer_count = vertex_buffers ? count : 0;
+		for(u32 i=0; i<entry->desc.vertex_buffer_count; i++) entry->desc.vertex_buffers[i] = (u8)vertex_buffers[i];
+	}
+	return result;
+}
+
+static TextureBuffer*
+UploadTexture(void* data, u32 width, u32 height, u8 num_components, TEXTURE_USAGE usage, Renderer* renderer) {
+	TextureBuffer* result = UploadBackendTexture(data, width, height, num_components, usage, renderer);
+	if(renderer->capture) {
+		RenderCaptureEntry* entry = RecordRenderCaptureResource(renderer, RENDER_CAPTURE_RESOURCE_Texture,
+				result->buffer, result->view, data, width*height*num_components);
+		entry->desc.width = width;
+		entry->desc.height = height;
+		entry->desc.components = num_components;
+		entry->desc.usage = (u8)usage;
+	}
+	return result;
+}
+
+static ReadableRenderTarget*
+UploadRenderTarget(u32 width, u32 height, Renderer* renderer) {
+	ReadableRenderTarget* result = UploadBackendRenderTarget(width, height, renderer);
+	if(renderer->capture) {
+		RenderCaptureEntry* entry = RecordRenderCaptureResource(renderer, RENDER_CAPTURE_RESOURCE_RenderTarget,
+				result->texture, result->shader_resource, 0, 0);
+		entry->target_view = result->render_target;
+		entry->desc.width = width;
+		entry->desc.height = height;
+	}
+	return result;
+}
+
+static IndexBuffer*
+UploadIndexBuffer(void* data, u32 count, Renderer* renderer) {
+	IndexBuffer* result = UploadBackendIndexBuffer(data, count, renderer);
+	if(renderer->capture) {
+		RenderCaptureEntry* entry = RecordRenderCaptureResource(renderer, RENDER_CAPTURE_RESOURCE_IndexBuffer,
+				result->buffer, 0, data, count*sizeof(u32));
+		entry->desc.width = count;
+	}
+	return result;
+}
+
+static VertexBuffer*
+UploadVertexBuffer(void* initial_data, u32 num_vertices, u8 num_components, bool dynamic, Renderer* renderer) {
+	VertexBuffer* result = UploadBackendVertexBuffer(initial_data, num_vertices, num_components, dynamic, renderer);
+	if(renderer->capture) {
+		RenderCaptureEntry* entry = RecordRenderCaptureResource(renderer, RENDER_CAPTURE_RESOURCE_VertexBuffer,
+				result->buffer, 0, initial_data, num_vertices*num_components*sizeof(float));
+		entry->desc.width = num_vertices;
+		entry->desc.height = num_components;
+		entry->desc.usage = dynamic;
+	}
+	return result;
+}
+
+// Capture
+
+// Commands reference device objects through wrappers the front end builds on the fly, so
+// resources are found by the handles inside them. Later entries win, addresses get reused.
+static u64
+GetRenderCaptureRef(Renderer* renderer, void* handle) {
+	if(!handle) return RENDER_CAPTURE_REF_None;
+	if(handle == renderer->backbuffer.view || handle == renderer->backbuffer.texture) return RENDER_CAPTURE_REF_Backbuffer;
+	if(handle == renderer->readable_render_target.render_target ||
+	   handle == renderer->readable_render_target.shader_resource) return RENDER_CAPTURE_REF_ReadableTarget;
+	if(handle == renderer->depth_stencil.view) return RENDER_CAPTURE_REF_DepthStencil;
+
+	RenderCapture* capture = renderer->capture;
+	for(u32 i=capture->entry_count; i>0; i--) {
+		RenderCaptureEntry* entry = capture->entries + i - 1;
+		if(entry->freed) continue;
+		if(entry->handle == handle || entry->view == handle || entry->target_view == handle)
+			return RENDER_CAPTURE_REF_FirstResource + i - 1;
+	}
+
+	// Uploaded before the capture was enabled
+	Assert(false);
+	return RENDER_CAPTURE_REF_None;
+}
+
+#define StoreRenderCaptureRef(field, handle) (*(u64*)&(field) = GetRenderCaptureRef(renderer, (handle)))
+
+// Bytes a command points at besides the resources it references
+static u32
+GetRenderCapturePayloadSize(Renderer* renderer, u8 type, void* data) {
+	if(type == RENDER_COMMAND_PushRenderBufferData) return ((PushRenderBufferData*)data)->size;
+	if(type == RENDER_COMMAND_PushRenderConstants) return ((PushRenderConstants*)data)->size;
+	if(type != RENDER_COMMAND_UpdateTextureRegion) return 0;
+
+	UpdateTextureRegion* command = (UpdateTextureRegion*)data;
+	u64 ref = GetRenderCaptureRef(renderer, command->texture->view);
+	Assert(ref >= RENDER_CAPTURE_REF_FirstResource);
+	u32 components = renderer->capture->entries[ref - RENDER_CAPTURE_REF_FirstResource].desc.components;
+	return command->height ? command->pitch*(command->height - 1) + command->width*components : 0;
+}
+
+static void
+WriteRenderCapture(Renderer* renderer) {
+	RenderCapture* capture = renderer->capture;
+	if(!capture->pending_path) return;
+	Assert(sizeof(void*) == sizeof(u64));
+
+	RenderCommandMark start = {};
+	u32 command_size = CopyRenderCommands(&renderer->commands, start, 0);
+	u8* commands = PushArray(renderer->frame_arena, u8, command_size);
+	CopyRenderCommands(&renderer->commands, start, commands);
+
+	u64 payload_size = 0;
+	for(u32 i=0; i<capture->entry_count; i++) payload_size += capture->entries[i].desc.data_size;
+	for(u8* cursor = commands; cursor < commands + command_size;) {
+		RenderCommandHeader* header = (RenderCommandHeader*)cursor;
+		Assert(header->type < RENDER_COMMAND_TOTAL && render_command_sizes[header->type]);
+		Assert(header->size == GetRenderCommandSize(render_command_sizes[header->type]));
+		payload_size += GetRenderCapturePayloadSize(renderer, header->type, header + 1);
+		cursor += header->size;
+	}
+
+	u64 resources_size = sizeof(RenderCaptureResource)*capture->entry_count;
+	u64 file_size = sizeof(RenderCaptureHeader) + resources_size + command_size + payload_size;
+	PlatformMemoryBlock* file = platform_api.allocate_memory(file_size);
+
+	RenderCaptureHeader* header = (RenderCaptureHeader*)file->bp;
+	RenderCaptureResource* resources = (RenderCaptureResource*)(header + 1);
+	u8* stored_commands = (u8*)(resources + capture->entry_count);
+	u8* payload = stored_commands + command_size;
+	u64 payload_cursor = 0;
+
+	header->magic = RENDER_CAPTURE_MAGIC;
+	header->version = RENDER_CAPTURE_VERSION;
+	header->pointer_size = sizeof(void*);
+	header->window_dim = renderer->window_dim;
+	header->target_dim = renderer->target_dim;
+	header->resource_count = capture->entry_count;
+	header->command_size = command_size;
+	header->payload_size = payload_size;
+
+	for(u32 i=0; i<capture->entry_count; i++) {
+		RenderCaptureEntry* entry = capture->entries + i;
+		resources[i] = entry->desc;
+		resources[i].data_offset = payload_cursor;
+		CopyMem(payload + payload_cursor, entry->data, entry->desc.data_size);
+		payload_cursor += entry->desc.data_size;
+	}
+
+	CopyMem(stored_commands, commands, command_size);
+	for(u8* cursor = stored_commands; cursor < stored_commands + command_size;) {
+		RenderCommandHeader* command_header = (RenderCommandHeader*)cursor;
+		void* data = command_header + 1;
+		cursor += command_header->size;
+
+		u32 size = GetRenderCapturePayloadSize(renderer, command_header->type, data);
+
+		switch(command_header->type) {
+
+			case RENDER_COMMAND_ClearRenderTarget: {
+				ClearRenderTarget* command = (ClearRenderTarget*)data;
+				StoreRenderCaptureRef(command->render_target, command->render_target ? command->render_target->view : 0);
+			} break;
+
+			case RENDER_COMMAND_ClearStencil: {
+				ClearStencil* command = (ClearStencil*)data;
+				StoreRenderCaptureRef(command->depth_stencil, command->depth_stencil ? command->depth_stencil->view : 0);
+			} break;
+
+			case RENDER_COMMAND_SetRenderTarget: {
+				SetRenderTarget* command = (SetRenderTarget*)data;
+				StoreRenderCaptureRef(command->render_target, command->render_target ? command->render_target->view : 0);
+			} break;
+
+			case RENDER_COMMAND_SetVertexShader: {
+				SetVertexShader* command = (SetVertexShader*)data;
+				StoreRenderCaptureRef(command->vertex, command->vertex->shader);
+			} break;
+
+			case RENDER_COMMAND_SetPixelShader: {
+				SetPixelShader* command = (SetPixelShader*)data;
+				StoreRenderCaptureRef(command->pixel, command->pixel->shader);
+			} break;
+
+			case RENDER_COMMAND_SetVertexBuffer: {
+				SetVertexBuffer* command = (SetVertexBuffer*)data;
+				StoreRenderCaptureRef(command->vertex, command->vertex->buffer);
+			} break;
+
+			case RENDER_COMMAND_SetIndexBuffer: {
+				SetIndexBuffer* command = (SetIndexBuffer*)data;
+				StoreRenderCaptureRef(command->index, command->index->buffer);
+			} break;
+
+			case RENDER_COMMAND_SetStructuredBuffer: {
+				SetStructuredBuffer* command = (SetStructuredBuffer*)data;
+				StoreRenderCaptureRef(command->structured, command->structured->view);
+			} break;
+
+			case RENDER_COMMAND_SetConstantsBuffer: {
+				SetConstantsBuffer* command = (SetConstantsBuffer*)data;
+				StoreRenderCaptureRef(command->constants, command->constants);
+			} break;
+
+			case RENDER_COMMAND_SetTextureBuffer: {
+				SetTextureBuffer* command = (SetTextureBuffer*)data;
+				StoreRenderCaptureRef(command->texture, command->texture ? command->texture->view : 0);
+			} break;
+
+			case RENDER_COMMAND_PushRenderBufferData: {
+				PushRenderBufferData* command = (PushRenderBufferData*)data;
+				CopyMem(payload + payload_cursor, command->data, size);
+				StoreRenderCaptureRef(command->buffer, command->buffer);
+				*(u64*)&command->data = payload_cursor;
+				payload_cursor += size;
+			} break;
+
+			case RENDER_COMMAND_PushRenderConstants: {
+				PushRenderConstants* command = (PushRenderConstants*)data;
+				CopyMem(payload + payload_cursor, command->data, size);
+				StoreRenderCaptureRef(command->constants, command->constants);
+				*(u64*)&command->data = payload_cursor;
+				payload_cursor += size;
+			} break;
+
+			case RENDER_COMMAND_UpdateTextureRegion: {
+				UpdateTextureRegion* command = (UpdateTextureRegion*)data;
+				CopyMem(payload + payload_cursor, command->data, size);
+				StoreRenderCaptureRef(command->texture, command->texture->view);
+				*(u64*)&command->data = payload_cursor;
+				payload_cursor += size;
+			} break;
+
+			case RENDER_COMMAND_FreeRenderResource: {
+				FreeRenderResource* command = (FreeRenderResource*)data;
+				StoreRenderCaptureRef(command->buffer, command->buffer);
+			} break;
+		}
+	}
+	Assert(payload_cursor == payload_size);
+
+	bool written = platform_api.write_entire_file(capture->pending_path, file->bp, file_size);
+	Assert(written);
+
+	platform_api.deallocate_memory(file);
+	capture->pending_path = 0;
+}
+
+// Replay
+
+struct RenderCaptureReplay {
+	Renderer* renderer;
+	WindowDimensions window_dim;
+
+	u32 resource_count;
+	void** wrappers;		// what each resource's Upload* call returned, a TextureBuffer for render targets
+	void** handles;			// its device object, for commands that skip the wrapper, a RenderTarget for render targets
+
+	RenderTarget readable_target;
+	TextureBuffer readable_texture;
+
+	u8* commands;
+	u32 command_size;
+	u32 freed_resources;	// FreeRenderResource commands dropped so the frame can run again
+};
+
+static void*
+GetReplayResource(RenderCaptureReplay* replay, void* field, bool handle) {
+	u64 ref = (u64)field;
+	if(ref == RENDER_CAPTURE_REF_None) return 0;
+	Assert(ref >= RENDER_CAPTURE_REF_FirstResource && ref - RENDER_CAPTURE_REF_FirstResource < replay->resource_count);
+	u64 index = ref - RENDER_CAPTURE_REF_FirstResource;
+	return handle ? replay->handles[index] : replay->wrappers[index];
+}
+
+static RenderTarget*
+GetReplayRenderTarget(RenderCaptureReplay* replay, void* field) {
+	u64 ref = (u64)field;
+	if(ref == RENDER_CAPTURE_REF_None) return 0;
+	if(ref == RENDER_CAPTURE_REF_Backbuffer) return &replay->renderer->backbuffer;
+	if(ref == RENDER_CAPTURE_REF_ReadableTarget) return &replay->readable_target;
+	return (RenderTarget*)GetReplayResource(replay, field, true);
+}
+
+static TextureBuffer*
+GetReplayTexture(RenderCaptureReplay* replay, void* field) {
+	if((u64)field == RENDER_CAPTURE_REF_ReadableTarget) return &replay->readable_texture;
+	return (TextureBuffer*)GetReplayResource(replay, field, false);
+}
+
+// Recreates the captured resources on renderer, which has to be freshly initialized at the
+// captured window size, and points the stored commands at them. file stays referenced.
+// Offscreen targets are grown to the captured size first, the commands address parts of them.
+static bool
+LoadRenderCapture(RenderCaptureReplay* replay, u8* file, u64 file_size, Renderer* renderer) {
+	RenderCaptureHeader* header = (RenderCaptureHeader*)file;
+	if(file_size < sizeof(RenderCaptureHeader) || header->magic != RENDER_CAPTURE_MAGIC ||
+	   header->version != RENDER_CAPTURE_VERSION || header->pointer_size != sizeof(void*)) return false;
+
+	RenderCaptureResource* resources = (RenderCaptureResource*)(header + 1);
+	u8* commands = (u8*)(resources + header->resource_count);
+	u8* payload = commands + header->command_size;
+	if(payload + header->payload_size != file + file_size) return false;
+
+	Assert(renderer->window_dim.width == header->window_dim.width && renderer->window_dim.height == header->window_dim.height);
+	ReserveRenderTargets(renderer, header->target_dim);
+	MemoryArena* arena = renderer->permanent_arena;
+
+	ZeroStruct(*replay);
+	replay->renderer = renderer;
+	replay->window_dim = header->window_dim;
+	replay->resource_count = header->resource_count;
+	replay->wrappers = PushArray(arena, void*, header->resource_count);
+	replay->handles = PushArray(arena, void*, header->resource_count);
+	replay->readable_target.texture = renderer->readable_render_target.texture;
+	replay->readable_target.view = renderer->readable_render_target.render_target;
+	replay->readable_texture.view = renderer->readable_render_target.shader_resource;
+
+	for(u32 i=0; i<header->resource_count; i++) {
+		RenderCaptureResource* resource = resources + i;
+		void* data = resource->data_size ? payload + resource->data_offset : 0;
+		char* shader = resource->shader < ArrayCount(render_capture_shaders) ? render_capture_shaders[resource->shader] : 0;
+		VERTEX_BUFFER vertex_buffers[VERTEX_BUFFER_TOTAL];
+		for(u32 j=0; j<resource->vertex_buffer_count; j++) vertex_buffers[j] = (VERTEX_BUFFER)resource->vertex_buffers[j];
+
+		switch(resource->kind) {
+
+			case RENDER_CAPTURE_RESOURCE_ConstantsBuffer: {
+				ConstantsBuffer* cb = UploadConstantsBuffer(resource->width, renderer);
+				replay->wrappers[i] = cb;
+				replay->handles[i] = cb;
+			} break;
+
+			case RENDER_CAPTURE_RESOURCE_StructuredBuffer: {
+				StructuredBuffer* sb = UploadStructuredBuffer(resource->width, resource->height, renderer);
+				replay->wrappers[i] = sb;
+				replay->handles[i] = sb->buffer;
+			} break;
+
+			case RENDER_CAPTURE_RESOURCE_PixelShader: {
+				PixelShader* ps = UploadPixelShader(shader, resource->width, resource->entry, renderer);
+				replay->wrappers[i] = ps;
+				replay->handles[i] = ps->shader;
+			} break;
+
+			case RENDER_CAPTURE_RESOURCE_VertexShader: {
+				VertexShader* vs = UploadVertexShader(shader, resource->width, resource->entry,
+						resource->vertex_buffer_count ? vertex_buffers : 0, resource->vertex_buffer_count, renderer);
+				replay->wrappers[i] = vs;
+				replay->handles[i] = vs->shader;
+			} break;
+
+			case RENDER_CAPTURE_RESOURCE_Texture: {
+				TextureBuffer* tb = UploadTexture(data, resource->width, resource->height, resource->components,
+						(TEXTURE_USAGE)resource->usage, renderer);
+				replay->wrappers[i] = tb;
+				replay->handles[i] = tb->buffer;
+			} break;
+
+			case RENDER_CAPTURE_RESOURCE_IndexBuffer: {
+				IndexBuffer* ib = UploadIndexBuffer(data, resource->width, renderer);
+				replay->wrappers[i] = ib;
+				replay->handles[i] = ib->buffer;
+			} break;
+
+			case RENDER_CAPTURE_RESOURCE_VertexBuffer: {
+				VertexBuffer* vb = UploadVertexBuffer(data, resource->width, (u8)resource->height, resource->usage != 0, renderer);
+				replay->wrappers[i] = vb;
+				replay->handles[i] = vb->buffer;
+			} break;
+
+			case RENDER_CAPTURE_RESOURCE_RenderTarget: {
+				ReadableRenderTarget* rrt = UploadRenderTarget(resource->width, resource->height, renderer);
+				RenderTarget* rt = PushStruct(arena, RenderTarget);
+				rt->texture = rrt->texture;
+				rt->view = rrt->render_target;
+				TextureBuffer* tb = PushStructClear(arena, TextureBuffer);
+				tb->buffer = rrt->texture;
+				tb->view = rrt->shader_resource;
+				replay->wrappers[i] = tb;
+				replay->handles[i] = rt;
+			} break;
+
+			default: return false;
+		}
+	}
+
+	replay->commands = (u8*)PushSize(arena, header->command_size);
+
+	u8* cursor = commands;
+	u8* out = replay->commands;
+	while(cursor < commands + header->command_size) {
+		RenderCommandHeader* command_header = (RenderCommandHeader*)cursor;
+		if(command_header->type >= RENDER_COMMAND_TOTAL || !render_command_sizes[command_header->type]) return false;
+		u32 size = command_header->size;
+		if(size != GetRenderCommandSize(render_command_sizes[command_header->type])) return false;
+		if(cursor + size > commands + header->command_size) return false;
+		cursor += size;
+
+		if(command_header->type == RENDER_COMMAND_FreeRenderResource) {
+			replay->freed_resources++;
+			continue;
+		}
+
+		CopyMem(out, command_header, size);
+		void* data = out + sizeof(RenderCommandHeader);
+		out += size;
+
+		switch(command_header->type) {
+
+			case RENDER_COMMAND_ClearRenderTarget: {
+				ClearRenderTarget* command = (ClearRenderTarget*)data;
+				command->render_target = GetReplayRenderTarget(replay, command->render_target);
+			} break;
+
+			case RENDER_COMMAND_ClearStencil: {
+				ClearStencil* command = (ClearStencil*)data;
+				command->depth_stencil = command->depth_stencil ? &renderer->depth_stencil : 0;
+			} break;
+
+			case RENDER_COMMAND_SetRenderTarget: {
+				SetRenderTarget* command = (SetRenderTarget*)data;
+				command->render_target = GetReplayRenderTarget(replay, command->render_target);
+			} break;
+
+			case RENDER_COMMAND_SetVertexShader: {
+				SetVertexShader* command = (SetVertexShader*)data;
+				command->vertex = (VertexShader*)GetReplayResource(replay, command->vertex, false);
+			} break;
+
+			case RENDER_COMMAND_SetPixelShader: {
+				SetPixelShader* command = (SetPixelShader*)data;
+				command->pixel = (PixelShader*)GetReplayResource(replay, command->pixel, false);
+			} break;
+
+			case RENDER_COMMAND_SetVertexBuffer: {
+				SetVertexBuffer* command = (SetVertexBuffer*)data;
+				command->vertex = (VertexBuffer*)GetReplayResource(replay, command->vertex, false);
+			} break;
+
+			case RENDER_COMMAND_SetIndexBuffer: {
+				SetIndexBuffer* command = (SetIndexBuffer*)data;
+				command->index = (IndexBuffer*)GetReplayResource(replay, command->index, false);
+			} break;
+
+			case RENDER_COMMAND_SetStructuredBuffer: {
+				SetStructuredBuffer* command = (SetStructuredBuffer*)data;
+				command->structured = (StructuredBuffer*)GetReplayResource(replay, command->structured, false);
+			} break;
+
+			case RENDER_COMMAND_SetConstantsBuffer: {
+				SetConstantsBuffer* command = (SetConstantsBuffer*)data;
+				command->constants = (ConstantsBuffer*)GetReplayResource(replay, command->constants, false);
+			} break;
+
+			case RENDER_COMMAND_SetTextureBuffer: {
+				SetTextureBuffer* command = (SetTextureBuffer*)data;
+				command->texture = GetReplayTexture(replay, command->texture);
+			} break;
+
+			case RENDER_COMMAND_PushRenderBufferData: {
+				PushRenderBufferData* command = (PushRenderBufferData*)data;
+				command->buffer = GetReplayResource(replay, command->buffer, true);
+				command->data = payload + (u64)command->data;
+			} break;
+
+			case RENDER_COMMAND_PushRenderConstants: {
+				PushRenderConstants* command = (PushRenderConstants*)data;
+				command->constants = (ConstantsBuffer*)GetReplayResource(replay, command->constants, false);
+				command->data = payload + (u64)command->data;
+			} break;
+
+			case RENDER_COMMAND_UpdateTextureRegion: {
+				UpdateTextureRegion* command = (UpdateTextureRegion*)data;
+				command->texture = GetReplayTexture(replay, command->texture);
+				command->data = payload + (u64)command->data;
+			} break;
+		}
+	}
+	replay->command_size = (u32)(out - replay->commands);
+
+	return cursor == commands + header->command_size;
+}
+
+// Runs the captured frame through the same path as RendererEndFrame
+static void
+ReplayRenderCapture(RenderCaptureReplay* replay) {
+	Renderer* renderer = replay->renderer;
+
+	RenderCommandBlock block = {};
+	block.base = replay->commands;
+	block.size = block.used = replay->command_size;
+	renderer->commands.first = renderer->commands.current = &block;
+
+	ExecuteRenderCommands(renderer);
+	PresentRenderer(renderer);
+
+	renderer->commands.first = renderer->commands.current = 0;
+	EndRenderStatsFrame(renderer);
+}
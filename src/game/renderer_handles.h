@@ -0,0 +1,20 @@
+// Backends without D3D headers. Device handles are only stored and compared by the front end,
+// so the cpu backends hand out their own resources behind the same pointer types.
+struct ID3D11Device;
+struct ID3D11DeviceContext;
+struct ID3D11DeviceContext1;
+struct IDXGISwapChain1;
+struct ID3D11Texture2D;
+struct ID3D11RenderTargetView;
+struct ID3D11ShaderResourceView;
+struct ID3D11DepthStencilView;
+struct ID3D11Buffer;
+struct ID3D11VertexShader;
+struct ID3D11InputLayout;
+struct ID3D11PixelShader;
+struct ID3D11SamplerState;
+struct ID3D11DepthStencilState;
+struct ID3D11BlendState;
+struct ID3D11RasterizerState;
+struct ID3D11Query;
+
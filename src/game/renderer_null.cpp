@@ -0,0 +1,411 @@
+// Null backend
+// Consumes the command stream without a device: every handle is checked against the virtual
+// resource it was created as, draws are checked against what is bound, and uploads are counted.
+
+#define NULL_RESOURCE_MAGIC 0x4c4c554e
+
+static NullResource*
+CreateNullResource(NULL_RESOURCE kind, u32 size, NullResource* parent, Renderer* renderer) {
+	NullResource* result = PushStructClear(renderer->permanent_arena, NullResource);
+	result->magic = NULL_RESOURCE_MAGIC;
+	result->kind = (u8)kind;
+	result->live = true;
+	result->size = size;
+	result->parent = parent;
+
+	renderer->null_device.resources_live++;
+	renderer->null_device.resource_bytes += size;
+	return result;
+}
+
+static NullResource*
+GetNullResource(void* handle, NULL_RESOURCE kind) {
+	NullResource* result = (NullResource*)handle;
+	Assert(result);
+	Assert(result->magic == NULL_RESOURCE_MAGIC);
+	Assert(result->live);
+	Assert(result->kind == kind);
+	if(result->parent) Assert(result->parent->live);
+	return result;
+}
+
+static void
+ReleaseNullResource(void* handle, Renderer* renderer) {
+	NullResource* resource = (NullResource*)handle;
+	Assert(resource->magic == NULL_RESOURCE_MAGIC);
+	Assert(resource->live);
+
+	resource->live = false;
+	renderer->null_device.resources_live--;
+	renderer->null_device.resource_bytes -= resource->size;
+}
+
+static NullResource*
+CreateNullTexture(u32 width, u32 height, u32 components, Renderer* renderer) {
+	NullResource* result = CreateNullResource(NULL_RESOURCE_Texture, width*height*components, 0, renderer);
+	result->width = width;
+	result->height = height;
+	result->components = components;
+	return result;
+}
+
+static void
+CreateNullBackbuffer(Renderer* renderer) {
+	NullResource* backbuffer = CreateNullTexture(renderer->window_dim.width, renderer->window_dim.height, 4, renderer);
+	renderer->backbuffer.texture = (ID3D11Texture2D*)backbuffer;
+	renderer->backbuffer.view = (ID3D11RenderTargetView*)CreateNullResource(NULL_RESOURCE_View, 0, backbuffer, renderer);
+	renderer->queue_stats.resources_created++;
+}
+
+static void
+CreateNullOffscreenTargets(Renderer* renderer) {
+	u32 width = renderer->target_dim.width;
+	u32 height = renderer->target_dim.height;
+
+	NullResource* depth = CreateNullTexture(width, height, 4, renderer);
+	renderer->depth_stencil.texture = (ID3D11Texture2D*)depth;
+	renderer->depth_stencil.view = (ID3D11DepthStencilView*)CreateNullResource(NULL_RESOURCE_View, 0, depth, renderer);
+
+	NullResource* readable = CreateNullTexture(width, height, 4, renderer);
+	ReadableRenderTarget* rrt = &renderer->readable_render_target;
+	rrt->texture = (ID3D11Texture2D*)readable;
+	rrt->render_target = (ID3D11RenderTargetView*)CreateNullResource(NULL_RESOURCE_View, 0, readable, renderer);
+	rrt->shader_resource = (ID3D11ShaderResourceView*)CreateNullResource(NULL_RESOURCE_View, 0, readable, renderer);
+
+	renderer->queue_stats.resources_created += 2;
+}
+
+static void
+ResizeBackendTargets(Renderer* renderer, bool offscreen) {
+	ReleaseNullResource(renderer->backbuffer.texture, renderer);
+	ReleaseNullResource(renderer->backbuffer.view, renderer);
+	CreateNullBackbuffer(renderer);
+	if(!offscreen) return;
+
+	ReleaseNullResource(renderer->depth_stencil.texture, renderer);
+	ReleaseNullResource(renderer->depth_stencil.view, renderer);
+	ReleaseNullResource(renderer->readable_render_target.texture, renderer);
+	ReleaseNullResource(renderer->readable_render_target.render_target, renderer);
+	ReleaseNullResource(renderer->readable_render_target.shader_resource, renderer);
+	CreateNullOffscreenTargets(renderer);
+}
+
+static void
+PresentBackend(Renderer* renderer) {
+	NullDevice* device = &renderer->null_device;
+	device->stats_last_frame = device->stats;
+	ZeroStruct(device->stats);
+
+	// The context forgets nothing between frames but the stream may not rely on it
+	device->render_target = 0;
+	ZeroArray(device->textures, ArrayCount(device->textures));
+	device->index_buffer = 0;
+	device->ps_constants = 0;
+	device->vs_bound = false;
+	device->ps_bound = false;
+}
+
+static void
+SignalBackendFence(Renderer* renderer, u64 fence) {
+	NullDevice* device = &renderer->null_device;
+	Assert(fence > device->fence_signaled);
+	device->fence_signaled = fence;
+	if(fence > device->fence_latency) device->fence_completed = Max(device->fence_completed, fence - device->fence_latency);
+}
+
+static u64
+GetBackendCompletedFence(Renderer* renderer) {
+	return renderer->null_device.fence_completed;
+}
+
+static void
+WaitBackendFence(Renderer* renderer, u64 fence) {
+	NullDevice* device = &renderer->null_device;
+	Assert(fence <= device->fence_signaled);
+	device->fence_completed = Max(device->fence_completed, fence);
+}
+
+// Ranges have to sit inside the ring on its alignment
+static void
+CheckNullConstants(ConstantsBuffer* constants, Renderer* renderer) {
+	NullResource* ring = GetNullResource(renderer->upload_ring_buffer, NULL_RESOURCE_Buffer);
+	Assert(constants->size && constants->size % UPLOAD_RING_ALIGNMENT == 0);
+	Assert(constants->offset % UPLOAD_RING_ALIGNMENT == 0);
+	Assert(constants->offset + constants->size <= ring->size);
+}
+
+// Aliased targets make this easy to get wrong, d3d11 would silently unbind the texture instead
+static void
+CheckNullFeedback(NullDevice* device) {
+	for(u32 i=0; i<ArrayCount(device->textures); i++) {
+		NullResource* texture = device->textures[i];
+		if(texture) Assert(texture->parent != device->render_target->parent);
+	}
+}
+
+static void
+CountNullDraw(NullDevice* device, u64 vertices) {
+	Assert(device->render_target && device->vs_bound && device->ps_bound);
+	CheckNullFeedback(device);
+
+	NullFrameStats* stats = &device->stats;
+	if(stats->draws < NULL_LOGGED_DRAWS) {
+		Vec4* logged = stats->ps_constants + stats->draws;
+		*logged = device->ps_constants ? *(Vec4*)device->ps_constants : V4Z();
+	}
+	stats->draws++;
+	stats->vertices += vertices;
+}
+
+static void
+ExecuteBackendCommand(RENDER_COMMAND type, void* data, Renderer* renderer) {
+	NullDevice* device = &renderer->null_device;
+	device->stats.commands++;
+
+	switch(type) {
+
+		case RENDER_COMMAND_ClearRenderTarget: {
+			ClearRenderTarget* command = (ClearRenderTarget*)data;
+			void* view = command->render_target ? (void*)command->render_target->view :
+				(void*)renderer->readable_render_target.render_target;
+			GetNullResource(view, NULL_RESOURCE_View);
+		} break;
+
+		case RENDER_COMMAND_ClearDepth:
+		case RENDER_COMMAND_ClearStencil: {
+			GetNullResource(renderer->depth_stencil.view, NULL_RESOURCE_View);
+		} break;
+
+		case RENDER_COMMAND_SetRenderTarget: {
+			SetRenderTarget* command = (SetRenderTarget*)data;
+			void* view = command->render_target ? (void*)command->render_target->view :
+				(void*)renderer->readable_render_target.render_target;
+			device->render_target = GetNullResource(view, NULL_RESOURCE_View);
+		} break;
+
+		case RENDER_COMMAND_SetDepthStencilState:
+		case RENDER_COMMAND_SetBlendState:
+		case RENDER_COMMAND_SetRasterizerState:
+		case RENDER_COMMAND_SetSamplerState:
+		case RENDER_COMMAND_SetPrimitiveTopology: break;
+
+		case RENDER_COMMAND_SetViewport: {
+			SetViewport* command = (SetViewport*)data;
+			Assert(command->dim.x > 0.0f && command->dim.y > 0.0f);
+		} break;
+
+		case RENDER_COMMAND_SetVertexShader: {
+			SetVertexShader* command = (SetVertexShader*)data;
+			GetNullResource(command->vertex->shader, NULL_RESOURCE_Shader);
+			device->vs_bound = true;
+		} break;
+
+		case RENDER_COMMAND_SetPixelShader: {
+			SetPixelShader* command = (SetPixelShader*)data;
+			GetNullResource(command->pixel->shader, NULL_RESOURCE_Shader);
+			device->ps_bound = true;
+		} break;
+
+		case RENDER_COMMAND_SetVertexBuffer: {
+			SetVertexBuffer* command = (SetVertexBuffer*)data;
+			NullResource* buffer = GetNullResource(command->vertex->buffer, NULL_RESOURCE_Buffer);
+			Assert(command->stride);
+			Assert(command->offset < buffer->size);
+		} break;
+
+		case RENDER_COMMAND_SetIndexBuffer: {
+			SetIndexBuffer* command = (SetIndexBuffer*)data;
+			device->index_buffer = GetNullResource(command->index->buffer, NULL_RESOURCE_Buffer);
+		} break;
+
+		case RENDER_COMMAND_SetStructuredBuffer: {
+			SetStructuredBuffer* command = (SetStructuredBuffer*)data;
+			GetNullResource(command->structured->view, NULL_RESOURCE_View);
+		} break;
+
+		case RENDER_COMMAND_SetTextureBuffer: {
+			SetTextureBuffer* command = (SetTextureBuffer*)data;
+			Assert(command->slot < ArrayCount(device->textures));
+			device->textures[command->slot] = command->texture ? GetNullResource(command->texture->view, NULL_RESOURCE_View) : 0;
+		} break;
+
+		case RENDER_COMMAND_SetConstantsBuffer: {
+			SetConstantsBuffer* command = (SetConstantsBuffer*)data;
+			CheckNullConstants(command->constants, renderer);
+			if(!command->vertex_shader && command->slot == 0) {
+				device->ps_constants = device->upload_ring_data + command->constants->offset;
+			}
+		} break;
+
+		case RENDER_COMMAND_PushRenderBufferData: {
+			PushRenderBufferData* command = (PushRenderBufferData*)data;
+			NullResource* buffer = GetNullResource(command->buffer, NULL_RESOURCE_Buffer);
+			Assert(command->size <= buffer->size);
+			Assert(command->data || !command->size);
+			device->stats.bytes_uploaded += command->size;
+		} break;
+
+		case RENDER_COMMAND_PushRenderConstants: {
+			PushRenderConstants* command = (PushRenderConstants*)data;
+			CheckNullConstants(command->constants, renderer);
+			Assert(command->size <= command->constants->size);
+			Assert(command->data || !command->size);
+			CopyMem(device->upload_ring_data + command->constants->offset, command->data, command->size);
+			device->stats.bytes_uploaded += command->size;
+		} break;
+
+		case RENDER_COMMAND_UpdateTextureRegion: {
+			UpdateTextureRegion* command = (UpdateTextureRegion*)data;
+			NullResource* texture = GetNullResource(command->texture->buffer, NULL_RESOURCE_Texture);
+			Assert(command->x + command->width <= texture->width);
+			Assert(command->y + command->height <= texture->height);
+			Assert(command->pitch >= command->width);
+			device->stats.bytes_uploaded += command->width*command->height*texture->components;
+		} break;
+
+		case RENDER_COMMAND_FreeRenderResource: {
+			FreeRenderResource* command = (FreeRenderResource*)data;
+			if(device->index_buffer == command->buffer) device->index_buffer = 0;
+			for(u32 i=0; i<ArrayCount(device->textures); i++)
+				if(device->textures[i] == command->buffer) device->textures[i] = 0;
+			ReleaseNullResource(command->buffer, renderer);
+		} break;
+
+		case RENDER_COMMAND_DrawVertices: {
+			DrawVertices* command = (DrawVertices*)data;
+			Assert(command->vertices_count);
+			CountNullDraw(device, command->vertices_count);
+		} break;
+
+		case RENDER_COMMAND_DrawIndexed: {
+			DrawIndexed* command = (DrawIndexed*)data;
+			Assert(device->index_buffer);
+			Assert((command->offset + command->indices_count)*sizeof(u32) <= device->index_buffer->size);
+			CountNullDraw(device, command->indices_count);
+		} break;
+
+		case RENDER_COMMAND_DrawInstanced: {
+			DrawInstanced* command = (DrawInstanced*)data;
+			Assert(command->vertices_count && command->instance_count);
+			CountNullDraw(device, (u64)command->vertices_count*command->instance_count);
+		} break;
+
+		case RENDER_COMMAND_DrawIndexedInstanced: {
+			DrawIndexedInstanced* command = (DrawIndexedInstanced*)data;
+			Assert(device->index_buffer);
+			Assert((command->offset + command->indices_count)*sizeof(u32) <= device->index_buffer->size);
+			Assert(command->instance_count);
+			CountNullDraw(device, (u64)command->indices_count*command->instance_count);
+		} break;
+
+		default: Assert(false);
+	}
+}
+
+static StructuredBuffer*
+UploadBackendStructuredBuffer(u32 struct_size, u32 count, Renderer* renderer) {
+	StructuredBuffer* sb = PushStruct(renderer->permanent_arena, StructuredBuffer);
+	renderer->queue_stats.resources_created++;
+
+	NullResource* buffer = CreateNullResource(NULL_RESOURCE_Buffer, struct_size*count, 0, renderer);
+	sb->buffer = (ID3D11Buffer*)buffer;
+	sb->view = (ID3D11ShaderResourceView*)CreateNullResource(NULL_RESOURCE_View, 0, buffer, renderer);
+	return sb;
+}
+
+static PixelShader*
+UploadBackendPixelShader(char* code, u32 length, char* entry, Renderer* renderer) {
+	PixelShader* ps = PushStruct(renderer->permanent_arena, PixelShader);
+	renderer->queue_stats.resources_created++;
+	Assert(code && entry);
+
+	ps->shader = (ID3D11PixelShader*)CreateNullResource(NULL_RESOURCE_Shader, length, 0, renderer);
+	ps->id = ++renderer->next_shader_id;
+	return ps;
+}
+
+static VertexShader*
+UploadBackendVertexShader(char* code, u32 length, char* entry, VERTEX_BUFFER* vertex_buffers, u8 count, Renderer* renderer) {
+	VertexShader* vs = PushStruct(renderer->permanent_arena, VertexShader);
+	renderer->queue_stats.resources_created++;
+	Assert(code && entry);
+	Assert(!vertex_buffers || count);
+
+	vs->shader = (ID3D11VertexShader*)CreateNullResource(NULL_RESOURCE_Shader, length, 0, renderer);
+	vs->il = 0;
+	vs->id = ++renderer->next_shader_id;
+	return vs;
+}
+
+static TextureBuffer*
+UploadBackendTexture(void* data, u32 width, u32 height, u8 num_components, TEXTURE_USAGE usage, Renderer* renderer) {
+	TextureBuffer* texture_buffer = PushStruct(renderer->permanent_arena, TextureBuffer);
+	renderer->queue_stats.resources_created++;
+	Assert(num_components == 1 || num_components == 4);
+	Assert(data || usage != TEXTURE_USAGE_Immutable);
+
+	NullResource* texture = CreateNullTexture(width, height, num_components, renderer);
+	texture_buffer->buffer = (ID3D11Texture2D*)texture;
+	texture_buffer->view = (ID3D11ShaderResourceView*)CreateNullResource(NULL_RESOURCE_View, 0, texture, renderer);
+	texture_buffer->id = ++renderer->next_texture_id;
+	return texture_buffer;
+}
+
+static ReadableRenderTarget*
+UploadBackendRenderTarget(u32 width, u32 height, Renderer* renderer) {
+	ReadableRenderTarget* result = PushStruct(renderer->permanent_arena, ReadableRenderTarget);
+	renderer->queue_stats.resources_created++;
+	Assert(width && height);
+
+	NullResource* texture = CreateNullTexture(width, height, 4, renderer);
+	result->texture = (ID3D11Texture2D*)texture;
+	result->render_target = (ID3D11RenderTargetView*)CreateNullResource(NULL_RESOURCE_View, 0, texture, renderer);
+	result->shader_resource = (ID3D11ShaderResourceView*)CreateNullResource(NULL_RESOURCE_View, 0, texture, renderer);
+	return result;
+}
+
+static IndexBuffer*
+UploadBackendIndexBuffer(void* data, u32 count, Renderer* renderer) {
+	IndexBuffer* index_buffer = PushStruct(renderer->permanent_arena, IndexBuffer);
+	renderer->queue_stats.resources_created++;
+	Assert(data);
+
+	index_buffer->buffer = (ID3D11Buffer*)CreateNullResource(NULL_RESOURCE_Buffer, sizeof(u32)*count, 0, renderer);
+	return index_buffer;
+}
+
+static VertexBuffer*
+UploadBackendVertexBuffer(void* initial_data, u32 num_vertices, u8 num_components, bool dynamic, Renderer* renderer) {
+	VertexBuffer* vb = PushStruct(renderer->permanent_arena, VertexBuffer);
+	renderer->queue_stats.resources_created++;
+	Assert(initial_data || dynamic);
+
+	u32 size = num_components*sizeof(float)*num_vertices;
+	vb->buffer = (ID3D11Buffer*)CreateNullResource(NULL_RESOURCE_Buffer, size, 0, renderer);
+	vb->id = ++renderer->next_mesh_id;
+	return vb;
+}
+
+static Renderer*
+InitRenderer(Win32Window* window, MemoryArena* parent_arena, MemoryArena* frame_arena) {
+	Renderer* renderer;
+	renderer = PushStructClear(parent_arena, Renderer);
+	renderer->permanent_arena = parent_arena;
+	renderer->frame_arena = frame_arena;
+	for(u32 i=0; i<RENDER_LIST_TOTAL; i++) InitRenderCommandList(renderer->lists + i, renderer);
+
+	renderer->window_dim = window->dim;
+	renderer->target_dim = window->dim;
+	renderer->render_dim = window->dim;
+	renderer->render_scale = 1.0f;
+	renderer->msaa_sample_count = 1;
+	CreateNullBackbuffer(renderer);
+	CreateNullOffscreenTargets(renderer);
+
+	InitUploadRing(&renderer->upload_ring, UPLOAD_RING_SIZE);
+	renderer->upload_ring_buffer = (ID3D11Buffer*)CreateNullResource(NULL_RESOURCE_Buffer, UPLOAD_RING_SIZE, 0, renderer);
+	renderer->null_device.upload_ring_data = (u8*)PushSize(parent_arena, UPLOAD_RING_SIZE);
+	renderer->null_device.fence_latency = 2;
+
+	return renderer;
+}
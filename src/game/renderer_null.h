@@ -0,0 +1,54 @@
+enum NULL_RESOURCE {
+	NULL_RESOURCE_Buffer,
+	NULL_RESOURCE_Texture,
+	NULL_RESOURCE_View,
+	NULL_RESOURCE_Shader,
+
+	NULL_RESOURCE_TOTAL
+};
+
+struct NullResource {
+	u32 magic;
+	u8 kind;
+	bool live;
+	u32 size;					// bytes
+	u32 width, height;			// textures
+	u32 components;
+	NullResource* parent;		// views point at what they view
+};
+
+#define NULL_LOGGED_DRAWS 16
+
+struct NullFrameStats {
+	u32 commands;				// commands that reached the backend after state filtering
+	u32 draws;
+	u64 vertices;				// vertices or indices times instances
+	u64 bytes_uploaded;
+
+	// Leading constants of pixel slot 0 at the first draws, what each pass really read
+	Vec4 ps_constants[NULL_LOGGED_DRAWS];
+};
+
+struct NullDevice {
+	NullFrameStats stats;
+	NullFrameStats stats_last_frame;
+
+	// Stands in for the gpu, a fence completes this many frames after it was signaled
+	u32 fence_latency;
+	u64 fence_signaled;
+	u64 fence_completed;
+
+	u32 resources_live;
+	u64 resource_bytes;
+
+	// Pushed constants land here, a draw sees whatever range was bound when it was set
+	u8* upload_ring_data;
+
+	// Only what draws are validated against
+	NullResource* render_target;
+	NullResource* textures[2];	// views, a draw may not sample what it renders to
+	NullResource* index_buffer;
+	u8* ps_constants;			// into upload_ring_data
+	bool vs_bound;
+	bool ps_bound;
+};
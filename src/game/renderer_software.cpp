@@ -0,0 +1,1513 @@
+// Software backend
+// Runs the command stream on the cpu. Draws are set up in parallel chunks and binned into screen
+// tiles, which are rasterized in parallel and flushed when something the pixels depend on changes.
+
+static SoftwareResource*
+CreateSoftwareResource(SOFTWARE_RESOURCE kind, u32 size, SoftwareResource* parent, Renderer* renderer) {
+	SoftwareResource* result = PushStructClear(renderer->permanent_arena, SoftwareResource);
+	result->kind = (u8)kind;
+	result->live = true;
+	result->size = size;
+	result->parent = parent;
+	if(size) result->data = (u8*)PushSizeClear(renderer->permanent_arena, size);
+	return result;
+}
+
+static SoftwareResource*
+GetSoftwareResource(void* handle, SOFTWARE_RESOURCE kind) {
+	SoftwareResource* result = (SoftwareResource*)handle;
+	Assert(result);
+	Assert(result->live);
+	Assert(result->kind == kind);
+	return result;
+}
+
+// Views resolve to the texture or buffer they were made for
+static SoftwareResource*
+GetSoftwareViewResource(void* handle) {
+	SoftwareResource* view = GetSoftwareResource(handle, SOFTWARE_RESOURCE_View);
+	Assert(view->parent && view->parent->live);
+	return view->parent;
+}
+
+static SoftwareResource*
+CreateSoftwareTexture(u32 width, u32 height, u32 components, Renderer* renderer) {
+	SoftwareResource* result = CreateSoftwareResource(SOFTWARE_RESOURCE_Texture, width*height*components, 0, renderer);
+	result->width = width;
+	result->height = height;
+	result->pitch = width;
+	result->components = (u8)components;
+	return result;
+}
+
+// Rows are padded to four pixels so a four wide group never leaves its tile
+static SoftwareResource*
+CreateSoftwareTarget(u32 width, u32 height, Renderer* renderer) {
+	SoftwareResource* result = PushStructClear(renderer->permanent_arena, SoftwareResource);
+	result->kind = SOFTWARE_RESOURCE_Texture;
+	result->live = true;
+	result->width = width;
+	result->height = height;
+	result->pitch = (width + 3) & ~3;
+	result->components = 4;
+	result->size = result->pitch*height*4;
+	result->block = platform_api.allocate_memory(result->size);
+	result->data = result->block->bp;
+	return result;
+}
+
+static void
+CreateSoftwareBackbuffer(Renderer* renderer) {
+	SoftwareResource* backbuffer = CreateSoftwareTarget(renderer->window_dim.width, renderer->window_dim.height, renderer);
+	renderer->backbuffer.texture = (ID3D11Texture2D*)backbuffer;
+	renderer->backbuffer.view = (ID3D11RenderTargetView*)CreateSoftwareResource(SOFTWARE_RESOURCE_View, 0, backbuffer, renderer);
+	renderer->queue_stats.resources_created++;
+}
+
+static void
+CreateSoftwareOffscreenTargets(Renderer* renderer) {
+	u32 width = renderer->target_dim.width;
+	u32 height = renderer->target_dim.height;
+	SoftwareDevice* device = &renderer->software_device;
+
+	device->depth = CreateSoftwareTarget(width, height, renderer);
+	renderer->depth_stencil.texture = (ID3D11Texture2D*)device->depth;
+	renderer->depth_stencil.view = (ID3D11DepthStencilView*)CreateSoftwareResource(SOFTWARE_RESOURCE_View, 0, device->depth, renderer);
+
+	SoftwareResource* readable = CreateSoftwareTarget(width, height, renderer);
+	ReadableRenderTarget* rrt = &renderer->readable_render_target;
+	rrt->texture = (ID3D11Texture2D*)readable;
+	rrt->render_target = (ID3D11RenderTargetView*)CreateSoftwareResource(SOFTWARE_RESOURCE_View, 0, readable, renderer);
+	rrt->shader_resource = (ID3D11ShaderResourceView*)CreateSoftwareResource(SOFTWARE_RESOURCE_View, 0, readable, renderer);
+
+	renderer->queue_stats.resources_created += 2;
+}
+
+static void
+ReleaseSoftwareTarget(void* texture) {
+	SoftwareResource* resource = (SoftwareResource*)texture;
+	resource->live = false;
+	platform_api.deallocate_memory(resource->block);
+	resource->block = 0;
+	resource->data = 0;
+}
+
+// RGBA8 with red in the low byte, like DXGI_FORMAT_R8G8B8A8_UNORM
+static u32
+PackSoftwareColor(Vec4 color) {
+	__m128 value = _mm_loadu_ps(&color.x);
+	value = _mm_min_ps(_mm_max_ps(value, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+	__m128i channels = _mm_cvtps_epi32(_mm_mul_ps(value, _mm_set1_ps(255.0f)));
+	channels = _mm_packus_epi32(channels, channels);
+	return (u32)_mm_cvtsi128_si32(_mm_packus_epi16(channels, channels));
+}
+
+static Vec4
+UnpackSoftwareColor(u32 color) {
+	__m128 value = _mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_cvtsi32_si128((i32)color)));
+	Vec4 result;
+	_mm_storeu_ps(&result.x, _mm_mul_ps(value, _mm_set1_ps(1.0f/255.0f)));
+	return result;
+}
+
+static Vec4
+LerpSoftwareV4(Vec4 a, float t, Vec4 b) {
+	return V4Add(a, V4MulF(V4Sub(b, a), t));
+}
+
+static Vec4
+LoadSoftwareTexel(SoftwareResource* texture, i32 x, i32 y) {
+	x = x < 0 ? 0 : (x >= (i32)texture->width ? (i32)texture->width - 1 : x);
+	y = y < 0 ? 0 : (y >= (i32)texture->height ? (i32)texture->height - 1 : y);
+
+	if(texture->components == 1) {
+		u8 r = texture->data[y*texture->pitch + x];
+		return V4((float)r*(1.0f/255.0f), 0.0f, 0.0f, 1.0f);
+	}
+	return UnpackSoftwareColor(((u32*)texture->data)[y*texture->pitch + x]);
+}
+
+// Clamp addressing like both samplers, unbound slots read zero like d3d
+static Vec4
+SampleSoftwareTexture(SoftwareResource* texture, u8 sampler, float u, float v) {
+	if(!texture) return V4(0.0f, 0.0f, 0.0f, 0.0f);
+
+	float x = u*(float)texture->width;
+	float y = v*(float)texture->height;
+	if(sampler == SAMPLER_STATE_Default) return LoadSoftwareTexel(texture, (i32)Floor(x), (i32)Floor(y));
+
+	x -= 0.5f;
+	y -= 0.5f;
+	float fx = Floor(x);
+	float fy = Floor(y);
+	float tx = x - fx;
+	float ty = y - fy;
+	i32 x0 = (i32)fx;
+	i32 y0 = (i32)fy;
+
+	Vec4 top = LerpSoftwareV4(LoadSoftwareTexel(texture, x0, y0), tx, LoadSoftwareTexel(texture, x0 + 1, y0));
+	Vec4 bottom = LerpSoftwareV4(LoadSoftwareTexel(texture, x0, y0 + 1), tx, LoadSoftwareTexel(texture, x0 + 1, y0 + 1));
+	return LerpSoftwareV4(top, ty, bottom);
+}
+
+static u32
+BlendSoftwareColor(u8 blend, Vec4 src, u32 dst_packed) {
+	if(blend == BLEND_STATE_NoBlend) return PackSoftwareColor(src);
+
+	Vec4 dst = UnpackSoftwareColor(dst_packed);
+	float src_factor = blend == BLEND_STATE_Regular ? src.w : 1.0f;
+	float dst_factor = 1.0f - src.w;
+
+	Vec4 result;
+	result.x = src.x*src_factor + dst.x*dst_factor;
+	result.y = src.y*src_factor + dst.y*dst_factor;
+	result.z = src.z*src_factor + dst.z*dst_factor;
+	result.w = src.w + dst.w;
+	return PackSoftwareColor(result);
+}
+
+// Kernels, one per shader in shader_code.h. Buffer layouts mirror the hlsl structs.
+
+struct SoftwareColoredQuad { Quad quad; Vec4 color; };
+struct SoftwareGlyph { Vec2 pos0, pos1; Vec2 uv0, uv1; Vec3 color; };
+struct SoftwareMeshInfo { Mat4 model; Vec4 color; };
+struct SoftwareLight { Vec3 position; float ambience; };
+struct SoftwareUIBuffer { Vec2 p0, p1; Vec4 color[4]; };
+struct SoftwareDebugPrimitive { Vec3 a; u32 color; Vec3 b; float thickness; };
+struct SoftwareDebugConstants { Mat4 view_proj; Vec2 half_size; };
+struct SoftwarePassConstants { Vec2 uv_scale; Vec2 resolution; };
+
+struct SoftwareVertex {
+	Vec4 position;
+	float varyings[SOFTWARE_MAX_VARYINGS];
+};
+
+global u8 software_varying_counts[SOFTWARE_SHADER_TOTAL] = {
+	0,		// None
+	2,		// TexturedQuad  uv
+	4,		// Quad          color
+	5,		// Text          uv, color
+	0,		// SDFText       pixel only
+	10,		// Mesh          world position, normal, color
+	2,		// FullScreenQuad uv
+	0,		// PostCopy      pixel only
+	0,		// PostEdge      pixel only
+	4,		// UI            color
+	4,		// DebugLine     color
+	4,		// DebugBox      color
+	4,		// DebugSphere   color
+};
+
+static void*
+GetSoftwareStructured(SoftwareDevice* device, u32 index, u32 stride) {
+	SoftwareResource* buffer = device->vs_structured;
+	Assert(buffer);
+	Assert((index + 1)*stride <= buffer->size);
+	return buffer->data + index*stride;
+}
+
+static Mat4*
+GetSoftwareCamera(SoftwareDevice* device) {
+	Assert(device->vs_constants[1]);
+	return (Mat4*)device->vs_constants[1];
+}
+
+static Vec3
+GetSoftwareVertexAttribute(SoftwareDevice* device, u32 slot, u32 vertex_id) {
+	SoftwareVertexBinding* binding = device->vertex_buffers + slot;
+	Assert(binding->buffer);
+	u32 offset = binding->offset + vertex_id*binding->stride;
+	Assert(offset + sizeof(Vec3) <= binding->buffer->size);
+	return *(Vec3*)(binding->buffer->data + offset);
+}
+
+#define SOFTWARE_DEBUG_SPHERE_SEGMENTS 16
+
+// Mirrors ExpandSegment in DebugDrawShader
+static void
+ExpandSoftwareDebugSegment(SoftwareDevice* device, Vec3 a, Vec3 b, SoftwareDebugPrimitive* primitive, u32 corner,
+		SoftwareVertex* out) {
+	u32 ends[6] = { 0, 0, 1, 1, 1, 0 };
+	float sides[6] = { -1.0f, 1.0f, 1.0f, 1.0f, -1.0f, -1.0f };
+	SoftwareDebugConstants* constants = (SoftwareDebugConstants*)device->vs_constants[1];
+	Assert(constants);
+
+	Vec4 p0 = M4MulV(constants->view_proj, V4FromV3(a, 1.0f));
+	Vec4 p1 = M4MulV(constants->view_proj, V4FromV3(b, 1.0f));
+
+	float near_w = 0.001f;
+	if(p0.w < near_w && p1.w >= near_w) p0 = V4Add(p0, V4MulF(V4Sub(p1, p0), (near_w - p0.w)/(p1.w - p0.w)));
+	if(p1.w < near_w && p0.w >= near_w) p1 = V4Add(p1, V4MulF(V4Sub(p0, p1), (near_w - p1.w)/(p0.w - p1.w)));
+
+	Vec2 dir = V2Mul(V2(p1.x/p1.w - p0.x/p0.w, p1.y/p1.w - p0.y/p0.w), constants->half_size);
+	float length = SquareRoot(V2Dot(dir, dir));
+	dir = length > 0.0f ? V2MulF(dir, 1.0f/length) : V2(1.0f, 0.0f);
+	Vec2 normal = V2(-dir.y, dir.x);
+
+	Vec4 position = ends[corner] ? p1 : p0;
+	float offset = sides[corner]*primitive->thickness*0.5f*position.w;
+	position.x += normal.x*offset/constants->half_size.x;
+	position.y += normal.y*offset/constants->half_size.y;
+
+	out->position = position;
+	u32 color = primitive->color;
+	out->varyings[0] = (float)(color & 0xff)/255.0f;
+	out->varyings[1] = (float)((color >> 8) & 0xff)/255.0f;
+	out->varyings[2] = (float)((color >> 16) & 0xff)/255.0f;
+	out->varyings[3] = (float)(color >> 24)/255.0f;
+}
+
+static Vec3
+GetSoftwareDebugBoxCorner(SoftwareDebugPrimitive* box, u32 corner) {
+	return V3(corner & 1 ? box->b.x : box->a.x, corner & 2 ? box->b.y : box->a.y, corner & 4 ? box->b.z : box->a.z);
+}
+
+static Vec3
+GetSoftwareDebugSpherePoint(SoftwareDebugPrimitive* sphere, u32 circle, u32 step) {
+	float angle = (float)step*6.28318530718f/SOFTWARE_DEBUG_SPHERE_SEGMENTS;
+	float c = Cos(angle)*sphere->b.x;
+	float s = Sin(angle)*sphere->b.x;
+	Vec3 offset = circle == 0 ? V3(c, s, 0.0f) : circle == 1 ? V3(c, 0.0f, s) : V3(0.0f, c, s);
+	return V3Add(sphere->a, offset);
+}
+
+static void
+RunSoftwareVertexShader(SoftwareDevice* device, u32 vertex_id, u32 instance_id, SoftwareVertex* out) {
+	switch(device->vs) {
+
+		case SOFTWARE_SHADER_TexturedQuad: {
+			Quad* quad = (Quad*)GetSoftwareStructured(device, instance_id, sizeof(Quad));
+			Vec3 corner = {};
+			float u = 0.0f, v = 0.0f;
+			if(vertex_id == 0) { corner = quad->bl; u = 0.0f; v = 1.0f; }
+			if(vertex_id == 1) { corner = quad->br; u = 1.0f; v = 1.0f; }
+			if(vertex_id == 2) { corner = quad->tl; u = 0.0f; v = 0.0f; }
+			if(vertex_id == 3) { corner = quad->tr; u = 1.0f; v = 0.0f; }
+
+			out->position = M4MulV(*GetSoftwareCamera(device), V4FromV3(corner, 1.0f));
+			out->varyings[0] = u;
+			out->varyings[1] = v;
+		} break;
+
+		case SOFTWARE_SHADER_Quad: {
+			SoftwareColoredQuad* quad = (SoftwareColoredQuad*)GetSoftwareStructured(device, vertex_id/6,
+					sizeof(SoftwareColoredQuad));
+			Vec3 corners[] = { quad->quad.tl, quad->quad.bl, quad->quad.br, quad->quad.br, quad->quad.tr, quad->quad.tl };
+
+			out->position = M4MulV(*GetSoftwareCamera(device), V4FromV3(corners[vertex_id % 6], 1.0f));
+			*(Vec4*)out->varyings = quad->color;
+		} break;
+
+		case SOFTWARE_SHADER_Text: {
+			SoftwareGlyph* glyph = (SoftwareGlyph*)GetSoftwareStructured(device, vertex_id/6, sizeof(SoftwareGlyph));
+			float left = glyph->pos0.x*2.0f - 1.0f;
+			float right = glyph->pos1.x*2.0f - 1.0f;
+			float top = 1.0f - glyph->pos0.y*2.0f;
+			float bottom = 1.0f - glyph->pos1.y*2.0f;
+
+			Vec2 position, uv;
+			switch(vertex_id % 6) {
+				case 0: case 5: position = V2(left, top);     uv = glyph->uv0; break;
+				case 1:         position = V2(left, bottom);  uv = V2(glyph->uv0.x, glyph->uv1.y); break;
+				case 2: case 3: position = V2(right, bottom); uv = glyph->uv1; break;
+				default:        position = V2(right, top);    uv = V2(glyph->uv1.x, glyph->uv0.y); break;
+			}
+
+			out->position = V4(position.x, position.y, 1.0f, 1.0f);
+			out->varyings[0] = uv.x;
+			out->varyings[1] = uv.y;
+			*(Vec3*)(out->varyings + 2) = glyph->color;
+		} break;
+
+		case SOFTWARE_SHADER_Mesh: {
+			SoftwareMeshInfo* info = (SoftwareMeshInfo*)GetSoftwareStructured(device, instance_id, sizeof(SoftwareMeshInfo));
+			Vec3 position = GetSoftwareVertexAttribute(device, 0, vertex_id);
+			Vec3 normal = GetSoftwareVertexAttribute(device, 1, vertex_id);
+
+			Vec4 world = M4MulV(info->model, V4FromV3(position, 1.0f));
+			Vec4 world_normal = M4MulV(info->model, V4FromV3(normal, 0.0f));
+
+			out->position = M4MulV(*GetSoftwareCamera(device), world);
+			*(Vec3*)(out->varyings + 0) = world.xyz;
+			*(Vec3*)(out->varyings + 3) = world_normal.xyz;
+			*(Vec4*)(out->varyings + 6) = info->color;
+		} break;
+
+		case SOFTWARE_SHADER_FullScreenQuad: {
+			SoftwarePassConstants* pass = (SoftwarePassConstants*)device->vs_constants[0];
+			Assert(pass);
+			float u = (float)((vertex_id << 1) & 2);
+			float v = (float)(vertex_id & 2);
+			out->position = V4(u*2.0f - 1.0f, v*-2.0f + 1.0f, 0.0f, 1.0f);
+			out->varyings[0] = u*pass->uv_scale.x;
+			out->varyings[1] = v*pass->uv_scale.y;
+		} break;
+
+		case SOFTWARE_SHADER_UI: {
+			Vec2 vertices[] = { V2(-1.0f, -1.0f), V2(-1.0f, 1.0f), V2(1.0f, -1.0f), V2(1.0f, 1.0f) };
+			SoftwareUIBuffer* ui = (SoftwareUIBuffer*)GetSoftwareStructured(device, instance_id, sizeof(SoftwareUIBuffer));
+
+			Vec2 half_size = V2MulF(V2Sub(ui->p1, ui->p0), 0.5f);
+			Vec2 center = V2MulF(V2Add(ui->p1, ui->p0), 0.5f);
+			Vec2 position = V2Add(V2Mul(vertices[vertex_id & 3], half_size), center);
+
+			out->position = V4(2.0f*position.x - 1.0f, 1.0f - 2.0f*position.y, 0.0f, 1.0f);
+			*(Vec4*)out->varyings = ui->color[vertex_id & 3];
+		} break;
+
+		case SOFTWARE_SHADER_DebugLine: {
+			SoftwareDebugPrimitive* line = (SoftwareDebugPrimitive*)GetSoftwareStructured(device, instance_id,
+					sizeof(SoftwareDebugPrimitive));
+			ExpandSoftwareDebugSegment(device, line->a, line->b, line, vertex_id, out);
+		} break;
+
+		case SOFTWARE_SHADER_DebugBox: {
+			u8 edges[12][2] = { { 0, 1 }, { 2, 3 }, { 4, 5 }, { 6, 7 }, { 0, 2 }, { 1, 3 },
+				{ 4, 6 }, { 5, 7 }, { 0, 4 }, { 1, 5 }, { 2, 6 }, { 3, 7 } };
+			SoftwareDebugPrimitive* box = (SoftwareDebugPrimitive*)GetSoftwareStructured(device, instance_id,
+					sizeof(SoftwareDebugPrimitive));
+			u8* edge = edges[vertex_id/6];
+			ExpandSoftwareDebugSegment(device, GetSoftwareDebugBoxCorner(box, edge[0]), GetSoftwareDebugBoxCorner(box, edge[1]),
+					box, vertex_id % 6, out);
+		} break;
+
+		case SOFTWARE_SHADER_DebugSphere: {
+			SoftwareDebugPrimitive* sphere = (SoftwareDebugPrimitive*)GetSoftwareStructured(device, instance_id,
+					sizeof(SoftwareDebugPrimitive));
+			u32 segment = vertex_id/6;
+			u32 circle = segment/SOFTWARE_DEBUG_SPHERE_SEGMENTS;
+			u32 step = segment % SOFTWARE_DEBUG_SPHERE_SEGMENTS;
+			ExpandSoftwareDebugSegment(device, GetSoftwareDebugSpherePoint(sphere, circle, step),
+					GetSoftwareDebugSpherePoint(sphere, circle, step + 1), sphere, vertex_id % 6, out);
+		} break;
+
+		default: Assert(false);
+	}
+}
+
+static float
+SoftwareSmoothstep(float edge0, float edge1, float x) {
+	if(edge1 <= edge0) return x >= edge0 ? 1.0f : 0.0f;
+	float t = Clamp(0.0f, (x - edge0)/(edge1 - edge0), 1.0f);
+	return t*t*(3.0f - 2.0f*t);
+}
+
+// Mirrors SampleSource in PostProcessShader
+static Vec4
+SampleSoftwarePassSource(SoftwareDraw* draw, float u, float v) {
+	SoftwarePassConstants* pass = (SoftwarePassConstants*)draw->constants[0];
+	u = Min(u, pass->uv_scale.x - 0.5f/pass->resolution.x);
+	v = Min(v, pass->uv_scale.y - 0.5f/pass->resolution.y);
+	return SampleSoftwareTexture(draw->texture, draw->sampler, u, v);
+}
+
+// ddx and ddy are the screen space derivatives of the varyings, only filled for kernels that use them
+static Vec4
+RunSoftwarePixelShader(SoftwareDraw* draw, float* varyings, float* ddx, float* ddy) {
+	switch(draw->ps) {
+
+		case SOFTWARE_SHADER_TexturedQuad: {
+			Vec4 sample = SampleSoftwareTexture(draw->texture, draw->sampler, varyings[0], varyings[1]);
+			return V4FromV3(sample.xyz, 1.0f);
+		}
+
+		case SOFTWARE_SHADER_PostCopy: {
+			Vec4 sample = SampleSoftwarePassSource(draw, varyings[0], varyings[1]);
+			return V4FromV3(sample.xyz, 1.0f);
+		}
+
+		case SOFTWARE_SHADER_Quad:
+		case SOFTWARE_SHADER_UI:
+		case SOFTWARE_SHADER_DebugLine: {
+			return *(Vec4*)varyings;
+		}
+
+		case SOFTWARE_SHADER_SDFText: {
+			float u = varyings[0], v = varyings[1];
+			float distance = SampleSoftwareTexture(draw->texture, draw->sampler, u, v).x;
+			float distance_x = SampleSoftwareTexture(draw->texture, draw->sampler, u + ddx[0], v + ddx[1]).x;
+			float distance_y = SampleSoftwareTexture(draw->texture, draw->sampler, u + ddy[0], v + ddy[1]).x;
+			float width = (Abs(distance_x - distance) + Abs(distance_y - distance))*0.5f;
+			float alpha = SoftwareSmoothstep(0.5f - width, 0.5f + width, distance);
+			return V4(varyings[2], varyings[3], varyings[4], alpha);
+		}
+
+		case SOFTWARE_SHADER_Mesh: {
+			SoftwareLight* light = (SoftwareLight*)draw->constants[1];
+			Vec3 position = *(Vec3*)(varyings + 0);
+			Vec3 normal = *(Vec3*)(varyings + 3);
+			Vec4 color = *(Vec4*)(varyings + 6);
+
+			Vec3 light_dir = V3Norm(V3Sub(position, light->position));
+			float cos = Max(0.0f, V3Dot(normal, light_dir));
+
+			// The hlsl swizzles ambient as rbg, kept so both backends match
+			Vec3 diffuse = V3MulF(color.xyz, cos);
+			Vec3 ambient = V3MulF(V3(color.x, color.z, color.y), light->ambience);
+			return V4FromV3(V3Add(ambient, diffuse), color.w);
+		}
+
+		case SOFTWARE_SHADER_PostEdge: {
+			SoftwarePassConstants* pass = (SoftwarePassConstants*)draw->constants[0];
+			float texel_x = 1.0f/pass->resolution.x;
+			float texel_y = 1.0f/pass->resolution.y;
+			float u = varyings[0], v = varyings[1];
+
+			float sobel_x[3][3] = { { -1.0f, 0.0f, 1.0f }, { -2.0f, 0.0f, 2.0f }, { -1.0f, 0.0f, 1.0f } };
+			float sobel_y[3][3] = { { -1.0f, -2.0f, -1.0f }, { 0.0f, 0.0f, 0.0f }, { 1.0f, 2.0f, 1.0f } };
+
+			Vec4 x_acc = {};
+			Vec4 y_acc = {};
+			for(i32 j=-1; j<=1; j++) {
+				for(i32 i=-1; i<=1; i++) {
+					if(i == 0 && j == 0) continue;
+					Vec4 sample = SampleSoftwarePassSource(draw, u + i*texel_x, v + j*texel_y);
+					x_acc = V4Add(x_acc, V4MulF(sample, sobel_x[j + 1][i + 1]));
+					y_acc = V4Add(y_acc, V4MulF(sample, sobel_y[j + 1][i + 1]));
+				}
+			}
+
+			return V4(SquareRoot(x_acc.x*x_acc.x + y_acc.x*y_acc.x), SquareRoot(x_acc.y*x_acc.y + y_acc.y*y_acc.y),
+					SquareRoot(x_acc.z*x_acc.z + y_acc.z*y_acc.z), SquareRoot(x_acc.w*x_acc.w + y_acc.w*y_acc.w));
+		}
+
+		default: Assert(false);
+	}
+	return V4(0.0f, 0.0f, 0.0f, 0.0f);
+}
+
+// Tiles
+
+// Edge functions of one triangle relative to the first pixel center of a tile. Edge e is
+// opposite vertex e, so its value over the area is that vertex's weight.
+struct SoftwareTileEdges {
+	float a[3], b[3];
+	float origin[3];
+	bool top_left[3];
+};
+
+static void
+SetupSoftwareTileEdges(SoftwareTriangle* tri, i32 tile_x0, i32 tile_y0, SoftwareTileEdges* edges) {
+	u8 edge_vertices[3][2] = { { 1, 2 }, { 2, 0 }, { 0, 1 } };
+	double origin_x = (double)tile_x0 + 0.5;
+	double origin_y = (double)tile_y0 + 0.5;
+
+	for(u32 e=0; e<3; e++) {
+		u32 va = edge_vertices[e][0];
+		u32 vb = edge_vertices[e][1];
+		float dx = tri->x[vb] - tri->x[va];
+		float dy = tri->y[vb] - tri->y[va];
+		edges->a[e] = -dy;
+		edges->b[e] = dx;
+
+		// Double keeps the constant exact for snapped positions anywhere in the guard band
+		double c = (double)dy*tri->x[va] - (double)dx*tri->y[va];
+		edges->origin[e] = (float)((double)edges->a[e]*origin_x + (double)edges->b[e]*origin_y + c);
+		edges->top_left[e] = dy < 0.0f || (dy == 0.0f && dx > 0.0f);
+	}
+}
+
+// Screen space derivatives of the varyings, only the sdf kernel needs them
+static void
+GetSoftwareDerivatives(SoftwareTriangle* tri, SoftwareDraw* draw, SoftwareTileEdges* edges, float* ddx, float* ddy) {
+	if(draw->ps != SOFTWARE_SHADER_SDFText) return;
+
+	for(u32 k=0; k<draw->varying_count; k++) {
+		ddx[k] = 0.0f;
+		ddy[k] = 0.0f;
+		for(u32 v=0; v<3; v++) {
+			float value = tri->varyings[v][k]/tri->inv_w[v];
+			ddx[k] += edges->a[v]*tri->inv_area*value;
+			ddy[k] += edges->b[v]*tri->inv_area*value;
+		}
+	}
+}
+
+// Coverage and depth for one triangle in one tile. Opaque triangles only leave their index in
+// ids and get shaded once the run ends, everything else is shaded and blended here.
+static u32
+RasterizeSoftwareTriangle(SoftwareDevice* device, u32 triangle_index, i32 tile_x0, i32 tile_y0, i32 tile_x1, i32 tile_y1, u32* ids) {
+	SoftwareTriangle* tri = device->triangles + triangle_index;
+	SoftwareDraw* draw = device->draws + tri->draw;
+	SoftwareResource* target = device->render_target;
+	u32 pitch = target->pitch;
+
+	i32 x0 = Max(tri->min_x, tile_x0);
+	i32 y0 = Max(tri->min_y, tile_y0);
+	i32 x1 = Min(tri->max_x, tile_x1);
+	i32 y1 = Min(tri->max_y, tile_y1);
+	if(x0 > x1 || y0 > y1) return 0;
+
+	SoftwareTileEdges edges;
+	SetupSoftwareTileEdges(tri, tile_x0, tile_y0, &edges);
+
+	float ddx[SOFTWARE_MAX_VARYINGS];
+	float ddy[SOFTWARE_MAX_VARYINGS];
+	if(!ids) GetSoftwareDerivatives(tri, draw, &edges, ddx, ddy);
+
+	__m128 lane_offsets = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+	__m128i lane_indices = _mm_setr_epi32(0, 1, 2, 3);
+	__m128 zero = _mm_setzero_ps();
+	__m128 one = _mm_set1_ps(1.0f);
+	__m128i range_min = _mm_set1_epi32(x0 - 1);
+	__m128i range_max = _mm_set1_epi32(x1 + 1);
+	__m128i id = _mm_set1_epi32((i32)triangle_index);
+	__m128 inv_area = _mm_set1_ps(tri->inv_area);
+
+	__m128 a[3], top_left[3];
+	for(u32 e=0; e<3; e++) {
+		a[e] = _mm_set1_ps(edges.a[e]);
+		top_left[e] = _mm_castsi128_ps(_mm_set1_epi32(edges.top_left[e] ? -1 : 0));
+	}
+
+	u32 shaded = 0;
+	for(i32 y=y0; y<=y1; y++) {
+		float local_y = (float)(y - tile_y0);
+		float row_values[3];
+		__m128 row[3];
+		for(u32 e=0; e<3; e++) {
+			row_values[e] = edges.origin[e] + edges.b[e]*local_y;
+			row[e] = _mm_set1_ps(row_values[e]);
+		}
+
+		// Where the row crosses the edges, padded a pixel so rounding never drops coverage.
+		// The masks below decide the exact pixels.
+		float span_min = (float)(x0 - tile_x0);
+		float span_max = (float)(x1 - tile_x0);
+		for(u32 e=0; e<3; e++) {
+			if(edges.a[e] > 0.0f) span_min = Max(span_min, -row_values[e]/edges.a[e] - 1.0f);
+			else if(edges.a[e] < 0.0f) span_max = Min(span_max, -row_values[e]/edges.a[e] + 1.0f);
+			else if(row_values[e] < 0.0f) span_max = -1.0f;
+		}
+		if(span_min > span_max) continue;
+		i32 row_x0 = tile_x0 + (i32)span_min;
+		i32 row_x1 = tile_x0 + (i32)span_max;
+
+		u32* color_row = (u32*)target->data + y*pitch;
+		float* depth_row = (float*)device->depth->data + y*device->depth->pitch;
+		u32* id_row = ids ? ids + (y - tile_y0)*SOFTWARE_TILE_SIZE - tile_x0 : 0;
+
+		for(i32 x=(row_x0 & ~3); x<=row_x1; x+=4) {
+			__m128 local_x = _mm_add_ps(_mm_set1_ps((float)(x - tile_x0)), lane_offsets);
+			__m128i xs = _mm_add_epi32(_mm_set1_epi32(x), lane_indices);
+			__m128 mask = _mm_castsi128_ps(_mm_and_si128(_mm_cmpgt_epi32(xs, range_min), _mm_cmplt_epi32(xs, range_max)));
+
+			__m128 values[3];
+			for(u32 e=0; e<3; e++) {
+				values[e] = _mm_add_ps(row[e], _mm_mul_ps(a[e], local_x));
+				__m128 inside = _mm_or_ps(_mm_cmpgt_ps(values[e], zero), _mm_and_ps(_mm_cmpeq_ps(values[e], zero), top_left[e]));
+				mask = _mm_and_ps(mask, inside);
+			}
+			if(!_mm_movemask_ps(mask)) continue;
+
+			__m128 w0 = _mm_mul_ps(values[0], inv_area);
+			__m128 w1 = _mm_mul_ps(values[1], inv_area);
+			__m128 w2 = _mm_mul_ps(values[2], inv_area);
+
+			__m128 z = _mm_add_ps(_mm_add_ps(_mm_mul_ps(w0, _mm_set1_ps(tri->z[0])),
+						_mm_mul_ps(w1, _mm_set1_ps(tri->z[1]))), _mm_mul_ps(w2, _mm_set1_ps(tri->z[2])));
+			__m128 stored = _mm_loadu_ps(depth_row + x);
+			mask = _mm_and_ps(mask, _mm_cmple_ps(z, stored));
+			i32 lanes = _mm_movemask_ps(mask);
+			if(!lanes) continue;
+			_mm_storeu_ps(depth_row + x, _mm_blendv_ps(stored, z, mask));
+
+			if(ids) {
+				__m128i previous = _mm_loadu_si128((__m128i*)(id_row + x));
+				_mm_storeu_si128((__m128i*)(id_row + x), _mm_castps_si128(_mm_blendv_ps(_mm_castsi128_ps(previous), _mm_castsi128_ps(id), mask)));
+				continue;
+			}
+
+			__m128 inv_w = _mm_add_ps(_mm_add_ps(_mm_mul_ps(w0, _mm_set1_ps(tri->inv_w[0])),
+						_mm_mul_ps(w1, _mm_set1_ps(tri->inv_w[1]))), _mm_mul_ps(w2, _mm_set1_ps(tri->inv_w[2])));
+			__m128 w = _mm_div_ps(one, inv_w);
+
+			float varyings[SOFTWARE_MAX_VARYINGS][4];
+			for(u32 k=0; k<draw->varying_count; k++) {
+				__m128 value = _mm_add_ps(_mm_add_ps(_mm_mul_ps(w0, _mm_set1_ps(tri->varyings[0][k])),
+							_mm_mul_ps(w1, _mm_set1_ps(tri->varyings[1][k]))), _mm_mul_ps(w2, _mm_set1_ps(tri->varyings[2][k])));
+				_mm_storeu_ps(varyings[k], _mm_mul_ps(value, w));
+			}
+
+			for(u32 lane=0; lane<4; lane++) {
+				if(!(lanes & (1 << lane))) continue;
+
+				float pixel_varyings[SOFTWARE_MAX_VARYINGS];
+				for(u32 k=0; k<draw->varying_count; k++) pixel_varyings[k] = varyings[k][lane];
+
+				Vec4 color = RunSoftwarePixelShader(draw, pixel_varyings, ddx, ddy);
+				color_row[x + lane] = BlendSoftwareColor(draw->blend, color, color_row[x + lane]);
+				shaded++;
+			}
+		}
+	}
+
+	return shaded;
+}
+
+// Shades what the opaque run left visible, once per pixel
+static u32
+ResolveSoftwareTile(SoftwareDevice* device, i32 tile_x0, i32 tile_y0, i32 tile_x1, i32 tile_y1, u32* ids) {
+	SoftwareResource* target = device->render_target;
+	u32 shaded = 0;
+
+	u32 current = U32Max;
+	SoftwareTriangle* tri = 0;
+	SoftwareDraw* draw = 0;
+	SoftwareTileEdges edges;
+	float ddx[SOFTWARE_MAX_VARYINGS];
+	float ddy[SOFTWARE_MAX_VARYINGS];
+
+	for(i32 y=tile_y0; y<=tile_y1; y++) {
+		u32* id_row = ids + (y - tile_y0)*SOFTWARE_TILE_SIZE;
+		u32* color_row = (u32*)target->data + y*target->pitch;
+		float local_y = (float)(y - tile_y0);
+
+		for(i32 x=tile_x0; x<=tile_x1; x++) {
+			u32 id = id_row[x - tile_x0];
+			if(id == U32Max) continue;
+			id_row[x - tile_x0] = U32Max;
+
+			if(id != current) {
+				current = id;
+				tri = device->triangles + id;
+				draw = device->draws + tri->draw;
+				SetupSoftwareTileEdges(tri, tile_x0, tile_y0, &edges);
+				GetSoftwareDerivatives(tri, draw, &edges, ddx, ddy);
+			}
+
+			float local_x = (float)(x - tile_x0);
+			float weights[3];
+			float inv_w = 0.0f;
+			for(u32 v=0; v<3; v++) {
+				weights[v] = (edges.origin[v] + edges.a[v]*local_x + edges.b[v]*local_y)*tri->inv_area;
+				inv_w += weights[v]*tri->inv_w[v];
+			}
+
+			float w = 1.0f/inv_w;
+			float varyings[SOFTWARE_MAX_VARYINGS];
+			for(u32 k=0; k<draw->varying_count; k++)
+				varyings[k] = (weights[0]*tri->varyings[0][k] + weights[1]*tri->varyings[1][k] + weights[2]*tri->varyings[2][k])*w;
+
+			color_row[x] = PackSoftwareColor(RunSoftwarePixelShader(draw, varyings, ddx, ddy));
+			shaded++;
+		}
+	}
+
+	return shaded;
+}
+
+// Triangles run in submission order. Consecutive opaque ones share a visibility buffer, so
+// overdraw inside the run costs coverage and depth but not shading.
+static u32
+RasterizeSoftwareTile(SoftwareDevice* device, u32 tile) {
+	SoftwareResource* target = device->render_target;
+	i32 tile_x0 = (i32)(tile % device->tiles_x)*SOFTWARE_TILE_SIZE;
+	i32 tile_y0 = (i32)(tile / device->tiles_x)*SOFTWARE_TILE_SIZE;
+	i32 tile_x1 = Min(tile_x0 + SOFTWARE_TILE_SIZE, (i32)target->width) - 1;
+	i32 tile_y1 = Min(tile_y0 + SOFTWARE_TILE_SIZE, (i32)target->height) - 1;
+
+	u32 ids[SOFTWARE_TILE_SIZE*SOFTWARE_TILE_SIZE];
+	for(u32 i=0; i<ArrayCount(ids); i++) ids[i] = U32Max;
+	bool pending = false;
+
+	u32 shaded = 0;
+	for(u32 i=device->tile_offsets[tile]; i<device->tile_offsets[tile + 1]; i++) {
+		u32 triangle_index = device->tile_triangles[i];
+		bool opaque = device->triangles[triangle_index].opaque;
+		if(!opaque && pending) {
+			shaded += ResolveSoftwareTile(device, tile_x0, tile_y0, tile_x1, tile_y1, ids);
+			pending = false;
+		}
+
+		shaded += RasterizeSoftwareTriangle(device, triangle_index, tile_x0, tile_y0, tile_x1, tile_y1, opaque ? ids : 0);
+		pending |= opaque;
+	}
+
+	if(pending) shaded += ResolveSoftwareTile(device, tile_x0, tile_y0, tile_x1, tile_y1, ids);
+	return shaded;
+}
+
+static PLATFORM_WORK_QUEUE_CALLBACK(DoSoftwareTileWork) {
+	SoftwareDevice* device = (SoftwareDevice*)data;
+	u32 tile_count = device->tiles_x*device->tiles_y;
+
+	for(;;) {
+		u32 tile = AtomicAddU32(&device->next_tile, 1);
+		if(tile >= tile_count) break;
+
+		u32 shaded = RasterizeSoftwareTile(device, tile);
+		if(shaded) AtomicAddU32(&device->stats.pixels_shaded, shaded);
+	}
+}
+
+static void
+FlushSoftwareTiles(Renderer* renderer) {
+	SoftwareDevice* device = &renderer->software_device;
+	if(!device->triangle_count) {
+		device->draw_count = 0;
+		return;
+	}
+
+	u64 start = __rdtsc();
+	SoftwareResource* target = device->render_target;
+	device->tiles_x = (target->width + SOFTWARE_TILE_SIZE - 1)/SOFTWARE_TILE_SIZE;
+	device->tiles_y = (target->height + SOFTWARE_TILE_SIZE - 1)/SOFTWARE_TILE_SIZE;
+	u32 tile_count = device->tiles_x*device->tiles_y;
+
+	// Count, prefix sum, fill. Triangles go in submission order so tiles blend in order.
+	u32* offsets = PushArrayClear(&device->arena, u32, tile_count + 1);
+	for(u32 i=0; i<device->triangle_count; i++) {
+		SoftwareTriangle* tri = device->triangles + i;
+		for(i32 ty=tri->min_y/SOFTWARE_TILE_SIZE; ty<=tri->max_y/SOFTWARE_TILE_SIZE; ty++)
+			for(i32 tx=tri->min_x/SOFTWARE_TILE_SIZE; tx<=tri->max_x/SOFTWARE_TILE_SIZE; tx++)
+				offsets[ty*device->tiles_x + tx + 1]++;
+	}
+	for(u32 i=0; i<tile_count; i++) offsets[i + 1] += offsets[i];
+
+	u32 entries = offsets[tile_count];
+	u32* tile_triangles = PushArray(&device->arena, u32, entries);
+	u32* cursors = PushArray(&device->arena, u32, tile_count);
+	for(u32 i=0; i<tile_count; i++) cursors[i] = offsets[i];
+
+	for(u32 i=0; i<device->triangle_count; i++) {
+		SoftwareTriangle* tri = device->triangles + i;
+		for(i32 ty=tri->min_y/SOFTWARE_TILE_SIZE; ty<=tri->max_y/SOFTWARE_TILE_SIZE; ty++)
+			for(i32 tx=tri->min_x/SOFTWARE_TILE_SIZE; tx<=tri->max_x/SOFTWARE_TILE_SIZE; tx++)
+				tile_triangles[cursors[ty*device->tiles_x + tx]++] = i;
+	}
+
+	device->tile_offsets = offsets;
+	device->tile_triangles = tile_triangles;
+	device->next_tile = 0;
+
+	if(renderer->work_queue) {
+		for(u32 i=0; i<renderer->worker_count + 1; i++)
+			platform_api.add_work_entry(renderer->work_queue, DoSoftwareTileWork, device);
+		platform_api.complete_all_work(renderer->work_queue);
+	}
+	else DoSoftwareTileWork(0, device);
+
+	device->stats.flushes++;
+	device->stats.bin_entries += entries;
+	device->stats.tile_cycles += __rdtsc() - start;
+	device->triangle_count = 0;
+	device->draw_count = 0;
+
+	EndTemporaryMemory(&device->arena_temp);
+	device->arena_temp = BeginTemporaryMemory(&device->arena);
+}
+
+// Geometry
+
+// Blending with a source alpha of exactly one gives back the source, so those triangles can
+// skip shading what later triangles cover. Alpha is known up front for the constant kernels
+// and for the ones that pass it through from the vertices.
+static bool
+IsSoftwareTriangleOpaque(SoftwareDraw* draw, SoftwareVertex** vertices) {
+	if(draw->blend == BLEND_STATE_NoBlend) return true;
+
+	u32 alpha_varying;
+	switch(draw->ps) {
+		case SOFTWARE_SHADER_TexturedQuad:
+		case SOFTWARE_SHADER_PostCopy: return true;
+		case SOFTWARE_SHADER_Quad:
+		case SOFTWARE_SHADER_UI:
+		case SOFTWARE_SHADER_DebugLine: alpha_varying = 3; break;
+		case SOFTWARE_SHADER_Mesh: alpha_varying = 9; break;
+		default: return false;
+	}
+
+	for(u32 i=0; i<3; i++) {
+		if(vertices[i]->varyings[alpha_varying] != 1.0f) return false;
+	}
+	return true;
+}
+
+// What every chunk of one draw reads. The draw is a copy, a flush while appending can move it.
+struct SoftwareGeometry {
+	SoftwareDevice* device;
+	SoftwareDraw draw;
+	u32* indices;				// 0 when not indexed
+	u32 first;
+	u32 count;					// vertices per instance
+	bool strip;
+	u32 instance_triangles;
+};
+
+// A range of the draw's triangles, instance major, set up into its own slice of staged_triangles
+struct SoftwareGeometryChunk {
+	SoftwareGeometry* geometry;
+	u32 first_triangle;
+	u32 end_triangle;
+	u32 stopped;				// the first one that did not fit, end_triangle when all did
+	u32 culled;
+	SoftwareTriangle* triangles;
+	u32 triangle_count;
+	u32 max_triangles;
+};
+
+// A triangle clipped against all seven planes is a polygon of at most ten vertices
+#define SOFTWARE_MAX_CLIPPED_TRIANGLES 8
+
+static void
+SetupSoftwareTriangle(SoftwareGeometryChunk* chunk, SoftwareVertex* v0, SoftwareVertex* v1, SoftwareVertex* v2) {
+	SoftwareDevice* device = chunk->geometry->device;
+	SoftwareDraw* draw = &chunk->geometry->draw;
+	SoftwareResource* target = device->render_target;
+	SoftwareVertex* vertices[3] = { v0, v1, v2 };
+
+	float x[3], y[3], z[3], inv_w[3];
+	for(u32 i=0; i<3; i++) {
+		Vec4 p = vertices[i]->position;
+		inv_w[i] = 1.0f/p.w;
+		float ndc_x = p.x*inv_w[i];
+		float ndc_y = p.y*inv_w[i];
+		float ndc_z = p.z*inv_w[i];
+
+		float screen_x = device->viewport_x + (ndc_x*0.5f + 0.5f)*device->viewport_width;
+		float screen_y = device->viewport_y + (0.5f - ndc_y*0.5f)*device->viewport_height;
+		x[i] = Floor(screen_x*16.0f + 0.5f)*(1.0f/16.0f);
+		y[i] = Floor(screen_y*16.0f + 0.5f)*(1.0f/16.0f);
+		z[i] = device->viewport_min_depth + ndc_z*(device->viewport_max_depth - device->viewport_min_depth);
+	}
+
+	// Positive area is clockwise on screen, the back face for every rasterizer state that culls
+	float area = (x[1] - x[0])*(y[2] - y[0]) - (x[2] - x[0])*(y[1] - y[0]);
+	if(area == 0.0f) return;
+	if(area > 0.0f && device->rasterizer != RASTERIZER_STATE_DoubleSided) {
+		chunk->culled++;
+		return;
+	}
+
+	u32 order[3] = { 0, 1, 2 };
+	if(area < 0.0f) {
+		order[1] = 2;
+		order[2] = 1;
+		area = -area;
+	}
+
+	float min_x = Min(x[0], Min(x[1], x[2]));
+	float min_y = Min(y[0], Min(y[1], y[2]));
+	float max_x = Max(x[0], Max(x[1], x[2]));
+	float max_y = Max(y[0], Max(y[1], y[2]));
+
+	// Pixel centers are at half coordinates
+	i32 bound_x0 = Max((i32)Ceil(min_x - 0.5f), Max((i32)device->viewport_x, 0));
+	i32 bound_y0 = Max((i32)Ceil(min_y - 0.5f), Max((i32)device->viewport_y, 0));
+	i32 bound_x1 = Min((i32)Floor(max_x - 0.5f), Min((i32)(device->viewport_x + device->viewport_width), (i32)target->width) - 1);
+	i32 bound_y1 = Min((i32)Floor(max_y - 0.5f), Min((i32)(device->viewport_y + device->viewport_height), (i32)target->height) - 1);
+	if(bound_x0 > bound_x1 || bound_y0 > bound_y1) return;
+
+	Assert(chunk->triangle_count < chunk->max_triangles);
+	SoftwareTriangle* tri = chunk->triangles + chunk->triangle_count++;
+	for(u32 i=0; i<3; i++) {
+		u32 from = order[i];
+		tri->x[i] = x[from];
+		tri->y[i] = y[from];
+		tri->z[i] = z[from];
+		tri->inv_w[i] = inv_w[from];
+		for(u32 k=0; k<draw->varying_count; k++) tri->varyings[i][k] = vertices[from]->varyings[k]*inv_w[from];
+	}
+	tri->inv_area = 1.0f/area;
+	tri->min_x = bound_x0;
+	tri->min_y = bound_y0;
+	tri->max_x = bound_x1;
+	tri->max_y = bound_y1;
+	tri->opaque = IsSoftwareTriangleOpaque(draw, vertices);
+}
+
+// Near w, the guard band and, when the rasterizer clips depth, 0 <= z <= w
+static float
+GetSoftwareClipDistance(SoftwareVertex* vertex, u32 plane, float guard_x, float guard_y) {
+	Vec4 p = vertex->position;
+	switch(plane) {
+		case 0: return p.w - 0.00001f;
+		case 1: return guard_x*p.w - p.x;
+		case 2: return guard_x*p.w + p.x;
+		case 3: return guard_y*p.w - p.y;
+		case 4: return guard_y*p.w + p.y;
+		case 5: return p.z;
+		default: return p.w - p.z;
+	}
+}
+
+static void
+ClipSoftwareTriangle(SoftwareGeometryChunk* chunk, SoftwareVertex* v0, SoftwareVertex* v1, SoftwareVertex* v2) {
+	SoftwareDevice* device = chunk->geometry->device;
+	float guard_x = 1.0f + SOFTWARE_GUARD_BAND*2.0f/device->viewport_width;
+	float guard_y = 1.0f + SOFTWARE_GUARD_BAND*2.0f/device->viewport_height;
+
+	// Double sided states are made with a zeroed desc in the d3d11 backend, which turns depth clip off
+	u32 plane_count = device->rasterizer == RASTERIZER_STATE_DoubleSided ? 5 : 7;
+
+	bool inside = true;
+	for(u32 plane=0; plane<plane_count; plane++) {
+		float d0 = GetSoftwareClipDistance(v0, plane, guard_x, guard_y);
+		float d1 = GetSoftwareClipDistance(v1, plane, guard_x, guard_y);
+		float d2 = GetSoftwareClipDistance(v2, plane, guard_x, guard_y);
+		if(d0 < 0.0f && d1 < 0.0f && d2 < 0.0f) return;
+		if(d0 < 0.0f || d1 < 0.0f || d2 < 0.0f) inside = false;
+	}
+
+	if(inside) {
+		SetupSoftwareTriangle(chunk, v0, v1, v2);
+		return;
+	}
+
+	u32 varying_count = chunk->geometry->draw.varying_count;
+	SoftwareVertex polygons[2][16];
+	u32 count = 3;
+	polygons[0][0] = *v0;
+	polygons[0][1] = *v1;
+	polygons[0][2] = *v2;
+
+	u32 current = 0;
+	for(u32 plane=0; plane<plane_count && count; plane++) {
+		SoftwareVertex* in = polygons[current];
+		SoftwareVertex* out = polygons[current ^ 1];
+		u32 out_count = 0;
+
+		for(u32 i=0; i<count; i++) {
+			SoftwareVertex* a = in + i;
+			SoftwareVertex* b = in + (i + 1) % count;
+			float da = GetSoftwareClipDistance(a, plane, guard_x, guard_y);
+			float db = GetSoftwareClipDistance(b, plane, guard_x, guard_y);
+
+			if(da >= 0.0f) out[out_count++] = *a;
+			if((da >= 0.0f) != (db >= 0.0f)) {
+				float t = da/(da - db);
+				SoftwareVertex* clipped = out + out_count++;
+				clipped->position = LerpSoftwareV4(a->position, t, b->position);
+				for(u32 k=0; k<varying_count; k++)
+					clipped->varyings[k] = a->varyings[k] + (b->varyings[k] - a->varyings[k])*t;
+			}
+		}
+
+		count = out_count;
+		current ^= 1;
+	}
+
+	for(u32 i=2; i<count; i++)
+		SetupSoftwareTriangle(chunk, polygons[current], polygons[current] + i - 1, polygons[current] + i);
+}
+
+#define SOFTWARE_VERTEX_CACHE_SIZE 64
+
+// Vertex kernels, clipping and setup for the chunk's triangles. Stops before a triangle that might
+// not fit, the draw picks up from there.
+static PLATFORM_WORK_QUEUE_CALLBACK(DoSoftwareGeometryWork) {
+	SoftwareGeometryChunk* chunk = (SoftwareGeometryChunk*)data;
+	SoftwareGeometry* geometry = chunk->geometry;
+
+	// Direct mapped, indexed meshes mostly reuse vertices within an instance and strips share two
+	// with the triangle before
+	SoftwareVertex cache[SOFTWARE_VERTEX_CACHE_SIZE];
+	u32 cache_tags[SOFTWARE_VERTEX_CACHE_SIZE];
+	u32 cached_instance = U32Max;
+
+	chunk->stopped = chunk->end_triangle;
+	for(u32 triangle=chunk->first_triangle; triangle<chunk->end_triangle; triangle++) {
+		if(chunk->triangle_count + SOFTWARE_MAX_CLIPPED_TRIANGLES > chunk->max_triangles) {
+			chunk->stopped = triangle;
+			break;
+		}
+
+		u32 instance = triangle / geometry->instance_triangles;
+		u32 in_instance = triangle % geometry->instance_triangles;
+		if(instance != cached_instance) {
+			for(u32 i=0; i<SOFTWARE_VERTEX_CACHE_SIZE; i++) cache_tags[i] = U32Max;
+			cached_instance = instance;
+		}
+
+		// Odd strip triangles swap their first two vertices to keep the winding
+		u32 first_vertex = geometry->strip ? in_instance : in_instance*3;
+		u32 corners[3] = { 0, 1, 2 };
+		if(geometry->strip && (in_instance & 1)) {
+			corners[0] = 1;
+			corners[1] = 0;
+		}
+
+		SoftwareVertex vertices[3];
+		for(u32 i=0; i<3; i++) {
+			u32 index = first_vertex + corners[i];
+			u32 vertex_id = geometry->indices ? geometry->indices[index] : geometry->first + index;
+			u32 slot = vertex_id % SOFTWARE_VERTEX_CACHE_SIZE;
+			if(cache_tags[slot] != vertex_id) {
+				RunSoftwareVertexShader(geometry->device, vertex_id, instance, cache + slot);
+				cache_tags[slot] = vertex_id;
+			}
+			vertices[i] = cache[slot];
+		}
+		ClipSoftwareTriangle(chunk, vertices + 0, vertices + 1, vertices + 2);
+	}
+}
+
+// Copies what the chunk set up behind the binned triangles, flushing when they are full
+static void
+AppendSoftwareTriangles(Renderer* renderer, SoftwareGeometryChunk* chunk) {
+	SoftwareDevice* device = &renderer->software_device;
+	for(u32 i=0; i<chunk->triangle_count; i++) {
+		if(device->triangle_count == SOFTWARE_MAX_TRIANGLES) {
+			SoftwareDraw draw = device->draws[device->draw_count - 1];
+			FlushSoftwareTiles(renderer);
+			device->draws[device->draw_count++] = draw;
+		}
+
+		SoftwareTriangle* tri = device->triangles + device->triangle_count++;
+		*tri = chunk->triangles[i];
+		tri->draw = (u16)(device->draw_count - 1);
+	}
+	device->stats.triangles += chunk->triangle_count;
+	device->stats.triangles_culled += chunk->culled;
+}
+
+static void
+DrawSoftware(Renderer* renderer, u32 count, u32 instance_count, u32 first, bool indexed) {
+	SoftwareDevice* device = &renderer->software_device;
+	Assert(device->render_target && device->vs && device->ps);
+	// Like d3d11, a smaller target uses the top left of the depth buffer
+	Assert(device->render_target->width <= device->depth->width && device->render_target->height <= device->depth->height);
+	device->stats.draws++;
+
+	if(device->draw_count == SOFTWARE_MAX_DRAWS) FlushSoftwareTiles(renderer);
+
+	SoftwareDraw* draw = device->draws + device->draw_count++;
+	draw->ps = device->ps;
+	draw->blend = device->blend;
+	draw->sampler = device->samplers[0];
+	draw->varying_count = software_varying_counts[device->vs];
+	draw->texture = device->ps_textures[0];
+	for(u32 slot=0; slot<2; slot++) {
+		// Ring ranges are never smaller than the copy
+		if(device->ps_constants[slot]) CopyMem(draw->constants[slot], device->ps_constants[slot], sizeof(draw->constants[slot]));
+		else ZeroArray(draw->constants[slot], 4);
+	}
+
+	SoftwareGeometry geometry = {};
+	geometry.device = device;
+	geometry.draw = *draw;
+	geometry.first = first;
+	geometry.count = count;
+	geometry.strip = device->topology != PRIMITIVE_TOPOLOGY_TriangleList;
+	geometry.instance_triangles = geometry.strip ? (count >= 2 ? count - 2 : 0) : count/3;
+	if(indexed) {
+		Assert(device->index_buffer);
+		u32 first_byte = device->index_offset + first*sizeof(u32);
+		Assert(first_byte + count*sizeof(u32) <= device->index_buffer->size);
+		geometry.indices = (u32*)(device->index_buffer->data + first_byte);
+	}
+
+	// Chunks get twice their triangles of room, more than that takes clipping most of them.
+	// Small draws are not worth the jobs and run here with all of it.
+	u32 total = geometry.instance_triangles*instance_count;
+	u32 chunk_room = 2*SOFTWARE_GEOMETRY_CHUNK;
+	SoftwareGeometryChunk chunks[SOFTWARE_MAX_TRIANGLES/(2*SOFTWARE_GEOMETRY_CHUNK)];
+	u32 next = 0;
+	while(next < total) {
+		bool jobs = renderer->work_queue && total - next >= 2*SOFTWARE_GEOMETRY_CHUNK;
+		u32 chunk_count = 0;
+		while(next < total && chunk_count < (jobs ? ArrayCount(chunks) : 1)) {
+			SoftwareGeometryChunk* chunk = chunks + chunk_count;
+			chunk->geometry = &geometry;
+			chunk->first_triangle = next;
+			chunk->end_triangle = jobs ? Min(next + SOFTWARE_GEOMETRY_CHUNK, total) : total;
+			chunk->culled = 0;
+			chunk->triangles = device->staged_triangles + chunk_count*chunk_room;
+			chunk->triangle_count = 0;
+			chunk->max_triangles = jobs ? chunk_room : SOFTWARE_MAX_TRIANGLES;
+			next = chunk->end_triangle;
+			chunk_count++;
+		}
+
+		u64 start = __rdtsc();
+		if(jobs) {
+			for(u32 i=0; i<chunk_count; i++) platform_api.add_work_entry(renderer->work_queue, DoSoftwareGeometryWork, chunks + i);
+			platform_api.complete_all_work(renderer->work_queue);
+		}
+		else DoSoftwareGeometryWork(0, chunks);
+		device->stats.geometry_cycles += __rdtsc() - start;
+
+		// In order up to the first chunk that ran out of room, the ones after it are set up again
+		for(u32 i=0; i<chunk_count; i++) {
+			AppendSoftwareTriangles(renderer, chunks + i);
+			if(chunks[i].stopped != chunks[i].end_triangle) {
+				next = chunks[i].stopped;
+				break;
+			}
+		}
+	}
+}
+
+static void
+ResizeBackendTargets(Renderer* renderer, bool offscreen) {
+	renderer->software_device.render_target = 0;
+
+	ReleaseSoftwareTarget(renderer->backbuffer.texture);
+	CreateSoftwareBackbuffer(renderer);
+	if(!offscreen) return;
+
+	ReleaseSoftwareTarget(renderer->depth_stencil.texture);
+	ReleaseSoftwareTarget(renderer->readable_render_target.texture);
+	CreateSoftwareOffscreenTargets(renderer);
+}
+
+static void
+PresentBackend(Renderer* renderer) {
+	SoftwareDevice* device = &renderer->software_device;
+	FlushSoftwareTiles(renderer);
+
+	device->stats_last_frame = device->stats;
+	ZeroStruct(device->stats);
+
+	device->render_target = 0;
+	device->vs = SOFTWARE_SHADER_None;
+	device->ps = SOFTWARE_SHADER_None;
+	device->index_buffer = 0;
+}
+
+static void
+SignalBackendFence(Renderer* renderer, u64 fence) {
+	renderer->software_device.fence_completed = fence;
+}
+
+static u64
+GetBackendCompletedFence(Renderer* renderer) {
+	return renderer->software_device.fence_completed;
+}
+
+static void
+WaitBackendFence(Renderer* renderer, u64 fence) {
+	Assert(fence <= renderer->software_device.fence_completed);
+}
+
+static void
+ExecuteBackendCommand(RENDER_COMMAND type, void* data, Renderer* renderer) {
+	SoftwareDevice* device = &renderer->software_device;
+
+	switch(type) {
+
+		case RENDER_COMMAND_ClearRenderTarget: {
+			ClearRenderTarget* command = (ClearRenderTarget*)data;
+			void* view = command->render_target ? (void*)command->render_target->view :
+				(void*)renderer->readable_render_target.render_target;
+			SoftwareResource* target = GetSoftwareViewResource(view);
+			if(target == device->render_target) FlushSoftwareTiles(renderer);
+
+			u32 color = PackSoftwareColor(*(Vec4*)command->color);
+			u32* pixels = (u32*)target->data;
+			for(u32 i=0; i<target->pitch*target->height; i++) pixels[i] = color;
+		} break;
+
+		case RENDER_COMMAND_ClearDepth: {
+			ClearDepth* command = (ClearDepth*)data;
+			FlushSoftwareTiles(renderer);
+
+			SoftwareResource* depth = GetSoftwareViewResource(renderer->depth_stencil.view);
+			float* values = (float*)depth->data;
+			for(u32 i=0; i<depth->pitch*depth->height; i++) values[i] = command->value;
+		} break;
+
+		// Nothing draws with stencil
+		case RENDER_COMMAND_ClearStencil: break;
+
+		case RENDER_COMMAND_SetRenderTarget: {
+			SetRenderTarget* command = (SetRenderTarget*)data;
+			void* view = command->render_target ? (void*)command->render_target->view :
+				(void*)renderer->readable_render_target.render_target;
+			SoftwareResource* target = GetSoftwareViewResource(view);
+			if(target != device->render_target) FlushSoftwareTiles(renderer);
+			device->render_target = target;
+		} break;
+
+		// One depth state, less equal with writes
+		case RENDER_COMMAND_SetDepthStencilState: break;
+
+		case RENDER_COMMAND_SetBlendState: {
+			SetBlendState* command = (SetBlendState*)data;
+			device->blend = command->type;
+		} break;
+
+		// Wireframe fills like the default state, nothing uses it
+		case RENDER_COMMAND_SetRasterizerState: {
+			SetRasterizerState* command = (SetRasterizerState*)data;
+			device->rasterizer = command->type;
+		} break;
+
+		case RENDER_COMMAND_SetSamplerState: {
+			SetSamplerState* command = (SetSamplerState*)data;
+			Assert(command->slot < ArrayCount(device->samplers));
+			device->samplers[command->slot] = command->type;
+		} break;
+
+		// Full depth range. The d3d11 backend still leaves it at 0..0, where the depth test always passes.
+		case RENDER_COMMAND_SetViewport: {
+			SetViewport* command = (SetViewport*)data;
+			device->viewport_x = command->topleft.x;
+			device->viewport_y = command->topleft.y;
+			device->viewport_width = command->dim.x;
+			device->viewport_height = command->dim.y;
+			device->viewport_min_depth = 0.0f;
+			device->viewport_max_depth = 1.0f;
+		} break;
+
+		case RENDER_COMMAND_SetPrimitiveTopology: {
+			SetPrimitiveTopology* command = (SetPrimitiveTopology*)data;
+			device->topology = command->type;
+		} break;
+
+		case RENDER_COMMAND_SetVertexShader: {
+			SetVertexShader* command = (SetVertexShader*)data;
+			device->vs = GetSoftwareResource(command->vertex->shader, SOFTWARE_RESOURCE_Shader)->shader;
+		} break;
+
+		case RENDER_COMMAND_SetPixelShader: {
+			SetPixelShader* command = (SetPixelShader*)data;
+			device->ps = GetSoftwareResource(command->pixel->shader, SOFTWARE_RESOURCE_Shader)->shader;
+		} break;
+
+		case RENDER_COMMAND_SetVertexBuffer: {
+			SetVertexBuffer* command = (SetVertexBuffer*)data;
+			Assert(command->slot < ArrayCount(device->vertex_buffers));
+			SoftwareVertexBinding* binding = device->vertex_buffers + command->slot;
+			binding->buffer = GetSoftwareResource(command->vertex->buffer, SOFTWARE_RESOURCE_Buffer);
+			binding->stride = command->stride;
+			binding->offset = command->offset;
+		} break;
+
+		case RENDER_COMMAND_SetIndexBuffer: {
+			SetIndexBuffer* command = (SetIndexBuffer*)data;
+			device->index_buffer = GetSoftwareResource(command->index->buffer, SOFTWARE_RESOURCE_Buffer);
+			device->index_offset = command->offset;
+		} break;
+
+		case RENDER_COMMAND_SetStructuredBuffer: {
+			SetStructuredBuffer* command = (SetStructuredBuffer*)data;
+			Assert(command->vertex_shader && command->slot == 0);
+			device->vs_structured = GetSoftwareViewResource(command->structured->view);
+		} break;
+
+		case RENDER_COMMAND_SetTextureBuffer: {
+			SetTextureBuffer* command = (SetTextureBuffer*)data;
+			Assert(command->slot < ArrayCount(device->ps_textures));
+			device->ps_textures[command->slot] = command->texture ? GetSoftwareViewResource(command->texture->view) : 0;
+		} break;
+
+		case RENDER_COMMAND_SetConstantsBuffer: {
+			SetConstantsBuffer* command = (SetConstantsBuffer*)data;
+			Assert(command->slot < 2);
+			SoftwareResource* ring = GetSoftwareResource(renderer->upload_ring_buffer, SOFTWARE_RESOURCE_Buffer);
+			u8* constants = ring->data + command->constants->offset;
+			if(command->vertex_shader) device->vs_constants[command->slot] = constants;
+			else device->ps_constants[command->slot] = constants;
+		} break;
+
+		// Vertex kernels read buffers at the draw and pixel constants are copied into it, so
+		// rewriting a buffer never has to wait for the tiles
+		case RENDER_COMMAND_PushRenderBufferData: {
+			PushRenderBufferData* command = (PushRenderBufferData*)data;
+			SoftwareResource* buffer = GetSoftwareResource(command->buffer, SOFTWARE_RESOURCE_Buffer);
+			Assert(command->size <= buffer->size);
+			CopyMem(buffer->data, command->data, command->size);
+		} break;
+
+		case RENDER_COMMAND_PushRenderConstants: {
+			PushRenderConstants* command = (PushRenderConstants*)data;
+			SoftwareResource* ring = GetSoftwareResource(renderer->upload_ring_buffer, SOFTWARE_RESOURCE_Buffer);
+			Assert(command->constants->offset + command->constants->size <= ring->size);
+			CopyMem(ring->data + command->constants->offset, command->data, command->size);
+		} break;
+
+		case RENDER_COMMAND_UpdateTextureRegion: {
+			UpdateTextureRegion* command = (UpdateTextureRegion*)data;
+			SoftwareResource* texture = GetSoftwareResource(command->texture->buffer, SOFTWARE_RESOURCE_Texture);
+			Assert(command->x + command->width <= texture->width);
+			Assert(command->y + command->height <= texture->height);
+			FlushSoftwareTiles(renderer);
+
+			u32 row_size = command->width*texture->components;
+			for(u32 y=0; y<command->height; y++) {
+				u8* dst = texture->data + ((command->y + y)*texture->pitch + command->x)*texture->components;
+				u8* src = (u8*)command->data + y*command->pitch;
+				CopyMem(dst, src, row_size);
+			}
+		} break;
+
+		case RENDER_COMMAND_FreeRenderResource: {
+			FreeRenderResource* command = (FreeRenderResource*)data;
+			FlushSoftwareTiles(renderer);
+			SoftwareResource* resource = (SoftwareResource*)command->buffer;
+			Assert(resource->live);
+			if(device->render_target == resource) device->render_target = 0;
+			if(resource->block) ReleaseSoftwareTarget(resource);
+			else resource->live = false;
+		} break;
+
+		case RENDER_COMMAND_DrawVertices: {
+			DrawVertices* command = (DrawVertices*)data;
+			DrawSoftware(renderer, command->vertices_count, 1, command->offset, false);
+		} break;
+
+		case RENDER_COMMAND_DrawIndexed: {
+			DrawIndexed* command = (DrawIndexed*)data;
+			DrawSoftware(renderer, command->indices_count, 1, command->offset, true);
+		} break;
+
+		case RENDER_COMMAND_DrawInstanced: {
+			DrawInstanced* command = (DrawInstanced*)data;
+			DrawSoftware(renderer, command->vertices_count, command->instance_count, command->offset, false);
+		} break;
+
+		case RENDER_COMMAND_DrawIndexedInstanced: {
+			DrawIndexedInstanced* command = (DrawIndexedInstanced*)data;
+			DrawSoftware(renderer, command->indices_count, command->instance_count, command->offset, true);
+		} break;
+
+		default: Assert(false);
+	}
+}
+
+// Writes the backbuffer as it was presented last
+static bool
+WriteSoftwareBackbuffer(char* path, Renderer* renderer) {
+	SoftwareResource* backbuffer = (SoftwareResource*)renderer->backbuffer.texture;
+	return stbi_write_png(path, backbuffer->width, backbuffer->height, 4, backbuffer->data, backbuffer->pitch*4) != 0;
+}
+
+static u8
+GetSoftwareShader(char* code, char* entry) {
+	if(code == TexturedQuadShader) return SOFTWARE_SHADER_TexturedQuad;
+	if(code == QuadShader) return SOFTWARE_SHADER_Quad;
+	if(code == TextShader) return SOFTWARE_SHADER_Text;
+	if(code == SDFTextShader) return SOFTWARE_SHADER_SDFText;
+	if(code == MeshShader) return SOFTWARE_SHADER_Mesh;
+	if(code == FullScreenQuadShader) return SOFTWARE_SHADER_FullScreenQuad;
+	if(code == UIShader) return SOFTWARE_SHADER_UI;
+	if(code == PostProcessShader) return StringCompare(entry, "ps_edge") ? SOFTWARE_SHADER_PostEdge : SOFTWARE_SHADER_PostCopy;
+	if(code == DebugDrawShader) {
+		if(StringCompare(entry, "vs_box")) return SOFTWARE_SHADER_DebugBox;
+		if(StringCompare(entry, "vs_sphere")) return SOFTWARE_SHADER_DebugSphere;
+		return SOFTWARE_SHADER_DebugLine;
+	}
+
+	// A new shader needs its kernel here
+	Assert(false);
+	return SOFTWARE_SHADER_None;
+}
+
+static StructuredBuffer*
+UploadBackendStructuredBuffer(u32 struct_size, u32 count, Renderer* renderer) {
+	StructuredBuffer* sb = PushStruct(renderer->permanent_arena, StructuredBuffer);
+	renderer->queue_stats.resources_created++;
+
+	SoftwareResource* buffer = CreateSoftwareResource(SOFTWARE_RESOURCE_Buffer, struct_size*count, 0, renderer);
+	sb->buffer = (ID3D11Buffer*)buffer;
+	sb->view = (ID3D11ShaderResourceView*)CreateSoftwareResource(SOFTWARE_RESOURCE_View, 0, buffer, renderer);
+	return sb;
+}
+
+static PixelShader*
+UploadBackendPixelShader(char* code, u32 length, char* entry, Renderer* renderer) {
+	PixelShader* ps = PushStruct(renderer->permanent_arena, PixelShader);
+	renderer->queue_stats.resources_created++;
+
+	SoftwareResource* shader = CreateSoftwareResource(SOFTWARE_RESOURCE_Shader, 0, 0, renderer);
+	shader->shader = GetSoftwareShader(code, entry);
+	ps->shader = (ID3D11PixelShader*)shader;
+	ps->id = ++renderer->next_shader_id;
+	return ps;
+}
+
+static VertexShader*
+UploadBackendVertexShader(char* code, u32 length, char* entry, VERTEX_BUFFER* vertex_buffers, u8 count, Renderer* renderer) {
+	VertexShader* vs = PushStruct(renderer->permanent_arena, VertexShader);
+	renderer->queue_stats.resources_created++;
+
+	SoftwareResource* shader = CreateSoftwareResource(SOFTWARE_RESOURCE_Shader, 0, 0, renderer);
+	shader->shader = GetSoftwareShader(code, entry);
+	vs->shader = (ID3D11VertexShader*)shader;
+	vs->il = 0;
+	vs->id = ++renderer->next_shader_id;
+	return vs;
+}
+
+static TextureBuffer*
+UploadBackendTexture(void* data, u32 width, u32 height, u8 num_components, TEXTURE_USAGE usage, Renderer* renderer) {
+	TextureBuffer* texture_buffer = PushStruct(renderer->permanent_arena, TextureBuffer);
+	renderer->queue_stats.resources_created++;
+	Assert(num_components == 1 || num_components == 4);
+	Assert(data || usage != TEXTURE_USAGE_Immutable);
+
+	SoftwareResource* texture = CreateSoftwareTexture(width, height, num_components, renderer);
+	if(data) CopyMem(texture->data, data, texture->size);
+	texture_buffer->buffer = (ID3D11Texture2D*)texture;
+	texture_buffer->view = (ID3D11ShaderResourceView*)CreateSoftwareResource(SOFTWARE_RESOURCE_View, 0, texture, renderer);
+	texture_buffer->id = ++renderer->next_texture_id;
+	return texture_buffer;
+}
+
+static ReadableRenderTarget*
+UploadBackendRenderTarget(u32 width, u32 height, Renderer* renderer) {
+	ReadableRenderTarget* result = PushStruct(renderer->permanent_arena, ReadableRenderTarget);
+	renderer->queue_stats.resources_created++;
+
+	SoftwareResource* texture = CreateSoftwareTarget(width, height, renderer);
+	result->texture = (ID3D11Texture2D*)texture;
+	result->render_target = (ID3D11RenderTargetView*)CreateSoftwareResource(SOFTWARE_RESOURCE_View, 0, texture, renderer);
+	result->shader_resource = (ID3D11ShaderResourceView*)CreateSoftwareResource(SOFTWARE_RESOURCE_View, 0, texture, renderer);
+	return result;
+}
+
+static IndexBuffer*
+UploadBackendIndexBuffer(void* data, u32 count, Renderer* renderer) {
+	IndexBuffer* index_buffer = PushStruct(renderer->permanent_arena, IndexBuffer);
+	renderer->queue_stats.resources_created++;
+	Assert(data);
+
+	SoftwareResource* buffer = CreateSoftwareResource(SOFTWARE_RESOURCE_Buffer, sizeof(u32)*count, 0, renderer);
+	CopyMem(buffer->data, data, buffer->size);
+	index_buffer->buffer = (ID3D11Buffer*)buffer;
+	return index_buffer;
+}
+
+static VertexBuffer*
+UploadBackendVertexBuffer(void* initial_data, u32 num_vertices, u8 num_components, bool dynamic, Renderer* renderer) {
+	VertexBuffer* vb = PushStruct(renderer->permanent_arena, VertexBuffer);
+	renderer->queue_stats.resources_created++;
+	Assert(initial_data || dynamic);
+
+	SoftwareResource* buffer = CreateSoftwareResource(SOFTWARE_RESOURCE_Buffer, num_components*sizeof(float)*num_vertices, 0, renderer);
+	if(initial_data) CopyMem(buffer->data, initial_data, buffer->size);
+	vb->buffer = (ID3D11Buffer*)buffer;
+	vb->id = ++renderer->next_mesh_id;
+	return vb;
+}
+
+static Renderer*
+InitRenderer(Win32Window* window, MemoryArena* parent_arena, MemoryArena* frame_arena) {
+	Renderer* renderer;
+	renderer = PushStructClear(parent_arena, Renderer);
+	renderer->permanent_arena = parent_arena;
+	renderer->frame_arena = frame_arena;
+	for(u32 i=0; i<RENDER_LIST_TOTAL; i++) InitRenderCommandList(renderer->lists + i, renderer);
+
+	renderer->window_dim = window->dim;
+	renderer->target_dim = window->dim;
+	renderer->render_dim = window->dim;
+	renderer->render_scale = 1.0f;
+	renderer->msaa_sample_count = 1;
+
+	SoftwareDevice* device = &renderer->software_device;
+	device->triangles = PushArray(parent_arena, SoftwareTriangle, SOFTWARE_MAX_TRIANGLES);
+	device->staged_triangles = PushArray(parent_arena, SoftwareTriangle, SOFTWARE_MAX_TRIANGLES);
+	device->draws = PushArray(parent_arena, SoftwareDraw, SOFTWARE_MAX_DRAWS);
+	device->arena.min_block_size = Megabytes(4);
+	device->arena_temp = BeginTemporaryMemory(&device->arena);
+	CreateSoftwareBackbuffer(renderer);
+	CreateSoftwareOffscreenTargets(renderer);
+
+	InitUploadRing(&renderer->upload_ring, UPLOAD_RING_SIZE);
+	renderer->upload_ring_buffer = (ID3D11Buffer*)CreateSoftwareResource(SOFTWARE_RESOURCE_Buffer, UPLOAD_RING_SIZE, 0, renderer);
+
+	return renderer;
+}
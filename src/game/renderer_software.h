@@ -0,0 +1,128 @@
+#define SOFTWARE_TILE_SIZE 64
+#define SOFTWARE_MAX_VARYINGS 12
+#define SOFTWARE_MAX_TRIANGLES 65536		// binned triangles before a forced flush
+#define SOFTWARE_MAX_DRAWS 4096
+#define SOFTWARE_GEOMETRY_CHUNK 256			// triangles a geometry job sets up
+#define SOFTWARE_GUARD_BAND 2048			// pixels past the viewport before triangles get clipped
+
+// Every shader in shader_code.h has a C++ kernel, picked by source and entry point at upload
+enum SOFTWARE_SHADER {
+	SOFTWARE_SHADER_None,
+
+	SOFTWARE_SHADER_TexturedQuad,
+	SOFTWARE_SHADER_Quad,
+	SOFTWARE_SHADER_Text,
+	SOFTWARE_SHADER_SDFText,
+	SOFTWARE_SHADER_Mesh,
+	SOFTWARE_SHADER_FullScreenQuad,
+	SOFTWARE_SHADER_PostCopy,
+	SOFTWARE_SHADER_PostEdge,
+	SOFTWARE_SHADER_UI,
+	SOFTWARE_SHADER_DebugLine,
+	SOFTWARE_SHADER_DebugBox,
+	SOFTWARE_SHADER_DebugSphere,
+
+	SOFTWARE_SHADER_TOTAL
+};
+
+enum SOFTWARE_RESOURCE {
+	SOFTWARE_RESOURCE_Buffer,
+	SOFTWARE_RESOURCE_Texture,
+	SOFTWARE_RESOURCE_View,
+	SOFTWARE_RESOURCE_Shader,
+};
+
+struct SoftwareResource {
+	u8 kind;
+	u8 shader;					// SOFTWARE_SHADER
+	u8 components;				// textures, 1 is R8 and 4 is RGBA8, depth is 4 and holds floats
+	bool live;
+	u32 width, height;
+	u32 pitch;					// texels per row, targets pad it to a multiple of four
+	u32 size;
+	u8* data;
+	PlatformMemoryBlock* block;	// targets are reallocated on resize
+	SoftwareResource* parent;	// views point at what they view
+};
+
+struct SoftwareVertexBinding {
+	SoftwareResource* buffer;
+	u32 stride;
+	u32 offset;
+};
+
+// Pixel state captured when a draw is binned, constants can be rewritten before the tiles run
+struct SoftwareDraw {
+	u8 ps;
+	u8 blend;
+	u8 sampler;
+	u8 varying_count;
+	SoftwareResource* texture;
+	float constants[2][4];
+};
+
+// Screen positions are snapped to 1/16th of a pixel and stored relative to nothing, edge
+// functions are evaluated per tile so shared edges come out exactly negated.
+struct SoftwareTriangle {
+	float x[3], y[3];
+	float z[3];
+	float inv_w[3];
+	float varyings[3][SOFTWARE_MAX_VARYINGS];	// divided by w
+	float inv_area;
+	i32 min_x, min_y, max_x, max_y;				// inclusive pixel bounds
+	u16 draw;
+	bool opaque;								// overwrites whatever is under it, see IsSoftwareTriangleOpaque
+};
+
+struct SoftwareFrameStats {
+	u32 draws;
+	u32 triangles;				// after clipping and culling
+	u32 triangles_culled;
+	u32 flushes;
+	u32 bin_entries;
+	u32 pixels_shaded;			// added to by the tile jobs
+	u64 geometry_cycles;		// wall clock of the vertex, clip and setup stage
+	u64 tile_cycles;			// wall clock of binning and the tile jobs
+};
+
+struct SoftwareDevice {
+	MemoryArena arena;			// triangles, draws and bins, reset on every flush
+	TemporaryMemory arena_temp;
+
+	SoftwareFrameStats stats;
+	SoftwareFrameStats stats_last_frame;
+
+	u64 fence_completed;		// draws run as they come, so a fence passes as soon as it is signaled
+
+	// Bound state
+	SoftwareResource* render_target;
+	SoftwareResource* depth;	// the one depth buffer, floats
+	float viewport_x, viewport_y, viewport_width, viewport_height;
+	float viewport_min_depth, viewport_max_depth;
+	u8 blend;
+	u8 rasterizer;
+	u8 topology;
+	u8 samplers[2];
+	u8 vs;
+	u8 ps;
+	SoftwareVertexBinding vertex_buffers[2];
+	SoftwareResource* index_buffer;
+	u32 index_offset;
+	SoftwareResource* vs_structured;
+	u8* vs_constants[2];		// into the upload ring
+	u8* ps_constants[2];
+	SoftwareResource* ps_textures[2];	// the kernels only sample the first
+
+	// Binned since the last flush, all against render_target
+	SoftwareTriangle* triangles;
+	u32 triangle_count;
+	SoftwareDraw* draws;
+	u32 draw_count;
+	SoftwareTriangle* staged_triangles;		// geometry jobs set up here, appended in submission order
+
+	// Filled by the flush for the tile jobs
+	u32 tiles_x, tiles_y;
+	u32* tile_offsets;			// tiles_x*tiles_y + 1 prefix sums into tile_triangles
+	u32* tile_triangles;
+	u32 volatile next_tile;
+};
@@ -0,0 +1,151 @@
+// Signed distance field glyphs
+// The glyph is rasterized SDF_UPSAMPLE times larger, its boundary pixels are collected and
+// every output texel takes the distance to the closest one.
+// Encoded as 128 + distance*127/padding, inside is positive.
+// Shared by the asset packer, which bakes the first atlas, and the game, which caches the rest at runtime.
+
+#include <emmintrin.h>
+
+#define SDF_UPSAMPLE 4
+#define SDF_FAR_AWAY 1e18f
+
+struct SDFEdges {
+	float* x;
+	float* y;
+	u32 count;		// padded to a multiple of 4 with far away points
+};
+
+struct SDFGlyph {
+	u8* pixels;
+	int width;
+	int height;
+	float xoff;
+	float yoff;
+	float xadvance;
+};
+
+static bool
+SDFInside(u8* bitmap, int w, int h, int x, int y) {
+	if(x < 0 || y < 0 || x >= w || y >= h) return false;
+	return bitmap[y*w + x] >= 128;
+}
+
+static SDFEdges
+CollectSDFEdges(u8* bitmap, int w, int h) {
+	SDFEdges result = {};
+
+	u32 capacity = 4;
+	for(int y=0; y<h; y++)
+		for(int x=0; x<w; x++)
+			if(SDFInside(bitmap, w, h, x, y)) capacity++;
+	capacity = (capacity + 3) & ~3;
+
+	result.x = (float*)_mm_malloc(capacity*sizeof(float), 16);
+	result.y = (float*)_mm_malloc(capacity*sizeof(float), 16);
+
+	for(int y=0; y<h; y++) {
+		for(int x=0; x<w; x++) {
+			if(!SDFInside(bitmap, w, h, x, y)) continue;
+			bool edge = !SDFInside(bitmap, w, h, x-1, y) || !SDFInside(bitmap, w, h, x+1, y) ||
+				!SDFInside(bitmap, w, h, x, y-1) || !SDFInside(bitmap, w, h, x, y+1);
+			if(!edge) continue;
+
+			result.x[result.count] = x + 0.5f;
+			result.y[result.count] = y + 0.5f;
+			result.count++;
+		}
+	}
+
+	while(result.count & 3) {
+		result.x[result.count] = SDF_FAR_AWAY;
+		result.y[result.count] = SDF_FAR_AWAY;
+		result.count++;
+	}
+
+	return result;
+}
+
+static float
+NearestEdgeDistanceSqScalar(SDFEdges* edges, float px, float py) {
+	float result = FLT_MAX;
+	for(u32 i=0; i<edges->count; i++) {
+		float dx = edges->x[i] - px;
+		float dy = edges->y[i] - py;
+		float d = dx*dx + dy*dy;
+		if(d < result) result = d;
+	}
+	return result;
+}
+
+static float
+NearestEdgeDistanceSqSSE2(SDFEdges* edges, float px, float py) {
+	__m128 x = _mm_set1_ps(px);
+	__m128 y = _mm_set1_ps(py);
+	__m128 nearest = _mm_set1_ps(FLT_MAX);
+
+	for(u32 i=0; i<edges->count; i+=4) {
+		__m128 dx = _mm_sub_ps(_mm_load_ps(edges->x + i), x);
+		__m128 dy = _mm_sub_ps(_mm_load_ps(edges->y + i), y);
+		__m128 d = _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy));
+		nearest = _mm_min_ps(nearest, d);
+	}
+
+	nearest = _mm_min_ps(nearest, _mm_shuffle_ps(nearest, nearest, _MM_SHUFFLE(1, 0, 3, 2)));
+	nearest = _mm_min_ps(nearest, _mm_shuffle_ps(nearest, nearest, _MM_SHUFFLE(2, 3, 0, 1)));
+	return _mm_cvtss_f32(nearest);
+}
+
+// Offsets and advance are in pixels at the size scale was computed for
+static SDFGlyph
+GenerateGlyphSDF(stbtt_fontinfo* info, int codepoint, float scale, int padding, bool simd) {
+	SDFGlyph result = {};
+
+	int advance, lsb;
+	stbtt_GetCodepointHMetrics(info, codepoint, &advance, &lsb);
+	result.xadvance = advance*scale;
+
+	float hi_scale = scale*SDF_UPSAMPLE;
+	int ix0, iy0, ix1, iy1;
+	stbtt_GetCodepointBitmapBox(info, codepoint, hi_scale, hi_scale, &ix0, &iy0, &ix1, &iy1);
+	int hi_w = ix1 - ix0;
+	int hi_h = iy1 - iy0;
+	if(hi_w <= 0 || hi_h <= 0) return result;
+
+	u8* hi_bitmap = (u8*)calloc(hi_w*hi_h, sizeof(u8));
+	stbtt_MakeCodepointBitmap(info, hi_bitmap, hi_w, hi_h, hi_w, hi_scale, hi_scale, codepoint);
+	SDFEdges edges = CollectSDFEdges(hi_bitmap, hi_w, hi_h);
+
+	int lx0 = (int)floorf((float)ix0/SDF_UPSAMPLE) - padding;
+	int ly0 = (int)floorf((float)iy0/SDF_UPSAMPLE) - padding;
+	int lx1 = (int)ceilf((float)ix1/SDF_UPSAMPLE) + padding;
+	int ly1 = (int)ceilf((float)iy1/SDF_UPSAMPLE) + padding;
+
+	result.width = lx1 - lx0;
+	result.height = ly1 - ly0;
+	result.xoff = (float)lx0;
+	result.yoff = (float)ly0;
+	result.pixels = (u8*)calloc(result.width*result.height, sizeof(u8));
+
+	float dist_scale = 127.0f/(padding*SDF_UPSAMPLE);
+	for(int j=0; j<result.height; j++) {
+		for(int i=0; i<result.width; i++) {
+			float hx = (lx0 + i + 0.5f)*SDF_UPSAMPLE - ix0;
+			float hy = (ly0 + j + 0.5f)*SDF_UPSAMPLE - iy0;
+
+			float d2 = simd ? NearestEdgeDistanceSqSSE2(&edges, hx, hy) : NearestEdgeDistanceSqScalar(&edges, hx, hy);
+			float d = sqrtf(d2);
+			if(!SDFInside(hi_bitmap, hi_w, hi_h, (int)floorf(hx), (int)floorf(hy))) d = -d;
+
+			float value = 128.0f + d*dist_scale;
+			if(value < 0.0f) value = 0.0f;
+			if(value > 255.0f) value = 255.0f;
+			result.pixels[j*result.width + i] = (u8)value;
+		}
+	}
+
+	_mm_free(edges.x);
+	_mm_free(edges.y);
+	free(hi_bitmap);
+
+	return result;
+}
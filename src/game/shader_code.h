@@ -1,9 +1,11 @@
 // TODO: Reorganize this
 char TexturedQuadShader[] = R"FOO(
 
-struct vs {
-	float3 position : POSITION;
-	float2 texcoord : TEXCOORD;
+struct Quad {
+	float3 tl;
+	float3 tr;
+	float3 bl;
+	float3 br;
 };
 
 struct ps {
@@ -15,11 +17,22 @@ cbuffer camera : register(b1) {
 	float4x4 view_proj;
 };
 
-ps vsf(vs input) {
+StructuredBuffer<Quad> quad_list : register(t0);
+
+ps vsf(in uint vert_id : SV_VertexID, in uint instance_id : SV_InstanceID) {
 	ps result;
 
-	result.pixel_pos = mul(view_proj, float4(input.position, 1.0));
-	result.texcoord = input.texcoord;
+	Quad quad = quad_list[instance_id];
+
+	float3 corner;
+	float2 texcoord;
+	if(vert_id == 0) { corner = quad.bl; texcoord = float2(0.0, 1.0); }
+	if(vert_id == 1) { corner = quad.br; texcoord = float2(1.0, 1.0); }
+	if(vert_id == 2) { corner = quad.tl; texcoord = float2(0.0, 0.0); }
+	if(vert_id == 3) { corner = quad.tr; texcoord = float2(1.0, 0.0); }
+
+	result.pixel_pos = mul(view_proj, float4(corner, 1.0));
+	result.texcoord = texcoord;
 
 	return result;
 }
@@ -234,19 +247,23 @@ ps vsf(in uint vert_id : SV_VertexID) {
 )FOO";
 
 
-char MonochromeShader[] = R"FOO(
+// Distance is 0.5 on the outline, the edge is antialiased over one screen pixel at any scale
+char SDFTextShader[] = R"FOO(
 
 struct ps {
 	float4 pixel_pos : SV_POSITION;
 	float2 texcoord : TEXCOORD;
+	float3 color : COLOR;
 };
 
-Texture2D diffuse_texture : register(t0);
-SamplerState default_sampler : register(s0);
+Texture2D sdf_texture : register(t0);
+SamplerState linear_sampler : register(s0);
 
 float4 psf(ps input) : SV_Target {
-	float4 diffuse_color = diffuse_texture.Sample(default_sampler, input.texcoord).x;
-	return diffuse_color;
+	float distance = sdf_texture.Sample(linear_sampler, input.texcoord).x;
+	float width = fwidth(distance)*0.5f;
+	float alpha = smoothstep(0.5f - width, 0.5f + width, distance);
+	return float4(input.color, alpha);
 }
 
 )FOO";
@@ -267,10 +284,7 @@ cbuffer camera : register(b1) {
 	float4x4 view_proj;
 };
 
-cbuffer mesh : register(b2) {
-	float4x4 model;
-	float4 color;
-};
+StructuredBuffer<MeshInfo> instances : register(t0);
 
 struct ps {
 	float4 pixel_pos : SV_POSITION;
@@ -286,12 +300,13 @@ cbuffer light : register(b1) {
 
 ps vsf(vs input, in uint instance_id : SV_InstanceID) {
 	ps output;
+	MeshInfo info = instances[instance_id];
 	
-	float4 world_pos = mul(model, float4(input.position, 1.0f));
+	float4 world_pos = mul(info.model, float4(input.position, 1.0f));
 	output.pixel_pos = mul(view_proj, world_pos);
 	output.vertex_pos = world_pos.xyz;
-	output.normal = mul(model, float4(input.normal, 0.0)).xyz;
-	output.color = color;
+	output.normal = mul(info.model, float4(input.normal, 0.0)).xyz;
+	output.color = info.color;
 
 	return output;
 }
@@ -317,11 +332,18 @@ struct ps {
 	float2 texcoord : TEXCOORD;
 };
 
+// Same layout as the one in PostProcessShader
+cbuffer pass : register(b0) {
+	float2 uv_scale;			// part of the source the pass reads
+	float2 resolution;			// of the whole source
+};
+
 ps vsf(in uint vert_id : SV_VertexID) {
 	ps result;
 
-	result.texcoord = float2((vert_id << 1) & 2, vert_id & 2);
-	result.pixel_pos = float4(result.texcoord * float2(2.0f, -2.0f) + float2(-1.0f, 1.0f), 0.0f, 1.0f);
+	float2 corner = float2((vert_id << 1) & 2, vert_id & 2);
+	result.texcoord = corner * uv_scale;
+	result.pixel_pos = float4(corner * float2(2.0f, -2.0f) + float2(-1.0f, 1.0f), 0.0f, 1.0f);
 
 	return result;
 }
@@ -349,16 +371,21 @@ struct ps {
 
 #define MAX_SAMPLES 16
 
-cbuffer image : register(b0) {
-	float width;
-	float height;
+cbuffer pass : register(b0) {
+	float2 uv_scale;
+	float2 resolution;
 };
 
 Texture2D tex: register(t0);
 SamplerState tex_sampler : register(s0);
 
+// Keeps filtering inside the part of the source that was drawn
+float4 SampleSource(float2 uv) {
+	return tex.Sample(tex_sampler, min(uv, uv_scale - 0.5/resolution));
+}
+
 float4 ps_copy(ps input) : SV_Target {
-	return float4(tex.Sample(tex_sampler, input.texcoord).xyz, 1.0);
+	return float4(SampleSource(input.texcoord).xyz, 1.0);
 };
 
 float4 ps_edge(ps input) : SV_Target {
@@ -366,23 +393,23 @@ float4 ps_edge(ps input) : SV_Target {
 
 	float4 x_acc = 0;
 	float4 y_acc = 0;
-	float2 texel = float2(1/width, 1/height);
+	float2 texel = 1/resolution;
 
-	x_acc += tex.Sample(tex_sampler, uv + float2(-texel.x, -texel.y))  * -1.0;
-	x_acc += tex.Sample(tex_sampler, uv + float2(-texel.x,  			0))  * -2.0;
-	x_acc += tex.Sample(tex_sampler, uv + float2(-texel.x,  texel.y))  * -1.0;
+	x_acc += SampleSource(uv + float2(-texel.x, -texel.y))  * -1.0;
+	x_acc += SampleSource(uv + float2(-texel.x,  			0))  * -2.0;
+	x_acc += SampleSource(uv + float2(-texel.x,  texel.y))  * -1.0;
 
-	x_acc += tex.Sample(tex_sampler, uv + float2( texel.x, -texel.y))  *  1.0;
-	x_acc += tex.Sample(tex_sampler, uv + float2( texel.x,  			0))  *  2.0;
-	x_acc += tex.Sample(tex_sampler, uv + float2( texel.x,  texel.y))  *  1.0;
+	x_acc += SampleSource(uv + float2( texel.x, -texel.y))  *  1.0;
+	x_acc += SampleSource(uv + float2( texel.x,  			0))  *  2.0;
+	x_acc += SampleSource(uv + float2( texel.x,  texel.y))  *  1.0;
 
-	y_acc += tex.Sample(tex_sampler, uv + float2(-texel.x, -texel.y))  * -1.0;
-	y_acc += tex.Sample(tex_sampler, uv + float2(       0, -texel.y))  * -2.0;
-	y_acc += tex.Sample(tex_sampler, uv + float2( texel.x, -texel.y))  * -1.0;
+	y_acc += SampleSource(uv + float2(-texel.x, -texel.y))  * -1.0;
+	y_acc += SampleSource(uv + float2(       0, -texel.y))  * -2.0;
+	y_acc += SampleSource(uv + float2( texel.x, -texel.y))  * -1.0;
 
-	y_acc += tex.Sample(tex_sampler, uv + float2(-texel.x,  texel.y))  *  1.0;
-	y_acc += tex.Sample(tex_sampler, uv + float2(       0,  texel.y))  *  2.0;
-	y_acc += tex.Sample(tex_sampler, uv + float2( texel.x,  texel.y))  *  1.0;
+	y_acc += SampleSource(uv + float2(-texel.x,  texel.y))  *  1.0;
+	y_acc += SampleSource(uv + float2(       0,  texel.y))  *  2.0;
+	y_acc += SampleSource(uv + float2( texel.x,  texel.y))  *  1.0;
 
 	return sqrt(x_acc*x_acc + y_acc*y_acc);
 };
@@ -435,3 +462,102 @@ float4 psf(ps input) : SV_Target {
 
 
 
+
+// Debug primitives are expanded here, every segment of a line, box or sphere becomes two
+// triangles thickness pixels wide. Each entry point draws one kind, six vertices per segment.
+char DebugDrawShader[] = R"FOO(
+
+struct DebugPrimitive {
+	float3 a;			// line start, box min, sphere center
+	uint color;			// rgba8
+	float3 b;			// line end, box max, sphere radius in x
+	float thickness;	// pixels
+};
+
+cbuffer camera : register(b1) {
+	float4x4 view_proj;
+	float2 half_size;	// of the viewport in pixels
+};
+
+StructuredBuffer<DebugPrimitive> primitives : register(t0);
+
+struct ps {
+	float4 pixel_pos : SV_POSITION;
+	float4 color : COLOR;
+};
+
+static const uint segment_ends[6] = { 0, 0, 1, 1, 1, 0 };
+static const float segment_sides[6] = { -1.0f, 1.0f, 1.0f, 1.0f, -1.0f, -1.0f };
+
+// Corners are bit 0 x, bit 1 y and bit 2 z of max
+static const uint2 box_edges[12] = {
+	uint2(0, 1), uint2(2, 3), uint2(4, 5), uint2(6, 7),
+	uint2(0, 2), uint2(1, 3), uint2(4, 6), uint2(5, 7),
+	uint2(0, 4), uint2(1, 5), uint2(2, 6), uint2(3, 7),
+};
+
+#define SPHERE_SEGMENTS 16
+
+float4 UnpackColor(uint color) {
+	return float4(color & 0xff, (color >> 8) & 0xff, (color >> 16) & 0xff, color >> 24) / 255.0f;
+}
+
+ps ExpandSegment(float3 a, float3 b, DebugPrimitive primitive, uint corner) {
+	float4 p0 = mul(view_proj, float4(a, 1.0f));
+	float4 p1 = mul(view_proj, float4(b, 1.0f));
+
+	// Pull an end behind the camera onto the near side, a segment entirely behind ends up degenerate
+	float near_w = 0.001f;
+	if(p0.w < near_w && p1.w >= near_w) p0 = lerp(p0, p1, (near_w - p0.w)/(p1.w - p0.w));
+	if(p1.w < near_w && p0.w >= near_w) p1 = lerp(p1, p0, (near_w - p1.w)/(p0.w - p1.w));
+
+	float2 dir = (p1.xy/p1.w - p0.xy/p0.w)*half_size;
+	float len = length(dir);
+	dir = len > 0.0f ? dir/len : float2(1.0f, 0.0f);
+	float2 normal = float2(-dir.y, dir.x);
+
+	float4 pos = segment_ends[corner] ? p1 : p0;
+	pos.xy += normal*segment_sides[corner]*primitive.thickness*0.5f/half_size*pos.w;
+
+	ps result;
+	result.pixel_pos = pos;
+	result.color = UnpackColor(primitive.color);
+	return result;
+}
+
+float3 BoxCorner(DebugPrimitive box, uint corner) {
+	return float3(corner & 1 ? box.b.x : box.a.x, corner & 2 ? box.b.y : box.a.y, corner & 4 ? box.b.z : box.a.z);
+}
+
+// Three great circles, in the xy, xz and yz planes
+float3 SpherePoint(DebugPrimitive sphere, uint circle, uint step) {
+	float angle = (float)step*6.28318530718f/SPHERE_SEGMENTS;
+	float c = cos(angle)*sphere.b.x;
+	float s = sin(angle)*sphere.b.x;
+	float3 offset = circle == 0 ? float3(c, s, 0.0f) : circle == 1 ? float3(c, 0.0f, s) : float3(0.0f, c, s);
+	return sphere.a + offset;
+}
+
+ps vs_line(in uint vert_id : SV_VertexID, in uint instance_id : SV_InstanceID) {
+	DebugPrimitive line = primitives[instance_id];
+	return ExpandSegment(line.a, line.b, line, vert_id);
+}
+
+ps vs_box(in uint vert_id : SV_VertexID, in uint instance_id : SV_InstanceID) {
+	DebugPrimitive box = primitives[instance_id];
+	uint2 edge = box_edges[vert_id/6];
+	return ExpandSegment(BoxCorner(box, edge.x), BoxCorner(box, edge.y), box, vert_id % 6);
+}
+
+ps vs_sphere(in uint vert_id : SV_VertexID, in uint instance_id : SV_InstanceID) {
+	DebugPrimitive sphere = primitives[instance_id];
+	uint segment = vert_id/6;
+	uint circle = segment/SPHERE_SEGMENTS;
+	uint step = segment % SPHERE_SEGMENTS;
+	return ExpandSegment(SpherePoint(sphere, circle, step), SpherePoint(sphere, circle, step + 1), sphere, vert_id % 6);
+}
+
+float4 psf(ps input) : SV_TARGET {
+	return input.color;
+}
+	)FOO";
@@ -49,9 +49,9 @@ MakeQuadFromLine(Line* line, float thickness, Vec3 normal) {
 static void
 GenerateTetrahedron(Vec3* out_vertices) {
 	float a = 1.0f / 3.0f;
-	float b = sqrtf(8.0f / 9.0f);
-	float c = sqrtf(2.0f / 9.0f);
-	float d = sqrtf(2.0f / 3.0f);
+	float b = SquareRoot(8.0f / 9.0f);
+	float c = SquareRoot(2.0f / 9.0f);
+	float d = SquareRoot(2.0f / 3.0f);
 
 	Vec3 vertices[4] = { V3(0.0, 0.0, 1.0f), 
 											 V3(-c, d, -a),	
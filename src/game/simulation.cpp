@@ -18,12 +18,9 @@ AllocEntity(EntityBlob* blob) {
 
 static void
 ReleaseEntity(Entity* entity, EntityBlob* blob) {
-	if(entity->prev && entity->next) {
-		entity->prev->next = entity->next;
-		entity->next->prev = entity->prev;
-	}
-	if(entity->prev && !entity->next) entity->prev->next = 0; 
-	if(!entity->prev && entity->next) entity->next->prev = 0;
+	if(entity->prev) entity->prev->next = entity->next;
+	else blob->entities = entity->next;
+	if(entity->next) entity->next->prev = entity->prev;
 
 	blob->entity_count--;
 	entity->next = blob->first_free;
@@ -39,33 +36,14 @@ UpdateTransform(Transform* inout, Transform var) {
 
 static BoundingBox
 UpdateBoundingBox(BoundingBox* box, Transform* transform) {
-	BoundingBox obb = {};
 	BoundingBox result = {};
+	Vec3 center, extent;
+	TransformBounds(V3MulF(V3Add(box->min, box->max), 0.5f), V3MulF(V3Sub(box->max, box->min), 0.5f), transform,
+			&center, &extent);
 
-	obb.min = V3Mul(transform->scale, box->min);
-	obb.max = V3Mul(transform->scale, box->max);
-
-	Mat4 rot_matrix = M4FromQuat(transform->rotation);
-	Vec4 min = M4MulV(rot_matrix, V4FromV3(obb.min, 1.0f));
-	Vec4 max = M4MulV(rot_matrix, V4FromV3(obb.max, 1.0f));
-	obb.min = V3(min.x, min.y, min.z);
-	obb.max = V3(max.x, max.y, max.z);
-
-	obb.min = V3Add(obb.min, transform->position);
-	obb.max = V3Add(obb.max, transform->position);
-
-	result.min.x = obb.min.x < obb.max.x ? obb.min.x : obb.max.x;
-	result.min.y = obb.min.y < obb.max.y ? obb.min.y : obb.max.y;
-	result.min.z = obb.min.z < obb.max.z ? obb.min.z : obb.max.z;
-
-	result.max.x = obb.max.x > obb.min.x ? obb.max.x : obb.min.x;
-	result.max.y = obb.max.y > obb.min.y ? obb.max.y : obb.min.y;
-	result.max.z = obb.max.z > obb.min.z ? obb.max.z : obb.min.z;
-
-	result.size.x = Abs((result.max.x - result.min.x)/2);
-	result.size.y = Abs((result.max.y - result.min.y)/2);
-	result.size.z = Abs((result.max.z - result.min.z)/2);
-
+	result.min = V3Sub(center, extent);
+	result.max = V3Add(center, extent);
+	result.size = extent;
 	return result;
 }
 
@@ -81,36 +59,13 @@ BoundingBoxIntersect(BoundingBox* left, BoundingBox* right) {
 }
 
 static BoundingBox
-GetBoundingBoxFromMeshData(MeshData* mesh_data) {
+GetBoundingBoxFromMeshBounds(MeshBounds* bounds) {
 	BoundingBox result = {};
-
-	u8 i=0;
-	for(i=0; i<mesh_data->vb_data_count; i++) 
-		if(mesh_data->vb_data[i].type == VERTEX_BUFFER_POSITION) break;
-
-	Vec3 max = V3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
-	Vec3 min = V3( FLT_MAX,  FLT_MAX,  FLT_MAX);
-
-	Vec3* data = (Vec3*)mesh_data->vb_data[i].data;
-	for(u32 j=0; j<mesh_data->vertices_count; j++) {
-		if(data[j].x < min.x) min.x = data[j].x;
-		if(data[j].y < min.y) min.y = data[j].y;
-		if(data[j].z < min.z) min.z = data[j].z;
-
-		if(data[j].x > max.x) max.x = data[j].x;
-		if(data[j].y > max.y) max.y = data[j].y;
-		if(data[j].z > max.z) max.z = data[j].z;
-	}
-
-	result.min = min;
-	result.max = max;
-
-	result.size.x = (result.min.x + result.max.x)/2;
-	result.size.y = (result.min.y + result.max.y)/2;
-	result.size.z = (result.min.z + result.max.z)/2;
-
+	result.min = bounds->min;
+	result.max = bounds->max;
+	result.size = bounds->half_size;
 	return result;
-};
+}
 
 static Entity*
 SpawnParticleSystem(ParticleSystem* particle_system, GameState* game_state) {
@@ -170,7 +125,8 @@ SpawnMine(Transform transform, GameState* game_state) {
 	result->health = 10;
 	result->attack_damage = 10;
 
-	result->bb_mesh_space = GetBoundingBoxFromMeshData(mesh_asset->data);
+	result->mesh_bounds = mesh_asset->bounds;
+	result->bb_mesh_space = GetBoundingBoxFromMeshBounds(mesh_asset->bounds);
 
 	result->transform = TransformI();
 	result->transform.scale = V3(20.0f, 20.0f, 20.0f);
@@ -208,7 +164,8 @@ SpawnPlayer(Transform transform, GameState* game_state) {
 	result->health = 100.0f;
 	result->attack_damage = 10.0f;
 
-	result->bb_mesh_space = GetBoundingBoxFromMeshData(mesh_asset->data);
+	result->mesh_bounds = mesh_asset->bounds;
+	result->bb_mesh_space = GetBoundingBoxFromMeshBounds(mesh_asset->bounds);
 	result->transform = TransformI();
 	result->transform.scale = V3(1.0f, 1.0f, 1.0f);
 
@@ -238,152 +195,284 @@ SpawnLevelBoundary(BoundingBox box, GameState* game_state) {
 	return result;
 }
 
+// Moves the entity back inside when the other one is the level boundary
 static void
-ResolveCollision(Entity* a, Entity* b) {
-	if(a->properties & ENTITY_PROPERTY_LevelBoundary) {
-		b->transform.position.x = Clamp(a->bb_object_space.min.x + b->bb_object_space.size.x, b->transform.position.x, a->bb_object_space.max.x - b->bb_object_space.size.x);
-		b->transform.position.y = Clamp(a->bb_object_space.min.y + b->bb_object_space.size.y, b->transform.position.y, a->bb_object_space.max.y - b->bb_object_space.size.y);
+ResolveCollision(Entity* other, Entity* entity) {
+	if(other->properties & ENTITY_PROPERTY_LevelBoundary) {
+		entity->transform.position.x = Clamp(other->bb_object_space.min.x + entity->bb_object_space.size.x, entity->transform.position.x, other->bb_object_space.max.x - entity->bb_object_space.size.x);
+		entity->transform.position.y = Clamp(other->bb_object_space.min.y + entity->bb_object_space.size.y, entity->transform.position.y, other->bb_object_space.max.y - entity->bb_object_space.size.y);
 	}
-	if(b->properties & ENTITY_PROPERTY_LevelBoundary) {
-		a->transform.position.x = Clamp(b->bb_object_space.min.x + a->bb_object_space.size.x, a->transform.position.x, b->bb_object_space.max.x - a->bb_object_space.size.x);
-		a->transform.position.y = Clamp(b->bb_object_space.min.y + a->bb_object_space.size.y, a->transform.position.y, b->bb_object_space.max.y - a->bb_object_space.size.y);
+}
+
+static void
+ResolveCollisionDamage(Entity* other, Entity* entity) {
+	if(other->properties & ENTITY_PROPERTY_DealsCollisionDamage &&
+			entity->properties & ENTITY_PROPERTY_TakesCollisionDamage) {
+		entity->health -= other->attack_damage - entity->damage_reduction*other->attack_damage;
 	}
 }
 
 static void
-ResolveDamageExchange(Entity* a, Entity* b) {
-	if(a->properties & ENTITY_PROPERTY_DealsCollisionDamage &&
-			b->properties & ENTITY_PROPERTY_TakesCollisionDamage) {
-		b->health -= a->attack_damage - b->damage_reduction*a->attack_damage;
+RenderEntity(Entity* entity, EntityRenderInfo* info, GameState* game_state) {
+	if(entity->properties & ENTITY_PROPERTY_Mesh) {
+		MeshInfo mesh_info = {};
+		mesh_info.model = info->model;
+		mesh_info.color = V4FromV3(WHITE, 1.0f);
+
+		MeshPipeline pipeline = { entity->mesh_pipeline.mesh, &mesh_info };
+		PushMeshPipeline(pipeline, game_state->mesh_renderer);
+	}
+
+	if(entity->properties & ENTITY_PROPERTY_TexturedQuad) {
+		PushTexturedQuad(&entity->textured_quad.quad, 
+				entity->textured_quad.texture, game_state->quad_renderer);
 	}
 
-	if(b->properties & ENTITY_PROPERTY_DealsCollisionDamage &&
-			a->properties & ENTITY_PROPERTY_TakesCollisionDamage) {
-		a->health -= b->attack_damage - a->damage_reduction*b->attack_damage;
+	if(entity->properties & ENTITY_PROPERTY_BoundingBox) {
+		DebugDrawBox(entity->bb_object_space.min, entity->bb_object_space.max, V4FromV3(YELLOW, 1.0f), 2.0f,
+				game_state->debug_draw);
 	}
 }
 
+// Pushes go to the renderers in list order, so they stay on this thread
 static void
-UpdateEntities(GameState* game_state, Input* input) {
-#define DEBUG_BOUNDING_BOX
-	EntityBlob* blob = &game_state->entity_blob;
-	Entity* entity = blob->entities;
+RenderVisibleEntities(GameState* game_state, EntityFrame* frame) {
+	MemoryArena* arena = game_state->entity_blob.frame_arena;
+
+	Mat4 view_projection = MakeViewPerspective(game_state->camera);
+	Frustum frustum = ExtractFrustum(&view_projection);
+
+	CullBoxes boxes = AllocateCullBoxes(frame->count, arena);
+	CullSpheres spheres = AllocateCullSpheres(frame->count, arena);
+	u32* box_entities = PushArray(arena, u32, frame->count);
+	u32* sphere_entities = PushArray(arena, u32, frame->count);
+
+	for(u32 i=0; i<frame->count; i++) {
+		EntityRenderInfo* info = frame->render_info + i;
+		if(info->cull == ENTITY_CULL_Box) box_entities[AddCullBox(info->min, info->max, &boxes)] = i;
+		else if(info->cull == ENTITY_CULL_Sphere) sphere_entities[AddCullSphere(info->min, info->max.x, &spheres)] = i;
+		else RenderEntity(frame->entities[i], info, game_state);
+	}
+
+	u8* box_visible = PushArray(arena, u8, boxes.count);
+	u8* sphere_visible = PushArray(arena, u8, spheres.count);
+	CullBoxesSSE(&frustum, &boxes, box_visible, &game_state->cull_stats);
+	CullSpheresSSE(&frustum, &spheres, sphere_visible, &game_state->cull_stats);
+
+	for(u32 i=0; i<boxes.count; i++) {
+		u32 index = box_entities[i];
+		if(box_visible[i]) RenderEntity(frame->entities[index], frame->render_info + index, game_state);
+	}
+	for(u32 i=0; i<spheres.count; i++) {
+		u32 index = sphere_entities[i];
+		if(sphere_visible[i]) RenderEntity(frame->entities[index], frame->render_info + index, game_state);
+	}
+}
 
-	Entity** entities_with_bb = PushArrayClear(blob->frame_arena, Entity*, blob->entity_count);
-	Entity** entities_to_release = PushArrayClear(blob->frame_arena, Entity*, blob->entity_count);
+static PLATFORM_JOB_CALLBACK(DoEntityPhaseJob) {
+	EntityPhaseJob* job = (EntityPhaseJob*)data;
+	job->phase(job->frame, job->first, job->end);
+}
 
-	SpawnInfo* entities_to_spawn = 0;
-	u32 release_count = 0;
-	u32 bb_count = 0;
+// Splits [0, count) into jobs and waits for them
+static void
+RunEntityPhase(EntityFrame* frame, EntityPhase* phase, u32 count) {
+	GameState* game_state = frame->game_state;
+	u32 job_count = (count + ENTITY_PHASE_JOB_SIZE - 1)/ENTITY_PHASE_JOB_SIZE;
+	if(job_count < 2) {
+		phase(frame, 0, count);
+		return;
+	}
+
+	EntityPhaseJob* phase_jobs = PushArray(game_state->frame_arena, EntityPhaseJob, job_count);
+	PlatformJob* jobs = PushArray(game_state->frame_arena, PlatformJob, job_count);
+	for(u32 i=0; i<job_count; i++) {
+		EntityPhaseJob* job = phase_jobs + i;
+		job->frame = frame;
+		job->phase = phase;
+		job->first = i*ENTITY_PHASE_JOB_SIZE;
+		job->end = Min(count, job->first + ENTITY_PHASE_JOB_SIZE);
+		jobs[i].callback = DoEntityPhaseJob;
+		jobs[i].data = job;
+	}
 
-	struct EntityTeam {
-		Entity** entities;
-		u32 count;
-	};
+	PlatformJobCounter counter = {};
+	platform_api.add_jobs(game_state->job_system, jobs, job_count, &counter, 0);
+	platform_api.wait_for_counter(game_state->job_system, &counter);
+}
 
-	EntityTeam entities_on_team[TEAM_TOTAL] = {};
-	for(u8 i=0; i<TEAM_TOTAL; i++) {
-		entities_on_team[i].entities = PushArrayClear(blob->frame_arena, Entity*, blob->entity_count);
+// LSD radix sort on the bits of min.x flipped to order as unsigned, returns indices into the boxes
+static u32*
+SortEntitiesOnMinX(Entity** entities, u32 count, MemoryArena* arena) {
+	u32* keys = PushArray(arena, u32, count);
+	u32* indices = PushArray(arena, u32, count);
+	u32* temp_keys = PushArray(arena, u32, count);
+	u32* temp_indices = PushArray(arena, u32, count);
+
+	for(u32 i=0; i<count; i++) {
+		u32 bits;
+		CopyMem(&bits, &entities[i]->bb_object_space.min.x, sizeof(bits));
+		keys[i] = bits & 0x80000000 ? ~bits : bits | 0x80000000;
+		indices[i] = i;
 	}
 
-	while(entity) {
-		if(entity->properties & ENTITY_PROPERTY_BoundingBox) {
-			entities_with_bb[bb_count++] = entity;
+	for(u32 shift=0; shift<32 && count; shift+=8) {
+		u32 offsets[256] = {};
+		for(u32 i=0; i<count; i++) offsets[(keys[i] >> shift) & 0xff]++;
+		if(offsets[(keys[0] >> shift) & 0xff] == count) continue;
+
+		u32 total = 0;
+		for(u32 i=0; i<256; i++) {
+			u32 bucket_count = offsets[i];
+			offsets[i] = total;
+			total += bucket_count;
 		}
-		u8 team = entity->team;
-		u32 count = entities_on_team[team].count;
-		entities_on_team[team].entities[count] = entity;
-		entities_on_team[team].count++;
 
-		entity = entity->next;
+		for(u32 i=0; i<count; i++) {
+			u32 index = offsets[(keys[i] >> shift) & 0xff]++;
+			temp_keys[index] = keys[i];
+			temp_indices[index] = indices[i];
+		}
+
+		u32* swap = keys;
+		keys = temp_keys;
+		temp_keys = swap;
+		swap = indices;
+		indices = temp_indices;
+		temp_indices = swap;
 	}
 
-	for(u32 i=0; i<bb_count; i++) {
-		for(u32 j=i+1; j<bb_count; j++) {
-			Entity* a = entities_with_bb[i];
-			Entity* b = entities_with_bb[j];
-
-			if(BoundingBoxIntersect(&a->bb_object_space, &b->bb_object_space)) {
-				if((a->team != b->team) && ((a->response == RESPONSE_HOSTILE) || (b->response == RESPONSE_HOSTILE)))
-					ResolveDamageExchange(a, b);
-				ResolveCollision(a, b);
+	return indices;
+}
+
+// Boxes after the one at sorted position p that overlap it, a box starting past its max.x ends the sweep
+static u32
+SweepEntityPairs(EntityFrame* frame, u32 p, u32* pairs) {
+	u32 a = frame->bb_sorted[p];
+	BoundingBox* box = &frame->with_bb[a]->bb_object_space;
+
+	u32 count = 0;
+	for(u32 q=p+1; q<frame->bb_count; q++) {
+		u32 b = frame->bb_sorted[q];
+		BoundingBox* other = &frame->with_bb[b]->bb_object_space;
+		if(other->min.x > box->max.x) break;
+
+		if(BoundingBoxIntersect(box, other)) {
+			if(pairs) {
+				pairs[2*count] = a;
+				pairs[2*count + 1] = b;
 			}
+			count++;
 		}
 	}
+	return count;
+}
 
-	entity = blob->entities;
-	while(entity) {
-		if(!game_state->dev_mode & DEV_MODE_PAUSED) {
-			if(entity->properties & ENTITY_PROPERTY_SpinInPlace) {
-				Quat spin;
-				if(entity->spin_axis == AXIS_X)
-					spin = QuatMulF(QuatFromEuler(0.1f, 0.0f, 0.0f), entity->spin_amount);
-				if(entity->spin_axis == AXIS_Y)
-					spin = QuatMulF(QuatFromEuler(0.0f, 0.1f, 0.0f), entity->spin_amount);
-				if(entity->spin_axis == AXIS_Z)
-					spin = QuatMulF(QuatFromEuler(0.0f, 0.0f, 0.1f), entity->spin_amount);
-
-				entity->transform.rotation = QuatMul(spin, entity->transform.rotation); 
-			}
+static ENTITY_PHASE(CountEntityPairs) {
+	for(u32 p=first; p<end; p++) frame->pair_offsets[p] = SweepEntityPairs(frame, p, 0);
+}
 
-			if(entity->properties & ENTITY_PROPERTY_SimpleChase) {
-				Vec3 closest_target = V3Z();
-				float closest_distance = FLT_MAX;
+static ENTITY_PHASE(WriteEntityPairs) {
+	for(u32 p=first; p<end; p++) SweepEntityPairs(frame, p, frame->pairs + 2*frame->pair_offsets[p]);
+}
 
-				for(u32 i=0; i<TEAM_TOTAL; i++) {
-					if(entity->team == i) continue;
+// Every entity only changes itself, its contacts are in the order the pairs had when they were
+// resolved one after the other
+static ENTITY_PHASE(ResolveEntityContacts) {
+	for(u32 i=first; i<end; i++) {
+		Entity* entity = frame->with_bb[i];
+		u32* contacts = frame->contacts + frame->contact_offsets[i];
+		u32 contact_count = frame->contact_offsets[i + 1] - frame->contact_offsets[i];
+
+		for(u32 j=0; j<contact_count; j++) {
+			Entity* other = frame->with_bb[contacts[j]];
+			if((entity->team != other->team) && ((entity->response == RESPONSE_HOSTILE) || (other->response == RESPONSE_HOSTILE)))
+				ResolveCollisionDamage(other, entity);
+			ResolveCollision(other, entity);
+		}
+	}
+}
 
-					for(u32 j=0; j<entities_on_team[i].count; j++) {
-						Entity* other = entities_on_team[i].entities[j];
+static ENTITY_PHASE(MoveEntities) {
+	Input* input = frame->input;
 
-						if(other->team != entity->team && other->response == RESPONSE_HOSTILE) {
-							float distance = V3Mag(V3Sub(entity->transform.position, other->transform.position));
-							if(distance < closest_distance) {
-								closest_distance = distance;
-								closest_target = other->transform.position;
-							}
-						}
+	for(u32 index=first; index<end; index++) {
+		Entity* entity = frame->entities[index];
+
+		if(entity->properties & ENTITY_PROPERTY_SpinInPlace) {
+			Quat spin;
+			if(entity->spin_axis == AXIS_X)
+				spin = QuatMulF(QuatFromEuler(0.1f, 0.0f, 0.0f), entity->spin_amount);
+			if(entity->spin_axis == AXIS_Y)
+				spin = QuatMulF(QuatFromEuler(0.0f, 0.1f, 0.0f), entity->spin_amount);
+			if(entity->spin_axis == AXIS_Z)
+				spin = QuatMulF(QuatFromEuler(0.0f, 0.0f, 0.1f), entity->spin_amount);
+
+			entity->transform.rotation = QuatMul(spin, entity->transform.rotation); 
+		}
+
+		if(entity->properties & ENTITY_PROPERTY_SimpleChase) {
+			Vec3 closest_target = V3Z();
+			float closest_distance = FLT_MAX;
 
+			for(u32 i=0; i<TEAM_TOTAL; i++) {
+				if(entity->team == i) continue;
+
+				EntityTeam* team = frame->teams + i;
+				for(u32 j=0; j<team->count; j++) {
+					u32 other_index = team->entities[j];
+					Entity* other = frame->entities[other_index];
+
+					if(other->team != entity->team && other->response == RESPONSE_HOSTILE) {
+						Vec3 position = frame->chase_positions[other_index];
+						float distance = V3Mag(V3Sub(entity->transform.position, position));
+						if(distance < closest_distance) {
+							closest_distance = distance;
+							closest_target = position;
+						}
 					}
-				}
 
-				Vec3 dir = V3Norm(V3Sub(closest_target, entity->transform.position));
-				entity->transform.position = V3Add(entity->transform.position, 
-						V3MulF(dir, entity->speed*entity->acceleration));
+				}
 			}
 
-			if(entity->properties & ENTITY_PROPERTY_PlayerControlled) {
-				bool up = input->buttons[WIN32_BUTTON_W].held;
-				bool down = input->buttons[WIN32_BUTTON_S].held;
-				bool left = input->buttons[WIN32_BUTTON_A].held;
-				bool right = input->buttons[WIN32_BUTTON_D].held;
-
-				float scale_factor = V3Mag(entity->transform.scale) * 1000.0f;
-				if(up) entity->transform.position.y += 0.2f * scale_factor;
-				if(down) entity->transform.position.y -= 0.2f * scale_factor;
-				if(left) entity->transform.position.x -= 0.2f * scale_factor;
-				if(right) entity->transform.position.x += 0.2f * scale_factor;
-			}
+			Vec3 dir = V3Norm(V3Sub(closest_target, entity->transform.position));
+			entity->transform.position = V3Add(entity->transform.position, 
+					V3MulF(dir, entity->speed*entity->acceleration));
+		}
+
+		if(entity->properties & ENTITY_PROPERTY_PlayerControlled) {
+			bool up = input->buttons[WIN32_BUTTON_W].held;
+			bool down = input->buttons[WIN32_BUTTON_S].held;
+			bool left = input->buttons[WIN32_BUTTON_A].held;
+			bool right = input->buttons[WIN32_BUTTON_D].held;
+
+			float scale_factor = V3Mag(entity->transform.scale) * 1000.0f;
+			if(up) entity->transform.position.y += 0.2f * scale_factor;
+			if(down) entity->transform.position.y -= 0.2f * scale_factor;
+			if(left) entity->transform.position.x -= 0.2f * scale_factor;
+			if(right) entity->transform.position.x += 0.2f * scale_factor;
 		}
+	}
+}
+
+// Only marks what to spawn and release, UpdateEntities changes the blob after
+static ENTITY_PHASE(UpdateEntitySpawns) {
+	GameState* game_state = frame->game_state;
+
+	for(u32 index=first; index<end; index++) {
+		Entity* entity = frame->entities[index];
 
 		if(entity->properties & ENTITY_PROPERTY_EntitySpawner) {
 			SpawnerInfo* info = &entity->spawner_info;
 			if(info->spawn_id >= info->spawn_count) {
-				entities_to_release[release_count++] = entity;
+				frame->release[index] = true;
 			}
 
 			if(info->current_delta >= info->delta_times[info->spawn_id]) {
-
-				SpawnInfo* last = entities_to_spawn;
-				if(!entities_to_spawn) last = entities_to_spawn = PushStructClear(game_state->frame_arena, SpawnInfo);
-				else {
-					SpawnInfo* last_node = entities_to_spawn;
-					while(last_node->next) last_node = last_node->next;
-
-					last = last_node->next = PushStructClear(game_state->frame_arena, SpawnInfo);
-				}
-				last->type = info->entity_types[info->spawn_id];
-				last->transform = info->transforms[info->spawn_id];
+				SpawnInfo* spawn = frame->spawns + index;
+				spawn->type = info->entity_types[info->spawn_id];
+				spawn->transform = info->transforms[info->spawn_id];
+				frame->spawned[index] = true;
 				info->current_delta = 0;
 				info->spawn_id++;
 			}
@@ -391,35 +480,16 @@ UpdateEntities(GameState* game_state, Input* input) {
 			info->current_delta += game_state->timer.frame_time;
 		}
 
-		if(entity->properties & ENTITY_PROPERTY_Mesh) {
-			entity->mesh_pipeline.info = PushStructClear(blob->frame_arena, MeshInfo);
-			entity->mesh_pipeline.info->model = MakeTransformMatrix(entity->transform);
-			entity->mesh_pipeline.info->color = V4FromV3(WHITE, 1.0f);
-			PushMeshPipeline(entity->mesh_pipeline, game_state->mesh_renderer);
-		}
-
-		if(entity->properties & ENTITY_PROPERTY_TexturedQuad) {
-			PushTexturedQuad(&entity->textured_quad.quad, 
-					entity->textured_quad.texture, game_state->quad_renderer);
-		}
-
 		if(entity->properties & ENTITY_PROPERTY_HasHealth) {
 			if(entity->health <= 0) {
-				entities_to_release[release_count++] = entity;
+				frame->release[index] = true;
 #if 0 
 				if(entity->properties & ENTITY_PROPERTY_SpawnsParticleSystem) {
-
-					SpawnInfo* last = entities_to_spawn;
-					if(!entities_to_spawn) last = entities_to_spawn = PushStructClear(game_state->frame_arena, SpawnInfo);
-					else {
-						SpawnInfo* last_node = entities_to_spawn;
-						while(last_node->next) last_node = last_node->next;
-
-						last = last_node->next = PushStructClear(game_state->frame_arena, SpawnInfo);
-					}
-					last->type = ENTITY_FAB_PARTICLE_SYSTEM;
-					last->particle_system = entity->particle_system;
-					last->particle_system.spawn_position = entity->transform.position;
+					SpawnInfo* spawn = frame->spawns + index;
+					spawn->type = ENTITY_FAB_PARTICLE_SYSTEM;
+					spawn->particle_system = entity->particle_system;
+					spawn->particle_system.spawn_position = entity->transform.position;
+					frame->spawned[index] = true;
 				}
 #endif
 			}
@@ -429,7 +499,7 @@ UpdateEntities(GameState* game_state, Input* input) {
 		if(entity->properties & ENTITY_PROPERTY_HasParticleSystem) {
 			ParticleSystem* particles = &entity->particle_system;
 			if(particles->current_time >= particles->life_time) {
-				entities_to_release[release_count++] = entity;
+				frame->release[index] = true;
 			}
 			else {
 				if(!particles->init) {
@@ -480,59 +550,173 @@ UpdateEntities(GameState* game_state, Input* input) {
 			}
 		}
 #endif
-
-		if(entity->properties & ENTITY_PROPERTY_BoundingBox) {
-			entity->bb_object_space = UpdateBoundingBox(&entity->bb_mesh_space, &entity->transform);
-#ifdef DEBUG_BOUNDING_BOX
-			Vec3 min = entity->bb_object_space.min;
-			Vec3 max = entity->bb_object_space.max;
-			Line l1 = { V3(min.x, min.y, min.z), V3(min.x, max.y, min.z) };
-			Line l2 = { V3(min.x, min.y, max.z), V3(min.x, max.y, max.z) };
-			Line l3 = { V3(max.x, min.y, min.z), V3(max.x, max.y, min.z) };
-			Line l4 = { V3(max.x, min.y, max.z), V3(max.x, max.y, max.z) };
-			Line l5 = { V3(min.x, min.y, min.z), V3(max.x, min.y, min.z) };
-			Line l6 = { V3(min.x, min.y, max.z), V3(max.x, min.y, max.z) };
-			Line l7 = { V3(min.x, max.y, min.z), V3(max.x, max.y, min.z) };
-			Line l8 = { V3(min.x, max.y, max.z), V3(max.x, max.y, max.z) };
-			Line l9 = { V3(min.x, min.y, min.z), V3(min.x, min.y, max.z) };
-			Line l10 = { V3(min.x, max.y, min.z), V3(min.x, max.y, max.z) };
-			Line l11 = { V3(max.x, min.y, min.z), V3(max.x, min.y, max.z) };
-			Line l12 = { V3(max.x, max.y, min.z), V3(max.x, max.y, max.z) };
-			PushRenderLine(&l1, V4FromV3(YELLOW, 1.0f), 2.0f, game_state->camera, game_state->quad_renderer);
-			PushRenderLine(&l2, V4FromV3(BLUE, 1.0f), 2.0f, game_state->camera, game_state->quad_renderer);
-			PushRenderLine(&l3, V4FromV3(RED, 1.0f), 2.0f, game_state->camera, game_state->quad_renderer);
-			PushRenderLine(&l4, V4FromV3(GREEN, 1.0f), 2.0f, game_state->camera, game_state->quad_renderer);
-			PushRenderLine(&l5, V4FromV3(MAGENTA, 1.0f), 2.0f, game_state->camera, game_state->quad_renderer);
-			PushRenderLine(&l6, V4FromV3(PURPLE, 1.0f), 2.0f, game_state->camera, game_state->quad_renderer);
-			PushRenderLine(&l7, V4FromV3(TEAL, 1.0f), 2.0f, game_state->camera, game_state->quad_renderer);
-			PushRenderLine(&l8, V4FromV3(GREY, 1.0f), 2.0f, game_state->camera, game_state->quad_renderer);
-			PushRenderLine(&l9, V4FromV3(WHITE, 1.0f), 2.0f, game_state->camera, game_state->quad_renderer);
-			PushRenderLine(&l10, V4FromV3(MAROON, 1.0f), 2.0f, game_state->camera, game_state->quad_renderer);
-			PushRenderLine(&l11, V4FromV3(OLIVE, 1.0f), 2.0f, game_state->camera, game_state->quad_renderer);
-			PushRenderLine(&l12, V4FromV3(CYAN, 1.0f), 2.0f, game_state->camera, game_state->quad_renderer);
-#endif
-		}
-		entity = entity->next;
-	}
-
-	for(u32 i=0; i<release_count; i++) ReleaseEntity(entities_to_release[i], blob);
-	SpawnInfo* last = entities_to_spawn;
-	while(last) {
-		if(last->type == ENTITY_FAB_MINE) 
-			SpawnMine(last->transform, game_state);
-		last = last->next;
 	}
 }
 
+static ENTITY_PHASE(UpdateEntityBounds) {
+	CullBoxes local = SliceCullBoxes(&frame->bb_local, first, end);
+	BoundsTransforms transforms = SliceBoundsTransforms(&frame->bb_transforms, first, end);
+	CullBoxes world = SliceCullBoxes(&frame->bb_world, first, end);
+	for(u32 i=first; i<end; i++) {
+		Entity* entity = frame->with_bb[i];
+		BoundingBox* box = &entity->bb_mesh_space;
+		u32 index = i - first;
+		local.center_x[index] = (box->min.x + box->max.x)*0.5f;
+		local.center_y[index] = (box->min.y + box->max.y)*0.5f;
+		local.center_z[index] = (box->min.z + box->max.z)*0.5f;
+		local.extent_x[index] = (box->max.x - box->min.x)*0.5f;
+		local.extent_y[index] = (box->max.y - box->min.y)*0.5f;
+		local.extent_z[index] = (box->max.z - box->min.z)*0.5f;
+		SetBoundsTransform(index, &entity->transform, &transforms);
+	}
 
+	TransformBoundsSSE(&local, &transforms, &world);
 
+	for(u32 i=first; i<end; i++) {
+		u32 index = i - first;
+		Vec3 center = V3(world.center_x[index], world.center_y[index], world.center_z[index]);
+		Vec3 extent = V3(world.extent_x[index], world.extent_y[index], world.extent_z[index]);
+		BoundingBox* box = &frame->with_bb[i]->bb_object_space;
+		box->min = V3Sub(center, extent);
+		box->max = V3Add(center, extent);
+		box->size = extent;
+	}
+}
 
+// Bounding boxes are tested when the entity has one, otherwise the mesh sphere or the quad's extent
+static ENTITY_PHASE(ExtractEntityRenderInfo) {
+	for(u32 index=first; index<end; index++) {
+		Entity* entity = frame->entities[index];
+		EntityRenderInfo* info = frame->render_info + index;
+		info->cull = ENTITY_CULL_None;
+		if(entity->properties & ENTITY_PROPERTY_Mesh) info->model = MakeTransformMatrix(entity->transform);
 
+		if(entity->properties & ENTITY_PROPERTY_BoundingBox) {
+			info->cull = ENTITY_CULL_Box;
+			info->min = entity->bb_object_space.min;
+			info->max = entity->bb_object_space.max;
+		}
+		else if((entity->properties & ENTITY_PROPERTY_Mesh) && entity->mesh_bounds) {
+			Transform* transform = &entity->transform;
+			Vec4 center = M4MulV(info->model, V4FromV3(entity->mesh_bounds->sphere_center, 1.0f));
+			float scale = Max(Abs(transform->scale.x), Max(Abs(transform->scale.y), Abs(transform->scale.z)));
+
+			info->cull = ENTITY_CULL_Sphere;
+			info->min = V3(center.x, center.y, center.z);
+			info->max = V3(entity->mesh_bounds->sphere_radius*scale, 0.0f, 0.0f);
+		}
+		else if(entity->properties & ENTITY_PROPERTY_TexturedQuad) {
+			Quad* quad = &entity->textured_quad.quad;
+			Vec3 min = quad->tl;
+			Vec3 max = quad->tl;
+			Vec3 corners[] = { quad->tr, quad->bl, quad->br };
+			for(u8 i=0; i<ArrayCount(corners); i++) {
+				min = V3(Min(min.x, corners[i].x), Min(min.y, corners[i].y), Min(min.z, corners[i].z));
+				max = V3(Max(max.x, corners[i].x), Max(max.y, corners[i].y), Max(max.z, corners[i].z));
+			}
 
+			info->cull = ENTITY_CULL_Box;
+			info->min = min;
+			info->max = max;
+		}
+	}
+}
 
+// Runs as phases that each go wide over the entities on the job system: gather, broadphase,
+// contacts, movement, spawns, bounds and render extraction. Phases read only what earlier ones
+// wrote, so the frame comes out the same on any number of threads.
+static void
+UpdateEntities(GameState* game_state, Input* input) {
+	EntityBlob* blob = &game_state->entity_blob;
+	MemoryArena* arena = blob->frame_arena;
+
+	EntityFrame* frame = PushStructClear(arena, EntityFrame);
+	frame->game_state = game_state;
+	frame->input = input;
+
+	// Gather
+	u32 count = blob->entity_count;
+	frame->entities = PushArray(arena, Entity*, count);
+	frame->with_bb = PushArray(arena, Entity*, count);
+	for(u32 i=0; i<TEAM_TOTAL; i++) frame->teams[i].entities = PushArray(arena, u32, count);
+
+	for(Entity* entity = blob->entities; entity; entity = entity->next) {
+		Assert(frame->count < count);
+		u32 index = frame->count++;
+		frame->entities[index] = entity;
+		if(entity->properties & ENTITY_PROPERTY_BoundingBox) frame->with_bb[frame->bb_count++] = entity;
+
+		EntityTeam* team = frame->teams + entity->team;
+		team->entities[team->count++] = index;
+	}
 
+	// Broadphase
+	u32 bb_count = frame->bb_count;
+	frame->bb_sorted = SortEntitiesOnMinX(frame->with_bb, bb_count, arena);
+	frame->pair_offsets = PushArray(arena, u32, bb_count);
+	RunEntityPhase(frame, CountEntityPairs, bb_count);
 
+	u32 pair_count = 0;
+	for(u32 i=0; i<bb_count; i++) {
+		u32 box_pairs = frame->pair_offsets[i];
+		frame->pair_offsets[i] = pair_count;
+		pair_count += box_pairs;
+	}
+	frame->pairs = PushArray(arena, u32, 2*pair_count);
+	RunEntityPhase(frame, WriteEntityPairs, bb_count);
+
+	// Contacts of every box both ways round, going through them by box and writing each one to the
+	// other box's list leaves every list in ascending order
+	frame->contact_offsets = PushArrayClear(arena, u32, bb_count + 1);
+	frame->contacts = PushArray(arena, u32, 2*pair_count);
+	u32* unsorted = PushArray(arena, u32, 2*pair_count);
+	u32* contact_cursors = PushArray(arena, u32, bb_count);
+	for(u32 i=0; i<2*pair_count; i++) frame->contact_offsets[frame->pairs[i] + 1]++;
+	for(u32 i=0; i<bb_count; i++) {
+		frame->contact_offsets[i + 1] += frame->contact_offsets[i];
+		contact_cursors[i] = frame->contact_offsets[i];
+	}
+	for(u32 i=0; i<pair_count; i++) {
+		u32 a = frame->pairs[2*i];
+		u32 b = frame->pairs[2*i + 1];
+		unsorted[contact_cursors[a]++] = b;
+		unsorted[contact_cursors[b]++] = a;
+	}
+	for(u32 i=0; i<bb_count; i++) contact_cursors[i] = frame->contact_offsets[i];
+	for(u32 i=0; i<bb_count; i++) {
+		for(u32 j=frame->contact_offsets[i]; j<frame->contact_offsets[i + 1]; j++)
+			frame->contacts[contact_cursors[unsorted[j]]++] = i;
+	}
 
+	// Narrowphase and damage
+	RunEntityPhase(frame, ResolveEntityContacts, bb_count);
 
+	// Movement, chasers head for where their targets were when it started
+	if(!(game_state->dev_mode & DEV_MODE_PAUSED)) {
+		frame->chase_positions = PushArray(arena, Vec3, count);
+		for(u32 i=0; i<count; i++) frame->chase_positions[i] = frame->entities[i]->transform.position;
+		RunEntityPhase(frame, MoveEntities, count);
+	}
 
-
+	// Spawn and despawn
+	frame->release = PushArrayClear(arena, u8, count);
+	frame->spawned = PushArrayClear(arena, u8, count);
+	frame->spawns = PushArray(arena, SpawnInfo, count);
+	RunEntityPhase(frame, UpdateEntitySpawns, count);
+
+	// Bounds and render extraction
+	frame->bb_local = AllocateCullBoxes(bb_count, arena);
+	frame->bb_transforms = AllocateBoundsTransforms(bb_count, arena);
+	frame->bb_world = AllocateCullBoxes(bb_count, arena);
+	RunEntityPhase(frame, UpdateEntityBounds, bb_count);
+	frame->render_info = PushArray(arena, EntityRenderInfo, count);
+	RunEntityPhase(frame, ExtractEntityRenderInfo, count);
+	RenderVisibleEntities(game_state, frame);
+
+	for(u32 i=0; i<count; i++)
+		if(frame->release[i]) ReleaseEntity(frame->entities[i], blob);
+	for(u32 i=0; i<count; i++) {
+		if(frame->spawned[i] && frame->spawns[i].type == ENTITY_FAB_MINE) 
+			SpawnMine(frame->spawns[i].transform, game_state);
+	}
+}
@@ -17,6 +17,8 @@ enum ENTITIY_PROPERTY {
 };
 enum DEV_MODE {
 	DEV_MODE_PAUSED = 0x1,
+	DEV_MODE_RENDER_STATS = 0x2,
+	DEV_MODE_EDGES = 0x4,
 };
 
 enum AXIS { AXIS_X, AXIS_Y, AXIS_Z };
@@ -84,6 +86,7 @@ struct Entity {
 	u8 spin_axis;
 	float spin_amount;
 
+	MeshBounds* mesh_bounds;
 	BoundingBox bb_mesh_space; 
 	BoundingBox bb_object_space; 
 	u8 bb_orientation;
@@ -112,3 +115,60 @@ struct EntityBlob {
 
 };
 
+#define ENTITY_PHASE_JOB_SIZE 64		// entities per job
+
+struct EntityTeam {
+	u32* entities;				// indices into EntityFrame::entities
+	u32 count;
+};
+
+enum ENTITY_CULL { ENTITY_CULL_None, ENTITY_CULL_Box, ENTITY_CULL_Sphere };
+
+struct EntityRenderInfo {
+	u8 cull;
+	Vec3 min;					// the sphere's center
+	Vec3 max;					// the sphere's radius in x
+	Mat4 model;
+};
+
+// What the phases of one UpdateEntities share. A job writes only the entities of its range and
+// their slots in the arrays, the lists that change the blob are merged in list order after.
+struct EntityFrame {
+	struct GameState* game_state;
+	Input* input;
+
+	Entity** entities;			// list order
+	u32 count;
+	EntityTeam teams[TEAM_TOTAL];
+	Vec3* chase_positions;		// where everything was when movement started
+
+	// Boxes sorted on min.x, the pairs sweeping them finds and the contacts of each box both ways round
+	Entity** with_bb;
+	u32 bb_count;
+	u32* bb_sorted;
+	u32* pair_offsets;
+	u32* pairs;
+	u32* contact_offsets;
+	u32* contacts;
+
+	// Mesh space boxes and transforms of the boxed entities, in with_bb order
+	CullBoxes bb_local;
+	BoundsTransforms bb_transforms;
+	CullBoxes bb_world;
+
+	u8* release;
+	u8* spawned;
+	SpawnInfo* spawns;
+
+	EntityRenderInfo* render_info;
+};
+
+#define ENTITY_PHASE(name) void name(EntityFrame* frame, u32 first, u32 end)
+typedef ENTITY_PHASE(EntityPhase);
+
+struct EntityPhaseJob {
+	EntityFrame* frame;
+	EntityPhase* phase;
+	u32 first;
+	u32 end;
+};
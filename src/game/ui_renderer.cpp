@@ -54,6 +54,11 @@ struct UICachedData {
 	bool pressed;
 };
 
+struct UISnapshot {
+	UIData* data;
+	u32 count;
+};
+
 struct UIRenderer {
 	UIData* data;  // Generated every frame
 	UIElement* elements;
@@ -329,39 +334,34 @@ InitUIRenderer(Renderer* renderer, WindowDimensions wd, TextUI* text_ui, MemoryA
 }
 
 static void
-UIRenderElements(UIRenderer* ui_renderer, Renderer* renderer) {
-
-	SetRenderTarget* set_render_target = PushRenderCommand(renderer, SetRenderTarget);
-	set_render_target->render_target = &renderer->backbuffer;
-
-	SetBlendState* set_blend_state = PushRenderCommand(renderer, SetBlendState);
-	set_blend_state->type = BLEND_STATE_Regular;
-
-	SetRasterizerState* srs = PushRenderCommand(renderer, SetRasterizerState);
+UIRenderElements(UIData* data, u32 count, UIRenderer* ui_renderer, RenderCommandList* list) {
 
-	SetPrimitiveTopology* set_topology = PushRenderCommand(renderer, SetPrimitiveTopology);
-	set_topology->type = PRIMITIVE_TOPOLOGY_TriangleStrip;
-
-	SetVertexShader* set_vertex_shader = PushRenderCommand(renderer, SetVertexShader);
-	set_vertex_shader->vertex = ui_renderer->vs;
-
-	SetPixelShader* set_pixel_shader = PushRenderCommand(renderer, SetPixelShader);
-	set_pixel_shader->pixel = ui_renderer->ps;
-
-	SetStructuredBuffer* set_ui_buffer = PushRenderCommand(renderer, SetStructuredBuffer);
+	PushRenderBufferData* push_ui_buffer = PushRenderCommand(list,PushRenderBufferData);
+	push_ui_buffer->buffer = ui_renderer->sb->buffer;
+	push_ui_buffer->size = count * sizeof(UIData);
+	push_ui_buffer->data = data;
+
+	// Deepest ui layer, text goes on top
+	RenderPipelineState state = {};
+	state.render_target = &list->renderer->backbuffer;
+	state.blend = BLEND_STATE_Regular;
+	state.rasterizer = RASTERIZER_STATE_DoubleSided;
+	state.topology = PRIMITIVE_TOPOLOGY_TriangleStrip;
+	state.vs = ui_renderer->vs;
+	state.ps = ui_renderer->ps;
+	BeginRenderItem(RENDER_PASS_UI, &state, 0, 0, 1.0f, list);
+
+	SetStructuredBuffer* set_ui_buffer = PushRenderCommand(list, SetStructuredBuffer);
 	set_ui_buffer->vertex_shader = true;
 	set_ui_buffer->structured = ui_renderer->sb;
 	set_ui_buffer->slot = 0;
 
-	PushRenderBufferData* push_ui_buffer = PushRenderCommand(renderer,PushRenderBufferData);
-	push_ui_buffer->buffer = ui_renderer->sb->buffer;
-	push_ui_buffer->size = ui_renderer->element_counter * sizeof(UIData);
-	push_ui_buffer->data = ui_renderer->data;
-
-	DrawInstanced* draw_instanced = PushRenderCommand(renderer, DrawInstanced);
+	DrawInstanced* draw_instanced = PushRenderCommand(list, DrawInstanced);
 	draw_instanced->vertices_count = 4;
-	draw_instanced->instance_count = ui_renderer->element_counter;
+	draw_instanced->instance_count = count;
+	draw_instanced->offset = 0;
 
+	EndRenderItem(list);
 }
 
 static void
@@ -392,15 +392,23 @@ UIGenerateData(Input* input, UIRenderer* ui_renderer) {
 	}
 }
 
+// Operates the frame's elements and copies what they draw, the render stage records it from the copy
+// while the next frame is built
 static void
-UIRendererFrame(Input* input, UIRenderer* ui_renderer, Renderer* renderer) {
-
+SnapshotUIRenderer(Input* input, UIRenderer* ui_renderer, UISnapshot* snapshot, MemoryArena* arena) {
 	UIGenerateData(input, ui_renderer);
-	if(ui_renderer->element_counter)
-		UIRenderElements(ui_renderer, renderer);
+
+	snapshot->count = ui_renderer->element_counter;
+	snapshot->data = PushArray(arena, UIData, snapshot->count);
+	CopyMem(snapshot->data, ui_renderer->data, snapshot->count*sizeof(UIData));
+
 	ui_renderer->element_counter = 0;
 	ui_renderer->data = 0;
 	ui_renderer->elements = 0;
 }
 
-
+static void
+UISnapshotFrame(UISnapshot* snapshot, UIRenderer* ui_renderer, RenderCommandList* list) {
+	if(snapshot->count)
+		UIRenderElements(snapshot->data, snapshot->count, ui_renderer, list);
+}
@@ -161,11 +161,14 @@ static PLATFORM_ALLOCATE_MEMORY(win32_allocate_memory) {
 	Win32MemoryBlock* sentinel = &g_win32_state.memory_sentinel;
 
 	block->block.size = size;
+
+	EnterCriticalSection(&g_win32_state.memory_lock);
 	block->next = sentinel;
 	block->prev = sentinel->prev;
 
 	block->prev->next = block;
 	block->next->prev = block;
+	LeaveCriticalSection(&g_win32_state.memory_lock);
 
 	PlatformMemoryBlock* plat_block = &block->block;
 	return plat_block;
@@ -174,13 +177,286 @@ static PLATFORM_ALLOCATE_MEMORY(win32_allocate_memory) {
 static PLATFORM_DEALLOCATE_MEMORY(win32_deallocate_memory) {
 	if(block) {
 		Win32MemoryBlock* win32_block = (Win32MemoryBlock*)block;
+		EnterCriticalSection(&g_win32_state.memory_lock);
 		win32_block->prev->next = win32_block->next;
 		win32_block->next->prev = win32_block->prev;
+		LeaveCriticalSection(&g_win32_state.memory_lock);
 		bool result = VirtualFree(block, 0, MEM_RELEASE);
 		Assert(result);
 	}
 }
 
+static __declspec(thread) PlatformJobContext win32_job_context;
+
+static void
+Win32LockJobs(u32 volatile* lock) {
+	while(InterlockedExchange((LONG volatile*)lock, 1)) _mm_pause();
+}
+
+static void
+Win32UnlockJobs(u32 volatile* lock) {
+	_WriteBarrier();
+	*lock = 0;
+}
+
+static bool
+Win32PushJobDeque(Win32JobDeque* deque, PlatformJobEntry* entry) {
+	i64 bottom = deque->bottom;
+	i64 top = deque->top;
+	if(bottom - top >= JOB_DEQUE_SIZE) return false;
+
+	deque->entries[bottom & (JOB_DEQUE_SIZE - 1)] = *entry;
+	_WriteBarrier();
+	deque->bottom = bottom + 1;
+	return true;
+}
+
+static bool
+Win32PopJobDeque(Win32JobDeque* deque, PlatformJobEntry* entry) {
+	i64 bottom = deque->bottom - 1;
+	deque->bottom = bottom;
+	MemoryBarrier();
+	i64 top = deque->top;
+
+	if(top > bottom) {
+		deque->bottom = bottom + 1;
+		return false;
+	}
+
+	*entry = deque->entries[bottom & (JOB_DEQUE_SIZE - 1)];
+	if(top < bottom) return true;
+
+	// Last one, a thief may be taking it too
+	bool taken = InterlockedCompareExchange64((LONG64 volatile*)&deque->top, top + 1, top) == top;
+	deque->bottom = bottom + 1;
+	return taken;
+}
+
+static bool
+Win32StealJobDeque(Win32JobDeque* deque, PlatformJobEntry* entry) {
+	i64 top = deque->top;
+	MemoryBarrier();
+	i64 bottom = deque->bottom;
+	if(top >= bottom) return false;
+
+	*entry = deque->entries[top & (JOB_DEQUE_SIZE - 1)];
+	return InterlockedCompareExchange64((LONG64 volatile*)&deque->top, top + 1, top) == top;
+}
+
+// Own deque first, then the shared queue, then the other workers'
+static bool
+Win32TakeJob(PlatformJobSystem* system, PlatformJobEntry* entry) {
+	u32 thread_index = win32_job_context.thread_index;
+	if(thread_index && Win32PopJobDeque(system->deques + thread_index - 1, entry)) return true;
+
+	if(system->shared_read != system->shared_write) {
+		bool taken = false;
+		Win32LockJobs(&system->shared_lock);
+		if(system->shared_read != system->shared_write) {
+			*entry = system->shared[system->shared_read & (JOB_SHARED_QUEUE_SIZE - 1)];
+			_WriteBarrier();
+			system->shared_read++;
+			taken = true;
+		}
+		Win32UnlockJobs(&system->shared_lock);
+		if(taken) return true;
+	}
+
+	for(u32 i=0; i<system->worker_count; i++) {
+		u32 victim = (thread_index + i) % system->worker_count;
+		if(victim + 1 == thread_index) continue;
+		if(Win32StealJobDeque(system->deques + victim, entry)) return true;
+	}
+	return false;
+}
+
+static void Win32PushJobs(PlatformJobSystem* system, PlatformJob* jobs, u32 count, PlatformJobCounter* counter);
+
+// The thread that takes the count to zero holds the lock while it does, so a waiter that saw
+// zero and no lock is the last one to touch the counter
+static void
+Win32FinishJob(PlatformJobSystem* system, PlatformJobCounter* counter) {
+	for(;;) {
+		u32 count = counter->count;
+		Assert(count);
+		if(count > 1) {
+			if((u32)InterlockedCompareExchange((LONG volatile*)&counter->count, count - 1, count) == count) return;
+			continue;
+		}
+
+		PlatformJob* dependents = 0;
+		u32 dependent_count = 0;
+		PlatformJobCounter* dependent_counter = 0;
+
+		Win32LockJobs(&counter->lock);
+		if(InterlockedDecrement((LONG volatile*)&counter->count) == 0) {
+			dependents = counter->dependents;
+			dependent_count = counter->dependent_count;
+			dependent_counter = counter->dependent_counter;
+			counter->dependents = 0;
+		}
+		Win32UnlockJobs(&counter->lock);
+
+		if(dependents) Win32PushJobs(system, dependents, dependent_count, dependent_counter);
+		return;
+	}
+}
+
+static void
+Win32RunJob(PlatformJobSystem* system, PlatformJobEntry* entry) {
+	PlatformJobContext* context = &win32_job_context;
+	Assert(context->scratch);
+
+	// Jobs run inside a wait stack their scratch on top of the waiting job's
+	u64 used = context->scratch->used;
+	entry->callback(context, entry->data);
+	context->scratch->used = used;
+
+	if(entry->counter) Win32FinishJob(system, entry->counter);
+}
+
+static void
+Win32PushJobs(PlatformJobSystem* system, PlatformJob* jobs, u32 count, PlatformJobCounter* counter) {
+	u32 thread_index = win32_job_context.thread_index;
+
+	for(u32 i=0; i<count; i++) {
+		PlatformJobEntry entry = { jobs[i].callback, jobs[i].data, counter };
+		if(thread_index) {
+			// A full deque runs the job in place
+			if(!Win32PushJobDeque(system->deques + thread_index - 1, &entry)) Win32RunJob(system, &entry);
+			continue;
+		}
+
+		Win32LockJobs(&system->shared_lock);
+		while(system->shared_write - system->shared_read == JOB_SHARED_QUEUE_SIZE) {
+			Win32UnlockJobs(&system->shared_lock);
+			PlatformJobEntry other;
+			if(Win32TakeJob(system, &other)) Win32RunJob(system, &other);
+			Win32LockJobs(&system->shared_lock);
+		}
+		system->shared[system->shared_write & (JOB_SHARED_QUEUE_SIZE - 1)] = entry;
+		_WriteBarrier();
+		system->shared_write++;
+		Win32UnlockJobs(&system->shared_lock);
+	}
+
+	// Pairs with the sleeping count going up before a worker looks for jobs one last time
+	MemoryBarrier();
+	u32 wake = Min(count, system->sleeping);
+	if(wake) ReleaseSemaphore(system->semaphore, wake, 0);
+}
+
+static PLATFORM_ADD_JOBS(win32_add_jobs) {
+	if(!count) return;
+	if(counter) AtomicAddU32(&counter->count, count);
+
+	if(dependency) {
+		Win32LockJobs(&dependency->lock);
+		bool park = dependency->count != 0;
+		if(park) {
+			Assert(!dependency->dependents);
+			dependency->dependents = jobs;
+			dependency->dependent_count = count;
+			dependency->dependent_counter = counter;
+		}
+		Win32UnlockJobs(&dependency->lock);
+		if(park) return;
+	}
+
+	Win32PushJobs(system, jobs, count, counter);
+}
+
+// The calling thread runs jobs instead of waiting
+static PLATFORM_WAIT_FOR_COUNTER(win32_wait_for_counter) {
+	while(counter->count || counter->lock) {
+		PlatformJobEntry entry;
+		if(Win32TakeJob(system, &entry)) Win32RunJob(system, &entry);
+		else _mm_pause();
+	}
+}
+
+static DWORD WINAPI
+Win32WorkerThreadProc(LPVOID param) {
+	Win32JobThread* thread = (Win32JobThread*)param;
+	PlatformJobSystem* system = thread->system;
+	win32_job_context.thread_index = thread->thread_index;
+	win32_job_context.scratch = win32_allocate_memory(JOB_SCRATCH_SIZE);
+
+	for(;;) {
+		PlatformJobEntry entry;
+		bool found = false;
+		for(u32 spin=0; spin<JOB_SPIN_COUNT && !found; spin++) {
+			found = Win32TakeJob(system, &entry);
+			if(!found) _mm_pause();
+		}
+
+		if(!found) {
+			InterlockedIncrement((LONG volatile*)&system->sleeping);
+			found = Win32TakeJob(system, &entry);
+			if(!found) WaitForSingleObjectEx(system->semaphore, INFINITE, FALSE);
+			InterlockedDecrement((LONG volatile*)&system->sleeping);
+		}
+
+		if(found) Win32RunJob(system, &entry);
+	}
+}
+
+// One per core besides the main thread's
+static u32
+Win32GetWorkerCount() {
+	SYSTEM_INFO info = {};
+	GetSystemInfo(&info);
+	return Min((u32)info.dwNumberOfProcessors - 1, MAX_WORKER_THREADS);
+}
+
+static PlatformJobSystem*
+Win32CreateJobSystem(u32 worker_count) {
+	Assert(worker_count <= MAX_WORKER_THREADS);
+	PlatformJobSystem* system = (PlatformJobSystem*)win32_allocate_memory(sizeof(PlatformJobSystem))->bp;
+	system->worker_count = worker_count;
+	system->semaphore = CreateSemaphoreExA(0, 0, MAX_WORKER_THREADS, 0, 0, SEMAPHORE_ALL_ACCESS);
+
+	// The creating thread is the one that adds and waits outside of jobs, it runs them while waiting
+	if(!win32_job_context.scratch) win32_job_context.scratch = win32_allocate_memory(JOB_SCRATCH_SIZE);
+
+	for(u32 i=0; i<worker_count; i++) {
+		Win32JobThread* thread = system->threads + i;
+		thread->system = system;
+		thread->thread_index = i + 1;
+
+		HANDLE handle = CreateThread(0, 0, Win32WorkerThreadProc, thread, 0, 0);
+		CloseHandle(handle);
+	}
+	return system;
+}
+
+static PLATFORM_JOB_CALLBACK(Win32DoWorkQueueEntry) {
+	PlatformWorkQueueEntry* entry = (PlatformWorkQueueEntry*)data;
+	entry->callback(entry->queue, entry->data);
+}
+
+static PLATFORM_ADD_WORK_ENTRY(win32_add_work_entry) {
+	Assert(queue->entry_count < MAX_WORK_QUEUE_ENTRIES);
+	PlatformWorkQueueEntry* entry = queue->entries + queue->entry_count++;
+	entry->queue = queue;
+	entry->callback = callback;
+	entry->data = data;
+
+	PlatformJob job = { Win32DoWorkQueueEntry, entry };
+	win32_add_jobs(queue->system, &job, 1, &queue->counter, 0);
+}
+
+static PLATFORM_COMPLETE_ALL_WORK(win32_complete_all_work) {
+	win32_wait_for_counter(queue->system, &queue->counter);
+	queue->entry_count = 0;
+}
+
+static void
+Win32InitWorkQueue(PlatformWorkQueue* queue, PlatformJobSystem* system) {
+	ZeroStruct(*queue);
+	queue->system = system;
+}
+
 static PLATFORM_OPEN_FILE(win32_open_file) {
 	PlatformFileHandle result = {};
 	char* filename = (char*)info->name;
@@ -205,7 +481,75 @@ static PLATFORM_CLOSE_FILE(win32_close_file) {
 static PLATFORM_READ_FILE(win32_read_file) {
 	Assert(!win32_handle->failed);
 	HANDLE handle = *(HANDLE*)&win32_handle->handle;
-	Assert(ReadFile(handle, dst, size, 0, 0)); 
+
+	// ReadFile takes a 32 bit size
+	u8* cursor = (u8*)dst;
+	while(size) {
+		DWORD chunk = size > Gigabytes(1) ? (DWORD)Gigabytes(1) : (DWORD)size;
+		DWORD bytes_read = 0;
+		Assert(ReadFile(handle, cursor, chunk, &bytes_read, 0)); 
+		Assert(bytes_read == chunk);
+		cursor += chunk;
+		size -= chunk;
+	}
+}
+
+static PLATFORM_MAP_FILE(win32_map_file) {
+	PlatformFileMapping result = {};
+	char* filename = (char*)info->name;
+
+	HANDLE handle = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, 0, 0);
+	if(handle == INVALID_HANDLE_VALUE) {
+		result.failed = true;
+		return result;
+	}
+
+	LARGE_INTEGER li = {};
+	GetFileSizeEx(handle, &li);
+	info->size = li.QuadPart;
+
+	HANDLE mapping = CreateFileMappingA(handle, 0, PAGE_READONLY, 0, 0, 0);
+	void* data = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : 0;
+	if(!data) {
+		if(mapping) CloseHandle(mapping);
+		CloseHandle(handle);
+		result.failed = true;
+		return result;
+	}
+
+	result.handle = handle;
+	result.mapping = mapping;
+	result.data = (u8*)data;
+	result.size = info->size;
+
+	return result;
+}
+
+static PLATFORM_UNMAP_FILE(win32_unmap_file) {
+	Assert(!file_mapping->failed);
+	UnmapViewOfFile(file_mapping->data);
+	CloseHandle((HANDLE)file_mapping->mapping);
+	CloseHandle((HANDLE)file_mapping->handle);
+	*file_mapping = {};
+}
+
+static PLATFORM_WRITE_ENTIRE_FILE(win32_write_entire_file) {
+	HANDLE handle = CreateFileA(path, GENERIC_WRITE, 0, 0, CREATE_ALWAYS, 0, 0);
+	if(handle == INVALID_HANDLE_VALUE) return false;
+
+	// WriteFile takes a 32 bit size
+	bool result = true;
+	u8* cursor = (u8*)data;
+	while(size && result) {
+		DWORD chunk = size > Gigabytes(1) ? (DWORD)Gigabytes(1) : (DWORD)size;
+		DWORD bytes_written = 0;
+		result = WriteFile(handle, cursor, chunk, &bytes_written, 0) && bytes_written == chunk;
+		cursor += chunk;
+		size -= chunk;
+	}
+
+	CloseHandle(handle);
+	return result;
 }
 
 static void
@@ -323,6 +667,16 @@ WinMain(HINSTANCE instance, HINSTANCE prev_instance, LPSTR cmdline, int show_cod
 	Win32MemoryBlock* sentinel = &g_win32_state.memory_sentinel;
 	sentinel->next = sentinel;
 	sentinel->prev = sentinel;
+	InitializeCriticalSection(&g_win32_state.memory_lock);
+
+	u32 worker_count = Win32GetWorkerCount();
+	PlatformJobSystem* job_system = Win32CreateJobSystem(worker_count);
+	PlatformWorkQueue work_queue;
+	Win32InitWorkQueue(&work_queue, job_system);
+
+	// The game's render stage, one frame in flight so frames are submitted in order
+	PlatformWorkQueue render_queue;
+	Win32InitWorkQueue(&render_queue, job_system);
 
 	Win32DLL game_code           = {};
 	game_code.transient_dll_name = "game_temp.dll";
@@ -337,11 +691,22 @@ WinMain(HINSTANCE instance, HINSTANCE prev_instance, LPSTR cmdline, int show_cod
 	win32_api.open_file         = win32_open_file;
 	win32_api.close_file        = win32_close_file;
 	win32_api.read_file         = win32_read_file;
+	win32_api.map_file          = win32_map_file;
+	win32_api.unmap_file        = win32_unmap_file;
+	win32_api.write_entire_file = win32_write_entire_file;
 	win32_api.allocate_memory   = win32_allocate_memory;
 	win32_api.deallocate_memory = win32_deallocate_memory;
+	win32_api.add_work_entry    = win32_add_work_entry;
+	win32_api.complete_all_work = win32_complete_all_work;
+	win32_api.add_jobs          = win32_add_jobs;
+	win32_api.wait_for_counter  = win32_wait_for_counter;
 
 	GameLayer game_layer = {};
 	game_layer.platform_api = win32_api;
+	game_layer.job_system = job_system;
+	game_layer.work_queue = &work_queue;
+	game_layer.worker_count = worker_count;
+	game_layer.render_queue = &render_queue;
 
 	g_win32_window.handle = window;
 	g_win32_window.dim = Win32GetWindowDimensions(window);
@@ -430,6 +795,8 @@ WinMain(HINSTANCE instance, HINSTANCE prev_instance, LPSTR cmdline, int show_cod
 		g_game_functions.game_loop(&game_layer, &g_win32_window, &input);
 
 		if(Win32HasDLLChanged(&game_code)) {
+			// The frame in flight runs code from the old dll
+			win32_complete_all_work(&render_queue);
 			Win32ReloadDLL(&g_win32_state, &game_code); 
 			game_layer.executable_reloaded = true;
 		}
@@ -460,6 +827,8 @@ WinMain(HINSTANCE instance, HINSTANCE prev_instance, LPSTR cmdline, int show_cod
 
 		LastCounter = EndCounter;
 	}
+
+	win32_complete_all_work(&render_queue);
 	return 1;
 }
 
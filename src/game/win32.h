@@ -27,8 +27,64 @@ struct Win32MemoryBlock {
 	Win32MemoryBlock* next;
 };
 
+#define MAX_WORK_QUEUE_ENTRIES 256
+#define MAX_WORKER_THREADS 8
+#define JOB_DEQUE_SIZE 4096				// per worker, a power of two
+#define JOB_SHARED_QUEUE_SIZE 4096		// a power of two
+#define JOB_SCRATCH_SIZE Megabytes(1)
+#define JOB_SPIN_COUNT 256				// tries before a worker sleeps
+
+struct PlatformJobEntry {
+	PlatformJobCallback* callback;
+	void* data;
+	PlatformJobCounter* counter;
+};
+
+// Chase-Lev, the owner pushes and pops at the bottom, thieves take from the top
+struct Win32JobDeque {
+	i64 volatile top;
+	u8 pad[56];
+	i64 volatile bottom;
+	PlatformJobEntry entries[JOB_DEQUE_SIZE];
+};
+
+struct Win32JobThread {
+	PlatformJobSystem* system;
+	u32 thread_index;
+};
+
+struct PlatformJobSystem {
+	Win32JobDeque deques[MAX_WORKER_THREADS];	// worker n owns deques[n - 1]
+	Win32JobThread threads[MAX_WORKER_THREADS];
+	u32 worker_count;
+
+	// Jobs from threads that are not workers, a ring behind a spin lock
+	u32 volatile shared_lock;
+	u32 volatile shared_read;
+	u32 volatile shared_write;
+	PlatformJobEntry shared[JOB_SHARED_QUEUE_SIZE];
+
+	u32 volatile sleeping;
+	HANDLE semaphore;
+};
+
+struct PlatformWorkQueueEntry {
+	PlatformWorkQueue* queue;
+	PlatformWorkQueueCallback* callback;
+	void* data;
+};
+
+// A counter on the job system
+struct PlatformWorkQueue {
+	PlatformJobSystem* system;
+	PlatformJobCounter counter;
+	u32 entry_count;
+	PlatformWorkQueueEntry entries[MAX_WORK_QUEUE_ENTRIES];
+};
+
 struct Win32State {
 	Win32MemoryBlock memory_sentinel;
+	CRITICAL_SECTION memory_lock;	// arenas on worker threads allocate blocks too
 
 	char exe_absfilepath[MAX_PATH];
 	char exe_absfolderpath[MAX_PATH];
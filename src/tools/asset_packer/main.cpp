@@ -1,5 +1,9 @@
 #include <stdint.h>
 #include <string.h>
+#include <math.h>
+#include <float.h>
+#include <stdio.h>
+#include <stdlib.h>
 
 #define WIN32_LEAN_AND_MEAN
 #include <windows.h>
@@ -8,16 +12,29 @@
 #include "../include/cgltf.h"
 #define STB_IMAGE_IMPLEMENTATION
 #include "../include/stb_image.h"
+#define STB_RECT_PACK_IMPLEMENTATION
+#include "../include/stb_rect_pack.h"
+#define STB_TRUETYPE_IMPLEMENTATION
+#include "../include/stb_truetype.h"
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include "../include/stb_image_write.h"
 
 typedef uint8_t u8;
 typedef uint16_t u16;
 typedef uint32_t u32;
 typedef uint64_t u64;
+typedef int8_t i8;
+
+#define ArrayCount(Array) (sizeof(Array) / sizeof((Array)[0]))
 
 #include <intrin.h>
 #define Assert(cond) do { if (!(cond)) __debugbreak(); } while (0)
 
+// ReadFile/WriteFile take a DWORD count
+#define MAX_IO_CHUNK (1u << 30)
+
 #include "buffers.cpp"
+#include "../../game/sdf.cpp"
 #include "../../game/asset_formats.h"
 #include "../../game/file_formats.h"
 
@@ -28,12 +45,21 @@ enum ASSET_TYPE {
 	ASSET_TYPE_TOTAL
 };
 
+// Subfolders of the asset root, a missing subfolder just packs no assets of that type
 char* asset_path_dir[ASSET_TYPE_TOTAL] = { 
-	"../assets/models",
-	"../assets/textures",
-	"../assets/fonts"
+	"models",
+	"textures",
+	"fonts"
 };
 
+// Glyph pixel height the SDF atlas is generated at, and the distance range around the outline in pixels
+#define SDF_BASE_SIZE 48
+#define SDF_PADDING 6
+
+#define FONT_FIRST_CODEPOINT 0x20
+#define FONT_CODEPOINT_COUNT (0x7F - 0x20)
+#define MAX_FONT_ATLAS_DIM 4096
+
 char* asset_file_format[ASSET_TYPE_TOTAL] = {
 	"gltf",
 	"png",
@@ -58,6 +84,9 @@ enum FORMAT {
 	FORMAT_PIXELS,
 
 	FORMAT_FONT,
+	FORMAT_FONT_ATLAS,
+	FORMAT_PACKED_CHAR,
+	FORMAT_FONT_PIXELS,
 	FORMAT_TTF,
 
 	FORMAT_TOTAL
@@ -81,9 +110,19 @@ u32 format_elem_sizes[FORMAT_TOTAL] {
 		sizeof(u8),
 
 		sizeof(FontFormat),
+		sizeof(FontAtlasFormat),
+		sizeof(PackedCharFormat),
+		sizeof(u8),
 		sizeof(u8)
 };
 
+static float DistanceSq3(float* a, float* b) {
+	float x = a[0] - b[0];
+	float y = a[1] - b[1];
+	float z = a[2] - b[2];
+	return x*x + y*y + z*z;
+}
+
 char* StrPrepend(char* string, char* prepend) {
 	u8 string_len = strlen(string);
 	u8 prepend_len = strlen(prepend);
@@ -120,6 +159,14 @@ char* MakeFullPath(char* dir, char* name, char* format) {
 	return result;
 }
 
+char* MakeDirPath(char* root, char* sub_dir) {
+	char* result = (char*)calloc(strlen(root)+strlen(sub_dir)+2, sizeof(char));
+	strcpy(result, root);
+	strcat(result, "/");
+	strcat(result, sub_dir);
+	return result;
+}
+
 struct FileInfo {
 	char* name;  // filename without format
 	char* format; // format prepended with .
@@ -139,7 +186,7 @@ static u32 FindNumberOfFilesInDir(char* full_folder_dir, char* dot_file_format)
 	WIN32_FIND_DATA fd;
 
 	h = FindFirstFile(full_folder_dir, &fd);
-	Assert(h != INVALID_HANDLE_VALUE);
+	if(h == INVALID_HANDLE_VALUE) return 0;
 
 	do {
 		if(StrHasStrEnd(fd.cFileName, dot_file_format)) file_count++;
@@ -160,6 +207,8 @@ static FolderInfo LoadFolder(char* dir, char* file_format) {
 	strcat(full_folder_dir, "\\*");
 
 	u32 file_count = FindNumberOfFilesInDir(full_folder_dir, dot_file_format);
+	folder_info.dir = dir;
+	if(!file_count) return folder_info;
 
 	WIN32_FIND_DATA fd;
 	HANDLE h;
@@ -189,25 +238,277 @@ static FolderInfo LoadFolder(char* dir, char* file_format) {
 		}
 	} while(FindNextFile(h, &fd) != 0); 
 
-	folder_info.dir = dir;
 	folder_info.files = file_info_a;
 	folder_info.file_count = file_count;
 
 	return folder_info;
 };
 
+// positions are packed float3, hull receives indices into positions
+static void
+ComputeMeshBounds(float* positions, u32 count, MeshFormat* mf, u32* hull) {
+	Assert(count);
+
+	for(u8 k=0; k<3; k++) mf->aabb_min[k] = mf->aabb_max[k] = positions[k];
+	for(u32 i=1; i<count; i++) {
+		float* p = positions + i*3;
+		for(u8 k=0; k<3; k++) {
+			if(p[k] < mf->aabb_min[k]) mf->aabb_min[k] = p[k];
+			if(p[k] > mf->aabb_max[k]) mf->aabb_max[k] = p[k];
+		}
+	}
+
+	// Ritter, seeded with an approximately most distant pair
+	u32 y = 0, z = 0;
+	float best = -1.0f;
+	for(u32 i=0; i<count; i++) {
+		float d = DistanceSq3(positions, positions + i*3);
+		if(d > best) { best = d; y = i; }
+	}
+	best = -1.0f;
+	for(u32 i=0; i<count; i++) {
+		float d = DistanceSq3(positions + y*3, positions + i*3);
+		if(d > best) { best = d; z = i; }
+	}
+
+	float* c = mf->sphere_center;
+	for(u8 k=0; k<3; k++) c[k] = (positions[y*3 + k] + positions[z*3 + k])*0.5f;
+	float r = sqrtf(best)*0.5f;
+
+	for(u32 i=0; i<count; i++) {
+		float* p = positions + i*3;
+		float d = sqrtf(DistanceSq3(c, p));
+		if(d > r) {
+			float new_r = (r + d)*0.5f;
+			float t = (new_r - r)/d;
+			for(u8 k=0; k<3; k++) c[k] += (p[k] - c[k])*t;
+			r = new_r;
+		}
+	}
+
+	// The aabb centred sphere is sometimes tighter for boxy meshes
+	float aabb_c[3], aabb_r = 0.0f;
+	for(u8 k=0; k<3; k++) aabb_c[k] = (mf->aabb_min[k] + mf->aabb_max[k])*0.5f;
+	for(u32 i=0; i<count; i++) {
+		float d = DistanceSq3(aabb_c, positions + i*3);
+		if(d > aabb_r) aabb_r = d;
+	}
+	aabb_r = sqrtf(aabb_r);
+	if(aabb_r < r) {
+		for(u8 k=0; k<3; k++) c[k] = aabb_c[k];
+		r = aabb_r;
+	}
+	mf->sphere_radius = r;
+
+	// Simplified hull, the extreme vertex along each 26-DOP direction
+	mf->hull_count = 0;
+	for(i8 dx=-1; dx<=1; dx++)
+	for(i8 dy=-1; dy<=1; dy++)
+	for(i8 dz=-1; dz<=1; dz++) {
+		if(!dx && !dy && !dz) continue;
+
+		u32 extreme = 0;
+		float extreme_d = -FLT_MAX;
+		for(u32 i=0; i<count; i++) {
+			float* p = positions + i*3;
+			float d = p[0]*dx + p[1]*dy + p[2]*dz;
+			if(d > extreme_d) { extreme_d = d; extreme = i; }
+		}
+
+		bool duplicate = false;
+		for(u32 i=0; i<mf->hull_count; i++)
+			if(hull[i] == extreme) duplicate = true;
+		if(!duplicate) hull[mf->hull_count++] = extreme;
+	}
+	Assert(mf->hull_count <= MAX_MESH_HULL_POINTS);
+}
+
 static void
 CopyFileToStructBuffer(char* path, u64 size, StructBuffer* buffer) {
 	ReserveMemoryStructBuffer(size, buffer);
 
 	HANDLE h = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, 0, 0);
 	Assert(h != INVALID_HANDLE_VALUE);
-	Assert(ReadFile(h, buffer->data, size, 0, 0));
+
+	u8* cursor = (u8*)GetCursorStructBuffer(buffer);
+	u64 remaining = size;
+	while(remaining) {
+		DWORD chunk = remaining > MAX_IO_CHUNK ? MAX_IO_CHUNK : (DWORD)remaining;
+		DWORD bytes_read = 0;
+		Assert(ReadFile(h, cursor, chunk, &bytes_read, 0));
+		Assert(bytes_read == chunk);
+		cursor += chunk;
+		remaining -= chunk;
+	}
+	CloseHandle(h);
 
 	buffer->filled_count += size;
 }
 
+// One SDF atlas per font, scaled to any size at draw time
+// Grows the atlas until the whole codepoint range fits
+static void
+BakeSDFAtlas(u8* ttf, FontAtlasFormat* atlas, StructBuffer* packed_chars, StructBuffer* pixels) {
+	stbtt_fontinfo font_info;
+	Assert(stbtt_InitFont(&font_info, ttf, stbtt_GetFontOffsetForIndex(ttf, 0)));
+
+	int ascent, descent, line_gap;
+	float scale_factor = stbtt_ScaleForPixelHeight(&font_info, (float)SDF_BASE_SIZE);
+	stbtt_GetFontVMetrics(&font_info, &ascent, &descent, &line_gap); 
+
+	SDFGlyph glyphs[FONT_CODEPOINT_COUNT];
+	stbrp_rect rects[FONT_CODEPOINT_COUNT];
+	for(u32 i=0; i<FONT_CODEPOINT_COUNT; i++) {
+		glyphs[i] = GenerateGlyphSDF(&font_info, FONT_FIRST_CODEPOINT + i, scale_factor, SDF_PADDING, true);
+		rects[i] = {};
+		rects[i].id = i;
+		rects[i].w = glyphs[i].width + 1;		// gutter against bilinear bleed
+		rects[i].h = glyphs[i].height + 1;
+	}
+
+	u32 dim = 128;
+	stbrp_node nodes[MAX_FONT_ATLAS_DIM];
+	for(;;) {
+		Assert(dim <= MAX_FONT_ATLAS_DIM);
+		stbrp_context context;
+		stbrp_init_target(&context, dim, dim, nodes, dim);
+		if(stbrp_pack_rects(&context, rects, FONT_CODEPOINT_COUNT)) break;
+		dim *= 2;
+	}
+
+	u8* bitmap = (u8*)calloc(dim*dim, sizeof(u8));
+	PackedCharFormat chars[FONT_CODEPOINT_COUNT] = {};
+	for(u32 i=0; i<FONT_CODEPOINT_COUNT; i++) {
+		SDFGlyph* glyph = glyphs + i;
+		stbrp_rect* rect = rects + i;
+
+		for(int y=0; y<glyph->height; y++)
+			memcpy(bitmap + (rect->y + y)*dim + rect->x, glyph->pixels + y*glyph->width, glyph->width);
+
+		PackedCharFormat* pc = chars + i;
+		pc->x0 = (u16)rect->x;
+		pc->y0 = (u16)rect->y;
+		pc->x1 = (u16)(rect->x + glyph->width);
+		pc->y1 = (u16)(rect->y + glyph->height);
+		pc->xoff = glyph->xoff;
+		pc->yoff = glyph->yoff;
+		pc->xoff2 = glyph->xoff + glyph->width;
+		pc->yoff2 = glyph->yoff + glyph->height;
+		pc->xadvance = glyph->xadvance;
+
+		free(glyph->pixels);
+	}
+
+	atlas->font_size = SDF_BASE_SIZE;
+	atlas->line_height = (ascent - descent + line_gap)*scale_factor;
+	atlas->width = dim;
+	atlas->height = dim;
+	atlas->first_codepoint = FONT_FIRST_CODEPOINT;
+	atlas->codepoint_count = FONT_CODEPOINT_COUNT;
+	atlas->sdf_padding = SDF_PADDING;
+
+	Assert(sizeof(PackedCharFormat) == sizeof(stbtt_packedchar));
+	atlas->offset_to_packed_chars = PushStructBuffer(chars, FONT_CODEPOINT_COUNT, packed_chars);
+	atlas->offset_to_pixels = PushStructBuffer(bitmap, dim*dim, pixels);
+
+	free(bitmap);
+}
+
+static double
+SecondsSince(LARGE_INTEGER start) {
+	LARGE_INTEGER end, frequency;
+	QueryPerformanceCounter(&end);
+	QueryPerformanceFrequency(&frequency);
+	return (double)(end.QuadPart - start.QuadPart)/(double)frequency.QuadPart;
+}
+
+// Times the scalar and SSE2 generators over every glyph of every font and checks they agree
+static void
+BenchSDF(FolderInfo* folder) {
+	for(u32 i=0; i<folder->file_count; i++) {
+		FileInfo file = folder->files[i];
+		char* path = MakeFullPath(folder->dir, file.name, file.format);
+
+		StructBuffer ttf_buffer = MakeStructBuffer(sizeof(u8));
+		CopyFileToStructBuffer(path, file.size, &ttf_buffer);
+		u8* ttf = (u8*)ttf_buffer.data;
+
+		stbtt_fontinfo font_info;
+		Assert(stbtt_InitFont(&font_info, ttf, stbtt_GetFontOffsetForIndex(ttf, 0)));
+		float scale_factor = stbtt_ScaleForPixelHeight(&font_info, (float)SDF_BASE_SIZE);
+
+		double seconds[2] = {};
+		SDFGlyph glyphs[2][FONT_CODEPOINT_COUNT];
+		for(u32 simd=0; simd<2; simd++) {
+			LARGE_INTEGER start;
+			QueryPerformanceCounter(&start);
+			for(u32 j=0; j<FONT_CODEPOINT_COUNT; j++)
+				glyphs[simd][j] = GenerateGlyphSDF(&font_info, FONT_FIRST_CODEPOINT + j, scale_factor, SDF_PADDING, simd);
+			seconds[simd] = SecondsSince(start);
+		}
+
+		int max_diff = 0;
+		for(u32 j=0; j<FONT_CODEPOINT_COUNT; j++) {
+			SDFGlyph* a = glyphs[0] + j;
+			SDFGlyph* b = glyphs[1] + j;
+			Assert(a->width == b->width && a->height == b->height);
+			for(int k=0; k<a->width*a->height; k++) {
+				int diff = abs((int)a->pixels[k] - (int)b->pixels[k]);
+				if(diff > max_diff) max_diff = diff;
+			}
+			free(a->pixels);
+			free(b->pixels);
+		}
+
+		printf("%s: scalar %.2f ms, sse2 %.2f ms, %.2fx, max texel diff %d\n", file.name,
+				seconds[0]*1000.0, seconds[1]*1000.0, seconds[0]/seconds[1], max_diff);
+		free(ttf_buffer.data);
+	}
+}
+
+// Writes the atlas every font bakes to <font>_sdf.png in the working directory, to look at it
+static void
+DumpSDFAtlases(FolderInfo* folder) {
+	for(u32 i=0; i<folder->file_count; i++) {
+		FileInfo file = folder->files[i];
+		char* path = MakeFullPath(folder->dir, file.name, file.format);
+
+		StructBuffer ttf_buffer = MakeStructBuffer(sizeof(u8));
+		CopyFileToStructBuffer(path, file.size, &ttf_buffer);
+		StructBuffer packed_chars = MakeStructBuffer(sizeof(PackedCharFormat));
+		StructBuffer pixels = MakeStructBuffer(sizeof(u8));
+
+		FontAtlasFormat atlas = {};
+		BakeSDFAtlas((u8*)ttf_buffer.data, &atlas, &packed_chars, &pixels);
+
+		char png_name[256];
+		snprintf(png_name, sizeof(png_name), "%s_sdf.png", file.name);
+		int written = stbi_write_png(png_name, atlas.width, atlas.height, 1, (u8*)pixels.data + atlas.offset_to_pixels,
+				atlas.width);
+		Assert(written);
+		printf("%s: %ux%u\n", png_name, atlas.width, atlas.height);
+
+		free(ttf_buffer.data);
+		free(packed_chars.data);
+		free(pixels.data);
+	}
+}
+
+// usage: asset_packer [output.gaf] [asset_root]
+//        asset_packer -bench_sdf [asset_root]
+//        asset_packer -dump_atlases [asset_root]
 int main(int argc, char** argv) {
+	if(argc > 1 && (strcmp(argv[1], "-bench_sdf") == 0 || strcmp(argv[1], "-dump_atlases") == 0)) {
+		char* asset_root = argc > 2 ? argv[2] : "../assets";
+		FolderInfo folder = LoadFolder(MakeDirPath(asset_root, asset_path_dir[ASSET_TYPE_FONT]), 
+				asset_file_format[ASSET_TYPE_FONT]);
+		if(strcmp(argv[1], "-bench_sdf") == 0) BenchSDF(&folder);
+		else DumpSDFAtlases(&folder);
+		return 0;
+	}
+
+	char* output_name = argc > 1 ? argv[1] : "data.gaf";
+	char* asset_root = argc > 2 ? argv[2] : "../assets";
 
 	StructBuffer struct_buffer[FORMAT_TOTAL] = {};
 	u64 blob_offsets[ASSET_BLOB_TOTAL] = {};
@@ -217,6 +518,7 @@ int main(int argc, char** argv) {
 		StructBuffer* gaff_buffer = &struct_buffer[FORMAT_GAME_ASSET_FILE];
 		GameAssetFile gaff = {};
 		strcpy(gaff.identification, "gaff");
+		gaff.version = GAF_VERSION;
 		gaff.number_of_blobs = ASSET_BLOB_TOTAL;
 		PushStructBuffer(&gaff, 1, gaff_buffer);
 	}
@@ -235,11 +537,11 @@ int main(int argc, char** argv) {
 
 		TexturesBlob textures_blob = {};
 
-		char* dir = asset_path_dir[ASSET_TYPE_TEXTURE];
+		char* dir = MakeDirPath(asset_root, asset_path_dir[ASSET_TYPE_TEXTURE]);
 		char* file_format = asset_file_format[ASSET_TYPE_TEXTURE];
 		FolderInfo folder = LoadFolder(dir, file_format);
 
-		for(u8 i=0; i<folder.file_count; i++) {
+		for(u32 i=0; i<folder.file_count; i++) {
 			FileInfo file = folder.files[i];
 			char* path = MakeFullPath(folder.dir, file.name, file.format);
 			int x, y, n;
@@ -269,9 +571,12 @@ int main(int argc, char** argv) {
 	{
 		StructBuffer* ab_fonts_blob = &struct_buffer[FORMAT_FONTS_BLOB];
 		StructBuffer* ab_font = &struct_buffer[FORMAT_FONT];
+		StructBuffer* ab_font_atlas = &struct_buffer[FORMAT_FONT_ATLAS];
+		StructBuffer* ab_packed_char = &struct_buffer[FORMAT_PACKED_CHAR];
+		StructBuffer* ab_font_pixels = &struct_buffer[FORMAT_FONT_PIXELS];
 		StructBuffer* ab_ttf = &struct_buffer[FORMAT_TTF];
 
-		char* dir = asset_path_dir[ASSET_TYPE_FONT];
+		char* dir = MakeDirPath(asset_root, asset_path_dir[ASSET_TYPE_FONT]);
 		char* file_format = asset_file_format[ASSET_TYPE_FONT];
 		FolderInfo folder = LoadFolder(dir, file_format);
 
@@ -279,7 +584,7 @@ int main(int argc, char** argv) {
 		fonts_blob.fonts_count = folder.file_count;
 
 		// Loading cgltf data
-		for(u8 i=0; i<folder.file_count; i++) {
+		for(u32 i=0; i<folder.file_count; i++) {
 			FileInfo file = folder.files[i];
 			char* path = MakeFullPath(folder.dir, file.name, file.format);
 
@@ -290,11 +595,20 @@ int main(int argc, char** argv) {
 			font_format.offset_to_data = GetOffsetStructBuffer(ab_ttf);
 			CopyFileToStructBuffer(path, file.size, ab_ttf);
 
+			u8* ttf = (u8*)ab_ttf->data + font_format.offset_to_data;
+			FontAtlasFormat atlas = {};
+			BakeSDFAtlas(ttf, &atlas, ab_packed_char, ab_font_pixels);
+			font_format.atlas_count = 1;
+			font_format.offset_to_atlases = PushStructBuffer(&atlas, 1, ab_font_atlas);
+
 			PushStructBuffer(&font_format, 1, ab_font);
 		}
 		PushStructBuffer(&fonts_blob, 1, ab_fonts_blob);
 		blob_offsets[ASSET_BLOB_FONTS] = GetOffsetStructBuffer(ab_fonts_blob) +
 																			GetOffsetStructBuffer(ab_font) +
+																			GetOffsetStructBuffer(ab_font_atlas) +
+																			GetOffsetStructBuffer(ab_packed_char) +
+																			GetOffsetStructBuffer(ab_font_pixels) +
 																			GetOffsetStructBuffer(ab_ttf);
 	}
 	{	// Loading Models
@@ -306,12 +620,12 @@ int main(int argc, char** argv) {
 
 		MeshesBlob meshes_blob = {};
 
-		char* dir = asset_path_dir[ASSET_TYPE_MODEL];
+		char* dir = MakeDirPath(asset_root, asset_path_dir[ASSET_TYPE_MODEL]);
 		char* file_format = asset_file_format[ASSET_TYPE_MODEL];
 		FolderInfo folder = LoadFolder(dir, file_format);
 
 		// Loading cgltf data
-		for(u8 i=0; i<folder.file_count; i++) {
+		for(u32 i=0; i<folder.file_count; i++) {
 			FileInfo file = folder.files[i];
 			char* path = MakeFullPath(folder.dir, file.name, file.format);
 
@@ -344,6 +658,8 @@ int main(int argc, char** argv) {
 					PushStructBuffer(&index, 1, ab_index_buffer_u32);
 				}
 				mesh_format.vertex_buffer_count = 0;
+				u64 offset_to_positions = 0;
+				bool has_positions = false;
 
 				for(u8 k=0; k<prim->attributes_count; k++) {
 					cgltf_attribute* att = prim->attributes + k;
@@ -360,6 +676,8 @@ int main(int argc, char** argv) {
 							VertexBufferFormat vbf = {};
 							strcpy(vbf.type, vertex_buffer_names[VERTEX_BUFFER_POSITION]);
 							vbf.offset_to_data = GetOffsetStructBuffer(ab_vertex_buffer_float);
+							offset_to_positions = vbf.offset_to_data;
+							has_positions = true;
 
 							ReserveMemoryStructBuffer(float_count, ab_vertex_buffer_float);
 							cgltf_accessor_unpack_floats(acc, (float*)GetCursorStructBuffer(ab_vertex_buffer_float), float_count);
@@ -399,6 +717,17 @@ int main(int argc, char** argv) {
 						} break;
 					}
 				}
+				Assert(has_positions);
+				u32 hull[MAX_MESH_HULL_POINTS];
+				float* positions = (float*)((u8*)ab_vertex_buffer_float->data + offset_to_positions);
+				ComputeMeshBounds(positions, mesh_format.vertices_count, &mesh_format, hull);
+
+				float hull_points[MAX_MESH_HULL_POINTS*3];
+				for(u32 k=0; k<mesh_format.hull_count; k++)
+					memcpy(hull_points + k*3, positions + hull[k]*3, sizeof(float)*3);
+				mesh_format.offset_to_hull = GetOffsetStructBuffer(ab_vertex_buffer_float);
+				PushStructBuffer(hull_points, mesh_format.hull_count*3, ab_vertex_buffer_float);
+
 				PushStructBuffer(&mesh_format, 1, ab_mesh);
 			}
 		}
@@ -413,7 +742,7 @@ int main(int argc, char** argv) {
 		GenericBuffer gb_file = {};
 		{
 			// Stitching up all buffers
-			u32 offset = 0;
+			u64 offset = 0;
 			for(u8 i=0; i<FORMAT_TOTAL; i++) gb_file.total_size += struct_buffer[i].elem_size * struct_buffer[i].filled_count;
 			gb_file.data = calloc(gb_file.total_size, sizeof(u8));
 
@@ -425,7 +754,7 @@ int main(int argc, char** argv) {
 			WriteStructBufferToGenericBuffer(&gb_file, &struct_buffer[FORMAT_GAME_ASSET_FILE]);
 
 			offset += GetOffsetStructBuffer(&struct_buffer[FORMAT_DIRECTORY]);
-			u32 blob_offset = 0;
+			u64 blob_offset = 0;
 			for(u32 i=0; i<struct_buffer[FORMAT_DIRECTORY].filled_count; i++) {
 				Directory* dir = (Directory*)GetElementStructBuffer(&struct_buffer[FORMAT_DIRECTORY], i);
 				dir->offset_to_blob += offset + blob_offset;
@@ -444,9 +773,10 @@ int main(int argc, char** argv) {
 			for(u32 i=0; i<struct_buffer[FORMAT_MESH].filled_count; i++) {
 				MeshFormat* mf = (MeshFormat*)GetElementStructBuffer(&struct_buffer[FORMAT_MESH], i);
 				mf->offset_to_vertex_buffers += offset;
-				u32 offset_vb = GetOffsetStructBuffer(&struct_buffer[FORMAT_VERTEX_BUFFER]);
-				u32 offset_vb_float = GetOffsetStructBuffer(&struct_buffer[FORMAT_VERTEX_BUFFER_FLOAT]);
+				u64 offset_vb = GetOffsetStructBuffer(&struct_buffer[FORMAT_VERTEX_BUFFER]);
+				u64 offset_vb_float = GetOffsetStructBuffer(&struct_buffer[FORMAT_VERTEX_BUFFER_FLOAT]);
 				mf->offset_to_indices += offset + offset_vb + offset_vb_float;
+				mf->offset_to_hull += offset + offset_vb;
 			}
 			WriteStructBufferToGenericBuffer(&gb_file, &struct_buffer[FORMAT_MESH]);
 
@@ -490,10 +820,29 @@ int main(int argc, char** argv) {
 			offset += GetOffsetStructBuffer(&struct_buffer[FORMAT_FONT]);
 			for(u32 i=0; i<struct_buffer[FORMAT_FONT].filled_count; i++) {
 				FontFormat* tf = (FontFormat*)GetElementStructBuffer(&struct_buffer[FORMAT_FONT], i);
-				tf->offset_to_data += offset;
+				u64 offset_atlas = GetOffsetStructBuffer(&struct_buffer[FORMAT_FONT_ATLAS]);
+				u64 offset_packed_char = GetOffsetStructBuffer(&struct_buffer[FORMAT_PACKED_CHAR]);
+				u64 offset_font_pixels = GetOffsetStructBuffer(&struct_buffer[FORMAT_FONT_PIXELS]);
+				tf->offset_to_data += offset + offset_atlas + offset_packed_char + offset_font_pixels;
+				tf->offset_to_atlases += offset;
 			}
 			WriteStructBufferToGenericBuffer(&gb_file, &struct_buffer[FORMAT_FONT]);
 
+			offset += GetOffsetStructBuffer(&struct_buffer[FORMAT_FONT_ATLAS]);
+			for(u32 i=0; i<struct_buffer[FORMAT_FONT_ATLAS].filled_count; i++) {
+				FontAtlasFormat* fa = (FontAtlasFormat*)GetElementStructBuffer(&struct_buffer[FORMAT_FONT_ATLAS], i);
+				u64 offset_packed_char = GetOffsetStructBuffer(&struct_buffer[FORMAT_PACKED_CHAR]);
+				fa->offset_to_packed_chars += offset;
+				fa->offset_to_pixels += offset + offset_packed_char;
+			}
+			WriteStructBufferToGenericBuffer(&gb_file, &struct_buffer[FORMAT_FONT_ATLAS]);
+
+			offset += GetOffsetStructBuffer(&struct_buffer[FORMAT_PACKED_CHAR]);
+			WriteStructBufferToGenericBuffer(&gb_file, &struct_buffer[FORMAT_PACKED_CHAR]);
+
+			offset += GetOffsetStructBuffer(&struct_buffer[FORMAT_FONT_PIXELS]);
+			WriteStructBufferToGenericBuffer(&gb_file, &struct_buffer[FORMAT_FONT_PIXELS]);
+
 			offset += GetOffsetStructBuffer(&struct_buffer[FORMAT_TTF]);
 			WriteStructBufferToGenericBuffer(&gb_file, &struct_buffer[FORMAT_TTF]);
 
@@ -501,12 +850,20 @@ int main(int argc, char** argv) {
 		}
 		//------------------------------------------------------------------------
 		{ // Writing to File
-			HANDLE h = CreateFileA("data.gaf", GENERIC_WRITE, 0, 0, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, 0);
+			HANDLE h = CreateFileA(output_name, GENERIC_WRITE, 0, 0, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, 0);
 			Assert(h != INVALID_HANDLE_VALUE);
 
-			DWORD bytes_written = 0;
-			Assert(WriteFile(h, gb_file.data, gb_file.filled_size, &bytes_written, 0));
-			Assert(bytes_written == gb_file.filled_size);
+			u8* cursor = (u8*)gb_file.data;
+			u64 remaining = gb_file.filled_size;
+			while(remaining) {
+				DWORD chunk = remaining > MAX_IO_CHUNK ? MAX_IO_CHUNK : (DWORD)remaining;
+				DWORD bytes_written = 0;
+				Assert(WriteFile(h, cursor, chunk, &bytes_written, 0));
+				Assert(bytes_written == chunk);
+				cursor += chunk;
+				remaining -= chunk;
+			}
+			CloseHandle(h);
 
 		}
 		return 1;